@@ -27,9 +27,30 @@ Author(s) / Copyright (s): Damon Hart-Davis 2015--2016
 #include "utility/OTRadioLink_FrameType.h"
 #include "utility/OTRadioLink_SecureableFrameType.h"
 
+// Batched secure frame decoding at a hub (not AVR).
+#include "utility/OTRadioLink_SecureFrameBatch.h"
+
+// Replay protection for received secure frames.
+#include "utility/OTRadioLink_ReplayFilter.h"
+
 // Radio Link base class definition.
 #include "utility/OTRadioLink_OTRadioLink.h"
 
+// TX airtime accounting against duty-cycle limits.
+#include "utility/OTRadioLink_TXDutyCycle.h"
+
+// ISR-safe queues of received frames.
+#include "utility/OTRadioLink_ISRRXQueue.h"
+
+// Compile-time chains of quick RX frame filters.
+#include "utility/OTRadioLink_FrameFilterChain.h"
+
+// Quick RX prefilters on sender ID.
+#include "utility/OTRadioLink_RXIDPrefilter.h"
+
+// Multiplexer over several radio links, eg at a hub.
+#include "utility/OTRadioLink_RadioMux.h"
+
 // Radio Link Null class definition.
 #include "utility/OTRadioLink_OTNullRadioLink.h"
 
@@ -73,6 +73,8 @@ Author(s) / Copyright (s): Damon Hart-Davis 2015--2016
 // Power, micro timing, I/O management and other misc support.
 #include "utility/OTV0P2BASE_Sleep.h"
 #include "utility/OTV0P2BASE_PowerManagement.h"
+// Worst-case CPU cycle costs of hot routines vs the sub-cycle budget.
+#include "utility/OTV0P2BASE_CycleProfile.h"
 
 // Software Real-Time Clock (RTC) support.
 #include "utility/OTV0P2BASE_RTC.h"
@@ -168,7 +168,80 @@ if(!isOK) { V0P2BASE_DEBUG_SERIAL_PRINTLN_FLASHSTRING("RFM23 bad"); }
     return(isOK);
     }
 
+// Record that val has been written to the register; no-op if the register is not shadowed.
+void OTRFM23BLinkBase::_regShadowNote(const uint8_t addr, const uint8_t val) const
+    {
+    const uint8_t slot = _regShadowSlot(addr);
+    if(0xff == slot) { return; }
+    // Lock out interrupts as the RX ISR may also fill the shadow.
+    ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+        {
+        regShadow[slot] = val;
+        regShadowValid |= (uint16_t)(1U << slot);
+        }
+    }
+
+// Forget all shadowed values, eg after a reset of the radio.
+void OTRFM23BLinkBase::_regShadowInvalidate() const
+    {
+    ATOMIC_BLOCK (ATOMIC_RESTORESTATE) { regShadowValid = 0; }
+    }
+
+// Write to 8-bit register on RFM23B unless the shadow shows that it already holds val.
+void OTRFM23BLinkBase::_writeRegCached_(const uint8_t addr, const uint8_t val)
+    {
+    if(_regShadowHolds(addr, val)) { return; }
+    _writeReg8Bit_(addr, val);
+    _regShadowNote(addr, val);
+    }
+
+// Read from 8-bit register on RFM23B, from the shadow if possible.
+uint8_t OTRFM23BLinkBase::_readRegCached_(const uint8_t addr) const
+    {
+    const uint8_t slot = _regShadowSlot(addr);
+    const bool cached = (0xff != slot) && (0 != (regShadowValid & (1U << slot)));
+    if(cached && !regShadowVerify) { return(regShadow[slot]); }
+    const bool neededEnable = _upSPI_();
+    const uint8_t val = _readReg8Bit_(addr);
+    if(neededEnable) { _downSPI_(); }
+    if(cached && (val != regShadow[slot])) { ++regShadowMismatchCountRecent; }
+    _regShadowNote(addr, val);
+    return(val);
+    }
+
+// Check all currently-shadowed registers against the radio,
+// counting and dropping any that do not match; returns the number of mismatches.
+uint8_t OTRFM23BLinkBase::verifyRegShadow()
+    {
+    static const uint8_t shadowed[REG_SHADOW_SLOTS] =
+        {
+        REG_INT_ENABLE1, REG_INT_ENABLE2, REG_30_DATA_ACCESS_CONTROL, REG_33_HEADER_CONTROL2,
+        REG_34_PREAMBLE_LENGTH, REG_3E_PACKET_LENGTH, REG_6E_TX_DATA_RATE1, REG_6F_TX_DATA_RATE0,
+        REG_70_MODULATION_CONTROL1, REG_RX_FIFO_CTRL, REG_7D_TX_FIFO_CTRL2,
+        };
+    uint8_t mismatches = 0;
+    ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+        {
+        const bool neededEnable = _upSPI_();
+        for(uint8_t i = 0; i < REG_SHADOW_SLOTS; ++i)
+            {
+            const uint8_t addr = shadowed[i];
+            const uint8_t slot = _regShadowSlot(addr);
+            if(0 == (regShadowValid & (1U << slot))) { continue; }
+            if(_readReg8Bit_(addr) == regShadow[slot]) { continue; }
+            regShadowValid &= (uint16_t)~(1U << slot);
+            ++mismatches;
+            }
+        if(neededEnable) { _downSPI_(); }
+        }
+    regShadowMismatchCountRecent += mismatches;
+    return(mismatches);
+    }
+
 // Configure the radio from a list of register/value pairs in readonly PROGMEM/Flash, terminating with an 0xff register value.
+// Runs of consecutive register addresses are written as single SPI bursts
+// (the RFM23B auto-increments the address within a burst),
+// saving the select/deselect and address byte for all but the first register of each run.
 // NOTE: argument is not a pointer into SRAM, it is into PROGMEM!
 void OTRFM23BLinkBase::_registerBlockSetup(const uint8_t registerValues[][2])
     {
@@ -176,6 +249,8 @@ void OTRFM23BLinkBase::_registerBlockSetup(const uint8_t registerValues[][2])
     ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
         {
         const bool neededEnable = _upSPI_();
+        // Address the open burst would write next; 0xff if no burst is open.
+        uint8_t next = 0xff;
         for( ; ; )
             {
             const uint8_t reg = pgm_read_byte(&(registerValues[0][0]));
@@ -188,9 +263,19 @@ void OTRFM23BLinkBase::_registerBlockSetup(const uint8_t registerValues[][2])
             V0P2BASE_DEBUG_SERIAL_PRINTFMT(val, HEX);
             V0P2BASE_DEBUG_SERIAL_PRINTLN();
 #endif
-            _writeReg8Bit_(reg, val);
+            if(reg != next)
+                {
+                // Start a new burst at this register.
+                if(0xff != next) { _DESELECT_(); }
+                _SELECT_();
+                _wr(reg | 0x80); // Force to write.
+                }
+            _wr(val);
+            _regShadowNote(reg, val);
+            next = reg + 1;
             ++registerValues;
             }
+        if(0xff != next) { _DESELECT_(); }
         if(neededEnable) { _downSPI_(); }
         }
     }
@@ -218,10 +303,17 @@ void OTRFM23BLinkBase::_queueFrameInTXFIFO(const uint8_t *bptr, uint8_t buflen)
         // Clear the TX FIFO.
         _clearTXFIFO();
 
+        // Load as much as fits, leaving any more to be streamed in.
+        txStreamFrame = bptr;
+        txStreamLen = buflen;
+        const uint8_t n = (buflen > FIFO_BYTES) ? FIFO_BYTES : buflen;
+        txStreamNext = bptr + n;
+        txStreamLeft = buflen - n;
+
         // Select RFM23B for duration of batch/burst write.
         _SELECT_();
         _wr(REG_FIFO | 0x80); // Start burst write to TX FIFO.
-        while(buflen-- > 0) { _wr(*bptr++); }
+        for(uint8_t i = n; i-- > 0; ) { _wr(*bptr++); }
         // Burst write finished; deselect RFM23B.
         _DESELECT_();
 
@@ -229,50 +321,116 @@ void OTRFM23BLinkBase::_queueFrameInTXFIFO(const uint8_t *bptr, uint8_t buflen)
         }
     }
 
-// Transmit contents of on-chip TX FIFO: caller should revert to low-power standby mode (etc) if required.
-// Returns true if packet apparently sent correctly/fully.
-// Does not clear TX FIFO (so possible to re-send immediately).
-bool OTRFM23BLinkBase::_TXFIFO()
+// Refill the TX FIFO from the rest of a streamed frame.
+void OTRFM23BLinkBase::_TXStreamRefill()
     {
-    const bool neededEnable = _upSPI_();
+    uint8_t n = txStreamLeft;
+    if(0 == n) { return; }
+    // At most TX_STREAM_ALMOST_EMPTY bytes are still in the TX FIFO.
+    if(n > FIFO_BYTES - TX_STREAM_ALMOST_EMPTY) { n = FIFO_BYTES - TX_STREAM_ALMOST_EMPTY; }
+    const uint8_t *bptr = txStreamNext;
+    _SELECT_();
+    _wr(REG_FIFO | 0x80); // Start burst write to TX FIFO.
+    for(uint8_t i = n; i-- > 0; ) { _wr(*bptr++); }
+    _DESELECT_();
+    txStreamNext = bptr;
+    txStreamLeft -= n;
+    // Frame all in: no more almost-empty interrupts needed, just packet-sent.
+    if(0 == txStreamLeft) { _writeRegCached_(REG_INT_ENABLE1, RFM23B_ENPKSENT); }
+    }
+
+// Check for the packet-sent status of the current TX, refilling the TX FIFO if streaming.
+bool OTRFM23BLinkBase::_TXCheckSent()
+    {
+    ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+        {
+        // Reading the status clears it, so note packet-sent for whichever of the ISR or TX poll sees it.
+        const uint8_t status = _readReg8Bit_(REG_INT_STATUS1);
+        if(status & (RFM23B_ITXFFAEM >> 8)) { _TXStreamRefill(); }
+        if(status & (RFM23B_IPKSENT >> 8)) { txPacketSent = true; txInProgress = false; }
+        }
+    return(txPacketSent);
+    }
 
+// Read (drain) n bytes from the RX FIFO without changing mode.
+void OTRFM23BLinkBase::_RXFIFODrain(uint8_t *buf, const uint8_t n)
+    {
+    _SELECT_();
+    _io(REG_FIFO & 0x7F);
+    for(uint8_t i = n; i-- > 0; ) { *buf++ = _io(0); }
+    _DESELECT_();
+    }
+
+// Start transmitting the contents of the on-chip TX FIFO, with all radio interrupts disabled
+// except packet-sent (and TX FIFO almost-empty while streaming).
+// SPI must already be configured and running.
+void OTRFM23BLinkBase::_TXFIFOStart()
+    {
     // Lock out interrupts while fiddling with interrupts and starting the TX.
     ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
         {
     //    // Enable interrupt on packet send ONLY.
     //    _writeReg8Bit_(REG_INT_ENABLE1, 4);
     //    _writeReg8Bit_(REG_INT_ENABLE2, 0);
-        // Disable all interrupts (eg to avoid invoking the RX ISR).
-        _writeReg8Bit_(REG_INT_ENABLE1, 0);
-        _writeReg8Bit_(REG_INT_ENABLE2, 0);
+        // Reload the start of a streamed frame whose rest has already gone into the TX FIFO.
+        if((txStreamLen > FIFO_BYTES) && (txStreamLeft != (uint8_t)(txStreamLen - FIFO_BYTES)))
+            { _queueFrameInTXFIFO(txStreamFrame, txStreamLen); }
+        txPacketSent = false;
+        txInProgress = true;
+        txTimeoutTicks = _getTXTimeoutTicks_(txStreamLen);
+        // Disable all interrupts (eg to avoid invoking the RX ISR) except packet-sent to wake the CPU,
+        // and TX FIFO almost-empty to stream in the rest of a long frame.
+        if(0 != txStreamLeft) { _writeRegCached_(REG_7D_TX_FIFO_CTRL2, TX_STREAM_ALMOST_EMPTY); }
+        _writeRegCached_(REG_INT_ENABLE1, RFM23B_ENPKSENT | ((0 != txStreamLeft) ? RFM23B_ENTXFFAEM : 0));
+        _writeRegCached_(REG_INT_ENABLE2, 0);
         _clearInterrupts_();
         // Enable TX mode and transmit TX FIFO contents.
         _modeTX_();
         }
+    }
 
-    // RFM23B data sheet claims up to 800uS from standby to TX; be conservative,
-    //::OTV0P2BASE::_delay_x4(250); // Spin CPU for ~1ms; does not depend on timer1, etc.
-    OTV0P2BASE_busy_spin_delay(1000);
+// Transmit contents of on-chip TX FIFO: caller should revert to low-power standby mode (etc) if required.
+// Returns true if packet apparently sent correctly/fully, false if not seen to complete within its timeout.
+// Does not clear TX FIFO (so possible to re-send immediately).
+bool OTRFM23BLinkBase::_TXFIFO()
+    {
+    bool neededEnable;
+    // Profile only the CPU work of starting TX, not the nap/sleep waiting for it to finish.
+        {
+        OTV0P2BASE_CYCLE_PROFILE_SCOPE(OTV0P2BASE::CPP_RFM23B_TXFIFO);
+        neededEnable = _upSPI_();
+        _TXFIFOStart();
+        if(neededEnable) { _downSPI_(); }
+        }
+    const uint8_t start = OTV0P2BASE::getSubCycleTime();
+
+    // Backstop should the sub-cycle timer stop (eg its crystal fail): the same timeout, in 100us units,
+    // counted down by each wait below at no more than its minimum length.
+    uint16_t backstop = (uint16_t)((uint16_t)txTimeoutTicks * OTV0P2BASE::SUBCYCLE_TICK_MS_RD * 10);
 
-    // Repeatedly nap until packet sent, with upper bound of ~120ms on TX time in case there is a problem.
+    // Wait for the packet-sent status, with an upper bound on TX time from the frame's airtime in case there is a problem.
     // (TX time is ~1.6ms per byte at 5000bps.)
     // DO NOT block interrupts while waiting for TX to complete!
     // Status is failed until RFM23B gives positive confirmation of frame sent.
-    bool result = false;
-    // Spin until TX complete or timeout.
-    for(int i = MAX_TX_ms; --i >= 0; )
+    for( ; ; )
         {
-        // Spin CPU for ~1ms; does not depend on timer1, delay(), millis(), etc, Arduino support.
-//        ::OTV0P2BASE::_delay_x4(250);
-        // RFM23B probably unlikely to exceed 80kbps, thus at least 100uS per byte, so no point sleeping much less.
-        OTV0P2BASE_busy_spin_delay(100);
-        // FIXME: don't have nap() support yet // nap(WDTO_15MS, true); // Sleep in low power mode for a short time waiting for bits to be sent...
-        const uint8_t status = _readReg8Bit_(REG_INT_STATUS1); // TODO: could use nIRQ instead if available.
-        if(status & 4) { result = true; break; } // Packet sent!
+        neededEnable = _upSPI_();
+        const bool sent = _TXCheckSent();
+        if(neededEnable) { _downSPI_(); }
+        if(sent) { return(true); } // Packet sent!
+        if((uint8_t)(OTV0P2BASE::getSubCycleTime() - start) > txTimeoutTicks) { return(false); } // ERROR: timed out.
+        if(0 == backstop) { return(false); } // ERROR: timed out without the sub-cycle timer.
+        // With nIRQ wired, sleep until the packet-sent (or TX FIFO almost-empty) interrupt;
+        // the watchdog bounds each sleep, so an interrupt that races ahead of the nap only delays the next check.
+        // A full nap counts as 15ms, one cut short by an interrupt as 1ms.
+        if(hasIRQ)
+            {
+            const uint8_t waited = ::OTV0P2BASE::nap(WDTO_15MS, true) ? 150 : 10;
+            backstop = (backstop > waited) ? (uint16_t)(backstop - waited) : 0;
+            }
+        // Else poll: RFM23B probably unlikely to exceed 80kbps, thus at least 100uS per byte, so no point spinning much less.
+        else { OTV0P2BASE_busy_spin_delay(100); --backstop; }
         }
-
-    if(neededEnable) { _downSPI_(); }
-    return(result);
     }
 
 // Send/TX a raw frame on the specified (default first/0) channel.
@@ -290,33 +448,33 @@ bool OTRFM23BLinkBase::_TXFIFO()
 // May block to transmit (eg to avoid copying the buffer).
 bool OTRFM23BLinkBase::sendRaw(const uint8_t *const buf, const uint8_t buflen, const int8_t channel, const TXpower power, const bool listenAfter)
     {
-    // FIXME: ignores channel entirely.
     // FIXME: currently ignores all hints.
+    if(buflen > maxFrameLen) { return(false); } // ERROR
 
     // Should not need to lock out interrupts while sending
     // as no poll()/ISR should start until this completes,
     // but will need to stop any RX in process,
     // eg to avoid TX FIFO buffer being zapped during RX handling.
+    _TXLoadFrame(buf, buflen, channel);
 
-    // Disable all interrupts (eg to avoid invoking the RX handler).
-    _modeStandbyAndClearState_();
-    
-    _setChannel(channel);
- 
-    // Load the frame into the TX FIFO.
-    _queueFrameInTXFIFO(buf, buflen);
-    
-    // Channel 0 is alsways GFSK
-    // Move this into _TXFIFO
-    const bool neededEnable = _upSPI_();
-
-    // Check if packet handling in RFM23B is enabled and set packet length
-    if ( _readReg8Bit_(REG_30_DATA_ACCESS_CONTROL) & RFM23B_ENPACTX )  {
-       _writeReg8Bit_(REG_3E_PACKET_LENGTH, buflen); 
-    }
+    // Check the duty-cycle budget for all the TXs to be made, then listen before talking.
+    bool neededEnable = _upSPI_();
+    const uint16_t airtime = _getTXAirtimeMs_(buflen);
+    const bool allowed = _TXAllowed(channel, (power >= TXmax) ? 2*airtime : airtime);
+    bool clear = allowed && _channelClear_();
     if(neededEnable) { _downSPI_(); }
+    // While the channel is busy back off for a random 1--4 naps (~15--60ms) and listen again.
+    for(uint8_t tries = 1; allowed && !clear && (tries < LBT_MAX_TRIES); ++tries)
+        {
+        for(uint8_t n = 1 + (::OTV0P2BASE::randRNG8() & 3); n-- > 0; ) { ::OTV0P2BASE::nap(WDTO_15MS); }
+        neededEnable = _upSPI_();
+        clear = _channelClear_();
+        if(neededEnable) { _downSPI_(); }
+        }
+    if(!clear) { _dolisten(); return(false); } // ERROR
 
     // Send the frame once.
+    if(NULL != txDutyCycle) { txDutyCycle->record(channel, airtime); }
     bool result = _TXFIFO();
     // For maximum 'power' attempt to resend the frame again after a short delay.
     if(power >= TXmax)
@@ -330,6 +488,7 @@ bool OTRFM23BLinkBase::sendRaw(const uint8_t *const buf, const uint8_t buflen, c
 #endif
 
         // Resend the frame.
+        if(NULL != txDutyCycle) { txDutyCycle->record(channel, airtime); }
         if(!_TXFIFO()) { result = false; }
         }
     // TODO: listen-after-send if requested.
@@ -340,11 +499,184 @@ bool OTRFM23BLinkBase::sendRaw(const uint8_t *const buf, const uint8_t buflen, c
     return(result);
     }
 
+// Stop any RX, select the channel and load the frame into the TX FIFO ready to send.
+void OTRFM23BLinkBase::_TXLoadFrame(const uint8_t *const buf, const uint8_t buflen, const int8_t channel)
+    {
+    // Disable all interrupts (eg to avoid invoking the RX handler).
+    _modeStandbyAndClearState_();
+
+    _setChannel(channel);
+
+    // Load the frame into the TX FIFO.
+    _queueFrameInTXFIFO(buf, buflen);
+
+    // Channel 0 is alsways GFSK
+    // Move this into _TXFIFO
+    const bool neededEnable = _upSPI_();
+
+    // Check if packet handling in RFM23B is enabled and set packet length
+    if ( _readRegCached_(REG_30_DATA_ACCESS_CONTROL) & RFM23B_ENPACTX )  {
+       _writeRegCached_(REG_3E_PACKET_LENGTH, buflen);
+    }
+    if(neededEnable) { _downSPI_(); }
+    }
+
+// TX bitrate (bps) of the current configuration, from the data rate registers.
+uint32_t OTRFM23BLinkBase::_getTXBitrate_() const
+    {
+    const uint16_t txdr = ((uint16_t)_readRegCached_(REG_6E_TX_DATA_RATE1) << 8) | _readRegCached_(REG_6F_TX_DATA_RATE0);
+    // bps = txdr * 1MHz / 2^16, or / 2^21 when scaled for low rates (below 30kbps).
+    const uint8_t shift = (_readRegCached_(REG_70_MODULATION_CONTROL1) & RFM23B_TXDTRTSCALE) ? 21 : 16;
+    // 1MHz is 15625 * 2^6, which keeps the product within 32 bits.
+    return(((uint32_t)txdr * 15625U) >> (shift - 6));
+    }
+
+// Approximate airtime (ms) of one TX of a frame of buflen bytes with the current configuration.
+uint16_t OTRFM23BLinkBase::_getTXAirtimeMs_(const uint8_t buflen) const
+    {
+    uint16_t bytes = buflen;
+    const uint8_t dac = _readRegCached_(REG_30_DATA_ACCESS_CONTROL);
+    if(dac & RFM23B_ENPACTX)
+        {
+        // Packet handler adds preamble (in nibbles), sync word, header, any length byte and any CRC.
+        const uint8_t hc2 = _readRegCached_(REG_33_HEADER_CONTROL2);
+        bytes += (_readRegCached_(REG_34_PREAMBLE_LENGTH) + 1) / 2;
+        bytes += ((hc2 >> 1) & 3) + 1;
+        bytes += (hc2 >> 4) & 7;
+        if(!(hc2 & RFM23B_FIXPKLEN)) { ++bytes; }
+        if(dac & RFM23B_CRCON) { bytes += 2; }
+        }
+    return(::OTRadioLink::TXDutyCycle::airtimeMs(bytes * 8, _getTXBitrate_()));
+    }
+
+// Sub-cycle ticks to allow for one TX of a frame of buflen bytes before giving up.
+uint8_t OTRFM23BLinkBase::_getTXTimeoutTicks_(const uint8_t buflen) const
+    {
+    const uint16_t airtime = _getTXAirtimeMs_(buflen);
+    // Bitrate unknown: allow the maximum.
+    if(0 == airtime) { return(MAX_TX_TICKS); }
+    const uint32_t ms = (uint32_t)airtime + (airtime / 4) + TX_TIMEOUT_MARGIN_MS;
+    // Round up, and allow for the partial tick at each end.
+    const uint32_t ticks = (ms + OTV0P2BASE::SUBCYCLE_TICK_MS_RD - 1) / OTV0P2BASE::SUBCYCLE_TICK_MS_RD + 1;
+    return((ticks > MAX_TX_TICKS) ? MAX_TX_TICKS : (uint8_t)ticks);
+    }
+
+// True if the duty-cycle budget (if any) allows the given airtime on the channel, else counts a refusal.
+bool OTRFM23BLinkBase::_TXAllowed(const int8_t channel, const uint16_t airtimeMs)
+    {
+    if((NULL == txDutyCycle) || txDutyCycle->allows(channel, airtimeMs)) { return(true); }
+    ++txDutyCycleRefusedCountRecent;
+    return(false);
+    }
+
+// Clear-channel assessment on the current channel.
+bool OTRFM23BLinkBase::_channelClear_()
+    {
+    if(0 == lbtRSSIThreshold) { return(true); }
+    _modeRX_();
+    // Allow the receiver to tune and its AGC to settle (~1ms).
+    OTV0P2BASE_busy_spin_delay(1000);
+    const uint8_t rssi = _readReg8Bit_(REG_RSSI);
+    _modeStandby_();
+    if(rssi < lbtRSSIThreshold) { return(true); }
+    ++txChannelBusyCountRecent;
+    return(false);
+    }
+
+// Start sending a frame from the TX queue without waiting for it to go.
+// At TXmax the frame is sent again after a gap of TX_REPEAT_GAP_TICKS.
+// Fails at once if the duty-cycle budget would be exceeded;
+// waits for a random backoff (without blocking) while the channel is busy.
+bool OTRFM23BLinkBase::_TXstart(const uint8_t *const buf, const uint8_t buflen, const int8_t channel, const uint8_t power)
+    {
+    if(buflen > maxFrameLen) { return(false); } // ERROR
+    // Suspend RX polling first so that the ISR leaves the radio alone.
+    txAsyncState = TXA_SENDING;
+    _TXLoadFrame(buf, buflen, channel);
+    txAsyncRepeats = (power >= TXmax) ? 1 : 0;
+    txAsyncChannel = channel;
+    txAsyncTries = 0;
+    const bool neededEnable = _upSPI_();
+    txAsyncAirtime = _getTXAirtimeMs_(buflen);
+    const bool allowed = _TXAllowed(channel, (uint16_t)(txAsyncAirtime * (1 + txAsyncRepeats)));
+    const bool clear = allowed && _channelClear_();
+    if(clear)
+        {
+        if(NULL != txDutyCycle) { txDutyCycle->record(channel, txAsyncAirtime); }
+        _TXFIFOStart();
+        }
+    if(neededEnable) { _downSPI_(); }
+    txAsyncTick = OTV0P2BASE::getSubCycleTime();
+    if(!allowed) { txAsyncState = TXA_IDLE; _dolisten(); return(false); } // ERROR
+    if(!clear) { txAsyncState = TXA_BACKOFF; txAsyncTries = 1; txAsyncBackoff = _LBTBackoffTicks(); }
+    return(true);
+    }
+
+// Check the progress of the frame from _TXstart(), from the packet-sent status,
+// with a timeout from the frame's airtime; reverts to listening if enabled when done.
+uint8_t OTRFM23BLinkBase::_TXpoll()
+    {
+    const uint8_t now = OTV0P2BASE::getSubCycleTime();
+    const uint8_t elapsed = (uint8_t)(now - txAsyncTick);
+    if(TXA_IDLE == txAsyncState) { return(TXS_FAILED); } // ERROR
+    const bool neededEnable = _upSPI_();
+    uint8_t result = TXS_BUSY;
+    if(TXA_BACKOFF == txAsyncState)
+        {
+        // Listen again once the backoff is over, giving up after LBT_MAX_TRIES attempts.
+        if(elapsed >= txAsyncBackoff)
+            {
+            if(_channelClear_())
+                {
+                if(NULL != txDutyCycle) { txDutyCycle->record(txAsyncChannel, txAsyncAirtime); }
+                _TXFIFOStart();
+                txAsyncState = TXA_SENDING;
+                }
+            else if(++txAsyncTries >= LBT_MAX_TRIES) { result = TXS_FAILED; }
+            else { txAsyncBackoff = _LBTBackoffTicks(); }
+            txAsyncTick = now;
+            }
+        }
+    else if(TXA_GAP == txAsyncState)
+        {
+        // Resend the frame (still in the TX FIFO) once the gap is over.
+        if(elapsed >= TX_REPEAT_GAP_TICKS)
+            {
+            if(NULL != txDutyCycle) { txDutyCycle->record(txAsyncChannel, txAsyncAirtime); }
+            _TXFIFOStart();
+            txAsyncTick = now;
+            txAsyncState = TXA_SENDING;
+            }
+        }
+    else if(_TXCheckSent()) // Packet sent!
+        {
+        if(txAsyncRepeats > 0)
+            {
+            --txAsyncRepeats;
+            _modeStandby_();
+            txAsyncTick = now;
+            txAsyncState = TXA_GAP;
+            }
+        else { result = TXS_SENT; }
+        }
+    else if(elapsed > txTimeoutTicks) { result = TXS_FAILED; } // Timed out.
+    if(neededEnable) { _downSPI_(); }
+    if(TXS_BUSY != result)
+        {
+        txAsyncState = TXA_IDLE;
+        // Revert to RX mode if listening, else go to standby to save energy.
+        _dolisten();
+        }
+    return(result);
+    }
+
 // Switch listening off, on to selected channel.
 // listenChannel will have been set by time this is called.
 // This always switches to standby mode first, then switches on RX as needed.
 void OTRFM23BLinkBase::_dolisten()
     {
+    // Any TX is over (or abandoned).
+    txInProgress = false;
     // Unconditionally stop listening and go into low-power standby mode.
     _modeStandbyAndClearState_();
 
@@ -365,20 +697,27 @@ void OTRFM23BLinkBase::_dolisten()
         _writeReg8Bit_(REG_OP_CTRL2, 3); // FFCLRRX | FFCLRTX
         _writeReg8Bit_(REG_OP_CTRL2, 0);
 
-        // Set FIFO RX almost-full threshold as specified.
+        // Frames longer than the RX FIFO can only be streamed with the packet handler (which knows the length).
+        const bool packetRX = (0 != (_readRegCached_(REG_30_DATA_ACCESS_CONTROL) & RFM23B_ENPACRX));
+        const bool streamRX = packetRX && (NULL != rxStreamBuf);
+        rxStreamLen = 0;
+
+        // Set FIFO RX almost-full threshold as specified,
+        // or when streaming low enough to drain the FIFO in time.
     //    _RFM22WriteReg8Bit(RFM22REG_RX_FIFO_CTRL, min(nearlyFullThreshold, 63));
-        _writeReg8Bit_(REG_RX_FIFO_CTRL, maxTypicalFrameBytes); // 55 is the default.
+        _writeRegCached_(REG_RX_FIFO_CTRL, streamRX ? RX_STREAM_ALMOST_FULL : maxTypicalFrameBytes); // 55 is the default.
 
         // Enable requested RX-related interrupts.
         // Do this regardless of hardware interrupt support on the board.
         // Check if packet handling in RFM23B is enabled and eneable interrupts accordingly
-        if ( _readReg8Bit_(REG_30_DATA_ACCESS_CONTROL) & RFM23B_ENPACRX )  {
-           _writeReg8Bit_(REG_INT_ENABLE1, RFM23B_ENPKVALID); // enable all interrupts
-           _writeReg8Bit_(REG_INT_ENABLE2, 0); // enable all interrupts
+        if ( packetRX )  {
+           // When streaming also drain the RX FIFO as it fills, and abandon the frame on a CRC error.
+           _writeRegCached_(REG_INT_ENABLE1, (uint8_t)(RFM23B_ENPKVALID | (streamRX ? (RFM23B_ENRXFFAFUL | RFM23B_ENCRCERROR) : 0)));
+           _writeRegCached_(REG_INT_ENABLE2, 0); // enable all interrupts
         }
         else {
-           _writeReg8Bit_(REG_INT_ENABLE1, 0x10); // enrxffafull: Enable RX FIFO Almost Full.
-           _writeReg8Bit_(REG_INT_ENABLE2, WAKE_ON_SYNC_RX ? 0x80 : 0); // enswdet: Enable Sync Word Detected.
+           _writeRegCached_(REG_INT_ENABLE1, 0x10); // enrxffafull: Enable RX FIFO Almost Full.
+           _writeRegCached_(REG_INT_ENABLE2, WAKE_ON_SYNC_RX ? 0x80 : 0); // enswdet: Enable Sync Word Detected.
        }
 
         // Clear any current interrupt/status.
@@ -397,6 +736,7 @@ void OTRFM23BLinkBase::_dolisten()
 // Trailing bytes (more than were actually sent) undefined.
 void OTRFM23BLinkBase::_RXFIFO(uint8_t *buf, const uint8_t bufSize)
     {
+    OTV0P2BASE_CYCLE_PROFILE_SCOPE(OTV0P2BASE::CPP_RFM23B_RXFIFO);
     // Lock out interrupts.
     ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
         {
@@ -415,8 +755,8 @@ void OTRFM23BLinkBase::_RXFIFO(uint8_t *buf, const uint8_t bufSize)
         _writeReg8Bit_(REG_OP_CTRL2, 3); // FFCLRRX | FFCLRTX
         _writeReg8Bit_(REG_OP_CTRL2, 0); // Needs both writes to clear.
         // Disable all interrupts.
-        _writeReg8Bit_(REG_INT_ENABLE1, 0);
-        _writeReg8Bit_(REG_INT_ENABLE2, 0); // TODO: possibly combine in burst write with previous...
+        _writeRegCached_(REG_INT_ENABLE1, 0);
+        _writeRegCached_(REG_INT_ENABLE2, 0); // TODO: possibly combine in burst write with previous...
     //    _writeReg16Bit0_(REG_INT_ENABLE1);
         // Clear any interrupts already/still pending...
         _clearInterrupts_();
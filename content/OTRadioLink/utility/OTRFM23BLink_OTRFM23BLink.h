@@ -65,10 +65,29 @@ namespace OTRFM23BLink
             static const int MaxRXMsgLen = 64;
             // Maximum rawTX message size in bytes.
             static const int MaxTXMsgLen = 64;
+            // Size of each of the RFM23B TX and RX FIFOs in bytes.
+            // Frames up to this size go through the FIFO whole;
+            // longer frames (up to MaxStreamMsgLen) are streamed through it when enabled.
+            static const uint8_t FIFO_BYTES = 64;
+            // Maximum raw message size in bytes when streaming, limited by the 8-bit packet length registers.
+            static const uint8_t MaxStreamMsgLen = 255;
+            // When streaming, the TX FIFO is refilled once it has at most TX_STREAM_ALMOST_EMPTY bytes left,
+            // and the RX FIFO drained of RX_STREAM_ALMOST_FULL bytes at a time.
+            // Either leaves ~2ms to respond at 57.6kbps.
+            static const uint8_t TX_STREAM_ALMOST_EMPTY = 16;
+            static const uint8_t RX_STREAM_ALMOST_FULL = 48;
 
             // Maximum allowed TX time, milliseconds.
             // Attempting a longer TX will result in a timeout.
             static const int MAX_TX_ms = 1000;
+            // Maximum allowed TX time in sub-cycle ticks; each TX is also timed out sooner from its airtime.
+            static const uint8_t MAX_TX_TICKS = (uint8_t)(((uint32_t)MAX_TX_ms * OTV0P2BASE::SUB_CYCLE_TICKS_PER_S) / 1000);
+            // Minimum gap before the repeat TX of a TXmax frame from the TX queue, in sub-cycle ticks (~15ms).
+            static const uint8_t TX_REPEAT_GAP_TICKS = 2;
+            // Allowance for radio start-up (up to ~800us from standby) and clock error in each TX timeout, milliseconds.
+            static const uint8_t TX_TIMEOUT_MARGIN_MS = 10;
+            // Maximum clear-channel assessments for one frame, with a random backoff between, when listening before talking.
+            static const uint8_t LBT_MAX_TRIES = 4;
 
             // Typical maximum size of encoded FHT8V/FS20 frame for OpenTRV as at 2015/07.
             static const uint8_t MAX_RX_FRAME_FHT8V = 45;
@@ -153,6 +172,13 @@ namespace OTRFM23BLink
             // RFM23B_REG_30_DATA_ACCESS_CONTROL
             static const uint8_t RFM23B_ENPACRX    =    0x80;
             static const uint8_t RFM23B_ENPACTX    =    0x08;
+            static const uint8_t RFM23B_CRCON      =    0x04;
+
+            // RFM23B_REG_33_HEADER_CONTROL2
+            static const uint8_t RFM23B_FIXPKLEN   =    0x08;
+
+            // RFM23B_REG_70_MODULATION_CONTROL1
+            static const uint8_t RFM23B_TXDTRTSCALE =   0x20;
 
             static const uint8_t REG_INT_STATUS1 = 3; // Interrupt status register 1.
             static const uint8_t REG_INT_STATUS2 = 4; // Interrupt status register 2.
@@ -165,9 +191,15 @@ namespace OTRFM23BLink
             static const uint8_t REG_RSSI1 = 0x28; // Antenna 1 diversity / RSSI.
             static const uint8_t REG_RSSI2 = 0x29; // Antenna 2 diversity / RSSI.
             static const uint8_t REG_30_DATA_ACCESS_CONTROL = 0x30; 
+            static const uint8_t REG_33_HEADER_CONTROL2 = 0x33;
+            static const uint8_t REG_34_PREAMBLE_LENGTH = 0x34; // In nibbles.
             static const uint8_t REG_3E_PACKET_LENGTH= 0x3e; 
             static const uint8_t REG_4B_RECEIVED_PACKET_LENGTH = 0x4b; 
             static const uint8_t REG_TX_POWER = 0x6d; // Transmit power.
+            static const uint8_t REG_6E_TX_DATA_RATE1 = 0x6e; // TX data rate, MSB.
+            static const uint8_t REG_6F_TX_DATA_RATE0 = 0x6f; // TX data rate, LSB.
+            static const uint8_t REG_70_MODULATION_CONTROL1 = 0x70;
+            static const uint8_t REG_7D_TX_FIFO_CTRL2 = 0x7d; // TX FIFO almost-empty threshold.
             static const uint8_t REG_RX_FIFO_CTRL = 0x7e; // RX FIFO control.
             static const uint8_t REG_FIFO = 0x7f; // TX FIFO on write, RX FIFO on read.
             // Allow validation of RFM22/RFM23 device and SPI connection to it.
@@ -185,8 +217,119 @@ namespace OTRFM23BLink
             // Too long may allow overruns, too short may make long-frame reception hard.
             volatile uint8_t maxTypicalFrameBytes;
 
+            // State of any TX from the TX queue; TXA_IDLE when none.
+            // While not idle, RX polling is suspended (as RX interrupts are disabled)
+            // so as not to consume the packet-sent status.
+            // Marked as volatile for ISR-/thread- safe access.
+            enum TXAsyncState { TXA_IDLE, TXA_SENDING, TXA_GAP, TXA_BACKOFF };
+            volatile uint8_t txAsyncState;
+            // Sub-cycle tick at which the current TX, repeat gap or backoff started.
+            uint8_t txAsyncTick;
+            // Repeat TXs still to do for the current frame.
+            uint8_t txAsyncRepeats;
+            // Clear-channel assessments made so far for the current frame, and the current backoff in sub-cycle ticks.
+            uint8_t txAsyncTries;
+            uint8_t txAsyncBackoff;
+            // Channel and airtime (ms) of one TX of the current frame, for duty-cycle accounting.
+            int8_t txAsyncChannel;
+            uint16_t txAsyncAirtime;
+
+            // Optional TX airtime accounting against a duty-cycle limit; NULL if none.
+            ::OTRadioLink::TXDutyCycle *txDutyCycle;
+            // Listen-before-talk: REG_RSSI value at or above which the channel is taken to be busy; 0 if disabled.
+            uint8_t lbtRSSIThreshold;
+            // Recent/short counts of TXs refused for lack of duty-cycle budget,
+            // and of clear-channel assessments that found the channel busy; wrap.
+            uint8_t txDutyCycleRefusedCountRecent;
+            uint8_t txChannelBusyCountRecent;
+
+            // Write-through shadow of the configuration registers that only this driver changes
+            // (interrupt enables, packet handler set-up, TX data rate and FIFO thresholds; see _regShadowSlot()),
+            // so that redundant writes are skipped and reads are served from RAM.
+            // The mode, FIFO, status and RSSI registers are never shadowed as the radio changes them itself.
+            // Mutable so that reads may fill the shadow.
+            static const uint8_t REG_SHADOW_SLOTS = 11;
+            mutable uint8_t regShadow[REG_SHADOW_SLOTS];
+            // Bit n is set iff regShadow[n] is known to match the radio; clear after any reset.
+            mutable uint16_t regShadowValid;
+            // If true, each shadowed read is also made from the radio and checked against the shadow.
+            bool regShadowVerify;
+            // Recent/short count of shadowed registers found not to match the radio; wraps.
+            mutable uint8_t regShadowMismatchCountRecent;
+
+            // Largest frame in bytes that this instance will send or receive, [FIFO_BYTES,MaxStreamMsgLen];
+            // frames longer than FIFO_BYTES are streamed through the FIFOs.
+            const uint8_t maxFrameLen;
+            // Frame loaded by _queueFrameInTXFIFO(), kept (by reference) to reload for a repeat TX if streamed.
+            const uint8_t *txStreamFrame;
+            uint8_t txStreamLen;
+            // Rest of the streamed frame still to go into the TX FIFO; txStreamLeft is 0 if none.
+            // Marked as volatile for ISR-/thread- safe access.
+            const uint8_t *volatile txStreamNext;
+            volatile uint8_t txStreamLeft;
+            // True from the start of a TX until its packet-sent status is seen or it is abandoned,
+            // while the ISR checks for packet-sent (and feeds any streamed frame) rather than RX.
+            volatile bool txInProgress;
+            // Set once the packet-sent status has been seen for the current TX.
+            volatile bool txPacketSent;
+            // Sub-cycle ticks allowed for the current TX before giving up.
+            uint8_t txTimeoutTicks;
+            // True if the radio's nIRQ line is wired to an interrupt, so that the CPU can sleep while waiting for it.
+            const bool hasIRQ;
+            // Streaming RX: buffer of maxFrameLen supplied by the deriving class (NULL if not streaming),
+            // and the bytes of the frame drained into it so far.
+            uint8_t *const rxStreamBuf;
+            volatile uint8_t rxStreamLen;
+
             // Constructor only available to deriving class.
-            OTRFM23BLinkBase() : _currentChannel(0), lastRXErr(0), maxTypicalFrameBytes(MAX_RX_FRAME_DEFAULT) { }
+            // With streaming (maxFrameLen > FIFO_BYTES) the deriving class supplies an RX buffer of maxFrameLen.
+            OTRFM23BLinkBase(const uint8_t _maxFrameLen = FIFO_BYTES, uint8_t *const _rxStreamBuf = NULL, const bool _hasIRQ = false)
+              : _currentChannel(0), lastRXErr(0), maxTypicalFrameBytes(MAX_RX_FRAME_DEFAULT),
+                txAsyncState(TXA_IDLE), txAsyncTick(0), txAsyncRepeats(0),
+                txAsyncTries(0), txAsyncBackoff(0), txAsyncChannel(0), txAsyncAirtime(0),
+                txDutyCycle(NULL), lbtRSSIThreshold(0), txDutyCycleRefusedCountRecent(0), txChannelBusyCountRecent(0),
+                regShadowValid(0), regShadowVerify(false), regShadowMismatchCountRecent(0),
+                maxFrameLen((_maxFrameLen > FIFO_BYTES) && (NULL != _rxStreamBuf) ? _maxFrameLen : FIFO_BYTES),
+                txStreamFrame(NULL), txStreamLen(0), txStreamNext(NULL), txStreamLeft(0),
+                txInProgress(false), txPacketSent(false), txTimeoutTicks(MAX_TX_TICKS), hasIRQ(_hasIRQ),
+                rxStreamBuf(_rxStreamBuf), rxStreamLen(0)
+                { }
+
+            // Index of the shadow slot for the register, or 0xff if the register is not shadowed.
+            static uint8_t _regShadowSlot(const uint8_t addr)
+                {
+                switch(addr)
+                    {
+                    case REG_INT_ENABLE1: return(0);
+                    case REG_INT_ENABLE2: return(1);
+                    case REG_30_DATA_ACCESS_CONTROL: return(2);
+                    case REG_33_HEADER_CONTROL2: return(3);
+                    case REG_34_PREAMBLE_LENGTH: return(4);
+                    case REG_3E_PACKET_LENGTH: return(5);
+                    case REG_6E_TX_DATA_RATE1: return(6);
+                    case REG_6F_TX_DATA_RATE0: return(7);
+                    case REG_70_MODULATION_CONTROL1: return(8);
+                    case REG_RX_FIFO_CTRL: return(9);
+                    case REG_7D_TX_FIFO_CTRL2: return(10);
+                    default: return(0xff);
+                    }
+                }
+            // True if the shadow shows that the register already holds val.
+            bool _regShadowHolds(const uint8_t addr, const uint8_t val) const
+                {
+                const uint8_t slot = _regShadowSlot(addr);
+                return((0xff != slot) && (0 != (regShadowValid & (1U << slot))) && (val == regShadow[slot]));
+                }
+            // Record that val has been written to the register; no-op if the register is not shadowed.
+            void _regShadowNote(uint8_t addr, uint8_t val) const;
+            // Forget all shadowed values, eg after a reset of the radio.
+            void _regShadowInvalidate() const;
+            // Write to 8-bit register on RFM23B unless the shadow shows that it already holds val.
+            // SPI must already be configured and running.
+            void _writeRegCached_(uint8_t addr, uint8_t val);
+            // Read from 8-bit register on RFM23B, from the shadow if possible.
+            // Powers up SPI if necessary to read from the radio.
+            uint8_t _readRegCached_(uint8_t addr) const;
 
             // Write/read one byte over SPI...
             // SPI must already be configured and running.
@@ -237,6 +380,7 @@ namespace OTRFM23BLink
             bool _checkConnected() const;
 
             // Configure the radio from a list of register/value pairs in readonly PROGMEM/Flash, terminating with an 0xff register value.
+            // Runs of consecutive register addresses are each written in a single SPI burst.
             // NOTE: argument is not a pointer into SRAM, it is into PROGMEM!
             typedef uint8_t regValPair_t[2];
             void _registerBlockSetup(const regValPair_t* registerValues);
@@ -248,13 +392,69 @@ namespace OTRFM23BLink
             // Clears the RFM23B TX FIFO and queues the supplied frame to send via the TX FIFO.
             // This routine does not change the frame area.
             // This uses an efficient burst write.
+            // A frame longer than FIFO_BYTES has only its first FIFO_BYTES loaded,
+            // the rest being streamed in by _TXCheckSent() as the TX FIFO empties,
+            // so the frame must stay in place until sent.
             void _queueFrameInTXFIFO(const uint8_t *bptr, uint8_t buflen);
+            // Refill the TX FIFO from the rest of a streamed frame, disabling the TX FIFO almost-empty interrupt
+            // once the frame is all in; call when the TX FIFO is almost empty.
+            // SPI must already be configured and running and interrupts blocked.
+            void _TXStreamRefill();
+            // Check for the packet-sent status of the current TX, refilling the TX FIFO if streaming.
+            // Safe to call from the ISR (on the packet-sent or TX FIFO almost-empty interrupt) and from the TX polling code.
+            // SPI must already be configured and running.
+            bool _TXCheckSent();
+            // Read (drain) n bytes from the RX FIFO without changing mode, eg while streaming RX.
+            // SPI must already be configured and running and interrupts blocked.
+            void _RXFIFODrain(uint8_t *buf, uint8_t n);
+
+            // Stop any RX, select the channel and load the frame into the TX FIFO ready to send.
+            void _TXLoadFrame(const uint8_t *buf, uint8_t buflen, int8_t channel);
+
+            // Start transmitting the contents of the on-chip TX FIFO, with all radio interrupts disabled
+            // except packet-sent, and TX FIFO almost-empty while streaming.
+            // Sets the timeout for the TX from its airtime.
+            // Reloads the start of a streamed frame (eg for a repeat TX) if it is no longer in the TX FIFO.
+            // SPI must already be configured and running.
+            void _TXFIFOStart();
+
+            // TX bitrate (bps) of the current configuration, from the data rate registers.
+            // SPI must already be configured and running.
+            uint32_t _getTXBitrate_() const;
+            // Approximate airtime (ms) of one TX of a frame of buflen bytes with the current configuration,
+            // including preamble, sync word, header, length and CRC when the packet handler is on.
+            // SPI must already be configured and running.
+            uint16_t _getTXAirtimeMs_(uint8_t buflen) const;
+            // Sub-cycle ticks to allow for one TX of a frame of buflen bytes before giving up:
+            // its airtime plus 25% and TX_TIMEOUT_MARGIN_MS, rounded up, and at most MAX_TX_TICKS.
+            // SPI must already be configured and running.
+            uint8_t _getTXTimeoutTicks_(uint8_t buflen) const;
+            // True if the duty-cycle budget (if any) allows the given airtime on the channel, else counts a refusal.
+            bool _TXAllowed(int8_t channel, uint16_t airtimeMs);
+            // Clear-channel assessment on the current channel: true if listen-before-talk is disabled
+            // or REG_RSSI sampled briefly in RX mode is below lbtRSSIThreshold.
+            // Call with the radio in standby and all its interrupts disabled, eg after _TXLoadFrame();
+            // leaves it so, with the TX FIFO intact.
+            // SPI must already be configured and running.
+            bool _channelClear_();
+            // Random backoff before the next clear-channel assessment, in sub-cycle ticks [1,8], ie ~8--62ms.
+            static uint8_t _LBTBackoffTicks() { return((uint8_t)(1 + (OTV0P2BASE::randRNG8() & 7))); }
 
             // Transmit contents of on-chip TX FIFO: caller should revert to low-power standby mode (etc) if required.
-            // Returns true if packet apparently sent correctly/fully.
+            // Returns true if packet apparently sent correctly/fully, false if not seen to complete within its timeout.
+            // With the nIRQ line the CPU sleeps until the packet-sent interrupt, else it polls.
             // Does not clear TX FIFO (so possible to re-send immediately).
             bool _TXFIFO();
 
+            // Start sending a frame from the TX queue without waiting for it to go.
+            // At TXmax the frame is sent again after a gap of TX_REPEAT_GAP_TICKS.
+            // Fails at once if the duty-cycle budget would be exceeded;
+            // waits for a random backoff (without blocking) while the channel is busy.
+            virtual bool _TXstart(const uint8_t *buf, uint8_t buflen, int8_t channel, uint8_t power);
+            // Check the progress of the frame from _TXstart(), from the packet-sent status,
+            // with a timeout from the frame's airtime; reverts to listening if enabled when done.
+            virtual uint8_t _TXpoll();
+
             // Put RFM23 into standby, attempt to read bytes from FIFO into supplied buffer.
             // Leaves RFM23 in low-power standby mode.
             // Trailing bytes (more than were actually sent) undefined.
@@ -286,6 +486,30 @@ namespace OTRFM23BLink
             // Too long may allow overruns, too short may make long-frame reception hard.
             void setMaxTypicalFrameBytes(uint8_t maxTypicalFrameBytes);
 
+            // Set (or clear, with NULL) TX airtime accounting against a duty-cycle limit.
+            // A TX (including any TXmax repeat) that would exceed the budget on its channel is refused.
+            // The airtime is estimated from the frame length and the configured bitrate.
+            void setTXDutyCycle(::OTRadioLink::TXDutyCycle *const d) { txDutyCycle = d; }
+            // Set the listen-before-talk REG_RSSI threshold, or 0 to disable.
+            // When enabled, each TX is preceded by a clear-channel assessment, with random backoff
+            // while the channel is busy, and is abandoned after LBT_MAX_TRIES busy assessments.
+            // This reduces collisions between nearby nodes, eg in dense valve clusters.
+            void setLBT(const uint8_t rssiThreshold) { lbtRSSIThreshold = rssiThreshold; }
+            // Recent/short count of TXs refused for lack of duty-cycle budget; wraps after 255/0xff.
+            uint8_t getTXDutyCycleRefusedRecent() const { return(txDutyCycleRefusedCountRecent); }
+            // Recent/short count of clear-channel assessments that found the channel busy; wraps after 255/0xff.
+            uint8_t getTXChannelBusyRecent() const { return(txChannelBusyCountRecent); }
+
+            // Debug mode: if true, every read of a shadowed register is also made from the radio
+            // and any mismatch is counted and corrected, at the cost of the SPI traffic that the shadow saves.
+            void setRegShadowVerify(const bool verify) { regShadowVerify = verify; }
+            // Check all currently-shadowed registers against the radio,
+            // counting and dropping any that do not match; returns the number of mismatches.
+            // Powers up SPI if necessary.
+            uint8_t verifyRegShadow();
+            // Recent/short count of shadowed registers found not to match the radio; wraps after 255/0xff.
+            uint8_t getRegShadowMismatchesRecent() const { return(regShadowMismatchCountRecent); }
+
             // Begin access to (initialise) this radio link if applicable and not already begun.
             // Returns true if it successfully began, false otherwise.
             // Allows logic to end() if required at the end of a block, etc.
@@ -314,6 +538,9 @@ namespace OTRFM23BLink
             //
             // Implementation specifics:
             //   * at TXmax will do double TX with 15ms sleep/IDLE mode between.
+            //   * with listen-before-talk enabled may nap for a random backoff while the channel is busy.
+            //   * returns false without sending if over the duty-cycle budget or the channel stays busy.
+            //   * must not be used while a frame from the TX queue is being sent.
             virtual bool sendRaw(const uint8_t *buf, uint8_t buflen, int8_t channel = 0, TXpower power = TXnormal, bool listenAfter = false);
 
             // End access to this radio link if applicable and not already ended.
@@ -333,18 +560,47 @@ namespace OTRFM23BLink
     // Hardwire to I/O pin for RFM23B active-low SPI device select: SPI_nSS_DigitalPin.
     // Hardwire to I/O pin for RFM23B active-low interrupt RFM_nIRQ_DigitalPin (-1 if none).
     // Set the targetISRRXMinQueueCapacity to at least 2, or 3 if RAM space permits, for busy RF channels.
-    template <uint8_t SPI_nSS_DigitalPin, int8_t RFM_nIRQ_DigitalPin = -1, uint8_t targetISRRXMinQueueCapacity = 3>
+    // With the default uint8_t RXQueueIndex_t the RX queue is at most 256 bytes (3 max-size frames);
+    // on a hub use uint16_t and a larger targetISRRXMinQueueCapacity to buffer bursts of frames.
+    // Set RXQueueMetadata to keep arrival sub-cycle time, RSSI, channel and error flags with each RX frame
+    // (see peekRXMetadata()), at the cost of 4 bytes per queued frame and an RSSI read per frame.
+    // Set RXQueuePriorityClasses non-zero to use a fixed-slot RX queue holding targetISRRXMinQueueCapacity frames
+    // that when full drops the oldest frame of the lowest priority class rather than the newest frame,
+    // with classes assigned by setPriorityRXISR() (eg framePrioritySecureable with FPS_CLASSES);
+    // RXQueueIndex_t is then ignored.
+    // maxFrameBytes may not be less than FIFO_BYTES, as a whole FIFO's worth may be read into an RX queue slot.
+    // Set maxFrameBytes above FIFO_BYTES (up to MaxStreamMsgLen) to send and receive longer frames
+    // by streaming them through the FIFOs from the ISR as they empty/fill,
+    // at the cost of an RX buffer of maxFrameBytes and larger RX queue entries;
+    // use a uint16_t RXQueueIndex_t (or RXQueuePriorityClasses) for more than ~120 bytes.
+    // RX streaming needs the packet handler (as with the GFSK channel),
+    // and streaming needs the nIRQ line or frequent poll()s to keep up with the FIFOs.
+    template <uint8_t SPI_nSS_DigitalPin, int8_t RFM_nIRQ_DigitalPin = -1, uint8_t targetISRRXMinQueueCapacity = 3,
+              typename RXQueueIndex_t = uint8_t, bool RXQueueMetadata = false, uint8_t RXQueuePriorityClasses = 0,
+              uint8_t maxFrameBytes = OTRFM23BLinkBase::FIFO_BYTES>
     class OTRFM23BLink : public OTRFM23BLinkBase
         {
+        static_assert(maxFrameBytes >= OTRFM23BLinkBase::FIFO_BYTES, "maxFrameBytes must be at least FIFO_BYTES");
+
         private:
             // RX queue.
 #if 0
             // Simple and fast 1-deep queue.
             ::OTRadioLink::ISRRXQueue1Deep<MaxRXMsgLen> queueRX;
 #else
-            // Queue that can make good use of space for variable-length messages.
-            ::OTRadioLink::ISRRXQueueVarLenMsg<MaxRXMsgLen, targetISRRXMinQueueCapacity> queueRX;
+            // Queue that can make good use of space for variable-length messages,
+            // or with RXQueuePriorityClasses a fixed-slot queue that drops low-priority frames first.
+            typename ::OTRadioLink::ISRRXQueueSelect<maxFrameBytes, targetISRRXMinQueueCapacity,
+                RXQueueIndex_t, RXQueueMetadata, RXQueuePriorityClasses>::type queueRX;
 #endif
+            // True if frames longer than the FIFOs are streamed through them.
+            static const bool streaming = (maxFrameBytes > FIFO_BYTES);
+            // Buffer to assemble a streamed RX frame in across several ISR calls (as RX queue buffers are only
+            // valid within a single call); minimal if not streaming.
+            uint8_t rxStream[streaming ? maxFrameBytes : 1];
+            // RX metadata flags to attach to the next frame queued, eg noting that frames were lost before it.
+            // Only used if RXQueueMetadata.
+            uint8_t rxMetadataPendingFlags;
 
             // Internal routines to enable/disable RFM23B on the the SPI bus.
             // These depend only on the (constant) SPI_nSS_DigitalPin template parameter
@@ -491,7 +747,12 @@ V0P2BASE_DEBUG_SERIAL_PRINTLN_FLASHSTRING("Rx");
                     // Disable all interrupts.
                     //  _RFM22WriteReg8Bit(RFM22REG_INT_ENABLE1, 0);
                     //  _RFM22WriteReg8Bit(RFM22REG_INT_ENABLE2, 0);
-                    _writeReg16Bit0(REG_INT_ENABLE1);
+                    if(!_regShadowHolds(REG_INT_ENABLE1, 0) || !_regShadowHolds(REG_INT_ENABLE2, 0))
+                        {
+                        _writeReg16Bit0(REG_INT_ENABLE1);
+                        _regShadowNote(REG_INT_ENABLE1, 0);
+                        _regShadowNote(REG_INT_ENABLE2, 0);
+                        }
                     // Clear any interrupts already/still pending...
                     _clearInterrupts();
                     if(neededEnable) { _downSPI(); }
@@ -524,10 +785,52 @@ V0P2BASE_DEBUG_SERIAL_PRINTLN_FLASHSTRING("RFM23 reset...");
 #endif
                 const bool neededEnable = _upSPI();
                 _writeReg8Bit(REG_OP_CTRL1, REG_OP_CTRL1_SWRES);
+                _regShadowInvalidate(); // All registers revert to their defaults.
                 _modeStandby();
                 if(neededEnable) { _downSPI(); }
                 }
 
+            // Read the RSSI for an RX frame's metadata; 0 if not keeping RX metadata.
+            // POWERS UP SPI IF NECESSARY.
+            inline uint8_t _readRSSIForRXMetadata()
+                {
+                if(!RXQueueMetadata) { return(0); }
+                const bool neededEnable = _upSPI();
+                const uint8_t rssi = _readReg8Bit(REG_RSSI);
+                if(neededEnable) { _downSPI(); }
+                return(rssi);
+                }
+            // Note that one or more RX frames have been lost, for the next frame's metadata.
+            inline void _noteRXLostForRXMetadata()
+                { if(RXQueueMetadata) { rxMetadataPendingFlags |= ::OTRadioLink::ISRRXFrameMetadata::FLAG_LOST_BEFORE; } }
+            // Attach metadata to the RX frame about to be queued, if keeping RX metadata.
+            // Call between queueRX._getRXBufForInbound() and queueRX._loadedBuf().
+            inline void _setRXMetadata(const uint8_t tick, const uint8_t rssi, const uint8_t flags)
+                {
+                if(!RXQueueMetadata) { return; }
+                ::OTRadioLink::ISRRXFrameMetadata m;
+                m.subCycleTick = tick;
+                m.rssi = rssi;
+                m.channel = (uint8_t)getListenChannel();
+                m.flags = flags | rxMetadataPendingFlags;
+                rxMetadataPendingFlags = 0;
+                queueRX._setRXMetadata(m);
+                }
+            // Queue the RX frame loaded into the buffer from queueRX._getRXBufForInbound(), with lengthRX > 0.
+            // With RX priority classes, classifies the frame and notes any frame dropped to make room.
+            inline void _loadedRXFrame(const volatile uint8_t *const bufferRX, const uint8_t lengthRX)
+                {
+                if(0 == RXQueuePriorityClasses) { queueRX._loadedBuf(lengthRX); return; }
+                quickFramePriority_t *const p = priorityRXISR;
+                const uint8_t priority = (NULL == p) ? 0 : p(bufferRX, lengthRX);
+                if(queueRX._loadedBufWithPriority(lengthRX, priority))
+                    {
+                    ++droppedRXedMessageCountRecent;
+                    lastRXErr = RXErr_DroppedFrame;
+                    _noteRXLostForRXMetadata();
+                    }
+                }
+
             // Common handling of polling and ISR code.
             // NOT RENTRANT: interrupts must be blocked when this is called.
             // Keeping everything inline helps allow better ISR code generation
@@ -538,17 +841,25 @@ V0P2BASE_DEBUG_SERIAL_PRINTLN_FLASHSTRING("RFM23 reset...");
             void _poll(const bool inISR)
                 {
  
+                // While sending, look only for packet-sent, keeping any streamed TX fed.
+                if(txInProgress)
+                    {
+                    const bool neededEnable = _upSPI();
+                    _TXCheckSent();
+                    if(neededEnable) { _downSPI(); }
+                    return;
+                    }
                 // Nothing to do if not listening at the moment.
                 if(-1 == getListenChannel()) { return; }
+                // Leave the status alone while sending from the TX queue.
+                if(TXA_IDLE != txAsyncState) { return; }
 
                 // See what has arrived, if anything.
                 const uint16_t status = _readStatusBoth();
 
                 // We need to check if RFM23B is in packet mode and based on that 
                 // we selelct interrupt routine
-                const bool neededEnable = _upSPI_();
-                uint8_t rxMode = _readReg8Bit_(REG_30_DATA_ACCESS_CONTROL);
-                if(neededEnable) { _downSPI_(); }
+                const uint8_t rxMode = _readRegCached_(REG_30_DATA_ACCESS_CONTROL);
                 if ( rxMode & RFM23B_ENPACRX ) 
                 {
 #if 1 && defined(MILENKO_DEBUG)
@@ -580,16 +891,28 @@ V0P2BASE_DEBUG_SERIAL_PRINTLN_FLASHSTRING("RFM23 reset...");
 #endif
                     if (status & RFM23B_IPKVALID) // Packet received OK
                     {
+                        const uint8_t rxTick = RXQueueMetadata ? ::OTV0P2BASE::getSubCycleTime() : 0;
+                        const uint8_t rxRSSI = _readRSSIForRXMetadata();
                         const bool neededEnable = _upSPI();
                         uint8_t len = _readReg8Bit(REG_4B_RECEIVED_PACKET_LENGTH);
                         if(neededEnable) { _downSPI(); }
+                        // Never read more than the queue can hold.
+                        uint8_t rxFlags = 0;
+                        if(len > maxFrameBytes) { len = maxFrameBytes; rxFlags = ::OTRadioLink::ISRRXFrameMetadata::FLAG_TRUNCATED; }
+                        // Any bytes already drained from the RX FIFO while streaming.
+                        const uint8_t drained = streaming ? rxStreamLen : 0;
                         // Received frame.
                         // If there is space in the queue then read in the frame, else discard it.
                         volatile uint8_t *const bufferRX = queueRX._getRXBufForInbound();
-                        if(NULL != bufferRX)
+                        if((NULL != bufferRX) && (drained <= len))
                         {
-                                   // Attempt to read the entire frame.
-                                   _RXFIFO((uint8_t *)bufferRX, len);
+                                   // Attempt to read the entire frame, after any already streamed in.
+                                   if(0 == drained) { _RXFIFO((uint8_t *)bufferRX, len); }
+                                   else
+                                   {
+                                       _RXFIFO(rxStream + drained, len - drained);
+                                       memcpy((uint8_t *)bufferRX, rxStream, len);
+                                   }
                                    uint8_t lengthRX = len; // Not very clever yet!
                                    // If an RX filter is present then apply it.
                                    quickFrameFilter_t *const f = filterRXISR;
@@ -600,7 +923,8 @@ V0P2BASE_DEBUG_SERIAL_PRINTLN_FLASHSTRING("RFM23 reset...");
                                    }
                                    else
                                    {
-                                       queueRX._loadedBuf(lengthRX); // Queue message.
+                                       _setRXMetadata(rxTick, rxRSSI, rxFlags);
+                                       _loadedRXFrame(bufferRX, lengthRX); // Queue message.
                                    }
                         }
                         else
@@ -610,11 +934,34 @@ V0P2BASE_DEBUG_SERIAL_PRINTLN_FLASHSTRING("RFM23 reset...");
                                    _RXFIFO(tmpbuf, sizeof(tmpbuf));
                                    ++droppedRXedMessageCountRecent;
                                    lastRXErr = RXErr_DroppedFrame;
+                                   _noteRXLostForRXMetadata();
                         }
                                // Clear up and force back to listening...
                         _dolisten();
                         //return;
                     }
+                    else if(streaming && (status & RFM23B_ICRCERROR))
+                    {
+                        // Abandon the part-streamed frame and force back to listening...
+                        _dolisten();
+                        return;
+                    }
+                    else if(streaming && (status & RFM23B_IRXFFAFULL))
+                    {
+                        // Drain the RX FIFO as a long frame arrives, while staying in RX mode.
+                        if(rxStreamLen > maxFrameBytes - RX_STREAM_ALMOST_FULL)
+                        {
+                            // Longer than allowed: give up on it.
+                            lastRXErr = RXErr_RXOverrun;
+                            _noteRXLostForRXMetadata();
+                            _dolisten();
+                            return;
+                        }
+                        const bool neededEnable = _upSPI();
+                        _RXFIFODrain(rxStream + rxStreamLen, RX_STREAM_ALMOST_FULL);
+                        if(neededEnable) { _downSPI(); }
+                        rxStreamLen += RX_STREAM_ALMOST_FULL;
+                    }
 #if 1 && defined(MILENKO_DEBUG)
                     if (status & RFM23B_ICRCERROR) // CRC error
                     {
@@ -653,12 +1000,15 @@ V0P2BASE_DEBUG_SERIAL_PRINTLN_FLASHSTRING("RFM23 reset...");
                     // Do this first to avoid trying to read a mangled/overrun frame.
                     // Note the overrun error.
                     lastRXErr = RXErr_RXOverrun;
+                    _noteRXLostForRXMetadata();
                     // Reset and force back to listening...
                     _dolisten();
                     return;
                     }
                 else if(status & 0x1000)
                     {
+                    const uint8_t rxTick = RXQueueMetadata ? ::OTV0P2BASE::getSubCycleTime() : 0;
+                    const uint8_t rxRSSI = _readRSSIForRXMetadata();
                     // Received frame.
                     // If there is space in the queue then read in the frame, else discard it.
                     volatile uint8_t *const bufferRX = queueRX._getRXBufForInbound();
@@ -676,7 +1026,8 @@ V0P2BASE_DEBUG_SERIAL_PRINTLN_FLASHSTRING("RFM23 reset...");
                             }
                         else
                             {
-                            queueRX._loadedBuf(lengthRX); // Queue message.
+                            _setRXMetadata(rxTick, rxRSSI, 0);
+                            _loadedRXFrame(bufferRX, lengthRX); // Queue message.
                             }
                         }
                     else
@@ -686,6 +1037,7 @@ V0P2BASE_DEBUG_SERIAL_PRINTLN_FLASHSTRING("RFM23 reset...");
                         _RXFIFO(tmpbuf, sizeof(tmpbuf));
                         ++droppedRXedMessageCountRecent;
                         lastRXErr = RXErr_DroppedFrame;
+                        _noteRXLostForRXMetadata();
                         }
                     // Clear up and force back to listening...
                     _dolisten();
@@ -711,7 +1063,7 @@ V0P2BASE_DEBUG_SERIAL_PRINTLN_FLASHSTRING("RFM23 reset...");
             // Should be a compile-time constant.
             static const bool hasInterruptSupport = (RFM_nIRQ_DigitalPin >= 0);
 
-            OTRFM23BLink() { }
+            OTRFM23BLink() : OTRFM23BLinkBase(maxFrameBytes, streaming ? rxStream : NULL, hasInterruptSupport), rxMetadataPendingFlags(0) { }
 
             // Do very minimal pre-initialisation, eg at power up, to get radio to safe low-power mode.
             // Argument is read-only pre-configuration data;
@@ -730,7 +1082,12 @@ V0P2BASE_DEBUG_SERIAL_PRINTLN_FLASHSTRING("RFM23 reset...");
             // May also be used for output processing,
             // eg to run a transmit state machine.
             // May be called very frequently and should not take more than a few 100ms per call.
-            virtual void poll() { if(!interruptLineIsEnabledAndInactive()) { ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { _poll(false); } } }
+            // Also advances any TX queue.
+            virtual void poll()
+                {
+                if(!interruptLineIsEnabledAndInactive()) { ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { _poll(false); } }
+                _pollTX();
+                }
 
             // Handle simple interrupt for this radio link.
             // Must be fast and ISR (Interrupt Service Routine) safe.
@@ -787,7 +1144,7 @@ V0P2BASE_DEBUG_SERIAL_PRINTLN_FLASHSTRING("RFM23 reset...");
             virtual void getCapacity(uint8_t &queueRXMsgsMin, uint8_t &maxRXMsgLen, uint8_t &maxTXMsgLen) const
                 {
                 queueRX.getRXCapacity(queueRXMsgsMin, maxRXMsgLen);
-                maxTXMsgLen = MaxTXMsgLen;
+                maxTXMsgLen = maxFrameBytes;
                 }
 
             // Fetches the current count of queued messages for RX.
@@ -812,6 +1169,20 @@ V0P2BASE_DEBUG_SERIAL_PRINTLN_FLASHSTRING("RFM23 reset...");
             // Not intended to be called from an ISR.
             virtual void removeRXMsg() { queueRX.removeRXMsg(); }
 
+            // Pass queued RX messages in place to the handler, then remove those dealt with at once.
+            // Not intended to be called from an ISR.
+            virtual uint8_t drainRXMsgs(::OTRadioLink::ISRRXDrainHandler_t *handler, void *context, uint8_t maxMsgs = 255)
+                { return(queueRX.drainRXMsgs(handler, context, maxMsgs)); }
+
+            // Get metadata for the first (oldest) queued RX message; false if none or !RXQueueMetadata.
+            // Not intended to be called from an ISR.
+            virtual bool peekRXMetadata(::OTRadioLink::ISRRXFrameMetadata &m) const { return(queueRX.peekRXMetadata(m)); }
+
+            // Recent/short count of RX frames of the given priority class dropped from a full queue; wraps.
+            // Only available with RXQueuePriorityClasses > 0.
+            uint8_t getRXMsgsEvictedRecent(const uint8_t priorityClass) const
+                { return(queueRX.getRXEvictedRecent(priorityClass)); }
+
 #if 0 // Defining the virtual destructor uses ~800+ bytes of Flash by forcing use of malloc()/free().
             // Ensure safe instance destruction when derived from.
             // by default attempts to shut down the sensor and otherwise free resources when done.
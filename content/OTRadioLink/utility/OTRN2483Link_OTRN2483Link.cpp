@@ -44,6 +44,7 @@ bool OTRN2483Link::OTRN2483Link::begin() {
 //	  sendCmd("mac join abp");
 //	  sendCmd("mac get status");
 //	  sendCmd("mac get devaddr");
+	return false; // Not yet implemented.
 }
 
 /**
@@ -52,6 +53,7 @@ bool OTRN2483Link::OTRN2483Link::begin() {
  */
 bool OTRN2483Link::OTRN2483Link::sendRaw(const uint8_t* buf, uint8_t buflen,
 		int8_t channel, TXpower power, bool listenAfter) {
+	return false; // Not yet implemented.
 }
 
 
@@ -99,6 +99,8 @@ public:
     bool queueToSend(const uint8_t *buf, uint8_t buflen, int8_t channel = 0, TXpower power = TXnormal);
     inline bool isAvailable(){ return bAvailable; };     // checks radio is there independant of power state
     void poll();
+    // poll() does not send from the OTRadioLink TX queue.
+    bool supportsTXQueue() const { return(false); }
     bool handleInterruptSimple();
 
     /**
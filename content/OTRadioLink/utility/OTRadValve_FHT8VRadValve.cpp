@@ -184,6 +184,7 @@ static uint8_t *_FHT8VCreate200usAppendByteEP(uint8_t *bptr, const uint8_t b)
 // Returns pointer to the terminating 0xff on exit.
 uint8_t *FHT8VRadValveBase::FHT8VCreate200usBitStreamBptr(uint8_t *bptr, const FHT8VRadValveBase::fht8v_msg_t *command)
   {
+  OTV0P2BASE_CYCLE_PROFILE_SCOPE(OTV0P2BASE::CPP_FHT8V_ENCODE);
   // Generate FHT8V preamble.
   // First 12 x 0 bits of preamble, pre-encoded as 6 x 0xcc bytes.
   *bptr++ = 0xcc;
@@ -143,6 +143,7 @@ static const uint8_t MIN_WINDOW_OPEN_TEMP_FALL_M = 10;
 //   * valvePCOpenRef  current valve position UPDATED BY THIS ROUTINE, in range [0,100]
 void ModelledRadValveState::tick(volatile uint8_t &valvePCOpenRef, const ModelledRadValveInputState &inputState)
   {
+  OTV0P2BASE_CYCLE_PROFILE_SCOPE(OTV0P2BASE::CPP_MRVS_TICK);
   const int rawTempC16 = inputState.refTempC16 - refTempOffsetC16; // Remove adjustment for target centre.
   if(!initialised)
     {
@@ -0,0 +1,191 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+/*
+ * Compile-time chains of quick RX frame filters for the RX ISR.
+ *
+ * A radio accepts a single quickFrameFilter_t (see OTRadioLink::setFilterRXISR()).
+ * FrameFilterChain<Stage...>::filter is one such routine that applies each stage in turn,
+ * stopping at the first to reject the frame; the stages are inlined into it,
+ * so that the chain costs little more than the tests themselves, eg:
+ *     typedef OTRadioLink::FrameFilterChain<
+ *         OTRadioLink::FrameFilterTrimTrailingZeros,
+ *         OTRadioLink::FrameFilterLength<8, 64>,
+ *         OTRadioLink::FrameFilterSecureableTypes<'O', '!'> > RXFilter;
+ *     radio.setFilterRXISR(RXFilter::filter);
+ *
+ * The radio counts every rejected frame in its filteredRXedMessageCountRecent;
+ * the chain also counts rejections by the stage responsible,
+ * ie by reason, available from getRejectedRecent().
+ *
+ * A stage is a type with a static routine with the same signature and constraints as a quickFrameFilter_t:
+ *     static bool filter(const volatile uint8_t *buf, volatile uint8_t &buflen);
+ * which may reduce buflen for later stages.
+ * A stage that wraps a quickFrameFilter_t routine, FrameFilterFunction, is not inlined unless the routine is.
+ */
+
+#ifndef ARDUINO_LIB_OTRADIOLINK_FRAMEFILTERCHAIN_H
+#define ARDUINO_LIB_OTRADIOLINK_FRAMEFILTERCHAIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "OTRadioLink_OTRadioLink.h"
+
+// Use namespaces to help avoid collisions.
+namespace OTRadioLink
+    {
+
+
+    // Compile-time list of byte values, for filter stages.
+    template<uint8_t... values>
+    struct FrameFilterValues
+        {
+        static const uint8_t COUNT = 0;
+        // True if v is one of the values.
+        static inline bool contains(uint8_t) { return(false); }
+        // True if the bytes starting at p are the values in order.
+        static inline bool matchAt(const volatile uint8_t *) { return(true); }
+        };
+    template<uint8_t first, uint8_t... rest>
+    struct FrameFilterValues<first, rest...>
+        {
+        static const uint8_t COUNT = 1 + sizeof...(rest);
+        static inline bool contains(const uint8_t v)
+            { return((first == v) || FrameFilterValues<rest...>::contains(v)); }
+        static inline bool matchAt(const volatile uint8_t *const p)
+            { return((first == p[0]) && FrameFilterValues<rest...>::matchAt(p + 1)); }
+        };
+
+    // Stage: rejects frames shorter than minLen or longer than maxLen bytes.
+    template<uint8_t minLen, uint8_t maxLen = 255>
+    struct FrameFilterLength
+        {
+        static inline bool filter(const volatile uint8_t *, volatile uint8_t &buflen)
+            {
+            const uint8_t l = buflen;
+            return((l >= minLen) && (l <= maxLen));
+            }
+        };
+
+    // Stage: trims (all but the first) trailing zeros, as frameFilterTrailingZeros(); never rejects a frame.
+    struct FrameFilterTrimTrailingZeros
+        {
+        static inline bool filter(const volatile uint8_t *const buf, volatile uint8_t &buflen)
+            {
+            if(buflen <= 1) { return(true); } // Too short to trim.
+            const volatile uint8_t *b = buf + buflen - 1;
+            if(0 != *b) { return(true); } // No trailing nulls at all, so don't trim frame size.
+            // Check for first non-zero byte from end backwards.
+            while(0 == *--b) { if(b == buf) { buflen = 1; return(true); } }
+            buflen = (uint8_t)(b - buf + 2);
+            return(true);
+            }
+        };
+
+    // Stage: accepts only secureable frames of the listed types (without the secure bit),
+    // ie with buf[1] & 0x7f one of types, eg FTS_BasicSensorOrValve.
+    template<uint8_t... types>
+    struct FrameFilterSecureableTypes
+        {
+        static inline bool filter(const volatile uint8_t *const buf, volatile uint8_t &buflen)
+            {
+            if(buflen < 2) { return(false); }
+            return(FrameFilterValues<types...>::contains(buf[1] & 0x7f));
+            }
+        };
+
+    // Stage: accepts only secureable frames whose ID starts with the given bytes,
+    // ie with an ID length (low nibble of buf[2]) at least the prefix length and the ID at buf[3] matching.
+    // Frames with too short an ID (eg none) are rejected.
+    template<uint8_t... prefix>
+    struct FrameFilterIDPrefix
+        {
+        static inline bool filter(const volatile uint8_t *const buf, volatile uint8_t &buflen)
+            {
+            const uint8_t n = FrameFilterValues<prefix...>::COUNT;
+            if(buflen < 3 + n) { return(false); }
+            if((buf[2] & 0xf) < n) { return(false); }
+            return(FrameFilterValues<prefix...>::matchAt(buf + 3));
+            }
+        };
+
+    // Stage: applies a quickFrameFilter_t routine, eg a filter with run-time state.
+    template<quickFrameFilter_t *f>
+    struct FrameFilterFunction
+        {
+        static inline bool filter(const volatile uint8_t *const buf, volatile uint8_t &buflen)
+            { return(f(buf, buflen)); }
+        };
+
+    // Applies the stages starting at the given index, counting a rejection against that stage.
+    template<uint8_t index, typename... Stages>
+    struct FrameFilterChainStages
+        {
+        static inline bool filter(const volatile uint8_t *, volatile uint8_t &, volatile uint8_t *) { return(true); }
+        };
+    template<uint8_t index, typename First, typename... Rest>
+    struct FrameFilterChainStages<index, First, Rest...>
+        {
+        static inline bool filter(const volatile uint8_t *const buf, volatile uint8_t &buflen, volatile uint8_t *const rejected)
+            {
+            if(!First::filter(buf, buflen)) { ++rejected[index]; return(false); }
+            return(FrameFilterChainStages<index + 1, Rest...>::filter(buf, buflen, rejected));
+            }
+        };
+
+    // Chain of quick RX frame filter stages, applied in order until one rejects the frame.
+    // filter is a quickFrameFilter_t routine to pass to OTRadioLink::setFilterRXISR().
+    // Each distinct chain type has its own (static) per-stage rejection counts.
+    template<typename... Stages>
+    class FrameFilterChain
+        {
+        public:
+            // Number of stages.
+            static const uint8_t STAGES = sizeof...(Stages);
+
+        private:
+            static const uint8_t COUNTERS = (0 == STAGES) ? 1 : STAGES;
+            // Recent/short count of frames rejected by each stage; wraps.
+            // Marked volatile for ISR-/thread- safe access without a lock.
+            static volatile uint8_t rejected[COUNTERS];
+
+        public:
+            // Returns false if any stage rejects the frame; stages may reduce buflen.
+            // ISR-safe if all the stages are.
+            static bool filter(const volatile uint8_t *const buf, volatile uint8_t &buflen)
+                { return(FrameFilterChainStages<0, Stages...>::filter(buf, buflen, rejected)); }
+
+            // Recent/short count of frames rejected by the given stage (from 0); wraps after 255/0xff.
+            // 0 for a stage out of range.
+            // ISR-/thread- safe.
+            static uint8_t getRejectedRecent(const uint8_t stage)
+                { return((stage < STAGES) ? rejected[stage] : 0); }
+
+            // Reset all the rejection counts.
+            // Not ISR-safe; the counts may be left inconsistent if a frame is filtered meanwhile.
+            static void resetRejected()
+                { for(uint8_t i = 0; i < STAGES; ++i) { rejected[i] = 0; } }
+        };
+    template<typename... Stages>
+    volatile uint8_t FrameFilterChain<Stages...>::rejected[FrameFilterChain<Stages...>::COUNTERS];
+
+
+    }
+
+#endif
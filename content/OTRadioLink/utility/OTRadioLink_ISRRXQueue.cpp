@@ -27,17 +27,55 @@ Author(s) / Copyright (s): Damon Hart-Davis 2015
 namespace OTRadioLink
     {
 
+// Peek at up to maxMsgs queued RX messages at once, oldest first, filling in spans[].
+// This default only handles the oldest message.
+uint8_t ISRRXQueue::peekRXMsgs(ISRRXMsgSpan *const spans, const uint8_t maxMsgs) const
+    {
+    if((0 == maxMsgs) || (NULL == spans)) { return(0); }
+    uint8_t len;
+    const volatile uint8_t *const buf = peekRXMsg(len);
+    if(NULL == buf) { return(0); }
+    spans[0].buf = buf;
+    spans[0].len = len;
+    return(1);
+    }
+
+// Remove the n (or all if fewer are queued) oldest queued RX messages at once.
+// This default removes them one at a time.
+void ISRRXQueue::removeRXMsgs(uint8_t n)
+    { while((n-- > 0) && !isEmpty()) { removeRXMsg(); } }
+
+// Pass up to maxMsgs queued RX messages in place to the handler, oldest first,
+// then remove all those that it has dealt with.
+// This default removes them one at a time.
+uint8_t ISRRXQueue::drainRXMsgs(ISRRXDrainHandler_t *const handler, void *const context, const uint8_t maxMsgs)
+    {
+    if(NULL == handler) { return(0); } // ERROR
+    uint8_t done = 0;
+    while(done < maxMsgs)
+        {
+        uint8_t len;
+        const volatile uint8_t *const buf = peekRXMsg(len);
+        if((NULL == buf) || !handler(context, buf, len)) { break; }
+        removeRXMsg();
+        ++done;
+        }
+    return(done);
+    }
+
 // True if the queue is full.
 // True iff _getRXBufForInbound() would return NULL.
 // ISR-/thread- safe.
-uint8_t ISRRXQueueVarLenMsgBase::isFull() const
+template<typename idx_t, bool withMetadata>
+uint8_t ISRRXQueueVarLenMsgBaseT<idx_t, withMetadata>::isFull() const
     { ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { return(_isFull()); } }
 
 // Remove the first (oldest) queued RX message.
 // Typically used after peekRXMessage().
 // Does nothing if the queue is empty.
 // Not intended to be called from an ISR.
-void ISRRXQueueVarLenMsgBase::removeRXMsg()
+template<typename idx_t, bool withMetadata>
+void ISRRXQueueVarLenMsgBaseT<idx_t, withMetadata>::removeRXMsg()
     {
     // Nothing to do if empty.
     if(isEmpty()) { return; }
@@ -47,16 +85,95 @@ void ISRRXQueueVarLenMsgBase::removeRXMsg()
         // Advance 'oldest' index to discard oldest length+frame, wrapping if necessary.
         // A wrap will be needed if advancing 'oldest' would take it too close to the buffer end
         // for a valid max-size incoming frame to have been stored there.
-        const uint8_t o = oldest; // Cache volatile value.
+        const idx_t o = oldest; // Cache volatile value.
         oldest = newIndex(o, b[o]);
         --queuedRXedMessageCount;
         }
     }
 
+// Remove the n (or all if fewer are queued) oldest queued RX messages at once.
+// Not intended to be called from an ISR.
+template<typename idx_t, bool withMetadata>
+void ISRRXQueueVarLenMsgBaseT<idx_t, withMetadata>::removeRXMsgs(uint8_t n)
+    {
+    // Messages already queued cannot be removed by an ISR,
+    // so the new 'oldest' index can be computed without blocking interrupts.
+    const uint8_t c = queuedRXedMessageCount;
+    if(n > c) { n = c; }
+    if(0 == n) { return; }
+    const idx_t o = _skipRXMsgs(n);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+        {
+        oldest = o;
+        queuedRXedMessageCount -= n;
+        }
+    }
+
+// Pass up to maxMsgs queued RX messages in place to the handler, oldest first,
+// then remove all those that it has dealt with at once.
+// Not intended to be called from an ISR.
+template<typename idx_t, bool withMetadata>
+uint8_t ISRRXQueueVarLenMsgBaseT<idx_t, withMetadata>::drainRXMsgs(ISRRXDrainHandler_t *const handler, void *const context, const uint8_t maxMsgs)
+    {
+    if(NULL == handler) { return(0); } // ERROR
+    idx_t o;
+    const uint8_t done = _drainRXMsgs(handler, context, maxMsgs, queuedRXedMessageCount, o);
+    if(0 != done)
+        {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+            {
+            oldest = o;
+            queuedRXedMessageCount -= done;
+            }
+        }
+    return(done);
+    }
+
+ISRRXQueuePriorityBase::ISRRXQueuePriorityBase(const uint8_t maxFrame, const uint8_t capacity, const uint8_t classes,
+                                               volatile uint8_t *const bp, volatile uint8_t *const lensp, volatile uint8_t *const priosp,
+                                               volatile uint8_t *const orderp, volatile uint8_t *const evictionsp, volatile uint8_t *const metap)
+    : b(bp), mf(maxFrame), cap(capacity), nClasses(classes),
+      lens(lensp), prios(priosp), order(orderp), evictions(evictionsp), meta(metap)
+    {
+    for(uint8_t i = 0; i <= cap; ++i) { order[i] = i; }
+    for(uint8_t i = 0; i < nClasses; ++i) { evictions[i] = 0; }
+    }
+
+// Get metadata for the first (oldest) queued RX message; false if none or not kept.
+// Not intended to be called from an ISR.
+bool ISRRXQueuePriorityBase::peekRXMetadata(ISRRXFrameMetadata &m) const
+    {
+    if((NULL == meta) || isEmpty()) { return(false); }
+    // The oldest frame cannot be moved or evicted by an ISR.
+    const volatile uint8_t *const p = meta + 4*order[0];
+    m.subCycleTick = p[0]; m.rssi = p[1]; m.channel = p[2]; m.flags = p[3];
+    return(true);
+    }
+
+// Remove the first (oldest) queued RX message.
+// Does nothing if the queue is empty.
+// Not intended to be called from an ISR.
+void ISRRXQueuePriorityBase::removeRXMsg()
+    {
+    // Nothing to do if empty.
+    if(isEmpty()) { return; }
+    // The ISR may be reordering the queued frames, so block interrupts.
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+        {
+        // Move the oldest frame's slot to be the first free one.
+        const uint8_t c = queuedRXedMessageCount;
+        const uint8_t s = order[0];
+        for(uint8_t i = 0; i < c - 1; ++i) { order[i] = order[i+1]; }
+        order[c - 1] = s;
+        queuedRXedMessageCount = c - 1;
+        }
+    }
+
 #ifdef ISRRXQueueVarLenMsg_VALIDATE
 // Validate state, dumping diagnostics to Print stream and returning false if problems found.
 // Intended for use in debugging only.
-bool ISRRXQueueVarLenMsgBase::validate(Print *p, uint8_t &n, uint8_t &o, uint8_t &c, const volatile uint8_t *&bp, int &s) const
+template<typename idx_t, bool withMetadata>
+bool ISRRXQueueVarLenMsgBaseT<idx_t, withMetadata>::validate(Print *p, idx_t &n, idx_t &o, uint8_t &c, const volatile uint8_t *&bp, int &s) const
     {
     n = next;
     o = oldest;
@@ -73,5 +190,15 @@ bool ISRRXQueueVarLenMsgBase::validate(Print *p, uint8_t &n, uint8_t &o, uint8_t
     }
 #endif
 
+// Index types supported, with and without metadata.
+template class ISRRXQueueVarLenMsgBaseT<uint8_t, false>;
+template class ISRRXQueueVarLenMsgBaseT<uint8_t, true>;
+#if !defined(__AVR__)
+template class ISRRXQueueVarLenMsgBaseT<uint16_t, false>;
+template class ISRRXQueueVarLenMsgBaseT<uint16_t, true>;
+template class ISRRXQueueVarLenMsgBaseT<uint32_t, false>;
+template class ISRRXQueueVarLenMsgBaseT<uint32_t, true>;
+#endif
+
 
     }
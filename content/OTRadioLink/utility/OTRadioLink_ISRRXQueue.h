@@ -33,6 +33,40 @@ Author(s) / Copyright (s): Damon Hart-Davis 2015
 // Use namespaces to help avoid collisions.
 namespace OTRadioLink
     {
+    // Optional metadata for a received frame, captured by the radio driver (eg in its ISR)
+    // as the frame is queued, and kept with it in queues that support it.
+    // Allows for example duplicate suppression, link-quality tracking and latency measurement
+    // without further ISR work.
+    struct ISRRXFrameMetadata
+        {
+        // Arrival time as OTV0P2BASE::getSubCycleTime().
+        uint8_t subCycleTick;
+        // Raw received signal strength in radio-specific units, eg from RFM23B REG_RSSI; 0 if unknown.
+        uint8_t rssi;
+        // Channel listened on when the frame arrived.
+        uint8_t channel;
+        // Error/condition flags, a combination of FLAG_XXX.
+        uint8_t flags;
+
+        // The frame was longer than allowed for and was truncated.
+        static const uint8_t FLAG_TRUNCATED = 1;
+        // One or more frames were lost (eg to queue overflow or radio overrun) just before this one.
+        static const uint8_t FLAG_LOST_BEFORE = 2;
+        };
+
+    // A queued RX message in place in its queue, as from ISRRXQueue::peekRXMsgs().
+    struct ISRRXMsgSpan
+        {
+        const volatile uint8_t *buf;
+        uint8_t len;
+        };
+
+    // Handler for each message passed in place by drainRXMsgs(), oldest first.
+    // Returns true if the message has been dealt with and can be removed,
+    // else false to stop draining, leaving this and any later messages queued.
+    // The message buffer MUST NOT be altered, nor the queue used, by the handler.
+    typedef bool ISRRXDrainHandler_t(void *context, const volatile uint8_t *buf, uint8_t len);
+
     // Base class for an ISR-based efficient RX packet queue.
     // All queueing operations are fixed (low) cost,
     // designed to be called from an ISR (or with interrupts disabled)
@@ -88,6 +122,26 @@ namespace OTRadioLink
             // Not intended to be called from an ISR.
             virtual void removeRXMsg() = 0;
 
+            // Peek at up to maxMsgs queued RX messages at once, oldest first, filling in spans[].
+            // Returns the number of spans filled in, which remain valid until removeRXMsgs() or removeRXMsg().
+            // Messages queued after this call starts are not included.
+            // The buffers pointed to MUST NOT be altered.
+            // Not intended to be called from an ISR.
+            virtual uint8_t peekRXMsgs(ISRRXMsgSpan *spans, uint8_t maxMsgs) const;
+
+            // Remove the n (or all if fewer are queued) oldest queued RX messages at once.
+            // Typically used after peekRXMsgs().
+            // Not intended to be called from an ISR.
+            virtual void removeRXMsgs(uint8_t n);
+
+            // Pass up to maxMsgs queued RX messages in place to the handler, oldest first,
+            // then remove all those that it has dealt with at once.
+            // Cheaper than peekRXMsg()/removeRXMsg() for each message,
+            // eg only blocking interrupts once.
+            // Returns the number of messages dealt with and removed; 0 if the handler is NULL.
+            // Not intended to be called from an ISR.
+            virtual uint8_t drainRXMsgs(ISRRXDrainHandler_t *handler, void *context, uint8_t maxMsgs = 255);
+
             // Get pointer for inbound/RX frame able to accommodate max frame size; NULL if no space.
             // Call this to get a pointer to load an inbound frame (<=maxRXBytes bytes) into;
             // after uploading the frame call _loadedBuf() to queue the new frame
@@ -103,6 +157,22 @@ namespace OTRadioLink
             // It is possible to formally abandon an upload attempt by calling this with 0.
             virtual void _loadedBuf(uint8_t frameLen) = 0;
 
+            // As _loadedBuf() but with the frame's priority class, 0 being the lowest.
+            // Returns true if a frame (possibly this one) had to be dropped to make room.
+            // Queues without priorities ignore the class.
+            virtual bool _loadedBufWithPriority(const uint8_t frameLen, uint8_t /*priority*/)
+                { _loadedBuf(frameLen); return(false); }
+
+            // Set metadata for the frame being uploaded, if this queue keeps metadata, else does nothing.
+            // Call only between _getRXBufForInbound() returning non-NULL and _loadedBuf().
+            virtual void _setRXMetadata(const ISRRXFrameMetadata &/*m*/) { }
+
+            // Get metadata for the first (oldest) queued RX message.
+            // Returns false (and leaves m unchanged) if the queue is empty or does not keep metadata.
+            // Valid until the next removeRXMessage().
+            // Not intended to be called from an ISR.
+            virtual bool peekRXMetadata(ISRRXFrameMetadata &/*m*/) const { return(false); }
+
 #if 0 // Defining the virtual destructor uses ~800+ bytes of Flash by forcing use of malloc()/free().
             // Ensure safe instance destruction when derived from.
             // by default attempts to shut down the sensor and otherwise free resources when done.
@@ -194,37 +264,53 @@ namespace OTRadioLink
                 }
         };
 
+
+    // Wider type in which to compute ISRRXQueueVarLenMsgBaseT indices without overflow.
+    template<typename idx_t> struct ISRRXQueueWideIndex { typedef uint32_t type; };
+    template<> struct ISRRXQueueWideIndex<uint8_t> { typedef uint16_t type; };
+
     // N-deep queue that can efficiently store variable-length messages.
-    // Total size limited to 256 bytes for efficiency of representation on 8-bit MCU.
+    // Indices into the buffer are of (unsigned) type idx_t.
+    // If withMetadata is true then each frame is preceded by an ISRRXFrameMetadata,
+    // ie the segments are (len,metadata,data+), else they are (len,data+).
+    // With the default uint8_t indices the total size is limited to 256 bytes
+    // for efficiency of representation on 8-bit MCU;
+    // on hosts (eg hubs) uint16_t indices allow a buffer large enough for hundreds of frames,
+    // though at most 255 frames are queued at once as the queued count is a uint8_t.
     // A frame to be queued can be up to maxRXBytes bytes long.
     // maximum message size (maxRXBytes) should be well under 255 bytes.
     // This can queue more short messages than full-size ones.
     // (So filters that trim message length may be helpful in maximising effective capacity.)
     // Does minimal checking; all arguments must be sane.
-    class ISRRXQueueVarLenMsgBase : public ISRRXQueue
+    template<typename idx_t, bool withMetadata = false>
+    class ISRRXQueueVarLenMsgBaseT : public ISRRXQueue
         {
         protected:
+            // Size of the header before each frame in the buffer: length and any metadata.
+            static const uint8_t HDR = 1 + (withMetadata ? sizeof(ISRRXFrameMetadata) : 0);
             // Shadow of buf.
             volatile uint8_t *const b;
             // Maximum allowed single frame in the queue.
             const uint8_t mf;
-            // BUFSIZE-1 (to fit in uint8_t); maximum allowed index in b/buf.
-            const uint8_t bsm1;
-            // Last usable index beyond which there is not enough space for len+maxSizeFrame.
-            const uint8_t lui;
+            // BUFSIZE-1 (to fit in idx_t); maximum allowed index in b/buf.
+            const idx_t bsm1;
+            // Last usable index beyond which there is not enough space for header+maxSizeFrame.
+            const idx_t lui;
             // Offsets to the start of the oldest and next entries in buf.
             // When oldest == next then isEmpty(), ie the queue is empty.
-            volatile uint8_t oldest, next;
+            volatile idx_t oldest, next;
             // Construct an instance.
-            ISRRXQueueVarLenMsgBase(uint8_t maxFrame, volatile uint8_t *bp, uint8_t bsm)
-                : b(bp), mf(maxFrame), bsm1(bsm), lui(bsm - maxFrame), oldest(0), next(0)
+            ISRRXQueueVarLenMsgBaseT(uint8_t maxFrame, volatile uint8_t *bp, idx_t bsm)
+                : b(bp), mf(maxFrame), bsm1(bsm), lui(bsm - maxFrame - (HDR-1)), oldest(0), next(0)
                 { }
             // True if the queue is full.
             // True iff _getRXBufForInbound() would return NULL.
             // Must be protected against re-entrance, eg by interrupts being blocked before calling.
             uint8_t _isFull() const
                 {
-                const uint8_t n = next, o = oldest; // Cache volatile values.
+                // With wide indices there may be space for more frames than can be counted.
+                if((sizeof(idx_t) > 1) && (0xff == queuedRXedMessageCount)) { return(true); }
+                const idx_t n = next, o = oldest; // Cache volatile values.
                 // If 'next' index is after 'oldest'
                 // then would be full if there weren't space for the largest possible frame
                 // but the 'next' index should have been wrapped already,
@@ -233,19 +319,66 @@ namespace OTRadioLink
                 // If 'next' index is on 'oldest' then queued-item count determines status.
                 if(n == o) { return(!isEmpty()); }
                 // Else 'next' is before 'oldest'
-                // so check for enough space between them *including* the leading length.
-                const uint8_t spaceBeforeOldest = o - n;
-                return(spaceBeforeOldest <= mf); // True if not enough space (including len).
+                // so check for enough space between them *including* the leading length (and metadata).
+                const idx_t spaceBeforeOldest = o - n;
+                return(spaceBeforeOldest <= mf + (HDR-1)); // True if not enough space (including header).
                 }
             // Compute new index given old one and the length of the frame.
             // Works for both adding a message at 'next' and removing one at 'oldest'.
             // Is inline for speed; does not adjust any state.
             // TODO: try to eliminate use of longer int for speed.
-            inline uint8_t newIndex(const uint8_t prevIndex, const uint8_t frameLen) const
+            inline idx_t newIndex(const idx_t prevIndex, const uint8_t frameLen) const
+                {
+                typedef typename ISRRXQueueWideIndex<idx_t>::type wide_t;
+                const wide_t newIndex = (wide_t)HDR + (wide_t)prevIndex + (wide_t)frameLen;
+                if(newIndex > (wide_t)lui) { return(0); } // Wrap if too to close to end for a max-size entry.
+                return((idx_t) newIndex);
+                }
+            // Copy the metadata of the oldest frame, which must exist; only if withMetadata.
+            inline void _getMetadata(ISRRXFrameMetadata &m) const
+                {
+                const volatile uint8_t *const p = b + oldest + 1;
+                m.subCycleTick = p[0]; m.rssi = p[1]; m.channel = p[2]; m.flags = p[3];
+                }
+            // Fill in spans for up to maxMsgs of the 'queued' oldest messages; returns the number filled in.
+            // Messages already queued cannot move or be removed by the producer,
+            // so this need not block interrupts.
+            uint8_t _peekRXMsgs(ISRRXMsgSpan *const spans, const uint8_t maxMsgs, const uint8_t queued) const
                 {
-                const uint16_t newIndex = 1U + (uint16_t)prevIndex + (uint16_t)frameLen;
-                if(newIndex > (uint16_t)lui) { return(0); } // Wrap if too to close to end for a max-size entry.
-                return((uint8_t) newIndex);
+                const uint8_t n = (queued < maxMsgs) ? queued : maxMsgs;
+                idx_t o = oldest;
+                for(uint8_t i = 0; i < n; ++i)
+                    {
+                    const uint8_t len = b[o];
+                    spans[i].buf = b + o + HDR;
+                    spans[i].len = len;
+                    o = newIndex(o, len);
+                    }
+                return(n);
+                }
+            // Pass up to maxMsgs of the 'queued' oldest messages to the handler.
+            // Returns the number dealt with, and in o the new 'oldest' index once they are removed.
+            uint8_t _drainRXMsgs(ISRRXDrainHandler_t *const handler, void *const context,
+                                 const uint8_t maxMsgs, const uint8_t queued, idx_t &o) const
+                {
+                const uint8_t n = (queued < maxMsgs) ? queued : maxMsgs;
+                o = oldest;
+                uint8_t done = 0;
+                while(done < n)
+                    {
+                    const uint8_t len = b[o];
+                    if(!handler(context, b + o + HDR, len)) { break; }
+                    o = newIndex(o, len);
+                    ++done;
+                    }
+                return(done);
+                }
+            // Compute the new 'oldest' index once the n oldest messages are removed.
+            idx_t _skipRXMsgs(uint8_t n) const
+                {
+                idx_t o = oldest;
+                while(n-- > 0) { o = newIndex(o, b[o]); }
+                return(o);
                 }
         public:
             // True if the queue is full.
@@ -266,7 +399,7 @@ namespace OTRadioLink
                 // This ISR is kept as short/fast as possible.
                 if(_isFull()) { return(NULL); }
                 // Return access to content of frame area for 'next' item if queue not full.
-                return(b + next + 1);
+                return(b + next + HDR);
                 }
 
             // Call after loading an RXed frame into the buffer indicated by _getRXBufForInbound().
@@ -279,7 +412,7 @@ namespace OTRadioLink
                 // This ISR is kept as short/fast as possible.
                 if(0 == frameLen) { return; } // New frame not being uploaded.
                 // PANIC if frameLen > max!
-                const uint8_t n = next; // Cache volatile value.
+                const idx_t n = next; // Cache volatile value.
                 b[n] = frameLen;
                 next = newIndex(n, frameLen);
                 ++queuedRXedMessageCount;
@@ -302,8 +435,26 @@ namespace OTRadioLink
                 // Cannot now become empty nor can the 'oldest' index change even if an ISR is invoked,
                 // thus interrupts need not be blocked here.
                 const volatile uint8_t *p = b + oldest;
-                len = *p++;
-                return(p);
+                len = *p;
+                return(p + HDR);
+                }
+
+            // Set metadata for the frame being uploaded, if withMetadata, else does nothing.
+            // Call only between _getRXBufForInbound() returning non-NULL and _loadedBuf().
+            virtual void _setRXMetadata(const ISRRXFrameMetadata &m)
+                {
+                if(!withMetadata) { return; }
+                volatile uint8_t *const p = b + next + 1;
+                p[0] = m.subCycleTick; p[1] = m.rssi; p[2] = m.channel; p[3] = m.flags;
+                }
+
+            // Get metadata for the first (oldest) queued RX message, if withMetadata.
+            // Returns false (and leaves m unchanged) if the queue is empty or !withMetadata.
+            virtual bool peekRXMetadata(ISRRXFrameMetadata &m) const
+                {
+                if(!withMetadata || isEmpty()) { return(false); }
+                _getMetadata(m);
+                return(true);
                 }
 
             // Remove the first (oldest) queued RX message.
@@ -311,34 +462,332 @@ namespace OTRadioLink
             // Does nothing if the queue is empty.
             // Not intended to be called from an ISR.
             virtual void removeRXMsg();
+
+            // Batch operations, as for ISRRXQueue;
+            // the removals only block interrupts once.
+            virtual uint8_t peekRXMsgs(ISRRXMsgSpan *spans, uint8_t maxMsgs) const
+                { return(_peekRXMsgs(spans, maxMsgs, queuedRXedMessageCount)); }
+            virtual void removeRXMsgs(uint8_t n);
+            virtual uint8_t drainRXMsgs(ISRRXDrainHandler_t *handler, void *context, uint8_t maxMsgs = 255);
 #undef ISRRXQueueVarLenMsg_VALIDATE
 #ifdef ISRRXQueueVarLenMsg_VALIDATE
             // Validate state, dumping diagnostics to Print stream and returning false if problems found.
             // Intended for use in debugging only.
-            bool validate(Print *p, uint8_t &n, uint8_t &o, uint8_t &c, const volatile uint8_t *&bp, int &s) const;
+            bool validate(Print *p, idx_t &n, idx_t &o, uint8_t &c, const volatile uint8_t *&bp, int &s) const;
 #endif
         };
+    // The original 8-bit-indexed queue of at most 256 bytes.
+    typedef ISRRXQueueVarLenMsgBaseT<uint8_t> ISRRXQueueVarLenMsgBase;
     //   * maxRXBytes  a frame to be queued can be up to maxRXBytes bytes long; in the range [1,255]
     //   * targetISRRXMinQueueCapacity  target number of max-sized frames queueable [1,255], usually [2,4]
-    template<uint8_t maxRXBytes, uint8_t targetISRRXMinQueueCapacity = 2>
-    class ISRRXQueueVarLenMsg : public ISRRXQueueVarLenMsgBase
+    //   * idx_t  buffer index type: uint8_t (the default, as on AVR) caps the buffer at 256 bytes,
+    //         uint16_t (hosts only) allows the full target capacity.
+    //   * withMetadata  if true, keep an ISRRXFrameMetadata with each frame;
+    //         the buffer grows to match, subject to the cap for uint8_t indices.
+    template<uint8_t maxRXBytes, uint8_t targetISRRXMinQueueCapacity = 2, typename idx_t = uint8_t, bool withMetadata = false>
+    class ISRRXQueueVarLenMsg : public ISRRXQueueVarLenMsgBaseT<idx_t, withMetadata>
         {
         private:
+            typedef ISRRXQueueVarLenMsgBaseT<idx_t, withMetadata> base_t;
             /*Actual buffer size (bytes). */
-            static const int BUFSIZ = min(256, maxRXBytes * (1+(int)targetISRRXMinQueueCapacity));
+            static const int32_t BUFSIZ_TARGET = (maxRXBytes + (base_t::HDR-1)) * (1+(int32_t)targetISRRXMinQueueCapacity);
+            static const int32_t BUFSIZ = ((1 == sizeof(idx_t)) && (BUFSIZ_TARGET > 256)) ? 256 : BUFSIZ_TARGET;
             /**Buffer holding a circular queue.
              * Contains a circular sequence of (len,data+) segments.
              * Wrapping around the end is done with a len==0 segment or hitting the end exactly.
              */
             volatile uint8_t buf[BUFSIZ];
         public:
-            ISRRXQueueVarLenMsg() : ISRRXQueueVarLenMsgBase(maxRXBytes, buf, (uint8_t)(BUFSIZ-1)) { }
+            ISRRXQueueVarLenMsg() : base_t(maxRXBytes, buf, (idx_t)(BUFSIZ-1)) { }
             /*Guaranteed minimum number of (full-length) messages that can be queued. */
-            static const uint8_t MinQueueCapacityMsgs = BUFSIZ / (maxRXBytes + 1);
+            static const uint8_t MinQueueCapacityMsgs = BUFSIZ / (maxRXBytes + base_t::HDR);
+            // Fetches the current inbound RX minimum queue capacity and maximum RX raw message size.
+            virtual void getRXCapacity(uint8_t &queueRXMsgsMin, uint8_t &maxRXMsgLen) const
+                { queueRXMsgsMin = MinQueueCapacityMsgs; maxRXMsgLen = maxRXBytes; }
+        };
+
+    // Queue of up to a fixed number of frames, each in a max-size slot, with priority classes.
+    // When full, a newly-received frame is still accepted, and then the oldest frame
+    // of the lowest priority class present (possibly the new frame itself) is evicted.
+    // So, unlike other queues, _getRXBufForInbound() never returns NULL,
+    // and isFull() is true when the next frame will cause an eviction.
+    // Frames are loaded with _loadedBufWithPriority(), eg with a class from a quickFramePriority_t;
+    // _loadedBuf() loads at the lowest priority, 0.
+    // The oldest frame, which the consumer may be reading in place, is never evicted;
+    // for the same reason peekRXMsgs() only returns the oldest frame.
+    // Keeps a recent/short (wrapping) count of evictions by priority class.
+    // Does minimal checking; all arguments must be sane.
+    class ISRRXQueuePriorityBase : public ISRRXQueue
+        {
+        protected:
+            // Frame slots, each mf bytes; there are cap+1 including one for the next inbound frame.
+            volatile uint8_t *const b;
+            // Maximum frame size.
+            const uint8_t mf;
+            // Maximum number of frames queued.
+            const uint8_t cap;
+            // Number of priority classes, >= 1.
+            const uint8_t nClasses;
+            // Per-slot frame length and priority class.
+            volatile uint8_t *const lens;
+            volatile uint8_t *const prios;
+            // Slot numbers, of queued frames oldest first, then of free slots.
+            // The slot for the next inbound frame is thus order[queuedRXedMessageCount].
+            volatile uint8_t *const order;
+            // Per-class count of evictions; wraps.
+            volatile uint8_t *const evictions;
+            // Per-slot ISRRXFrameMetadata (as 4 bytes), or NULL if not kept.
+            volatile uint8_t *const meta;
+
+            ISRRXQueuePriorityBase(uint8_t maxFrame, uint8_t capacity, uint8_t classes,
+                                   volatile uint8_t *bp, volatile uint8_t *lensp, volatile uint8_t *priosp,
+                                   volatile uint8_t *orderp, volatile uint8_t *evictionsp, volatile uint8_t *metap);
+
+            // Start of the given slot.
+            inline volatile uint8_t *_slot(const uint8_t s) const { return(b + (uint16_t)s * mf); }
+
+        public:
+            // True if the queue is full, so that the next frame will cause an eviction.
+            // ISR-/thread- safe.
+            virtual uint8_t isFull() const { return(queuedRXedMessageCount >= cap); }
+
+            // Get pointer for inbound/RX frame able to accommodate max frame size; never NULL.
+            // Must only be called from within an ISR and/or with interfering threads excluded.
+            virtual volatile uint8_t *_getRXBufForInbound() { return(_slot(order[queuedRXedMessageCount])); }
+
+            // Queue the frame loaded into the buffer indicated by _getRXBufForInbound(), at priority 0.
+            // It is possible to formally abandon an upload attempt by calling this with 0.
+            // Must still be in the scope of the same (ISR) call as _getRXBufForInbound().
+            virtual void _loadedBuf(const uint8_t frameLen) { _loadedBufWithPriority(frameLen, 0); }
+
+            // Queue the frame loaded into the buffer indicated by _getRXBufForInbound(),
+            // at the given priority class (classes above the highest are treated as the highest).
+            // If the queue was full then evicts the oldest of the lowest-priority frames other than the oldest,
+            // and returns true.
+            // Must still be in the scope of the same (ISR) call as _getRXBufForInbound().
+            virtual bool _loadedBufWithPriority(const uint8_t frameLen, uint8_t priority)
+                {
+                if(0 == frameLen) { return(false); } // New frame not being uploaded.
+                if(priority >= nClasses) { priority = nClasses - 1; }
+                uint8_t c = queuedRXedMessageCount;
+                const uint8_t s = order[c];
+                lens[s] = frameLen;
+                prios[s] = priority;
+                if(++c <= cap) { queuedRXedMessageCount = c; return(false); }
+                // Find the oldest frame of the lowest priority, never the oldest frame overall.
+                uint8_t victim = c - 1;
+                uint8_t victimPriority = priority;
+                for(uint8_t i = c - 1; --i > 0; )
+                    {
+                    const uint8_t p = prios[order[i]];
+                    if(p <= victimPriority) { victim = i; victimPriority = p; }
+                    }
+                // Move the victim's slot to be the next free one.
+                const uint8_t vs = order[victim];
+                for(uint8_t i = victim; i < c - 1; ++i) { order[i] = order[i+1]; }
+                order[c - 1] = vs;
+                ++evictions[victimPriority];
+                return(true);
+                }
+
+            // Set metadata for the frame being uploaded, if kept, else does nothing.
+            // Call only between _getRXBufForInbound() and _loadedBuf()/_loadedBufWithPriority().
+            virtual void _setRXMetadata(const ISRRXFrameMetadata &m)
+                {
+                if(NULL == meta) { return; }
+                volatile uint8_t *const p = meta + 4*order[queuedRXedMessageCount];
+                p[0] = m.subCycleTick; p[1] = m.rssi; p[2] = m.channel; p[3] = m.flags;
+                }
+
+            // Peek at first (oldest) queued RX message, returning a pointer or NULL if no message waiting.
+            // The oldest message is never evicted, so remains valid until removeRXMsg().
+            // Not intended to be called from an ISR.
+            virtual const volatile uint8_t *peekRXMsg(uint8_t &len) const
+                {
+                if(isEmpty()) { return(NULL); }
+                const uint8_t s = order[0];
+                len = lens[s];
+                return(_slot(s));
+                }
+
+            // Get metadata for the first (oldest) queued RX message; false if none or not kept.
+            virtual bool peekRXMetadata(ISRRXFrameMetadata &m) const;
+
+            // Remove the first (oldest) queued RX message.
+            // Does nothing if the queue is empty.
+            // Not intended to be called from an ISR.
+            virtual void removeRXMsg();
+
+            // Get the priority class of the first (oldest) queued RX message; 0 if none.
+            uint8_t peekRXPriority() const { return(isEmpty() ? 0 : prios[order[0]]); }
+
+            // Recent/short count of frames of the given priority class evicted (or rejected) when full.
+            // Wraps after 255/0xff; 0 for a class out of range.
+            // ISR-/thread- safe.
+            uint8_t getRXEvictedRecent(const uint8_t priority) const
+                { return((priority < nClasses) ? evictions[priority] : 0); }
+        };
+    //   * maxRXBytes  a frame to be queued can be up to maxRXBytes bytes long; in the range [1,255]
+    //   * queueCapacity  number of frames queueable [1,254], usually [2,4]
+    //   * priorityClasses  number of priority classes [1,255]
+    //   * withMetadata  if true, keep an ISRRXFrameMetadata with each frame
+    template<uint8_t maxRXBytes, uint8_t queueCapacity = 3, uint8_t priorityClasses = 4, bool withMetadata = false>
+    class ISRRXQueuePriority : public ISRRXQueuePriorityBase
+        {
+        private:
+            static const uint8_t SLOTS = queueCapacity + 1;
+            volatile uint8_t buf[SLOTS * (uint16_t)maxRXBytes];
+            volatile uint8_t lensBuf[SLOTS], priosBuf[SLOTS], orderBuf[SLOTS];
+            volatile uint8_t evictionsBuf[priorityClasses];
+            volatile uint8_t metaBuf[withMetadata ? 4*SLOTS : 1];
+        public:
+            ISRRXQueuePriority()
+                : ISRRXQueuePriorityBase(maxRXBytes, queueCapacity, priorityClasses,
+                                         buf, lensBuf, priosBuf, orderBuf, evictionsBuf,
+                                         withMetadata ? metaBuf : NULL)
+                { }
+            // Guaranteed minimum number of (full-length) messages that can be queued.
+            static const uint8_t MinQueueCapacityMsgs = queueCapacity;
             // Fetches the current inbound RX minimum queue capacity and maximum RX raw message size.
             virtual void getRXCapacity(uint8_t &queueRXMsgsMin, uint8_t &maxRXMsgLen) const
                 { queueRXMsgsMin = MinQueueCapacityMsgs; maxRXMsgLen = maxRXBytes; }
         };
+
+    // Selects the RX queue type for a radio driver from its template parameters:
+    // ISRRXQueuePriority if priorityClasses > 0 (ignoring idx_t), else ISRRXQueueVarLenMsg.
+    template<uint8_t maxRXBytes, uint8_t queueCapacity, typename idx_t, bool withMetadata, uint8_t priorityClasses>
+    struct ISRRXQueueSelect
+        { typedef ISRRXQueuePriority<maxRXBytes, queueCapacity, priorityClasses, withMetadata> type; };
+    template<uint8_t maxRXBytes, uint8_t queueCapacity, typename idx_t, bool withMetadata>
+    struct ISRRXQueueSelect<maxRXBytes, queueCapacity, idx_t, withMetadata, 0>
+        { typedef ISRRXQueueVarLenMsg<maxRXBytes, queueCapacity, idx_t, withMetadata> type; };
+
+#if !defined(__AVR__)
+    // Lock-free single-producer single-consumer variant of ISRRXQueueVarLenMsgBaseT for threaded hosts,
+    // eg a hub with one thread reading the radio and another processing frames.
+    // Same (len,data+) segment layout, but instead of blocking interrupts
+    // the producer publishes each frame, and the consumer each removal, with release stores
+    // which the other side reads with acquire loads:
+    //   * only the producer (_getRXBufForInbound(), _loadedBuf(), isFull()) writes 'next';
+    //   * only the consumer (peekRXMsg(), removeRXMsg()) writes 'oldest';
+    //   * both update the queued message count with atomic read-modify-writes.
+    // getRXMsgsQueued() and isEmpty() remain safe to call from either thread.
+    template<typename idx_t, bool withMetadata = false>
+    class ISRRXQueueVarLenMsgSPSCBaseT : public ISRRXQueueVarLenMsgBaseT<idx_t, withMetadata>
+        {
+        protected:
+            typedef ISRRXQueueVarLenMsgBaseT<idx_t, withMetadata> base_t;
+            ISRRXQueueVarLenMsgSPSCBaseT(uint8_t maxFrame, volatile uint8_t *bp, idx_t bsm)
+                : base_t(maxFrame, bp, bsm) { }
+
+        public:
+            // True if the queue is full; producer only.
+            // True iff _getRXBufForInbound() would return NULL.
+            virtual uint8_t isFull() const
+                {
+                const idx_t n = this->next;
+                // Read the count before 'oldest' as the consumer updates them in the opposite order,
+                // so that any removal not yet seen can only make the queue look fuller.
+                const uint8_t c = __atomic_load_n(&this->queuedRXedMessageCount, __ATOMIC_ACQUIRE);
+                const idx_t o = __atomic_load_n(&this->oldest, __ATOMIC_ACQUIRE);
+                if((sizeof(idx_t) > 1) && (0xff == c)) { return(true); }
+                if(n > o) { return(false); }
+                if(n == o) { return(0 != c); }
+                return((idx_t)(o - n) <= this->mf + (base_t::HDR-1));
+                }
+
+            // Get pointer for inbound/RX frame able to accommodate max frame size; NULL if no space.
+            // Producer only.
+            virtual volatile uint8_t *_getRXBufForInbound()
+                {
+                if(isFull()) { return(NULL); }
+                return(this->b + this->next + base_t::HDR);
+                }
+
+            // Call after loading an RXed frame into the buffer indicated by _getRXBufForInbound()
+            // to publish it to the consumer; 0 abandons the upload.
+            // Producer only.
+            virtual void _loadedBuf(const uint8_t frameLen)
+                {
+                if(0 == frameLen) { return; } // New frame not being uploaded.
+                const idx_t n = this->next;
+                this->b[n] = frameLen;
+                this->next = this->newIndex(n, frameLen);
+                // Publish the length and frame.
+                __atomic_fetch_add(&this->queuedRXedMessageCount, 1, __ATOMIC_RELEASE);
+                }
+
+            // Peek at first (oldest) queued RX message, returning a pointer or NULL if no message waiting.
+            // The returned pointer and length are valid until the next removeRXMsg().
+            // Consumer only.
+            virtual const volatile uint8_t *peekRXMsg(uint8_t &len) const
+                {
+                if(0 == __atomic_load_n(&this->queuedRXedMessageCount, __ATOMIC_ACQUIRE)) { return(NULL); }
+                const volatile uint8_t *p = this->b + this->oldest;
+                len = *p;
+                return(p + base_t::HDR);
+                }
+
+            // Get metadata for the first (oldest) queued RX message, if withMetadata; consumer only.
+            virtual bool peekRXMetadata(ISRRXFrameMetadata &m) const
+                {
+                if(!withMetadata) { return(false); }
+                if(0 == __atomic_load_n(&this->queuedRXedMessageCount, __ATOMIC_ACQUIRE)) { return(false); }
+                this->_getMetadata(m);
+                return(true);
+                }
+
+            // Remove the first (oldest) queued RX message; does nothing if the queue is empty.
+            // Consumer only.
+            virtual void removeRXMsg() { removeRXMsgs(1); }
+
+            // Batch operations, as for ISRRXQueue; consumer only.
+            // Removals publish the new 'oldest' index and count once for all the messages removed.
+            virtual uint8_t peekRXMsgs(ISRRXMsgSpan *spans, uint8_t maxMsgs) const
+                { return(this->_peekRXMsgs(spans, maxMsgs, __atomic_load_n(&this->queuedRXedMessageCount, __ATOMIC_ACQUIRE))); }
+            virtual void removeRXMsgs(uint8_t n)
+                {
+                const uint8_t c = __atomic_load_n(&this->queuedRXedMessageCount, __ATOMIC_ACQUIRE);
+                if(n > c) { n = c; }
+                if(0 == n) { return; }
+                _release(this->_skipRXMsgs(n), n);
+                }
+            virtual uint8_t drainRXMsgs(ISRRXDrainHandler_t *handler, void *context, uint8_t maxMsgs = 255)
+                {
+                if(NULL == handler) { return(0); } // ERROR
+                idx_t o;
+                const uint8_t done = this->_drainRXMsgs(handler, context, maxMsgs,
+                    __atomic_load_n(&this->queuedRXedMessageCount, __ATOMIC_ACQUIRE), o);
+                if(0 != done) { _release(o, done); }
+                return(done);
+                }
+
+        private:
+            // Release the space of the n oldest messages, then account for them.
+            void _release(const idx_t newOldest, const uint8_t n)
+                {
+                __atomic_store_n(&this->oldest, newOldest, __ATOMIC_RELEASE);
+                __atomic_fetch_sub(&this->queuedRXedMessageCount, n, __ATOMIC_RELEASE);
+                }
+        };
+    typedef ISRRXQueueVarLenMsgSPSCBaseT<uint8_t> ISRRXQueueVarLenMsgSPSCBase;
+    // As ISRRXQueueVarLenMsg, with the same capacity and template parameters,
+    // but for one producer thread and one consumer thread (see ISRRXQueueVarLenMsgSPSCBaseT).
+    template<uint8_t maxRXBytes, uint8_t targetISRRXMinQueueCapacity = 2, typename idx_t = uint8_t, bool withMetadata = false>
+    class ISRRXQueueVarLenMsgSPSC : public ISRRXQueueVarLenMsgSPSCBaseT<idx_t, withMetadata>
+        {
+        private:
+            typedef ISRRXQueueVarLenMsgBaseT<idx_t, withMetadata> base_t;
+            static const int32_t BUFSIZ_TARGET = (maxRXBytes + (base_t::HDR-1)) * (1+(int32_t)targetISRRXMinQueueCapacity);
+            static const int32_t BUFSIZ = ((1 == sizeof(idx_t)) && (BUFSIZ_TARGET > 256)) ? 256 : BUFSIZ_TARGET;
+            volatile uint8_t buf[BUFSIZ];
+        public:
+            ISRRXQueueVarLenMsgSPSC() : ISRRXQueueVarLenMsgSPSCBaseT<idx_t, withMetadata>(maxRXBytes, buf, (idx_t)(BUFSIZ-1)) { }
+            static const uint8_t MinQueueCapacityMsgs = BUFSIZ / (maxRXBytes + base_t::HDR);
+            virtual void getRXCapacity(uint8_t &queueRXMsgsMin, uint8_t &maxRXMsgLen) const
+                { queueRXMsgsMin = MinQueueCapacityMsgs; maxRXMsgLen = maxRXBytes; }
+        };
+#endif // !defined(__AVR__)
     }
 
 
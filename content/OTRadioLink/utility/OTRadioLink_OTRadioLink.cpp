@@ -17,6 +17,8 @@ Author(s) / Copyright (s): Damon Hart-Davis 2015
 */
 
 #include "OTRadioLink_OTRadioLink.h"
+#include "OTRadioLink_SecureableFrameType.h"
+#include "OTRadioLink_FrameFilterChain.h"
 
 #include <util/atomic.h>
 
@@ -84,14 +86,27 @@ namespace OTRadioLink
     // Leaves first trailing zero for those frame types that may legitimately have one trailing zero.
     // Always returns true, ie never rejects a frame outright.
     bool frameFilterTrailingZeros(const volatile uint8_t *const buf, volatile uint8_t &buflen)
+        { return(FrameFilterTrimTrailingZeros::filter(buf, buflen)); }
+
+    // Classify a frame by a quick plausibility check of the secureable frame header.
+    // Puts secure frames above non-secure and both above other traffic,
+    // with secure valve/sensor frames highest.
+    // Does not validate the frame fully nor check any CRC or authentication.
+    uint8_t framePrioritySecureable(const volatile uint8_t *const buf, const uint8_t buflen)
         {
-        if(buflen <= 1) { return(true); } // Too short to trim.
-        const volatile uint8_t *b = buf + buflen - 1;
-        if(0 != *b) { return(true); } // No trailing nulls at all, so don't trim frame size.
-        // Check for first non-zero byte from end backwards.
-        while(0 == *--b) { if(b == buf) { buflen = 1; return(true); } }
-        buflen = (uint8_t)(b - buf + 2);
-        return(true);
+        // Need at least fl, fType, seqLen/il and one further byte.
+        if(buflen < 4) { return(FPS_OTHER); }
+        const uint8_t fl = buf[0];
+        // Frame length excluding fl byte, at least 4 (type, seq/il, bl, trailer bytes), within the buffer.
+        if((fl < 4) || (fl > SecurableFrameHeader::maxSmallFrameSize) || (fl >= buflen)) { return(FPS_OTHER); }
+        const uint8_t fType = buf[1];
+        const uint8_t t = fType & 0x7f;
+        if((FTS_NONE == t) || (FTS_INVALID_HIGH == t)) { return(FPS_OTHER); }
+        // ID length must be valid and fit in the frame.
+        const uint8_t il = buf[2] & 0xf;
+        if((il > SecurableFrameHeader::maxIDLength) || (il > fl - 4)) { return(FPS_OTHER); }
+        if(0 == (fType & 0x80)) { return(FPS_NONSECURE); }
+        return((FTS_BasicSensorOrValve == t) ? FPS_SECURE_VALVE : FPS_SECURE);
         }
 
     // Set (or clear) the optional fast filter for RX ISR/poll; NULL to clear.
@@ -103,6 +118,55 @@ namespace OTRadioLink
         ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
             { filterRXISR = filterRX; }
         }
+
+    // Copy a raw frame to the TX queue to be sent by poll(), without blocking.
+    // Returns false if no TX queue is set, the frame is too long for it, or the queue is full.
+    bool OTRadioLink::queueToSendAsync(const uint8_t *const buf, const uint8_t buflen, const int8_t channel, const TXpower power,
+                                       TXCompletion_t *const callback, void *const context)
+        {
+        if(NULL == txQueue) { return(false); } // ERROR
+        if(txQueue->isFull()) { ++rejectedTXMessageCountRecent; return(false); }
+        return(txQueue->enqueue(buf, buflen, channel, (uint8_t)power, callback, context));
+        }
+
+    // Advance the TX queue: complete the frame being sent (calling its callback) if it is done,
+    // and start the next, as many frames as complete immediately.
+    void OTRadioLink::_pollTX()
+        {
+        if(NULL == txQueue) { return; }
+        for( ; ; )
+            {
+            if(!txQueueBusy)
+                {
+                uint8_t buflen;
+                int8_t channel;
+                uint8_t power;
+                const uint8_t *const buf = txQueue->peek(buflen, channel, power);
+                if(NULL == buf) { return; } // Nothing (more) to send.
+                txQueueBusy = _TXstart(buf, buflen, channel, power);
+                if(txQueueBusy) { continue; }
+                // Could not start: fail the frame.
+                void *context;
+                TXCompletion_t *const callback = txQueue->remove(context);
+                if(NULL != callback) { callback(context, false); }
+                continue;
+                }
+            const uint8_t status = _TXpoll();
+            if(TXS_BUSY == status) { return; } // Still sending.
+            txQueueBusy = false;
+            void *context;
+            TXCompletion_t *const callback = txQueue->remove(context);
+            if(NULL != callback) { callback(context, TXS_SENT == status); }
+            }
+        }
+
+    // Set (or clear) the optional fast RX frame classifier for RX ISR/poll; NULL to clear.
+    void OTRadioLink::setPriorityRXISR(quickFramePriority_t *const priorityRX)
+        {
+        // Lock out interrupts to ensure no partial pointer is seen.
+        ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+            { priorityRXISR = priorityRX; }
+        }
     }
 
 
@@ -30,6 +30,9 @@ Author(s) / Copyright (s): Damon Hart-Davis 2015--2016
 #include <Print.h>
 #include <OTV0p2Base.h>
 
+#include "OTRadioLink_ISRRXQueue.h"
+#include "OTRadioLink_TXQueue.h"
+
 
 // Use namespaces to help avoid collisions.
 namespace OTRadioLink
@@ -103,6 +106,29 @@ namespace OTRadioLink
     // Always returns true, ie never rejects a frame outright.
     quickFrameFilter_t frameFilterTrailingZeros;
 
+    // Type of a fast ISR-safe routine to assign a priority class to an RX frame that is to be queued.
+    // Returns the class, 0 being the lowest; the number of classes depends on the routine.
+    // When a priority RX queue is full, the oldest frame of the lowest class queued is dropped,
+    // rather than the newest frame, so that (eg) valve reports are not lost to a flood of other traffic.
+    // Called after any quickFrameFilter_t, with the same constraints.
+    // The buffer content may not be altered.
+    typedef uint8_t quickFramePriority_t(const volatile uint8_t *buf, uint8_t buflen);
+
+    // Priority classes from framePrioritySecureable(), lowest first.
+    enum FramePrioritySecureable
+        {
+        FPS_OTHER,          // Not apparently a secureable frame, eg FS20 or raw JSON.
+        FPS_NONSECURE,      // Plausible non-secure secureable frame.
+        FPS_SECURE,         // Plausible secure frame.
+        FPS_SECURE_VALVE,   // Plausible secure FTS_BasicSensorOrValve frame.
+        FPS_CLASSES         // Number of classes.
+        };
+    // Classify a frame by a quick plausibility check of the secureable frame header.
+    // Puts secure frames above non-secure and both above other traffic,
+    // with secure valve/sensor frames highest.
+    // Does not validate the frame fully nor check any CRC or authentication.
+    quickFramePriority_t framePrioritySecureable;
+
     // Base class for radio link hardware driver.
     // Radios can support multiple channels and can be (for example) TX-only for leaf nodes.
     // Implementation cannot be assume to either re-entrant or ISR-safe except where stated.
@@ -111,6 +137,7 @@ namespace OTRadioLink
         public:
             // Import typedef into this class for itself and derived classes.
             typedef ::OTRadioLink::quickFrameFilter_t quickFrameFilter_t;
+            typedef ::OTRadioLink::quickFramePriority_t quickFramePriority_t;
 
         private:
             // Channel being listened on or -1.
@@ -146,6 +173,22 @@ namespace OTRadioLink
             // Marked volatile for ISR-/thread- access.
             volatile quickFrameFilter_t *filterRXISR;
 
+            // Optional fast RX frame classifier for RX ISR/poll; NULL if not present.
+            // Only used where the RX queue supports priorities, else frames are all treated alike.
+            // This pointer must by updated only with interrupts locked out.
+            // Marked volatile for ISR-/thread- access.
+            volatile quickFramePriority_t *priorityRXISR;
+
+            // Optional queue of frames to send from poll(); NULL if none.
+            TXQueue *txQueue;
+            // True while the oldest frame in txQueue is being sent.
+            bool txQueueBusy;
+            // Result of the last synchronous send by the default _TXstart().
+            bool txLastSent;
+            // Current recent/short count of frames refused by queueToSendAsync() because the TX queue was full.
+            // This value wraps after 255/0xff.
+            volatile uint8_t rejectedTXMessageCountRecent;
+
             // Configure the hardware.
             // Called from configure() once nChannels and channelConfig is set.
             // Returns false if hardware not present or configuration is invalid.
@@ -157,19 +200,46 @@ namespace OTRadioLink
             // listenChannel will have been set by time this is called.
             virtual void _dolisten() = 0;
 
+            // TX status from _TXpoll().
+            enum TXStatus { TXS_BUSY, TXS_SENT, TXS_FAILED };
+
+            // Start sending a frame from the TX queue, without waiting for it to go if possible.
+            // The frame buffer remains valid until _TXpoll() returns other than TXS_BUSY.
+            // Returns false if the frame could not be started, in which case it has failed.
+            // Defaults to send the frame with sendRaw(), so blocking while it is sent.
+            virtual bool _TXstart(const uint8_t *buf, uint8_t buflen, int8_t channel, uint8_t power)
+                { txLastSent = sendRaw(buf, buflen, channel, (TXpower)power); return(true); }
+            // Check the progress of the frame started by _TXstart().
+            // Returns TXS_BUSY until it has been sent (TXS_SENT) or has failed (TXS_FAILED),
+            // when the radio is idle again and has reverted to listening if enabled.
+            // Defaults to report the result of the sendRaw() from the default _TXstart().
+            virtual uint8_t _TXpoll() { return(txLastSent ? TXS_SENT : TXS_FAILED); }
+            // Advance the TX queue: complete the frame being sent (calling its callback) if it is done,
+            // and start the next, as many frames as complete immediately.
+            // Implementations of poll() that support the TX queue should call this,
+            // outside of any ATOMIC_BLOCK; never call from an ISR.
+            void _pollTX();
+
         public:
             OTRadioLink()
               : listenChannel(-1), nChannels(0), channelConfig(NULL),
                 droppedRXedMessageCountRecent(0), filteredRXedMessageCountRecent(0),
-                filterRXISR(NULL)
+                filterRXISR(NULL), priorityRXISR(NULL),
+                txQueue(NULL), txQueueBusy(false), txLastSent(false), rejectedTXMessageCountRecent(0)
                 { }
 
             // Set (or clear) the optional fast filter for RX ISR/poll; NULL to clear.
             // The routine should return false to drop an inbound frame early in processing,
             // to save queue space and CPU, and cope better with a busy channel.
             // At most one filter can be set; setting a new one clears any previous.
+            // To apply several tests use a FrameFilterChain (OTRadioLink_FrameFilterChain.h).
             void setFilterRXISR(quickFrameFilter_t *const filterRX);
 
+            // Set (or clear) the optional fast RX frame classifier for RX ISR/poll; NULL to clear.
+            // Where the RX queue supports priorities, a full queue drops the oldest lowest-priority frame;
+            // without a classifier all frames have priority 0, so the oldest queued frame after the first is dropped.
+            void setPriorityRXISR(quickFramePriority_t *const priorityRX);
+
             // Do very minimal pre-initialisation, eg at power up, to get radio to safe low-power mode.
             // Argument is read-only pre-configuration data;
             // may be mandatory for some radio types, else can be NULL.
@@ -276,6 +346,34 @@ namespace OTRadioLink
             // Not intended to be called from an ISR.
             virtual void removeRXMsg() = 0;
 
+            // Pass up to maxMsgs queued RX messages in place to the handler, oldest first,
+            // then remove those that it has dealt with (see ISRRXDrainHandler_t).
+            // Returns the number of messages dealt with and removed; 0 if the handler is NULL.
+            // Implementations with an ISRRXQueue may do this more cheaply than
+            // peekRXMsg()/removeRXMsg() for each message.
+            // Not intended to be called from an ISR.
+            virtual uint8_t drainRXMsgs(ISRRXDrainHandler_t *handler, void *context, uint8_t maxMsgs = 255)
+                {
+                if(NULL == handler) { return(0); } // ERROR
+                uint8_t done = 0;
+                while(done < maxMsgs)
+                    {
+                    uint8_t len;
+                    const volatile uint8_t *const buf = peekRXMsg(len);
+                    if((NULL == buf) || !handler(context, buf, len)) { break; }
+                    removeRXMsg();
+                    ++done;
+                    }
+                return(done);
+                }
+
+            // Get metadata (eg arrival time and RSSI) for the first (oldest) queued RX message.
+            // Returns false (and leaves m unchanged) if there is no message
+            // or this link does not keep RX metadata.
+            // Valid until the next removeRXMessage().
+            // Not intended to be called from an ISR.
+            virtual bool peekRXMetadata(ISRRXFrameMetadata &/*m*/) const { return(false); }
+
             // Basic RX error numbers in range 0--127 as returned by getRXRerr() (cast to uint8_t).
             // Implementations can provide more specific errors in range 128--255.
             // 0 (zero) means no error.
@@ -323,9 +421,52 @@ namespace OTRadioLink
             //   * power  hint to indicate transmission importance
             //     and thus possibly power or other efforts to get it heard;
             //     this hint may be ignored.
-            // Defaults to redirect to sendRaw(), in which case see sendRaw() comments.
+            // Defaults to queueToSendAsync() without a callback if a TX queue has been set,
+            // else to redirect to sendRaw(), in which case see sendRaw() comments.
             // Should not block unless in a call to sendRaw().
-            virtual bool queueToSend(const uint8_t *buf, uint8_t buflen, int8_t channel = 0, TXpower power = TXnormal) { return sendRaw(buf, buflen, channel, power); };
+            virtual bool queueToSend(const uint8_t *buf, uint8_t buflen, int8_t channel = 0, TXpower power = TXnormal)
+                {
+                if(NULL != txQueue) { return(queueToSendAsync(buf, buflen, channel, power)); }
+                return sendRaw(buf, buflen, channel, power);
+                }
+
+            // True if poll() sends frames from a TX queue (by calling _pollTX()), so that one may be set.
+            // Defaults to true, as the default poll() does;
+            // links that override poll() without calling _pollTX() must return false.
+            virtual bool supportsTXQueue() const { return(true); }
+
+            // Set (or clear, with NULL) the queue of frames to send from poll().
+            // Must be empty and only be changed when no queued frame is being sent,
+            // eg before begin() or when getTXMsgsQueued() is 0.
+            // Returns false, leaving the queue unchanged, if a frame is being sent
+            // or (unless clearing) this link does not support a TX queue.
+            bool setTXQueue(TXQueue *const q)
+                {
+                if(txQueueBusy) { return(false); } // ERROR
+                if((NULL != q) && !supportsTXQueue()) { return(false); } // ERROR
+                txQueue = q;
+                return(true);
+                }
+
+            // Copy a raw frame to the TX queue to be sent by poll(), without blocking.
+            // The frame is sent on the given channel and with the given power as for sendRaw().
+            // If callback is not NULL it is called from poll() with context
+            // once the frame has been sent or has failed.
+            // Returns false if no TX queue is set, the frame is too long for it,
+            // or the queue is full, ie back-pressure: the caller should try again later or drop the frame.
+            // Not intended to be called from an ISR.
+            bool queueToSendAsync(const uint8_t *buf, uint8_t buflen, int8_t channel = 0, TXpower power = TXnormal,
+                                  TXCompletion_t *callback = NULL, void *context = NULL);
+
+            // Number of frames in the TX queue, including any being sent; 0 if there is no TX queue.
+            // ISR-/thread- safe.
+            uint8_t getTXMsgsQueued() const { return((NULL == txQueue) ? 0 : txQueue->getMsgsQueued()); }
+            // True if a TX queue is set and is full, so that queueToSendAsync() would refuse a frame.
+            bool isTXQueueFull() const { return((NULL != txQueue) && txQueue->isFull()); }
+            // Current recent/short count of frames refused by queueToSendAsync() because the TX queue was full.
+            // This value wraps after 255/0xff.
+            // ISR-/thread- safe.
+            inline uint8_t getTXMsgsRejectedRecent() const { return(rejectedTXMessageCountRecent); }
 
             // Poll for incoming messages (eg where interrupts are not available) and other processing.
             // Can be used safely in addition to handling inbound/outbound interrupts.
@@ -334,8 +475,8 @@ namespace OTRadioLink
             // May also be used for output processing,
             // eg to run a transmit state machine.
             // May be called very frequently and should not take more than a few 100ms per call.
-            // Default is to do nothing.
-            virtual void poll() { }
+            // Default is to advance any TX queue.
+            virtual void poll() { _pollTX(); }
 
             // Handle simple interrupt for this radio link.
             // Must be fast and ISR (Interrupt Service Routine) safe.
@@ -0,0 +1,93 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+/*
+ * Quick RX prefilters on sender ID.
+ */
+
+#include "OTRadioLink_RXIDPrefilter.h"
+
+namespace OTRadioLink
+    {
+
+
+#if !defined(__AVR__)
+// Bits for the given number of IDs: a power of 2 of at least 16 per ID, and at least 1024.
+uint32_t RXIDPrefilterBloom::sizeFor(const uint32_t expectedIDs)
+    {
+    uint32_t n = 1024;
+    while((n < 16 * (uint64_t)expectedIDs) && (n < 0x80000000UL)) { n <<= 1; }
+    return(n);
+    }
+
+RXIDPrefilterBloom::RXIDPrefilterBloom(const uint32_t expectedIDs, const uint8_t keyBytes_)
+  : words(new uint32_t[sizeFor(expectedIDs) / 32]), mask(sizeFor(expectedIDs) - 1),
+    keyBytes((keyBytes_ < 1) ? 1 : ((keyBytes_ > 8) ? 8 : keyBytes_))
+    { clear(); }
+
+RXIDPrefilterBloom::~RXIDPrefilterBloom() { delete[] words; }
+
+// FNV-1a 64-bit hash of the key, with a final mix so that both halves are usable.
+uint64_t RXIDPrefilterBloom::hash(const volatile uint8_t *const key) const
+    {
+    uint64_t h = 14695981039346656037ULL;
+    for(uint8_t i = 0; i < keyBytes; ++i) { h = (h ^ key[i]) * 1099511628211ULL; }
+    h ^= h >> 29;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 32;
+    return(h);
+    }
+
+// Add an ID (of at least keyBytes bytes); ignored if NULL.
+void RXIDPrefilterBloom::add(const uint8_t *const id)
+    {
+    if(NULL == id) { return; } // ERROR
+    const uint64_t h = hash(id);
+    // Double hashing: positions h1 + i*h2, with h2 odd so that they are distinct.
+    const uint32_t h1 = (uint32_t)h;
+    const uint32_t h2 = (uint32_t)(h >> 32) | 1;
+    for(uint8_t i = 0; i < HASHES; ++i)
+        {
+        const uint32_t b = (h1 + i * h2) & mask;
+        __atomic_fetch_or(&words[b >> 5], (uint32_t)1 << (b & 31), __ATOMIC_RELAXED);
+        }
+    }
+
+// True if the key (the leading keyBytes bytes of an ID) may be in the set.
+bool RXIDPrefilterBloom::mayContain(const volatile uint8_t *const key) const
+    {
+    const uint64_t h = hash(key);
+    const uint32_t h1 = (uint32_t)h;
+    const uint32_t h2 = (uint32_t)(h >> 32) | 1;
+    for(uint8_t i = 0; i < HASHES; ++i)
+        {
+        const uint32_t b = (h1 + i * h2) & mask;
+        if(0 == (__atomic_load_n(&words[b >> 5], __ATOMIC_RELAXED) & ((uint32_t)1 << (b & 31)))) { return(false); }
+        }
+    return(true);
+    }
+
+// Remove all IDs.
+void RXIDPrefilterBloom::clear()
+    {
+    for(uint32_t i = 0; i <= (mask >> 5); ++i) { words[i] = 0; }
+    }
+#endif // !defined(__AVR__)
+
+
+    }
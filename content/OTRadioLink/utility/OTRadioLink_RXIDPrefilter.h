@@ -0,0 +1,186 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+/*
+ * Quick RX prefilters on sender ID, to drop frames from foreign nodes in the RX ISR.
+ *
+ * A receiver (eg a hub) may hear many nodes from neighbouring installations
+ * whose frames it would only discard after fully decoding them.
+ * These filters hold a compact set of the leading bytes of authorised node IDs
+ * and reject any secureable frame whose ID does not start with one of them,
+ * before the frame occupies RX queue space.
+ * Membership tests may give false positives (later stages must still check the ID)
+ * but never false negatives.
+ *
+ * RXIDPrefilterBitset is a small fixed bitset of hashed ID prefixes, eg 32 bytes on the AVR.
+ * RXIDPrefilterBloom (not AVR) is a Bloom filter sized for many IDs, eg at a hub.
+ *
+ * Either can be used as a quickFrameFilter_t or FrameFilterChain stage via FrameFilterIDPrefilter, eg:
+ *     static OTRadioLink::RXIDPrefilterBitset<> authIDs;
+ *     ...
+ *     authIDs.add(id);
+ *     radio.setFilterRXISR(OTRadioLink::FrameFilterIDPrefilter<OTRadioLink::RXIDPrefilterBitset<>, &authIDs>::filter);
+ */
+
+#ifndef ARDUINO_LIB_OTRADIOLINK_RXIDPREFILTER_H
+#define ARDUINO_LIB_OTRADIOLINK_RXIDPREFILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "OTRadioLink_FrameFilterChain.h"
+
+// Use namespaces to help avoid collisions.
+namespace OTRadioLink
+    {
+
+
+    // Get the leading keyBytes bytes of the ID of a secureable frame, or NULL if it has no such ID.
+    // The frame must be at least long enough to hold them, and have an ID length (low nibble of buf[2])
+    // of at least keyBytes, and the ID starts at buf[3].
+    inline const volatile uint8_t *getSecureableFrameIDPrefix(const volatile uint8_t *const buf, const uint8_t buflen,
+                                                              const uint8_t keyBytes)
+        {
+        if(buflen < 3 + keyBytes) { return(NULL); }
+        if((buf[2] & 0xf) < keyBytes) { return(NULL); }
+        return(buf + 3);
+        }
+
+    // Set of (hashed) leading ID bytes in a fixed bitset of bits bits, a power of 2 up to 2^15.
+    // Uses the first keyBytes bytes of each ID, usually the first 2 on the AVR.
+    // A single hash is used, so with n IDs the chance of a false positive is about n/bits.
+    // add() and clear() are not ISR-safe: populate before setting as a filter,
+    // or with interrupts blocked.
+    template<uint16_t bits = 256, uint8_t keyBytes = 2>
+    class RXIDPrefilterBitset
+        {
+        private:
+            // hash() masks with bits-1.
+            static_assert((0 != bits) && (0 == (bits & (bits - 1))), "bits must be a non-zero power of 2");
+
+            volatile uint8_t set[(bits + 7) / 8];
+
+            // Bit number of the given key.
+            static inline uint16_t hash(const volatile uint8_t *const key)
+                {
+                uint16_t h = 0;
+                for(uint8_t i = 0; i < keyBytes; ++i) { h = (uint16_t)((h << 5) | (h >> 11)) ^ key[i]; }
+                h ^= (h >> 8) * 0x9d;
+                return(h & (bits - 1));
+                }
+
+        public:
+            // Number of leading ID bytes used.
+            static const uint8_t KEY_BYTES = keyBytes;
+
+            RXIDPrefilterBitset() { clear(); }
+
+            // Add an ID (of at least keyBytes bytes); ignored if NULL.
+            void add(const uint8_t *const id)
+                {
+                if(NULL == id) { return; } // ERROR
+                const uint16_t h = hash(id);
+                set[h >> 3] |= (uint8_t)(1 << (h & 7));
+                }
+            // Add n IDs, each idLen (>= keyBytes) bytes, stored consecutively.
+            void addAll(const uint8_t *ids, uint16_t n, const uint8_t idLen)
+                { if(NULL != ids) { for( ; n-- > 0; ids += idLen) { add(ids); } } }
+
+            // True if the key (the leading keyBytes bytes of an ID) may be in the set.
+            // ISR-safe.
+            inline bool mayContain(const volatile uint8_t *const key) const
+                {
+                const uint16_t h = hash(key);
+                return(0 != (set[h >> 3] & (1 << (h & 7))));
+                }
+
+            // True if the frame is a secureable frame whose ID may be in the set.
+            // ISR-safe.
+            inline bool filterFrame(const volatile uint8_t *const buf, const uint8_t buflen) const
+                {
+                const volatile uint8_t *const key = getSecureableFrameIDPrefix(buf, buflen, keyBytes);
+                return((NULL != key) && mayContain(key));
+                }
+
+            // Remove all IDs.
+            void clear() { for(uint16_t i = 0; i < sizeof(set); ++i) { set[i] = 0; } }
+        };
+
+#if !defined(__AVR__)
+    // Bloom filter of the leading keyBytes (1 to 8) bytes of IDs, eg all the authorised IDs at a hub.
+    // Sized on construction for about 16 bits per expected ID, with 4 hashes,
+    // giving a false positive rate of about 0.25% when holding that many IDs.
+    // add() may be called while filtering from another thread (bits are only ever set)
+    // but clear() must not be.
+    class RXIDPrefilterBloom
+        {
+        private:
+            // Bit set, of mask+1 bits.
+            volatile uint32_t *const words;
+            const uint32_t mask;
+            const uint8_t keyBytes;
+
+            // Number of bit positions set per key.
+            static const uint8_t HASHES = 4;
+
+            static uint32_t sizeFor(uint32_t expectedIDs);
+            // 64-bit hash of the key, split to make the bit positions.
+            uint64_t hash(const volatile uint8_t *key) const;
+
+            // Not copyable.
+            RXIDPrefilterBloom(const RXIDPrefilterBloom &) = delete;
+            RXIDPrefilterBloom &operator=(const RXIDPrefilterBloom &) = delete;
+
+        public:
+            // Create an empty filter for about the given number of IDs, using their leading keyBytes bytes.
+            // keyBytes is coerced to [1,8].
+            explicit RXIDPrefilterBloom(uint32_t expectedIDs, uint8_t keyBytes = 4);
+            ~RXIDPrefilterBloom();
+
+            // As for RXIDPrefilterBitset.
+            void add(const uint8_t *id);
+            void addAll(const uint8_t *ids, uint32_t n, uint8_t idLen)
+                { if(NULL != ids) { for( ; n-- > 0; ids += idLen) { add(ids); } } }
+            bool mayContain(const volatile uint8_t *key) const;
+            bool filterFrame(const volatile uint8_t *const buf, const uint8_t buflen) const
+                {
+                const volatile uint8_t *const key = getSecureableFrameIDPrefix(buf, buflen, keyBytes);
+                return((NULL != key) && mayContain(key));
+                }
+            void clear();
+
+            uint8_t getKeyBytes() const { return(keyBytes); }
+            // Size of the bit set in bits.
+            uint32_t getBits() const { return(mask + 1); }
+        };
+#endif // !defined(__AVR__)
+
+    // FrameFilterChain stage, and quickFrameFilter_t routine (filter), for a given ID prefilter object f,
+    // eg an RXIDPrefilterBitset or RXIDPrefilterBloom with static storage.
+    // Rejects frames without an ID or whose ID is not (apparently) in the filter's set.
+    template<typename F, F *f>
+    struct FrameFilterIDPrefilter
+        {
+        static bool filter(const volatile uint8_t *const buf, volatile uint8_t &buflen)
+            { return(f->filterFrame(buf, buflen)); }
+        };
+
+
+    }
+
+#endif
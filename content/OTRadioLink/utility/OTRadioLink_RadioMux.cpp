@@ -0,0 +1,305 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+/*
+ * Multiplexer over several radio links.
+ */
+
+#include <string.h>
+
+// Standard library headers first, before Arduino.h defines min() and max() as macros.
+#if !defined(__AVR__)
+#include <chrono>
+#include <exception>
+#include <thread>
+#endif
+
+#include "OTRadioLink_RadioMux.h"
+
+namespace OTRadioLink
+    {
+
+
+// Links (as a bit mask) to send the frame on.
+uint8_t RadioMuxTXRoutes::route(const uint8_t *const buf, const uint8_t buflen) const
+    {
+    if(NULL == buf) { return(0); } // ERROR
+    for(uint8_t i = 0; i < nRoutes; ++i)
+        {
+        const RadioMuxTXRoute &r = routes[i];
+        if((r.offset < buflen) && (r.value == (buf[r.offset] & r.mask))) { return(r.links); }
+        }
+    return(defaultLinks);
+    }
+
+RadioMux::RadioMux(OTRadioLink *const *const links_, const uint8_t nLinks_, ISRRXQueue &rxQueue_)
+  : links(links_), nLinks((NULL == links_) ? 0 : ((nLinks_ > MAX_LINKS) ? MAX_LINKS : nLinks_)),
+    rxQueue(rxQueue_), nextLink(0), droppedRXCountRecent(0)
+    { }
+
+// Move frames received by link i into the merged queue until it is full;
+// returns the number moved.
+uint8_t RadioMux::_collectRX(const uint8_t i)
+    {
+    OTRadioLink &l = *links[i];
+    uint8_t queueRXMsgsMin, maxRXMsgLen;
+    rxQueue.getRXCapacity(queueRXMsgsMin, maxRXMsgLen);
+    uint8_t moved = 0;
+    for( ; ; )
+        {
+        uint8_t len;
+        const volatile uint8_t *const src = l.peekRXMsg(len);
+        if(NULL == src) { break; }
+        if(len >= maxRXMsgLen) { ++droppedRXCountRecent; l.removeRXMsg(); continue; } // Too long.
+        // Leave the frame with the link if there is no room for it yet.
+        volatile uint8_t *const dest = rxQueue._getRXBufForInbound();
+        if(NULL == dest) { break; }
+        dest[0] = i;
+        for(uint8_t j = 0; j < len; ++j) { dest[j+1] = src[j]; }
+        rxQueue._loadedBuf(len + 1);
+        l.removeRXMsg();
+        ++moved;
+        }
+    return(moved);
+    }
+
+// Poll all the links, then collect their received frames into the merged queue.
+// Returns the number of frames collected.
+uint8_t RadioMux::poll()
+    {
+    if(0 == nLinks) { return(0); }
+    for(uint8_t i = 0; i < nLinks; ++i) { links[i]->poll(); }
+    // Start with a different link each time so that none is starved when the merged queue fills.
+    uint8_t collected = 0;
+    const uint8_t first = nextLink;
+    for(uint8_t n = 0; n < nLinks; ++n)
+        {
+        uint8_t i = first + n;
+        if(i >= nLinks) { i -= nLinks; }
+        collected += _collectRX(i);
+        }
+    if(++nextLink >= nLinks) { nextLink = 0; }
+    return(collected);
+    }
+
+// Send the frame with queueToSend() on each of the given links (a bit mask), ie fan-out.
+// Returns the links (a bit mask) that accepted it.
+uint8_t RadioMux::sendTo(const uint8_t linkMask, const uint8_t *const buf, const uint8_t buflen,
+                         const int8_t channel, const OTRadioLink::TXpower power)
+    {
+    uint8_t sent = 0;
+    for(uint8_t i = 0; i < nLinks; ++i)
+        {
+        const uint8_t bit = (uint8_t)(1 << i);
+        if((0 != (linkMask & bit)) && links[i]->queueToSend(buf, buflen, channel, power)) { sent |= bit; }
+        }
+    return(sent);
+    }
+
+// Peek at the oldest frame in the merged RX queue, with the index of the link it arrived on;
+// NULL if none.
+const volatile uint8_t *RadioMux::peekRXMsg(uint8_t &len, uint8_t &link) const
+    {
+    uint8_t l;
+    const volatile uint8_t *const p = rxQueue.peekRXMsg(l);
+    if(NULL == p) { return(NULL); }
+    link = p[0];
+    len = l - 1;
+    return(p + 1);
+    }
+
+
+#if !defined(__AVR__)
+// Slots for at least the given capacity: a power of 2, at least 2.
+uint32_t RadioMuxMPSCQueue::sizeFor(const uint32_t capacity)
+    {
+    uint32_t n = 2;
+    while((n < capacity) && (n < 0x80000000UL)) { n <<= 1; }
+    return(n);
+    }
+
+RadioMuxMPSCQueue::RadioMuxMPSCQueue(const uint32_t capacity)
+  : slots(new Slot[sizeFor(capacity)]), mask(sizeFor(capacity) - 1), tail(0), head(0)
+    {
+    // Each slot is free for the producer whose claimed position equals its sequence number.
+    for(uint32_t i = 0; i <= mask; ++i) { slots[i].seq = i; }
+    }
+
+RadioMuxMPSCQueue::~RadioMuxMPSCQueue() { delete[] slots; }
+
+// Approximate number of frames queued, including any being published.
+uint32_t RadioMuxMPSCQueue::getMsgsQueued() const
+    { return(__atomic_load_n(&tail, __ATOMIC_RELAXED) - __atomic_load_n(&head, __ATOMIC_RELAXED)); }
+
+// Copy a frame to the queue; returns false if the queue is full (or buf is NULL).
+bool RadioMuxMPSCQueue::enqueue(const uint8_t tag, const volatile uint8_t *const buf, const uint8_t buflen)
+    {
+    if(NULL == buf) { return(false); } // ERROR
+    uint32_t pos = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+    Slot *s;
+    for( ; ; )
+        {
+        s = slots + (pos & mask);
+        const int32_t diff = (int32_t)(__atomic_load_n(&s->seq, __ATOMIC_ACQUIRE) - pos);
+        if(0 == diff)
+            {
+            // Slot free: try to claim it (pos is refreshed on failure).
+            if(__atomic_compare_exchange_n(&tail, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) { break; }
+            }
+        else if(diff < 0) { return(false); } // Full: the slot still holds a frame from the previous lap.
+        else { pos = __atomic_load_n(&tail, __ATOMIC_RELAXED); } // Another producer claimed it.
+        }
+    s->len = buflen;
+    s->tag = tag;
+    for(uint8_t i = 0; i < buflen; ++i) { s->buf[i] = buf[i]; }
+    // Publish the frame.
+    __atomic_store_n(&s->seq, pos + 1, __ATOMIC_RELEASE);
+    return(true);
+    }
+
+// Peek at the oldest frame and its tag; NULL if none.
+const uint8_t *RadioMuxMPSCQueue::peek(uint8_t &len, uint8_t &tag) const
+    {
+    const Slot *const s = slots + (head & mask);
+    if(__atomic_load_n(&s->seq, __ATOMIC_ACQUIRE) != head + 1) { return(NULL); } // Not (yet) published.
+    len = s->len;
+    tag = s->tag;
+    return(s->buf);
+    }
+
+// Remove the oldest frame; does nothing if none.
+void RadioMuxMPSCQueue::remove()
+    {
+    Slot *const s = slots + (head & mask);
+    if(__atomic_load_n(&s->seq, __ATOMIC_ACQUIRE) != head + 1) { return; }
+    // Free the slot for the producer one lap on.
+    __atomic_store_n(&s->seq, head + mask + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&head, head + 1, __ATOMIC_RELAXED);
+    }
+
+// Per-link thread and TX queue.
+// Frames to send are queued by the consumer (the only producer) and sent by the link's thread,
+// each preceded by its channel and power.
+struct RadioMuxThreaded::Worker
+    {
+    std::thread thread;
+    ISRRXQueueVarLenMsgSPSC<MAX_TX_BYTES + 2, 4, uint16_t> txQueue;
+    };
+
+RadioMuxThreaded::RadioMuxThreaded(OTRadioLink *const *const links_, const uint8_t nLinks_, const uint32_t rxCapacity)
+  : links(links_), nLinks((NULL == links_) ? 0 : ((nLinks_ > RadioMux::MAX_LINKS) ? RadioMux::MAX_LINKS : nLinks_)),
+    rxQueue(rxCapacity), workers(new Worker[(0 == nLinks) ? 1 : nLinks]),
+    idleSleepUs(1000), running(false)
+    { }
+
+RadioMuxThreaded::~RadioMuxThreaded()
+    {
+    stop();
+    delete[] workers;
+    }
+
+// Body of the thread for link i.
+void RadioMuxThreaded::_run(const uint8_t i)
+    {
+    OTRadioLink &l = *links[i];
+    Worker &w = workers[i];
+    uint8_t txBuf[MAX_TX_BYTES];
+    while(__atomic_load_n(&running, __ATOMIC_ACQUIRE))
+        {
+        bool busy = false;
+        l.poll();
+        // Move received frames to the shared queue, leaving any that do not fit for next time.
+        for( ; ; )
+            {
+            uint8_t len;
+            const volatile uint8_t *const buf = l.peekRXMsg(len);
+            if(NULL == buf) { break; }
+            if(!rxQueue.enqueue(i, buf, len)) { break; }
+            l.removeRXMsg();
+            busy = true;
+            }
+        // Send queued frames.
+        for( ; ; )
+            {
+            uint8_t len;
+            const volatile uint8_t *const buf = w.txQueue.peekRXMsg(len);
+            if(NULL == buf) { break; }
+            const uint8_t n = len - 2;
+            for(uint8_t j = 0; j < n; ++j) { txBuf[j] = buf[j+2]; }
+            l.sendRaw(txBuf, n, (int8_t)buf[0], (OTRadioLink::TXpower)buf[1]);
+            w.txQueue.removeRXMsg();
+            busy = true;
+            }
+        if(!busy) { std::this_thread::sleep_for(std::chrono::microseconds(idleSleepUs)); }
+        }
+    }
+
+// Start a thread for each link, which sleeps for idleSleepUs when idle.
+// Returns false if already running or there are no links.
+bool RadioMuxThreaded::start(const uint32_t idleSleepUs_)
+    {
+    if(isRunning() || (0 == nLinks)) { return(false); }
+    idleSleepUs = idleSleepUs_;
+    __atomic_store_n(&running, true, __ATOMIC_RELEASE);
+    try { for(uint8_t i = 0; i < nLinks; ++i) { workers[i].thread = std::thread(&RadioMuxThreaded::_run, this, i); } }
+    catch(const std::exception &) // eg std::system_error if no more threads are available.
+        {
+        // Roll back: stop and join the threads already started.
+        stop();
+        return(false); // ERROR
+        }
+    return(true);
+    }
+
+// Stop and join all the threads; does nothing if not running.
+void RadioMuxThreaded::stop()
+    {
+    if(!isRunning()) { return; }
+    __atomic_store_n(&running, false, __ATOMIC_RELEASE);
+    for(uint8_t i = 0; i < nLinks; ++i) { if(workers[i].thread.joinable()) { workers[i].thread.join(); } }
+    }
+
+// Queue the frame to be sent by the thread of each of the given links.
+// Returns the links (a bit mask) that accepted it.
+uint8_t RadioMuxThreaded::sendTo(const uint8_t linkMask, const uint8_t *const buf, const uint8_t buflen,
+                                 const int8_t channel, const OTRadioLink::TXpower power)
+    {
+    if((NULL == buf) || (0 == buflen) || (buflen > MAX_TX_BYTES)) { return(0); } // ERROR
+    uint8_t queued = 0;
+    for(uint8_t i = 0; i < nLinks; ++i)
+        {
+        const uint8_t bit = (uint8_t)(1 << i);
+        if(0 == (linkMask & bit)) { continue; }
+        volatile uint8_t *const dest = workers[i].txQueue._getRXBufForInbound();
+        if(NULL == dest) { continue; } // Full.
+        dest[0] = (uint8_t)channel;
+        dest[1] = (uint8_t)power;
+        for(uint8_t j = 0; j < buflen; ++j) { dest[j+2] = buf[j]; }
+        workers[i].txQueue._loadedBuf(buflen + 2);
+        queued |= bit;
+        }
+    return(queued);
+    }
+
+// Number of frames queued for TX by the given link's thread; 0 if out of range.
+uint8_t RadioMuxThreaded::getTXMsgsQueued(const uint8_t link) const
+    { return((link < nLinks) ? workers[link].txQueue.getRXMsgsQueued() : 0); }
+#endif // !defined(__AVR__)
+
+
+    }
@@ -0,0 +1,304 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+/*
+ * Multiplexer over several radio links, eg at a hub.
+ *
+ * A hub may have an RFM23B for local valves plus a SIM900 or RN2483 uplink,
+ * each an OTRadioLink with its own poll() and RX queue.
+ * RadioMux polls them all in one call and merges their received frames into a single queue,
+ * each tagged with the index of the link that received it,
+ * and sends frames to one or more links chosen by routing rules on the frame content.
+ *
+ * RadioMux runs in the caller's thread (and on the AVR), eg:
+ *     static OTRadioLink::OTRadioLink *const links[] = { &RFM23B, &SIM900 };
+ *     static OTRadioLink::RadioMuxFixed<64> mux(links, 2);
+ *     ...
+ *     mux.poll();
+ *     uint8_t len, link;
+ *     const volatile uint8_t *const buf = mux.peekRXMsg(len, link);
+ *
+ * RadioMuxThreaded (not AVR) instead runs each link's (possibly blocking) I/O on its own thread,
+ * feeding a shared lock-free queue read by the caller.
+ */
+
+#ifndef ARDUINO_LIB_OTRADIOLINK_RADIOMUX_H
+#define ARDUINO_LIB_OTRADIOLINK_RADIOMUX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "OTRadioLink_OTRadioLink.h"
+#include "OTRadioLink_ISRRXQueue.h"
+
+// Use namespaces to help avoid collisions.
+namespace OTRadioLink
+    {
+
+
+    // TX routing rule: a frame whose byte at offset, masked with mask, equals value
+    // is sent on each link whose bit (1 << index) is set in links.
+    // Eg to send secureable valve frames ('O') only on link 0:
+    //     { 1, 0x7f, OTRadioLink::FTS_BasicSensorOrValve, 1 }
+    struct RadioMuxTXRoute
+        {
+        uint8_t offset;
+        uint8_t mask;
+        uint8_t value;
+        uint8_t links;
+        };
+
+    // Ordered set of TX routing rules; the first matching rule applies,
+    // else frames go to the default links (all of them unless set otherwise).
+    struct RadioMuxTXRoutes
+        {
+        const RadioMuxTXRoute *routes;
+        uint8_t nRoutes;
+        uint8_t defaultLinks;
+
+        RadioMuxTXRoutes() : routes(NULL), nRoutes(0), defaultLinks(0xff) { }
+
+        // Links (as a bit mask) to send the frame on.
+        uint8_t route(const uint8_t *buf, uint8_t buflen) const;
+        };
+
+    // Multiplexer over up to MAX_LINKS radio links, run from the caller's thread.
+    // Received frames are merged into one ISRRXQueue, each preceded by the index of its link;
+    // that queue's frames must thus allow for one more byte than the links' largest frame.
+    // The links' own queues hold frames while the merged queue is full.
+    // Not intended to be used from an ISR.
+    class RadioMux
+        {
+        public:
+            // Maximum number of links, so that a set of links fits in a uint8_t bit mask.
+            static const uint8_t MAX_LINKS = 8;
+
+        protected:
+            // The links; nLinks of them.
+            OTRadioLink *const *const links;
+            const uint8_t nLinks;
+            // Merged RX queue.
+            ISRRXQueue &rxQueue;
+            // TX routing.
+            RadioMuxTXRoutes txRoutes;
+            // Link to collect RX frames from first on the next poll(), for fairness.
+            uint8_t nextLink;
+            // Recent/short count of frames dropped as too long for the merged queue; wraps.
+            uint8_t droppedRXCountRecent;
+
+            // Move frames received by link i into the merged queue until it is full;
+            // returns the number moved.
+            uint8_t _collectRX(uint8_t i);
+
+        public:
+            // Multiplex the given links (at most MAX_LINKS are used) into the given merged RX queue.
+            // The links array and queue must outlive this instance.
+            RadioMux(OTRadioLink *const *links, uint8_t nLinks, ISRRXQueue &rxQueue);
+
+            // Number of links and the link with the given index (NULL if out of range).
+            uint8_t getLinkCount() const { return(nLinks); }
+            OTRadioLink *getLink(const uint8_t i) const { return((i < nLinks) ? links[i] : NULL); }
+
+            // Set TX routing rules, tried in order, and the links for frames matching none.
+            // The rules are retained (not copied) so must outlive this instance.
+            void setTXRoutes(const RadioMuxTXRoute *routes, uint8_t nRoutes, uint8_t defaultLinks = 0xff)
+                { txRoutes.routes = routes; txRoutes.nRoutes = routes ? nRoutes : 0; txRoutes.defaultLinks = defaultLinks; }
+            // Links (as a bit mask) that queueToSend() would send the frame on.
+            uint8_t routeTX(const uint8_t *buf, uint8_t buflen) const
+                { return(txRoutes.route(buf, buflen) & (uint8_t)((1U << nLinks) - 1)); }
+
+            // Poll all the links, then collect their received frames into the merged queue.
+            // Returns the number of frames collected.
+            uint8_t poll();
+
+            // Send the frame with queueToSend() on each of the given links (a bit mask), ie fan-out.
+            // Returns the links (a bit mask) that accepted it.
+            uint8_t sendTo(uint8_t linkMask, const uint8_t *buf, uint8_t buflen,
+                           int8_t channel = 0, OTRadioLink::TXpower power = OTRadioLink::TXnormal);
+            // Send the frame on the links chosen by the TX routing rules.
+            // Returns the links (a bit mask) that accepted it; 0 if none.
+            uint8_t queueToSend(const uint8_t *buf, uint8_t buflen,
+                                int8_t channel = 0, OTRadioLink::TXpower power = OTRadioLink::TXnormal)
+                { return(sendTo(routeTX(buf, buflen), buf, buflen, channel, power)); }
+
+            // Number of frames in the merged RX queue.
+            uint8_t getRXMsgsQueued() const { return(rxQueue.getRXMsgsQueued()); }
+            // Peek at the oldest frame in the merged RX queue, with the index of the link it arrived on;
+            // NULL if none.
+            // Valid until removeRXMsg(); the buffer MUST NOT be altered.
+            const volatile uint8_t *peekRXMsg(uint8_t &len, uint8_t &link) const;
+            // Remove the oldest frame from the merged RX queue; does nothing if none.
+            void removeRXMsg() { rxQueue.removeRXMsg(); }
+            // Recent/short count of received frames dropped as too long for the merged queue; wraps.
+            uint8_t getRXMsgsDroppedRecent() const { return(droppedRXCountRecent); }
+        };
+
+    // RadioMux with its own merged RX queue for at least queueCapacity frames of up to maxRXBytes (< 255) bytes.
+    // On the AVR the queue has 8-bit indices so is capped at 256 bytes,
+    // and may then hold fewer (eg 3 frames of 64 bytes): see MinQueueCapacityMsgs.
+    template<uint8_t maxRXBytes, uint8_t queueCapacity = 4>
+    class RadioMuxFixed : public RadioMux
+        {
+        private:
+#if !defined(__AVR__)
+            typedef ISRRXQueueVarLenMsg<maxRXBytes + 1, queueCapacity, uint16_t> queue_t;
+            static_assert(queue_t::MinQueueCapacityMsgs >= queueCapacity, "merged RX queue smaller than queueCapacity");
+#else
+            typedef ISRRXQueueVarLenMsg<maxRXBytes + 1, queueCapacity> queue_t;
+#endif
+            queue_t q;
+        public:
+            // Number of frames of maxRXBytes that the merged RX queue can always hold.
+            static const uint8_t MinQueueCapacityMsgs = queue_t::MinQueueCapacityMsgs;
+            RadioMuxFixed(OTRadioLink *const *const links_, const uint8_t nLinks_) : RadioMux(links_, nLinks_, q) { }
+        };
+
+#if !defined(__AVR__)
+    // Bounded lock-free queue of frames, each tagged with a byte (eg a link index),
+    // for any number of producer threads and one consumer thread.
+    // Each of capacity (rounded up to a power of 2) slots holds a frame of up to 255 bytes.
+    // Producers claim a slot by advancing the tail with a compare-and-swap,
+    // then publish the frame with a release store of the slot's sequence number,
+    // which the consumer reads with an acquire load.
+    class RadioMuxMPSCQueue
+        {
+        private:
+            struct Slot
+                {
+                uint32_t seq;
+                uint8_t len;
+                uint8_t tag;
+                uint8_t buf[255];
+                };
+            Slot *const slots;
+            const uint32_t mask;
+            // Next slot to fill; advanced by producers.
+            uint32_t tail;
+            // Next slot to consume; consumer only.
+            uint32_t head;
+
+            static uint32_t sizeFor(uint32_t capacity);
+
+            // Not copyable.
+            RadioMuxMPSCQueue(const RadioMuxMPSCQueue &) = delete;
+            RadioMuxMPSCQueue &operator=(const RadioMuxMPSCQueue &) = delete;
+
+        public:
+            explicit RadioMuxMPSCQueue(uint32_t capacity);
+            ~RadioMuxMPSCQueue();
+
+            uint32_t getCapacity() const { return(mask + 1); }
+            // Approximate number of frames queued, including any being published.
+            uint32_t getMsgsQueued() const;
+
+            // Copy a frame to the queue; returns false if the queue is full (or buf is NULL).
+            // Any thread.
+            bool enqueue(uint8_t tag, const volatile uint8_t *buf, uint8_t buflen);
+
+            // Peek at the oldest frame and its tag; NULL if none.
+            // Valid until remove().
+            // Consumer only.
+            const uint8_t *peek(uint8_t &len, uint8_t &tag) const;
+            // Remove the oldest frame; does nothing if none.
+            // Consumer only.
+            void remove();
+        };
+
+    // Multiplexer over up to RadioMux::MAX_LINKS radio links, each with a thread of its own.
+    // Each link's thread repeatedly calls its poll(), moves its received frames into a shared RadioMuxMPSCQueue,
+    // and sends the frames queued for it, sleeping briefly when there is nothing to do;
+    // all of a link's I/O is thus on its own thread, so may block without holding up the others.
+    // The (single) consumer thread reads the merged frames and queues frames to send, without locking.
+    // The links must not be used directly while running.
+    class RadioMuxThreaded
+        {
+        public:
+            // Maximum frame length for TX.
+            static const uint8_t MAX_TX_BYTES = 253;
+
+        private:
+            // Per-link thread and TX queue.
+            struct Worker;
+
+            OTRadioLink *const *const links;
+            const uint8_t nLinks;
+            RadioMuxMPSCQueue rxQueue;
+            Worker *const workers;
+            RadioMuxTXRoutes txRoutes;
+            // Sleep when a link's thread finds nothing to do, in microseconds.
+            uint32_t idleSleepUs;
+            // True while the threads should run.
+            bool running;
+
+            // Body of the thread for link i.
+            void _run(uint8_t i);
+
+            // Not copyable.
+            RadioMuxThreaded(const RadioMuxThreaded &) = delete;
+            RadioMuxThreaded &operator=(const RadioMuxThreaded &) = delete;
+
+        public:
+            // Multiplex the given links (at most RadioMux::MAX_LINKS are used)
+            // into a shared queue of at least rxCapacity frames.
+            // The links array must outlive this instance.
+            RadioMuxThreaded(OTRadioLink *const *links, uint8_t nLinks, uint32_t rxCapacity = 64);
+            // Stops the threads if running.
+            ~RadioMuxThreaded();
+
+            uint8_t getLinkCount() const { return(nLinks); }
+
+            // Start a thread for each link, which sleeps for idleSleepUs when idle.
+            // Returns false if already running or there are no links,
+            // or if the threads could not all be started, when any that were are stopped again.
+            bool start(uint32_t idleSleepUs = 1000);
+            // Stop and join all the threads; does nothing if not running.
+            // Frames queued for TX but not yet sent stay queued until the next start().
+            void stop();
+            bool isRunning() const { return(__atomic_load_n(&running, __ATOMIC_ACQUIRE)); }
+
+            // As for RadioMux; should not be changed while running.
+            void setTXRoutes(const RadioMuxTXRoute *routes, uint8_t nRoutes, uint8_t defaultLinks = 0xff)
+                { txRoutes.routes = routes; txRoutes.nRoutes = routes ? nRoutes : 0; txRoutes.defaultLinks = defaultLinks; }
+            uint8_t routeTX(const uint8_t *buf, uint8_t buflen) const
+                { return(txRoutes.route(buf, buflen) & (uint8_t)((1U << nLinks) - 1)); }
+
+            // Queue the frame to be sent (with sendRaw()) by the thread of each of the given links.
+            // Returns the links (a bit mask) that accepted it, ie whose TX queues were not full.
+            // Consumer thread only.
+            uint8_t sendTo(uint8_t linkMask, const uint8_t *buf, uint8_t buflen,
+                           int8_t channel = 0, OTRadioLink::TXpower power = OTRadioLink::TXnormal);
+            // Queue the frame to be sent on the links chosen by the TX routing rules.
+            // Consumer thread only.
+            uint8_t queueToSend(const uint8_t *buf, uint8_t buflen,
+                                int8_t channel = 0, OTRadioLink::TXpower power = OTRadioLink::TXnormal)
+                { return(sendTo(routeTX(buf, buflen), buf, buflen, channel, power)); }
+            // Number of frames queued for TX by the given link's thread; 0 if out of range.
+            uint8_t getTXMsgsQueued(uint8_t link) const;
+
+            // Approximate number of received frames queued.
+            uint32_t getRXMsgsQueued() const { return(rxQueue.getMsgsQueued()); }
+            // As for RadioMux; consumer thread only.
+            const uint8_t *peekRXMsg(uint8_t &len, uint8_t &link) const { return(rxQueue.peek(len, link)); }
+            void removeRXMsg() { rxQueue.remove(); }
+        };
+#endif // !defined(__AVR__)
+
+
+    }
+
+#endif
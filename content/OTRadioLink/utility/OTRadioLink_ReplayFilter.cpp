@@ -0,0 +1,100 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+/*
+ * Replay protection for received secure frames.
+ */
+
+#include "OTRadioLink_ReplayFilter.h"
+
+namespace OTRadioLink
+    {
+
+
+#if !defined(__AVR__)
+// FNV-1a hash of a node ID.
+static uint32_t hashReplayID(const uint8_t *const id)
+    {
+    uint32_t h = 2166136261UL;
+    for(uint8_t i = 0; i < ReplayFilterHub::ID_LENGTH; ++i) { h = (h ^ id[i]) * 16777619UL; }
+    return(h);
+    }
+
+ReplayFilterHub::ReplayFilterHub(const uint32_t initialIDs)
+  : entries(NULL), mask(0), used(0)
+    {
+    uint32_t n = 16;
+    while(n < 2 * initialIDs) { n <<= 1; }
+    entries = new Entry[n];
+    mask = n - 1;
+    }
+
+ReplayFilterHub::~ReplayFilterHub() { delete[] entries; }
+
+// Returns the entry for the ID, else the empty entry where it would go.
+ReplayFilterHub::Entry *ReplayFilterHub::find(const uint8_t *const id) const
+    {
+    // Never more than half full, so an empty entry will be found.
+    for(uint32_t s = hashReplayID(id) & mask; ; s = (s + 1) & mask)
+        {
+        Entry &e = entries[s];
+        if(e.window.isUnused() || (0 == memcmp(e.id, id, ID_LENGTH))) { return(&e); }
+        }
+    }
+
+// Double the table size, rehashing all entries.
+void ReplayFilterHub::grow()
+    {
+    Entry *const old = entries;
+    const uint32_t oldSize = mask + 1;
+    entries = new Entry[2 * oldSize];
+    mask = 2 * oldSize - 1;
+    for(uint32_t i = 0; i < oldSize; ++i)
+        { if(!old[i].window.isUnused()) { *find(old[i].id) = old[i]; } }
+    delete[] old;
+    }
+
+bool ReplayFilterHub::check(const uint8_t *const id, const uint64_t counter) const
+    {
+    if(NULL == id) { return(false); } // ERROR
+    return(find(id)->window.check(counter));
+    }
+
+bool ReplayFilterHub::accept(const uint8_t *const id, const uint64_t counter)
+    {
+    if(NULL == id) { return(false); } // ERROR
+    Entry *e = find(id);
+    if(e->window.isUnused())
+        {
+        // New sender: make room first if need be.
+        if(2 * (used + 1) > (mask + 1)) { grow(); e = find(id); }
+        memcpy(e->id, id, ID_LENGTH);
+        ++used;
+        }
+    return(e->window.accept(counter));
+    }
+
+void ReplayFilterHub::clear()
+    {
+    for(uint32_t i = 0; i <= mask; ++i) { entries[i].window.seen = 0; }
+    used = 0;
+    }
+#endif // !defined(__AVR__)
+
+
+    }
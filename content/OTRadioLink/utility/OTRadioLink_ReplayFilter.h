@@ -0,0 +1,228 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+/*
+ * Replay protection for received secure frames.
+ *
+ * Each secure small frame carries a 48-bit message counter in its trailer
+ * (3-byte restart counter then 3-byte TX message counter, as the last 6 bytes of the IV),
+ * which a sender increases for every frame it sends.
+ * For each sender ID a filter keeps the highest counter accepted
+ * and a bitmap of which of the counters just below that have also been accepted,
+ * so that frames reordered in transit by less than the bitmap width are still accepted once,
+ * while repeats and older frames are rejected.
+ *
+ * Use as a stage after a frame has been authenticated and decrypted,
+ * so that forged frames cannot advance the window, eg:
+ *     if(!filter.acceptTrailer(senderID, trailer)) { drop the frame }
+ * All lookups are O(1), and so cheap enough for the RX poll path.
+ *
+ * ReplayFilterFixed is a fixed-size open-addressed table for a few IDs, eg on the AVR.
+ * ReplayFilterHub (not AVR) is a growable hash table for many (eg tens of thousands of) IDs.
+ */
+
+#ifndef ARDUINO_LIB_OTRADIOLINK_REPLAYFILTER_H
+#define ARDUINO_LIB_OTRADIOLINK_REPLAYFILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Use namespaces to help avoid collisions.
+namespace OTRadioLink
+    {
+
+
+    // Size of the message counter in a secure frame trailer.
+    static const uint8_t SECURE_FRAME_COUNTER_BYTES = 6;
+
+    // Get the 48-bit message counter from the 6 big-endian bytes at the start of a secure frame trailer
+    // (or the last 6 bytes of its IV/nonce); never NULL.
+    inline uint64_t getSecureFrameMessageCounter(const uint8_t *const counterBytes)
+        {
+        uint64_t c = 0;
+        for(uint8_t i = 0; i < SECURE_FRAME_COUNTER_BYTES; ++i) { c = (c << 8) | counterBytes[i]; }
+        return(c);
+        }
+
+    // Replay window for one sender: the highest counter accepted and a bitmap of those accepted below it.
+    // W is an unsigned integer type whose width is the window size, eg uint16_t on the AVR.
+    template<typename W>
+    struct ReplayWindowT
+        {
+        static const uint8_t WINDOW_BITS = 8 * sizeof(W);
+        // Highest counter accepted.
+        uint64_t highest;
+        // Bit i is set if counter (highest - i) has been accepted;
+        // bit 0 is always set once any counter has been accepted, so zero means unused.
+        W seen;
+
+        ReplayWindowT() : highest(0), seen(0) { }
+
+        bool isUnused() const { return(0 == seen); }
+
+        // True if counter c would be accepted now: not seen before and not too old.
+        bool check(const uint64_t c) const
+            {
+            if(isUnused() || (c > highest)) { return(true); }
+            const uint64_t back = highest - c;
+            if(back >= WINDOW_BITS) { return(false); } // Too old.
+            return(0 == (seen & ((W)1 << back)));
+            }
+
+        // If counter c is acceptable then record it and return true, else return false.
+        bool accept(const uint64_t c)
+            {
+            if(isUnused()) { highest = c; seen = 1; return(true); }
+            if(c > highest)
+                {
+                const uint64_t shift = c - highest;
+                seen = (shift >= WINDOW_BITS) ? (W)1 : (W)((seen << shift) | 1);
+                highest = c;
+                return(true);
+                }
+            const uint64_t back = highest - c;
+            if(back >= WINDOW_BITS) { return(false); } // Too old.
+            const W bit = (W)1 << back;
+            if(0 != (seen & bit)) { return(false); } // Replay.
+            seen |= bit;
+            return(true);
+            }
+        };
+
+    // Fixed-size replay filter for up to maxIDs senders identified by idLen-byte IDs.
+    // Uses an open-addressed table with linear probing; IDs are never evicted,
+    // so frames from a new sender are rejected once the table is full.
+    // Not ISR-safe: call from the RX poll path.
+    template<uint8_t maxIDs, uint8_t idLen = 4, typename W = uint16_t>
+    class ReplayFilterFixed
+        {
+        private:
+            struct Entry
+                {
+                uint8_t id[idLen];
+                ReplayWindowT<W> window;
+                };
+            Entry entries[maxIDs];
+
+            // Returns the entry for the ID, else the empty entry where it would go, else NULL if full.
+            Entry *find(const uint8_t *const id) const
+                {
+                uint8_t h = 0;
+                for(uint8_t i = 0; i < idLen; ++i) { h = (uint8_t)((h << 1) | (h >> 7)) ^ id[i]; }
+                for(uint8_t n = maxIDs, s = h % maxIDs; n-- > 0; s = (s + 1) % maxIDs)
+                    {
+                    const Entry &e = entries[s];
+                    if(e.window.isUnused() || (0 == memcmp(e.id, id, idLen))) { return(const_cast<Entry *>(&e)); }
+                    }
+                return(NULL);
+                }
+
+        public:
+            ReplayFilterFixed() { clear(); }
+
+            // True if the frame from the given sender and with the given counter would be accepted.
+            bool check(const uint8_t *const id, const uint64_t counter) const
+                {
+                if(NULL == id) { return(false); } // ERROR
+                const Entry *const e = find(id);
+                return((NULL != e) && e->window.check(counter));
+                }
+
+            // If the frame from the given sender and with the given counter is not a replay
+            // then record it and return true; else return false.
+            // Also returns false if id is NULL, or if the table is full and the sender is new.
+            bool accept(const uint8_t *const id, const uint64_t counter)
+                {
+                if(NULL == id) { return(false); } // ERROR
+                Entry *const e = find(id);
+                if(NULL == e) { return(false); } // ERROR
+                if(e->window.isUnused()) { memcpy(e->id, id, idLen); }
+                return(e->window.accept(counter));
+                }
+            // As accept() with the counter from the start of a secure frame trailer.
+            bool acceptTrailer(const uint8_t *const id, const uint8_t *const trailer)
+                {
+                if(NULL == trailer) { return(false); } // ERROR
+                return(accept(id, getSecureFrameMessageCounter(trailer)));
+                }
+
+            // Number of senders tracked.
+            uint8_t size() const
+                {
+                uint8_t n = 0;
+                for(uint8_t i = 0; i < maxIDs; ++i) { if(!entries[i].window.isUnused()) { ++n; } }
+                return(n);
+                }
+
+            // Forget all senders.
+            void clear() { for(uint8_t i = 0; i < maxIDs; ++i) { entries[i].window.seen = 0; } }
+        };
+
+
+#if !defined(__AVR__)
+    // Replay filter for any number of senders identified by 8-byte (full node) IDs, eg at a hub.
+    // Open-addressed hash table with linear probing, doubled in size when half full.
+    // Not thread-safe: use one per RX thread or lock around calls.
+    class ReplayFilterHub
+        {
+        public:
+            static const uint8_t ID_LENGTH = 8;
+            typedef ReplayWindowT<uint64_t> Window;
+
+        private:
+            struct Entry
+                {
+                uint8_t id[ID_LENGTH];
+                Window window;
+                };
+            Entry *entries;
+            // Table size is mask+1, a power of 2.
+            uint32_t mask;
+            uint32_t used;
+
+            Entry *find(const uint8_t *id) const;
+            void grow();
+
+            // Not copyable.
+            ReplayFilterHub(const ReplayFilterHub &) = delete;
+            ReplayFilterHub &operator=(const ReplayFilterHub &) = delete;
+
+        public:
+            // Create a filter with space for at least the given number of senders before growing.
+            explicit ReplayFilterHub(uint32_t initialIDs = 1024);
+            ~ReplayFilterHub();
+
+            // As for ReplayFilterFixed.
+            bool check(const uint8_t *id, uint64_t counter) const;
+            bool accept(const uint8_t *id, uint64_t counter);
+            bool acceptTrailer(const uint8_t *const id, const uint8_t *const trailer)
+                {
+                if(NULL == trailer) { return(false); } // ERROR
+                return(accept(id, getSecureFrameMessageCounter(trailer)));
+                }
+
+            uint32_t size() const { return(used); }
+            void clear();
+        };
+#endif // !defined(__AVR__)
+
+
+    }
+
+#endif
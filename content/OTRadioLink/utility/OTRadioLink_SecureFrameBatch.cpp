@@ -0,0 +1,1068 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+/*
+ * Batched decryption/authentication of secure small frames at a hub.
+ *
+ * AES-128-GCM per NIST SP 800-38D, specialised for 96-bit IVs and 256-bit (or empty) texts:
+ * counter block 1 masks the tag and counter blocks 2 and 3 the text,
+ * and GHASH covers the authtext, the two text blocks (if any) and the lengths block.
+ */
+
+#if !defined(__AVR__)
+
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "OTRadioLink_SecureFrameBatch.h"
+
+// Use AES-NI and PCLMULQDQ on x86 when the CPU has them (checked at run time).
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define OTRADIOLINK_AESGCM_NI
+#define OTRADIOLINK_AESGCM_NI_TARGET __attribute__((target("aes,pclmul,ssse3")))
+#endif
+
+namespace OTRadioLink
+    {
+
+
+// Frames passed through the AES unit together: 3 blocks each, to keep its pipeline full.
+static const uint8_t GCM_LANES = 4;
+
+// One fixed-size GCM encryption or decryption.
+struct GCMJob
+    {
+    const uint8_t *iv;
+    const uint8_t *aad;
+    uint8_t aadLen;
+    // 32-byte input and output texts; must not overlap.
+    // With in NULL there is no text (eg a secure frame with an empty body), and out is not used.
+    const uint8_t *in;
+    uint8_t *out;
+    // Computed tag.
+    uint8_t tag[16];
+    };
+
+// Encrypts or decrypts n [1,GCM_LANES] jobs with the same key, computing each tag.
+// When encrypting the tag covers the output, else the input.
+typedef void gcm32B_t(const AESGCMKeyContext &k, GCMJob *jobs, uint8_t n, bool encrypt);
+
+
+// The portable AES-128 and GHASH are constant-time, after BearSSL's aes_ct64 and ghash_ctmul64 (Thomas Pornin, MIT licence):
+// no memory index or branch depends on key or data, so neither leaks through caches or timing to other code on the host.
+// AES is bitsliced, four blocks at a time; GHASH assumes 64-bit integer multiply is constant-time,
+// as on current x86-64 and ARMv8 cores.
+
+static inline uint32_t dec32le(const uint8_t *const p)
+    { return((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24)); }
+static inline void enc32le(uint8_t *const p, const uint32_t x)
+    { p[0] = (uint8_t)x; p[1] = (uint8_t)(x >> 8); p[2] = (uint8_t)(x >> 16); p[3] = (uint8_t)(x >> 24); }
+static inline uint64_t dec64be(const uint8_t *const p)
+    {
+    uint64_t x = 0;
+    for(uint8_t i = 0; i < 8; ++i) { x = (x << 8) | p[i]; }
+    return(x);
+    }
+static inline void enc64be(uint8_t *const p, const uint64_t x)
+    { for(uint8_t i = 0; i < 8; ++i) { p[i] = (uint8_t)(x >> (56 - 8*i)); } }
+
+// AES S-box applied to bitsliced state q (Boyar and Peralta's circuit); q[7] holds the top bits.
+static void bsSbox(uint64_t *const q)
+    {
+    const uint64_t x0 = q[7], x1 = q[6], x2 = q[5], x3 = q[4], x4 = q[3], x5 = q[2], x6 = q[1], x7 = q[0];
+    // Top linear transformation.
+    const uint64_t y14 = x3 ^ x5;
+    const uint64_t y13 = x0 ^ x6;
+    const uint64_t y9 = x0 ^ x3;
+    const uint64_t y8 = x0 ^ x5;
+    const uint64_t t0 = x1 ^ x2;
+    const uint64_t y1 = t0 ^ x7;
+    const uint64_t y4 = y1 ^ x3;
+    const uint64_t y12 = y13 ^ y14;
+    const uint64_t y2 = y1 ^ x0;
+    const uint64_t y5 = y1 ^ x6;
+    const uint64_t y3 = y5 ^ y8;
+    const uint64_t t1 = x4 ^ y12;
+    const uint64_t y15 = t1 ^ x5;
+    const uint64_t y20 = t1 ^ x1;
+    const uint64_t y6 = y15 ^ x7;
+    const uint64_t y10 = y15 ^ t0;
+    const uint64_t y11 = y20 ^ y9;
+    const uint64_t y7 = x7 ^ y11;
+    const uint64_t y17 = y10 ^ y11;
+    const uint64_t y19 = y10 ^ y8;
+    const uint64_t y16 = t0 ^ y11;
+    const uint64_t y21 = y13 ^ y16;
+    const uint64_t y18 = x0 ^ y16;
+    // Non-linear section.
+    const uint64_t t2 = y12 & y15;
+    const uint64_t t3 = y3 & y6;
+    const uint64_t t4 = t3 ^ t2;
+    const uint64_t t5 = y4 & x7;
+    const uint64_t t6 = t5 ^ t2;
+    const uint64_t t7 = y13 & y16;
+    const uint64_t t8 = y5 & y1;
+    const uint64_t t9 = t8 ^ t7;
+    const uint64_t t10 = y2 & y7;
+    const uint64_t t11 = t10 ^ t7;
+    const uint64_t t12 = y9 & y11;
+    const uint64_t t13 = y14 & y17;
+    const uint64_t t14 = t13 ^ t12;
+    const uint64_t t15 = y8 & y10;
+    const uint64_t t16 = t15 ^ t12;
+    const uint64_t t17 = t4 ^ t14;
+    const uint64_t t18 = t6 ^ t16;
+    const uint64_t t19 = t9 ^ t14;
+    const uint64_t t20 = t11 ^ t16;
+    const uint64_t t21 = t17 ^ y20;
+    const uint64_t t22 = t18 ^ y19;
+    const uint64_t t23 = t19 ^ y21;
+    const uint64_t t24 = t20 ^ y18;
+    const uint64_t t25 = t21 ^ t22;
+    const uint64_t t26 = t21 & t23;
+    const uint64_t t27 = t24 ^ t26;
+    const uint64_t t28 = t25 & t27;
+    const uint64_t t29 = t28 ^ t22;
+    const uint64_t t30 = t23 ^ t24;
+    const uint64_t t31 = t22 ^ t26;
+    const uint64_t t32 = t31 & t30;
+    const uint64_t t33 = t32 ^ t24;
+    const uint64_t t34 = t23 ^ t33;
+    const uint64_t t35 = t27 ^ t33;
+    const uint64_t t36 = t24 & t35;
+    const uint64_t t37 = t36 ^ t34;
+    const uint64_t t38 = t27 ^ t36;
+    const uint64_t t39 = t29 & t38;
+    const uint64_t t40 = t25 ^ t39;
+    const uint64_t t41 = t40 ^ t37;
+    const uint64_t t42 = t29 ^ t33;
+    const uint64_t t43 = t29 ^ t40;
+    const uint64_t t44 = t33 ^ t37;
+    const uint64_t t45 = t42 ^ t41;
+    const uint64_t z0 = t44 & y15;
+    const uint64_t z1 = t37 & y6;
+    const uint64_t z2 = t33 & x7;
+    const uint64_t z3 = t43 & y16;
+    const uint64_t z4 = t40 & y1;
+    const uint64_t z5 = t29 & y7;
+    const uint64_t z6 = t42 & y11;
+    const uint64_t z7 = t45 & y17;
+    const uint64_t z8 = t41 & y10;
+    const uint64_t z9 = t44 & y12;
+    const uint64_t z10 = t37 & y3;
+    const uint64_t z11 = t33 & y4;
+    const uint64_t z12 = t43 & y13;
+    const uint64_t z13 = t40 & y5;
+    const uint64_t z14 = t29 & y2;
+    const uint64_t z15 = t42 & y9;
+    const uint64_t z16 = t45 & y14;
+    const uint64_t z17 = t41 & y8;
+    // Bottom linear transformation.
+    const uint64_t t46 = z15 ^ z16;
+    const uint64_t t47 = z10 ^ z11;
+    const uint64_t t48 = z5 ^ z13;
+    const uint64_t t49 = z9 ^ z10;
+    const uint64_t t50 = z2 ^ z12;
+    const uint64_t t51 = z2 ^ z5;
+    const uint64_t t52 = z7 ^ z8;
+    const uint64_t t53 = z0 ^ z3;
+    const uint64_t t54 = z6 ^ z7;
+    const uint64_t t55 = z16 ^ z17;
+    const uint64_t t56 = z12 ^ t48;
+    const uint64_t t57 = t50 ^ t53;
+    const uint64_t t58 = z4 ^ t46;
+    const uint64_t t59 = z3 ^ t54;
+    const uint64_t t60 = t46 ^ t57;
+    const uint64_t t61 = z14 ^ t57;
+    const uint64_t t62 = t52 ^ t58;
+    const uint64_t t63 = t49 ^ t58;
+    const uint64_t t64 = z4 ^ t59;
+    const uint64_t t65 = t61 ^ t62;
+    const uint64_t t66 = z1 ^ t63;
+    const uint64_t s0 = t59 ^ t63;
+    const uint64_t s6 = t56 ^ ~t62;
+    const uint64_t s7 = t48 ^ ~t60;
+    const uint64_t t67 = t64 ^ t65;
+    const uint64_t s3 = t53 ^ t66;
+    const uint64_t s4 = t51 ^ t66;
+    const uint64_t s5 = t47 ^ t65;
+    const uint64_t s1 = t64 ^ ~s3;
+    const uint64_t s2 = t55 ^ ~t67;
+    q[7] = s0; q[6] = s1; q[5] = s2; q[4] = s3; q[3] = s4; q[2] = s5; q[1] = s6; q[0] = s7;
+    }
+
+// Swap the bits selected by cl in x with those selected by ch in y, s places up.
+static inline void bsSwap(const uint64_t cl, const uint64_t ch, const uint8_t s, uint64_t &x, uint64_t &y)
+    {
+    const uint64_t a = x, b = y;
+    x = (a & cl) | ((b & cl) << s);
+    y = ((a & ch) >> s) | (b & ch);
+    }
+
+// Convert between interleaved and bitsliced state (an involution).
+static void bsOrtho(uint64_t *const q)
+    {
+    static const uint64_t m1 = 0x5555555555555555ULL, m2 = 0x3333333333333333ULL, m4 = 0x0f0f0f0f0f0f0f0fULL;
+    bsSwap(m1, ~m1, 1, q[0], q[1]); bsSwap(m1, ~m1, 1, q[2], q[3]); bsSwap(m1, ~m1, 1, q[4], q[5]); bsSwap(m1, ~m1, 1, q[6], q[7]);
+    bsSwap(m2, ~m2, 2, q[0], q[2]); bsSwap(m2, ~m2, 2, q[1], q[3]); bsSwap(m2, ~m2, 2, q[4], q[6]); bsSwap(m2, ~m2, 2, q[5], q[7]);
+    bsSwap(m4, ~m4, 4, q[0], q[4]); bsSwap(m4, ~m4, 4, q[1], q[5]); bsSwap(m4, ~m4, 4, q[2], q[6]); bsSwap(m4, ~m4, 4, q[3], q[7]);
+    }
+
+// Interleave one block, as four little-endian words, into q0 and q1, and back.
+static inline void bsInterleaveIn(uint64_t &q0, uint64_t &q1, const uint32_t *const w)
+    {
+    uint64_t x[4];
+    for(uint8_t i = 0; i < 4; ++i)
+        {
+        x[i] = w[i];
+        x[i] = (x[i] | (x[i] << 16)) & 0x0000ffff0000ffffULL;
+        x[i] = (x[i] | (x[i] << 8)) & 0x00ff00ff00ff00ffULL;
+        }
+    q0 = x[0] | (x[2] << 8);
+    q1 = x[1] | (x[3] << 8);
+    }
+static inline void bsInterleaveOut(uint32_t *const w, const uint64_t q0, const uint64_t q1)
+    {
+    uint64_t x[4] = { q0, q1, q0 >> 8, q1 >> 8 };
+    for(uint8_t i = 0; i < 4; ++i)
+        {
+        x[i] &= 0x00ff00ff00ff00ffULL;
+        x[i] = (x[i] | (x[i] >> 8)) & 0x0000ffff0000ffffULL;
+        w[i] = (uint32_t)x[i] | (uint32_t)(x[i] >> 16);
+        }
+    }
+
+// AES SubWord() of a little-endian key schedule word.
+static uint32_t aesSubWord(const uint32_t x)
+    {
+    uint64_t q[8] = { x };
+    bsOrtho(q);
+    bsSbox(q);
+    bsOrtho(q);
+    return((uint32_t)q[0]);
+    }
+
+static inline void bsShiftRows(uint64_t *const q)
+    {
+    for(uint8_t i = 0; i < 8; ++i)
+        {
+        const uint64_t x = q[i];
+        q[i] = (x & 0x000000000000ffffULL)
+             | ((x & 0x00000000fff00000ULL) >> 4)
+             | ((x & 0x00000000000f0000ULL) << 12)
+             | ((x & 0x0000ff0000000000ULL) >> 8)
+             | ((x & 0x000000ff00000000ULL) << 8)
+             | ((x & 0xf000000000000000ULL) >> 12)
+             | ((x & 0x0fff000000000000ULL) << 4);
+        }
+    }
+
+static inline uint64_t rotr32(const uint64_t x) { return((x << 32) | (x >> 32)); }
+
+static inline void bsMixColumns(uint64_t *const q)
+    {
+    uint64_t r[8];
+    for(uint8_t i = 0; i < 8; ++i) { r[i] = (q[i] >> 16) | (q[i] << 48); }
+    const uint64_t q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3], q4 = q[4], q5 = q[5], q6 = q[6], q7 = q[7];
+    q[0] = q7 ^ r[7] ^ r[0] ^ rotr32(q0 ^ r[0]);
+    q[1] = q0 ^ r[0] ^ q7 ^ r[7] ^ r[1] ^ rotr32(q1 ^ r[1]);
+    q[2] = q1 ^ r[1] ^ r[2] ^ rotr32(q2 ^ r[2]);
+    q[3] = q2 ^ r[2] ^ q7 ^ r[7] ^ r[3] ^ rotr32(q3 ^ r[3]);
+    q[4] = q3 ^ r[3] ^ q7 ^ r[7] ^ r[4] ^ rotr32(q4 ^ r[4]);
+    q[5] = q4 ^ r[4] ^ r[5] ^ rotr32(q5 ^ r[5]);
+    q[6] = q5 ^ r[5] ^ r[6] ^ rotr32(q6 ^ r[6]);
+    q[7] = q6 ^ r[6] ^ r[7] ^ rotr32(q7 ^ r[7]);
+    }
+
+// Bitsliced round keys in use: 8 words per round.
+static const uint8_t BS_ROUND_KEYS_SIZE = 88;
+
+// Expand the compressed bitsliced round keys of an AESGCMKeyContext for use.
+static void bsExpandRoundKeys(const uint64_t *const comp, uint64_t *const skey)
+    {
+    for(uint8_t u = 0; u < 22; ++u)
+        {
+        for(uint8_t b = 0; b < 4; ++b)
+            {
+            const uint64_t x = (comp[u] >> b) & 0x1111111111111111ULL;
+            skey[4*u + b] = (x << 4) - x;
+            }
+        }
+    }
+
+// Portable AES-128 encryption of four consecutive blocks in place, with expanded bitsliced round keys.
+static void aesEncrypt4Blocks(const uint64_t *const skey, uint8_t *const blocks)
+    {
+    uint32_t w[16];
+    for(uint8_t i = 0; i < 16; ++i) { w[i] = dec32le(blocks + 4*i); }
+    uint64_t q[8];
+    for(uint8_t i = 0; i < 4; ++i) { bsInterleaveIn(q[i], q[i + 4], w + 4*i); }
+    bsOrtho(q);
+    for(uint8_t i = 0; i < 8; ++i) { q[i] ^= skey[i]; }
+    for(uint8_t round = 1; round <= 10; ++round)
+        {
+        bsSbox(q);
+        bsShiftRows(q);
+        if(10 != round) { bsMixColumns(q); }
+        for(uint8_t i = 0; i < 8; ++i) { q[i] ^= skey[8*round + i]; }
+        }
+    bsOrtho(q);
+    for(uint8_t i = 0; i < 4; ++i) { bsInterleaveOut(w + 4*i, q[i], q[i + 4]); }
+    for(uint8_t i = 0; i < 16; ++i) { enc32le(blocks + 4*i, w[i]); }
+    }
+
+// Low 64 bits of the carry-less product of x and y,
+// from integer multiplies of every fourth bit, whose carries then fall in the masked-off holes.
+static inline uint64_t bmul64(const uint64_t x, const uint64_t y)
+    {
+    static const uint64_t m0 = 0x1111111111111111ULL, m1 = m0 << 1, m2 = m0 << 2, m3 = m0 << 3;
+    const uint64_t x0 = x & m0, x1 = x & m1, x2 = x & m2, x3 = x & m3;
+    const uint64_t y0 = y & m0, y1 = y & m1, y2 = y & m2, y3 = y & m3;
+    const uint64_t z0 = (x0 * y0) ^ (x1 * y3) ^ (x2 * y2) ^ (x3 * y1);
+    const uint64_t z1 = (x0 * y1) ^ (x1 * y0) ^ (x2 * y3) ^ (x3 * y2);
+    const uint64_t z2 = (x0 * y2) ^ (x1 * y1) ^ (x2 * y0) ^ (x3 * y3);
+    const uint64_t z3 = (x0 * y3) ^ (x1 * y2) ^ (x2 * y1) ^ (x3 * y0);
+    return((z0 & m0) | (z1 & m1) | (z2 & m2) | (z3 & m3));
+    }
+
+// Bit-reverse a 64-bit word.
+static inline uint64_t rev64(uint64_t x)
+    {
+    x = ((x & 0x5555555555555555ULL) << 1) | ((x >> 1) & 0x5555555555555555ULL);
+    x = ((x & 0x3333333333333333ULL) << 2) | ((x >> 2) & 0x3333333333333333ULL);
+    x = ((x & 0x0f0f0f0f0f0f0f0fULL) << 4) | ((x >> 4) & 0x0f0f0f0f0f0f0f0fULL);
+    x = ((x & 0x00ff00ff00ff00ffULL) << 8) | ((x >> 8) & 0x00ff00ff00ff00ffULL);
+    x = ((x & 0x0000ffff0000ffffULL) << 16) | ((x >> 16) & 0x0000ffff0000ffffULL);
+    return((x << 32) | (x >> 32));
+    }
+
+// Portable GHASH multiply of x in place by H, given as big-endian 64-bit halves.
+// The 128-bit carry-less product is built by Karatsuba from 64-bit halves,
+// with the high half of each 64x64 product taken from the bit-reversed operands.
+static void ghashMult(const uint64_t *const h, uint8_t *const x)
+    {
+    const uint64_t h1 = h[0], h0 = h[1];
+    const uint64_t h0r = rev64(h0), h1r = rev64(h1);
+    const uint64_t y1 = dec64be(x), y0 = dec64be(x + 8);
+    const uint64_t y0r = rev64(y0), y1r = rev64(y1);
+    const uint64_t z0 = bmul64(y0, h0);
+    const uint64_t z1 = bmul64(y1, h1);
+    const uint64_t z2 = bmul64(y0 ^ y1, h0 ^ h1) ^ z0 ^ z1;
+    const uint64_t z0h = bmul64(y0r, h0r);
+    const uint64_t z1h = bmul64(y1r, h1r);
+    const uint64_t z2h = rev64(bmul64(y0r ^ y1r, h0r ^ h1r) ^ z0h ^ z1h) >> 1;
+    uint64_t v0 = z0;
+    uint64_t v1 = (rev64(z0h) >> 1) ^ z2;
+    uint64_t v2 = z1 ^ z2h;
+    uint64_t v3 = rev64(z1h) >> 1;
+    // Shift left one bit for the bit-reflected representation, then reduce.
+    v3 = (v3 << 1) | (v2 >> 63);
+    v2 = (v2 << 1) | (v1 >> 63);
+    v1 = (v1 << 1) | (v0 >> 63);
+    v0 = (v0 << 1);
+    v2 ^= v0 ^ (v0 >> 1) ^ (v0 >> 2) ^ (v0 >> 7);
+    v1 ^= (v0 << 63) ^ (v0 << 62) ^ (v0 << 57);
+    v3 ^= v1 ^ (v1 >> 1) ^ (v1 >> 2) ^ (v1 >> 7);
+    v2 ^= (v1 << 63) ^ (v1 << 62) ^ (v1 << 57);
+    enc64be(x, v3);
+    enc64be(x + 8, v2);
+    }
+
+// Initial GCM counter block for a 96-bit IV, with the given final counter byte.
+static inline void gcmCounterBlock(const uint8_t *const iv, const uint8_t ctr, uint8_t *const block)
+    {
+    memcpy(block, iv, 12);
+    block[12] = 0;
+    block[13] = 0;
+    block[14] = 0;
+    block[15] = ctr;
+    }
+
+// GCM lengths block for the given authtext size and a 32-byte text, or none.
+static inline void gcmLengthsBlock(const uint8_t aadLen, const bool hasText, uint8_t *const block)
+    {
+    memset(block, 0, 16);
+    const uint16_t aadBits = 8 * (uint16_t)aadLen;
+    block[6] = (uint8_t)(aadBits >> 8);
+    block[7] = (uint8_t)aadBits;
+    if(hasText) { block[14] = 1; } // 256 bits.
+    }
+
+static void gcm32BPortable(const AESGCMKeyContext &k, GCMJob *const jobs, const uint8_t n, const bool encrypt)
+    {
+    uint64_t skey[BS_ROUND_KEYS_SIZE];
+    bsExpandRoundKeys(k.bsRoundKeys, skey);
+    // Counter blocks 1, 2 and 3 of each job, encrypted four at a time; unused lanes are harmless.
+    uint8_t cb[GCM_LANES][48];
+    for(uint8_t j = 0; j < GCM_LANES; ++j)
+        {
+        if(j < n) { gcmCounterBlock(jobs[j].iv, 1, cb[j]); } else { memset(cb[j], 0, 16); }
+        memcpy(cb[j] + 16, cb[j], 16);
+        cb[j][31] = 2;
+        memcpy(cb[j] + 32, cb[j], 16);
+        cb[j][47] = 3;
+        }
+    for(uint8_t i = 0; i < 3*GCM_LANES; i += 4) { aesEncrypt4Blocks(skey, cb[0] + 16*i); }
+    for(uint8_t j = 0; j < n; ++j)
+        {
+        GCMJob &job = jobs[j];
+        const uint8_t *const tagMask = cb[j];
+        const uint8_t *const ks = cb[j] + 16;
+        const bool hasText = (NULL != job.in);
+        if(hasText) { for(uint8_t i = 0; i < 32; ++i) { job.out[i] = job.in[i] ^ ks[i]; } }
+        const uint8_t *const ctext = encrypt ? job.out : job.in;
+        uint8_t y[16];
+        memset(y, 0, sizeof(y));
+        for(uint8_t off = 0; off < job.aadLen; off += 16)
+            {
+            const uint8_t len = ((job.aadLen - off) > 16) ? 16 : (job.aadLen - off);
+            for(uint8_t i = 0; i < len; ++i) { y[i] ^= job.aad[off + i]; }
+            ghashMult(k.h64, y);
+            if(len < 16) { break; }
+            }
+        for(uint8_t off = 0; hasText && (off < 32); off += 16)
+            {
+            for(uint8_t i = 0; i < 16; ++i) { y[i] ^= ctext[off + i]; }
+            ghashMult(k.h64, y);
+            }
+        uint8_t lb[16];
+        gcmLengthsBlock(job.aadLen, hasText, lb);
+        for(uint8_t i = 0; i < 16; ++i) { y[i] ^= lb[i]; }
+        ghashMult(k.h64, y);
+        for(uint8_t i = 0; i < 16; ++i) { job.tag[i] = y[i] ^ tagMask[i]; }
+        }
+    }
+
+
+#ifdef OTRADIOLINK_AESGCM_NI
+// Reverse the bytes of a block, to and from the representation used for carry-less multiplication.
+OTRADIOLINK_AESGCM_NI_TARGET static inline __m128i bswap128(const __m128i x)
+    { return(_mm_shuffle_epi8(x, _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15))); }
+
+// Accumulate the unreduced 256-bit product a*b into lo, mid and hi.
+// Products may be summed before a single gfReduce(), as reduction is linear.
+OTRADIOLINK_AESGCM_NI_TARGET static inline void clmulAcc(const __m128i a, const __m128i b,
+                                                         __m128i &lo, __m128i &mid, __m128i &hi)
+    {
+    lo = _mm_xor_si128(lo, _mm_clmulepi64_si128(a, b, 0x00));
+    hi = _mm_xor_si128(hi, _mm_clmulepi64_si128(a, b, 0x11));
+    mid = _mm_xor_si128(mid, _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x10), _mm_clmulepi64_si128(a, b, 0x01)));
+    }
+
+// Reduce an accumulated product modulo the GCM polynomial (Intel GCM white paper, algorithm 5).
+OTRADIOLINK_AESGCM_NI_TARGET static inline __m128i gfReduce(const __m128i lo, const __m128i mid, const __m128i hi)
+    {
+    __m128i t3 = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+    __m128i t6 = _mm_xor_si128(hi, _mm_srli_si128(mid, 8));
+    // Shift the 256-bit product left one bit, for the bit-reflected representation.
+    __m128i t7 = _mm_srli_epi32(t3, 31);
+    __m128i t8 = _mm_srli_epi32(t6, 31);
+    t3 = _mm_slli_epi32(t3, 1);
+    t6 = _mm_slli_epi32(t6, 1);
+    const __m128i t9 = _mm_srli_si128(t7, 12);
+    t8 = _mm_slli_si128(t8, 4);
+    t7 = _mm_slli_si128(t7, 4);
+    t3 = _mm_or_si128(t3, t7);
+    t6 = _mm_or_si128(_mm_or_si128(t6, t8), t9);
+    // Reduce.
+    t7 = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi32(t3, 31), _mm_slli_epi32(t3, 30)), _mm_slli_epi32(t3, 25));
+    t8 = _mm_srli_si128(t7, 4);
+    t7 = _mm_slli_si128(t7, 12);
+    t3 = _mm_xor_si128(t3, t7);
+    __m128i t2 = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi32(t3, 1), _mm_srli_epi32(t3, 2)), _mm_srli_epi32(t3, 7));
+    t2 = _mm_xor_si128(t2, t8);
+    t3 = _mm_xor_si128(t3, t2);
+    return(_mm_xor_si128(t6, t3));
+    }
+
+OTRADIOLINK_AESGCM_NI_TARGET static void gcm32BNI(const AESGCMKeyContext &k, GCMJob *const jobs, const uint8_t n, const bool encrypt)
+    {
+    __m128i rk[11];
+    for(uint8_t i = 0; i < 11; ++i) { rk[i] = _mm_loadu_si128((const __m128i *)(k.roundKeys + 16*i)); }
+    // Counter blocks 1, 2 and 3 of each job, all encrypted together; unused lanes are harmless.
+    __m128i b[3*GCM_LANES];
+    for(uint8_t j = 0; j < GCM_LANES; ++j)
+        {
+        uint8_t cb[16];
+        if(j < n) { gcmCounterBlock(jobs[j].iv, 1, cb); } else { memset(cb, 0, sizeof(cb)); }
+        b[3*j] = _mm_loadu_si128((const __m128i *)cb);
+        cb[15] = 2;
+        b[3*j + 1] = _mm_loadu_si128((const __m128i *)cb);
+        cb[15] = 3;
+        b[3*j + 2] = _mm_loadu_si128((const __m128i *)cb);
+        }
+    for(uint8_t i = 0; i < 3*GCM_LANES; ++i) { b[i] = _mm_xor_si128(b[i], rk[0]); }
+    for(uint8_t r = 1; r < 10; ++r)
+        { for(uint8_t i = 0; i < 3*GCM_LANES; ++i) { b[i] = _mm_aesenc_si128(b[i], rk[r]); } }
+    for(uint8_t i = 0; i < 3*GCM_LANES; ++i) { b[i] = _mm_aesenclast_si128(b[i], rk[10]); }
+
+    const __m128i h1 = _mm_loadu_si128((const __m128i *)k.hPow[0]);
+    const __m128i h2 = _mm_loadu_si128((const __m128i *)k.hPow[1]);
+    const __m128i h3 = _mm_loadu_si128((const __m128i *)k.hPow[2]);
+    const __m128i h4 = _mm_loadu_si128((const __m128i *)k.hPow[3]);
+    for(uint8_t j = 0; j < n; ++j)
+        {
+        GCMJob &job = jobs[j];
+        const bool hasText = (NULL != job.in);
+        // GHASH input blocks: authtext (zero padded), text, lengths.
+        __m128i blk[(255 + 15) / 16 + 3];
+        uint8_t nb = 0;
+        for(uint8_t off = 0; off < job.aadLen; off += 16)
+            {
+            const uint8_t len = ((job.aadLen - off) > 16) ? 16 : (job.aadLen - off);
+            uint8_t pb[16];
+            memset(pb, 0, sizeof(pb));
+            memcpy(pb, job.aad + off, len);
+            blk[nb++] = bswap128(_mm_loadu_si128((const __m128i *)pb));
+            if(len < 16) { break; }
+            }
+        if(hasText)
+            {
+            const __m128i in0 = _mm_loadu_si128((const __m128i *)job.in);
+            const __m128i in1 = _mm_loadu_si128((const __m128i *)(job.in + 16));
+            const __m128i out0 = _mm_xor_si128(in0, b[3*j + 1]);
+            const __m128i out1 = _mm_xor_si128(in1, b[3*j + 2]);
+            _mm_storeu_si128((__m128i *)job.out, out0);
+            _mm_storeu_si128((__m128i *)(job.out + 16), out1);
+            blk[nb++] = bswap128(encrypt ? out0 : in0);
+            blk[nb++] = bswap128(encrypt ? out1 : in1);
+            }
+        uint8_t lb[16];
+        gcmLengthsBlock(job.aadLen, hasText, lb);
+        blk[nb++] = bswap128(_mm_loadu_si128((const __m128i *)lb));
+        // Four blocks per reduction: Y' = (Y+B0)H^4 + B1.H^3 + B2.H^2 + B3.H.
+        __m128i y = _mm_setzero_si128();
+        uint8_t i = 0;
+        for( ; i + 4 <= nb; i += 4)
+            {
+            __m128i lo = _mm_setzero_si128(), mid = _mm_setzero_si128(), hi = _mm_setzero_si128();
+            clmulAcc(_mm_xor_si128(y, blk[i]), h4, lo, mid, hi);
+            clmulAcc(blk[i + 1], h3, lo, mid, hi);
+            clmulAcc(blk[i + 2], h2, lo, mid, hi);
+            clmulAcc(blk[i + 3], h1, lo, mid, hi);
+            y = gfReduce(lo, mid, hi);
+            }
+        for( ; i < nb; ++i)
+            {
+            __m128i lo = _mm_setzero_si128(), mid = _mm_setzero_si128(), hi = _mm_setzero_si128();
+            clmulAcc(_mm_xor_si128(y, blk[i]), h1, lo, mid, hi);
+            y = gfReduce(lo, mid, hi);
+            }
+        _mm_storeu_si128((__m128i *)job.tag, _mm_xor_si128(bswap128(y), b[3*j]));
+        }
+    }
+
+static bool isAESGCMHardwareAvailable()
+    {
+#if defined(__AES__) && defined(__PCLMUL__) && defined(__SSSE3__)
+    return(true);
+#else
+    __builtin_cpu_init();
+    return(__builtin_cpu_supports("aes") && __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3"));
+#endif
+    }
+#endif // OTRADIOLINK_AESGCM_NI
+
+static std::atomic<gcm32B_t *> gcm32B(NULL);
+
+// Get the implementation, selecting it on first use.
+static gcm32B_t *getGCM32B()
+    {
+    gcm32B_t *const impl = gcm32B.load();
+    if(NULL != impl) { return(impl); }
+    setAESGCMHardwareAllowed(true);
+    return(gcm32B.load());
+    }
+
+bool isAESGCMHardwareInUse()
+    {
+#ifdef OTRADIOLINK_AESGCM_NI
+    return(gcm32BNI == getGCM32B());
+#else
+    return(false);
+#endif
+    }
+
+void setAESGCMHardwareAllowed(const bool allowed)
+    {
+#ifdef OTRADIOLINK_AESGCM_NI
+    static const bool available = isAESGCMHardwareAvailable();
+    if(allowed && available) { gcm32B = gcm32BNI; return; }
+#else
+    (void)allowed;
+#endif
+    gcm32B = gcm32BPortable;
+    }
+
+
+bool AESGCMKeyContext::init(const uint8_t *const key)
+    {
+    if(NULL == key) { return(false); } // ERROR
+    // AES-128 key expansion, as little-endian words.
+    static const uint8_t rcon[10] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36 };
+    uint32_t w[ROUND_KEYS_SIZE / 4];
+    for(uint8_t i = 0; i < KEY_SIZE / 4; ++i) { w[i] = dec32le(key + 4*i); }
+    for(uint8_t i = KEY_SIZE / 4; i < ROUND_KEYS_SIZE / 4; ++i)
+        {
+        uint32_t t = w[i - 1];
+        // RotWord, SubWord and Rcon.
+        if(0 == (i & 3)) { t = aesSubWord((t << 24) | (t >> 8)) ^ rcon[i/4 - 1]; }
+        w[i] = w[i - 4] ^ t;
+        }
+    for(uint8_t i = 0; i < ROUND_KEYS_SIZE / 4; ++i) { enc32le(roundKeys + 4*i, w[i]); }
+    // Bitsliced round keys, keeping one bit in four of each word.
+    for(uint8_t i = 0; i < ROUND_KEYS_SIZE / 4; i += 4)
+        {
+        uint64_t q[8];
+        bsInterleaveIn(q[0], q[4], w + i);
+        q[1] = q[2] = q[3] = q[0];
+        q[5] = q[6] = q[7] = q[4];
+        bsOrtho(q);
+        for(uint8_t h = 0; h < 2; ++h)
+            {
+            bsRoundKeys[i/2 + h] = (q[4*h] & 0x1111111111111111ULL) | (q[4*h + 1] & 0x2222222222222222ULL) |
+                                   (q[4*h + 2] & 0x4444444444444444ULL) | (q[4*h + 3] & 0x8888888888888888ULL);
+            }
+        }
+    // H = E(K, 0^128).
+    uint64_t skey[BS_ROUND_KEYS_SIZE];
+    bsExpandRoundKeys(bsRoundKeys, skey);
+    uint8_t blocks[64];
+    memset(blocks, 0, sizeof(blocks));
+    aesEncrypt4Blocks(skey, blocks);
+    h64[0] = dec64be(blocks);
+    h64[1] = dec64be(blocks + 8);
+    // Powers of H, byte-reversed, for the carry-less multiply.
+    uint8_t p[16];
+    memcpy(p, blocks, sizeof(p));
+    for(uint8_t i = 0; i < 4; ++i)
+        {
+        if(0 != i) { ghashMult(h64, p); }
+        for(uint8_t j = 0; j < 16; ++j) { hPow[i][j] = p[15 - j]; }
+        }
+    return(true);
+    }
+
+// Compare tags in time independent of their contents.
+static bool tagsEqual(const uint8_t *const a, const uint8_t *const b)
+    {
+    uint8_t diff = 0;
+    for(uint8_t i = 0; i < 16; ++i) { diff |= a[i] ^ b[i]; }
+    return(0 == diff);
+    }
+
+bool fixed32BTextSize12BNonce16BTagSimpleEnc_HUB(void *const state,
+        const uint8_t *const key, const uint8_t *const iv,
+        const uint8_t *const authtext, const uint8_t authtextSize,
+        const uint8_t *const plaintext,
+        uint8_t *const ciphertextOut, uint8_t *const tagOut)
+    {
+    if(((NULL == state) && (NULL == key)) || (NULL == iv) ||
+       ((NULL == authtext) && (0 != authtextSize)) ||
+       ((NULL != plaintext) && (NULL == ciphertextOut)) || (NULL == tagOut)) { return(false); } // ERROR
+    AESGCMKeyContext local;
+    const AESGCMKeyContext *k = (const AESGCMKeyContext *)state;
+    if(NULL == k) { local.init(key); k = &local; }
+    uint8_t ctext[ENC_BODY_SMALL_FIXED_CTEXT_SIZE];
+    GCMJob job = { iv, authtext, authtextSize, plaintext, ctext, { 0 } };
+    getGCM32B()(*k, &job, 1, true);
+    if(NULL != plaintext) { memcpy(ciphertextOut, ctext, sizeof(ctext)); }
+    memcpy(tagOut, job.tag, sizeof(job.tag));
+    return(true);
+    }
+
+bool fixed32BTextSize12BNonce16BTagSimpleDec_HUB(void *const state,
+        const uint8_t *const key, const uint8_t *const iv,
+        const uint8_t *const authtext, const uint8_t authtextSize,
+        const uint8_t *const ciphertext, const uint8_t *const tag,
+        uint8_t *const plaintextOut)
+    {
+    if(((NULL == state) && (NULL == key)) || (NULL == iv) ||
+       ((NULL == authtext) && (0 != authtextSize)) ||
+       ((NULL != ciphertext) && (NULL == plaintextOut)) || (NULL == tag)) { return(false); } // ERROR
+    AESGCMKeyContext local;
+    const AESGCMKeyContext *k = (const AESGCMKeyContext *)state;
+    if(NULL == k) { local.init(key); k = &local; }
+    uint8_t ptext[ENC_BODY_SMALL_FIXED_CTEXT_SIZE];
+    GCMJob job = { iv, authtext, authtextSize, ciphertext, ptext, { 0 } };
+    getGCM32B()(*k, &job, 1, false);
+    if(!tagsEqual(job.tag, tag)) { return(false); } // ERROR
+    if(NULL != ciphertext) { memcpy(plaintextOut, ptext, sizeof(ptext)); }
+    return(true);
+    }
+
+
+// Number of hash slots for a cache of the given capacity: a power of 2 at least twice capacity.
+static uint32_t keyCacheSlots(const uint32_t capacity)
+    {
+    uint32_t n = 2;
+    while(n < 2 * capacity) { n <<= 1; }
+    return(n);
+    }
+
+// FNV-1a hash of a node ID.
+static uint32_t hashID(const uint8_t *const id, const uint8_t idLen)
+    {
+    uint32_t h = 2166136261UL;
+    for(uint8_t i = 0; i < idLen; ++i) { h = (h ^ id[i]) * 16777619UL; }
+    return(h);
+    }
+
+AESGCMKeyCache::AESGCMKeyCache(const uint32_t capacity_)
+  : entries(new Entry[(0 == capacity_) ? 1 : capacity_]),
+    capacity((0 == capacity_) ? 1 : capacity_),
+    used(0), newest(NONE), oldest(NONE),
+    slots(new uint32_t[keyCacheSlots(capacity_)]),
+    slotMask(keyCacheSlots(capacity_) - 1),
+    expansions(0)
+    { clear(); }
+
+AESGCMKeyCache::~AESGCMKeyCache()
+    {
+    delete[] entries;
+    delete[] slots;
+    }
+
+// Returns the slot holding the given ID, else the empty slot where it would go.
+uint32_t AESGCMKeyCache::findSlot(const uint8_t *const id, const uint8_t idLen) const
+    {
+    // Never more than half full, so an empty slot will be found.
+    for(uint32_t s = hashID(id, idLen) & slotMask; ; s = (s + 1) & slotMask)
+        {
+        const uint32_t e = slots[s];
+        if(NONE == e) { return(s); }
+        const Entry &en = entries[e];
+        if((idLen == en.idLen) && (0 == memcmp(id, en.id, idLen))) { return(s); }
+        }
+    }
+
+void AESGCMKeyCache::unlink(const uint32_t e)
+    {
+    Entry &en = entries[e];
+    if(NONE != en.newer) { entries[en.newer].older = en.older; } else { newest = en.older; }
+    if(NONE != en.older) { entries[en.older].newer = en.newer; } else { oldest = en.newer; }
+    en.newer = NONE;
+    en.older = NONE;
+    }
+
+void AESGCMKeyCache::linkNewest(const uint32_t e)
+    {
+    Entry &en = entries[e];
+    en.newer = NONE;
+    en.older = newest;
+    if(NONE != newest) { entries[newest].newer = e; } else { oldest = e; }
+    newest = e;
+    }
+
+// Empty the given slot, moving back any following entries that could then not be found.
+void AESGCMKeyCache::removeSlot(uint32_t slot)
+    {
+    slots[slot] = NONE;
+    for(uint32_t s = (slot + 1) & slotMask; ; s = (s + 1) & slotMask)
+        {
+        const uint32_t e = slots[s];
+        if(NONE == e) { return; }
+        // Leave the entry if its home slot is cyclically within (slot, s].
+        const uint32_t home = hashID(entries[e].id, entries[e].idLen) & slotMask;
+        const bool stays = (slot <= s) ? ((slot < home) && (home <= s)) : ((slot < home) || (home <= s));
+        if(stays) { continue; }
+        slots[slot] = e;
+        slots[s] = NONE;
+        slot = s;
+        }
+    }
+
+const AESGCMKeyContext *AESGCMKeyCache::get(const uint8_t *const id, const uint8_t idLen, const uint8_t *const key)
+    {
+    if((NULL == id) || (0 == idLen) || (idLen > MAX_ID_LENGTH) || (NULL == key)) { return(NULL); } // ERROR
+    const uint32_t slot = findSlot(id, idLen);
+    uint32_t e = slots[slot];
+    if(NONE != e)
+        {
+        // Hit: re-expand only if the node's key has changed.
+        unlink(e);
+        linkNewest(e);
+        Entry &en = entries[e];
+        if(0 != memcmp(en.key, key, AESGCMKeyContext::KEY_SIZE))
+            {
+            en.context.init(key);
+            memcpy(en.key, key, AESGCMKeyContext::KEY_SIZE);
+            ++expansions;
+            }
+        return(&en.context);
+        }
+    // Miss: use a free entry, else evict the least recently used.
+    if(used < capacity) { e = used++; slots[slot] = e; }
+    else
+        {
+        e = oldest;
+        unlink(e);
+        removeSlot(findSlot(entries[e].id, entries[e].idLen));
+        // Removal may have moved entries, so look again.
+        slots[findSlot(id, idLen)] = e;
+        }
+    Entry &en = entries[e];
+    memcpy(en.id, id, idLen);
+    en.idLen = idLen;
+    memcpy(en.key, key, AESGCMKeyContext::KEY_SIZE);
+    en.context.init(key);
+    ++expansions;
+    linkNewest(e);
+    return(&en.context);
+    }
+
+bool AESGCMKeyCache::remove(const uint8_t *const id, const uint8_t idLen)
+    {
+    if((NULL == id) || (0 == idLen) || (idLen > MAX_ID_LENGTH)) { return(false); } // ERROR
+    const uint32_t slot = findSlot(id, idLen);
+    const uint32_t e = slots[slot];
+    if(NONE == e) { return(false); }
+    unlink(e);
+    removeSlot(slot);
+    // Keep live entries contiguous by moving the last into the gap.
+    const uint32_t last = --used;
+    if(e != last)
+        {
+        Entry &en = entries[e];
+        en = entries[last];
+        if(NONE != en.newer) { entries[en.newer].older = e; } else { newest = e; }
+        if(NONE != en.older) { entries[en.older].newer = e; } else { oldest = e; }
+        slots[findSlot(en.id, en.idLen)] = e;
+        }
+    return(true);
+    }
+
+void AESGCMKeyCache::clear()
+    {
+    used = 0;
+    newest = NONE;
+    oldest = NONE;
+    for(uint32_t s = 0; s <= slotMask; ++s) { slots[s] = NONE; }
+    }
+
+
+// Frames below which another thread is not worth starting.
+static const size_t minFramesPerThread = 64;
+
+// Group index for frames without a key.
+static const uint32_t NO_GROUP = 0xffffffffUL;
+
+// Hash of a 16-byte key, for grouping frames by key.
+static inline uint32_t hashKey(const uint8_t *const key)
+    {
+    uint64_t a, b;
+    memcpy(&a, key, 8);
+    memcpy(&b, key + 8, 8);
+    return((uint32_t)(((a ^ (b * 0x9e3779b97f4a7c15ULL)) * 0xff51afd7ed558ccdULL) >> 32));
+    }
+
+// Look up the expanded key for each group in the cache, by the node ID of its first frame,
+// leaving NULL (to be expanded locally) those that cannot safely be shared.
+// At most capacity lookups are made, so none evicts an entry already looked up for this batch
+// (the least recently used is never one of the most recent lookups unless all entries are).
+static void getGroupContexts(AESGCMKeyCache &cache, const SecureSmallFrameBatchItem *const items,
+                             const std::vector<uint32_t> &groupFirst, std::vector<const AESGCMKeyContext *> &groupContext)
+    {
+    const size_t nc = (groupFirst.size() < cache.getCapacity()) ? groupFirst.size() : cache.getCapacity();
+    std::vector<std::pair<const AESGCMKeyContext *, uint32_t> > got;
+    got.reserve(nc);
+    for(uint32_t g = 0; g < nc; ++g)
+        {
+        const SecureSmallFrameBatchItem &it = items[groupFirst[g]];
+        const SecurableFrameView v(it.buf, it.buflen);
+        if(v.isInvalid()) { continue; }
+        const FrameSpan<const uint8_t> id = v.id();
+        groupContext[g] = cache.get(id.data, id.size, it.key);
+        if(NULL != groupContext[g]) { got.push_back(std::make_pair(groupContext[g], g)); }
+        }
+    // A node ID seen with different keys has its entry re-expanded for each in turn:
+    // only the last group to get it may use it.
+    std::sort(got.begin(), got.end());
+    for(size_t i = 1; i < got.size(); ++i)
+        { if(got[i - 1].first == got[i].first) { groupContext[got[i - 1].second] = NULL; } }
+    }
+
+// Decodes the items at order[begin,end), in which frames of a group (with equal keys) are adjacent.
+// Uses the group's expanded key from groupContext where not NULL, else expands it once per run of the group.
+// Returns the number of frames that passed.
+static size_t decodeBatchRange(gcm32B_t *const impl,
+                               SecureSmallFrameBatchItem *const items, const uint32_t *const order,
+                               const uint32_t *const groupOf, const AESGCMKeyContext *const *const groupContext,
+                               const size_t begin, const size_t end, bool *const passOut)
+    {
+    AESGCMKeyContext local;
+    const AESGCMKeyContext *k = NULL;
+    uint32_t kGroup = NO_GROUP;
+    GCMJob jobs[GCM_LANES];
+    uint32_t jobItem[GCM_LANES];
+    uint8_t ptext[GCM_LANES][ENC_BODY_SMALL_FIXED_CTEXT_SIZE];
+    uint8_t nj = 0;
+    size_t passed = 0;
+    for(size_t o = begin; ; ++o)
+        {
+        const bool atEnd = (o >= end);
+        const SecureSmallFrameBatchItem *const item = atEnd ? NULL : &items[order[o]];
+        const uint32_t g = atEnd ? NO_GROUP : groupOf[order[o]];
+        const bool newKey = (NO_GROUP != g) && (kGroup != g);
+        // Complete the pending jobs before the key changes, when the lanes are full, or at the end.
+        if((0 != nj) && (atEnd || newKey || (GCM_LANES == nj)))
+            {
+            impl(*k, jobs, nj, false);
+            for(uint8_t j = 0; j < nj; ++j)
+                {
+                SecureSmallFrameBatchItem &it = items[jobItem[j]];
+                const uint8_t fl = it.buf[0];
+                if(!tagsEqual(jobs[j].tag, it.buf + fl - 16)) { continue; } // ERROR
+                // Unpad as decodeSecureSmallFrameRaw() does; an empty body has nothing to unpad.
+                const uint8_t upbl = (NULL == jobs[j].in) ? 0 : removePaddingTo32BTrailing0sAndPadCount(ptext[j]);
+                if(upbl > ENC_BODY_SMALL_FIXED_PTEXT_MAX_SIZE) { continue; } // ERROR
+                if(upbl > it.decryptedBodyOutBuflen) { continue; } // ERROR
+                memcpy(it.decryptedBodyOut, ptext[j], upbl);
+                it.decodedBodyOutSize = upbl;
+                passOut[jobItem[j]] = true;
+                ++passed;
+                }
+            nj = 0;
+            }
+        if(atEnd) { break; }
+        passOut[order[o]] = false;
+        // Checks as for checkAndDecodeSmallFrameHeader() and decodeSecureSmallFrameRaw(),
+        // but requiring the whole 32-byte encrypted body, if any, to be present.
+        if((NULL == item->key) || (NULL == item->iv) || (NULL == item->decryptedBodyOut)) { continue; } // ERROR
+        const SecurableFrameView v(item->buf, item->buflen);
+        if(v.isInvalid()) { continue; } // ERROR
+        if(23 != v.trailer().size) { continue; } // ERROR
+        if(0x80 != v.trailer()[22]) { continue; } // ERROR
+        const FrameSpan<const uint8_t> body = v.body();
+        if((0 != body.size) && (ENC_BODY_SMALL_FIXED_CTEXT_SIZE != body.size)) { continue; } // ERROR
+        if(newKey)
+            {
+            k = groupContext[g];
+            if(NULL == k) { local.init(item->key); k = &local; }
+            kGroup = g;
+            }
+        GCMJob &job = jobs[nj];
+        job.iv = item->iv;
+        job.aad = item->buf;
+        job.aadLen = (uint8_t)(body.data - item->buf);
+        job.in = (0 == body.size) ? NULL : body.data;
+        job.out = ptext[nj];
+        jobItem[nj] = order[o];
+        ++nj;
+        }
+    return(passed);
+    }
+
+size_t decodeSecureSmallFramesBatch(SecureSmallFrameBatchItem *const items, const size_t n, bool *const passOut,
+                                    const unsigned threads, AESGCMKeyCache *const cache)
+    {
+    if((0 == n) || (NULL == items) || (NULL == passOut)) { return(0); } // ERROR
+    // Group frames by key in one pass, through a hash of key to group; frames without a key are in none.
+    std::vector<uint32_t> groupOf(n);
+    std::vector<uint32_t> groupFirst;
+    std::vector<size_t> groupNext;
+    const uint32_t slotMask = keyCacheSlots((uint32_t)n) - 1;
+    std::vector<uint32_t> slots(slotMask + 1, NO_GROUP);
+    size_t noKey = 0;
+    for(size_t i = 0; i < n; ++i)
+        {
+        const uint8_t *const key = items[i].key;
+        if(NULL == key) { groupOf[i] = NO_GROUP; ++noKey; continue; }
+        uint32_t g;
+        for(uint32_t s = hashKey(key) & slotMask; ; s = (s + 1) & slotMask)
+            {
+            g = slots[s];
+            if(NO_GROUP == g)
+                {
+                g = (uint32_t)groupFirst.size();
+                slots[s] = g;
+                groupFirst.push_back((uint32_t)i);
+                groupNext.push_back(0);
+                break;
+                }
+            const uint8_t *const gk = items[groupFirst[g]].key;
+            if((gk == key) || (0 == memcmp(gk, key, AESGCMKeyContext::KEY_SIZE))) { break; }
+            }
+        groupOf[i] = g;
+        ++groupNext[g];
+        }
+    // Visit frames without a key first (they fail), then each group's frames together, in arrival order.
+    size_t at = noKey;
+    for(size_t g = 0; g < groupNext.size(); ++g) { const size_t c = groupNext[g]; groupNext[g] = at; at += c; }
+    std::vector<uint32_t> order(n);
+    size_t nk = 0;
+    for(size_t i = 0; i < n; ++i)
+        {
+        const uint32_t g = groupOf[i];
+        order[(NO_GROUP == g) ? nk++ : groupNext[g]++] = (uint32_t)i;
+        }
+    std::vector<const AESGCMKeyContext *> groupContext(groupFirst.size(), NULL);
+    if(NULL != cache) { getGroupContexts(*cache, items, groupFirst, groupContext); }
+    // Split into contiguous runs, one per thread; the caller's thread takes the first.
+    // No more threads than cores: with one core (or an unknown number) decode serially.
+    const unsigned cores = std::thread::hardware_concurrency();
+    size_t nThreads = (0 != threads) ? threads : cores;
+    if(nThreads > cores) { nThreads = cores; }
+    if(nThreads > n / minFramesPerThread) { nThreads = n / minFramesPerThread; }
+    if(nThreads < 1) { nThreads = 1; }
+    gcm32B_t *const impl = getGCM32B();
+    const uint32_t *const ord = order.data();
+    const uint32_t *const grp = groupOf.data();
+    const AESGCMKeyContext *const *const ctx = groupContext.data();
+    std::vector<size_t> passed(nThreads, 0);
+    const size_t perThread = (n + nThreads - 1) / nThreads;
+    std::vector<std::thread> workers;
+    workers.reserve(nThreads - 1);
+    size_t started = 1;
+    try
+        {
+        for( ; started < nThreads; ++started)
+            {
+            const size_t begin = started * perThread;
+            const size_t end = ((begin + perThread) > n) ? n : (begin + perThread);
+            size_t *const p = &passed[started];
+            workers.push_back(std::thread([=]() { *p = decodeBatchRange(impl, items, ord, grp, ctx, begin, end, passOut); }));
+            }
+        }
+    catch(const std::system_error &) { } // Could not start a thread: decode the remaining runs here.
+    size_t total = 0;
+    for(size_t t = 0; t < nThreads; ++t)
+        {
+        if((0 != t) && (t < started)) { continue; }
+        const size_t begin = t * perThread;
+        const size_t end = ((begin + perThread) > n) ? n : (begin + perThread);
+        total += decodeBatchRange(impl, items, ord, grp, ctx, begin, end, passOut);
+        }
+    for(size_t t = 1; t < started; ++t)
+        {
+        workers[t - 1].join();
+        total += passed[t];
+        }
+    return(total);
+    }
+
+    }
+
+#endif // !defined(__AVR__)
@@ -0,0 +1,202 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+/*
+ * Batched decryption/authentication of secure small frames at a hub.
+ *
+ * A hub may receive frames from many nodes, and can usefully decode them in bulk.
+ * This provides a self-contained AES-128-GCM for the fixed 32-byte texts, 12-byte nonces
+ * and 16-byte tags of secure small frames (see OTRadioLink_SecureableFrameType.h),
+ * with expanded keys kept in an AESGCMKeyContext so that they may be reused,
+ * using AES-NI and PCLMULQDQ when the CPU supports them, else a portable constant-time implementation.
+ *
+ * decodeSecureSmallFramesBatch() groups frames by key so that each key is expanded at most once
+ * (or not at all, with an AESGCMKeyCache), pipelines several frames at a time through the AES unit,
+ * and splits the work across up to a given number of threads.
+ *
+ * AESGCMKeyCache keeps expanded keys by node ID, so that a hub hearing from many nodes
+ * need not expand a key for every frame it decodes one at a time.
+ *
+ * Not for the AVR (where OTAESGCM should be used): there this header declares nothing.
+ * The fixed32BTextSize12BNonce16BTag... function-pointer interface is unchanged,
+ * so AVR code continues to pass its own (eg NULL) state.
+ */
+
+#ifndef ARDUINO_LIB_OTRADIOLINK_SECUREFRAMEBATCH_H
+#define ARDUINO_LIB_OTRADIOLINK_SECUREFRAMEBATCH_H
+
+#if !defined(__AVR__)
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "OTRadioLink_SecureableFrameType.h"
+
+namespace OTRadioLink
+    {
+
+
+    // Expanded AES-128-GCM key: AES round keys and GHASH key powers.
+    // About 0.4kB; set up with init() once per key and reused read-only (eg by several threads).
+    struct AESGCMKeyContext
+        {
+        static const uint8_t KEY_SIZE = 16;
+        static const uint8_t ROUND_KEYS_SIZE = 176;
+        // AES-128 round keys in FIPS-197 order.
+        uint8_t roundKeys[ROUND_KEYS_SIZE];
+        // GHASH key H^1..H^4, byte-reversed for carry-less multiply, in hPow[0]..hPow[3].
+        uint8_t hPow[4][16];
+        // For the (constant-time) portable implementation:
+        // the AES-128 round keys bitsliced, two words per round, and GHASH key H as big-endian halves.
+        uint64_t bsRoundKeys[22];
+        uint64_t h64[2];
+
+        // Expand the given 16-byte key; returns false if key is NULL.
+        bool init(const uint8_t *key);
+        };
+
+    // True if the AES-NI/PCLMULQDQ implementation is in use.
+    bool isAESGCMHardwareInUse();
+    // Allow (the default) or disallow use of AES-NI/PCLMULQDQ, eg to test or benchmark the portable code.
+    // Should not be changed while other threads are encrypting or decrypting.
+    void setAESGCMHardwareAllowed(bool allowed);
+
+    // AES-128-GCM fixed32BTextSize12BNonce16BTagSimpleEnc_ptr_t/Dec_ptr_t implementations.
+    // The state may be NULL, in which case key is expanded on each call,
+    // or point to an AESGCMKeyContext already initialised with key, in which case key is ignored.
+    // As for those types, a NULL plaintext/ciphertext means an empty text, authenticating only the authtext,
+    // in which case ciphertextOut/plaintextOut is not used and may be NULL.
+    // Return true on success, false on failure; on failure decryption leaves plaintextOut unchanged.
+    bool fixed32BTextSize12BNonce16BTagSimpleEnc_HUB(void *state,
+            const uint8_t *key, const uint8_t *iv,
+            const uint8_t *authtext, uint8_t authtextSize,
+            const uint8_t *plaintext,
+            uint8_t *ciphertextOut, uint8_t *tagOut);
+    bool fixed32BTextSize12BNonce16BTagSimpleDec_HUB(void *state,
+            const uint8_t *key, const uint8_t *iv,
+            const uint8_t *authtext, uint8_t authtextSize,
+            const uint8_t *ciphertext, const uint8_t *tag,
+            uint8_t *plaintextOut);
+
+    // Expanded keys by node ID, with least-recently-used eviction beyond a fixed capacity.
+    // The context for a node can be passed as state to the _HUB enc/dec functions, eg:
+    //     decodeSecureSmallFrameRaw(&sfh, buf, buflen, fixed32BTextSize12BNonce16BTagSimpleDec_HUB,
+    //         (void *)cache.get(nodeID, 8, key), key, iv, ...);
+    // All storage is allocated on construction.
+    // Not thread-safe: use one per thread or lock around get() and the use of its result.
+    class AESGCMKeyCache
+        {
+        public:
+            // Longest node ID supported.
+            static const uint8_t MAX_ID_LENGTH = SecurableFrameHeader::maxIDLength;
+
+        private:
+            static const uint32_t NONE = 0xffffffffUL;
+            struct Entry
+                {
+                AESGCMKeyContext context;
+                uint8_t key[AESGCMKeyContext::KEY_SIZE];
+                uint8_t id[MAX_ID_LENGTH];
+                uint8_t idLen;
+                // Neighbours in recency order; NONE at the ends.
+                uint32_t newer, older;
+                };
+            // Entries; the first 'used' of 'capacity' are live.
+            Entry *const entries;
+            const uint32_t capacity;
+            uint32_t used;
+            // Most and least recently used live entries, or NONE if none.
+            uint32_t newest, oldest;
+            // Open-addressed hash of ID to entry index, NONE if a slot is empty; slotMask+1 slots.
+            uint32_t *const slots;
+            const uint32_t slotMask;
+            // Number of key expansions done (misses, and hits with a changed key).
+            uint32_t expansions;
+
+            uint32_t findSlot(const uint8_t *id, uint8_t idLen) const;
+            void unlink(uint32_t e);
+            void linkNewest(uint32_t e);
+            void removeSlot(uint32_t slot);
+
+            // Not copyable.
+            AESGCMKeyCache(const AESGCMKeyCache &) = delete;
+            AESGCMKeyCache &operator=(const AESGCMKeyCache &) = delete;
+
+        public:
+            // Create a cache holding up to capacity (>= 1) nodes' keys.
+            explicit AESGCMKeyCache(uint32_t capacity);
+            ~AESGCMKeyCache();
+
+            // Get the expanded key for the given node, expanding key if not cached or if changed.
+            // Marks the node as most recently used, evicting the least recently used if full.
+            // The result is valid until the next non-const call;
+            // returns NULL if id is NULL or idLen is outside [1,MAX_ID_LENGTH], or key is NULL.
+            const AESGCMKeyContext *get(const uint8_t *id, uint8_t idLen, const uint8_t *key);
+            // Forget the node's key, eg when it is revoked; returns true if it was cached.
+            bool remove(const uint8_t *id, uint8_t idLen);
+            // Forget all keys.
+            void clear();
+
+            uint32_t size() const { return(used); }
+            uint32_t getCapacity() const { return(capacity); }
+            uint32_t getExpansions() const { return(expansions); }
+        };
+
+    // A received secure small frame to be decoded in a batch, with its key and IV/nonce.
+    // The key and IV are as would be passed to decodeSecureSmallFrameRaw().
+    struct SecureSmallFrameBatchItem
+        {
+        // Frame starting with its leading fl byte, and the number of bytes available there.
+        const uint8_t *buf;
+        uint8_t buflen;
+        // 16-byte key and 12-byte IV/nonce for this frame.
+        const uint8_t *key;
+        const uint8_t *iv;
+        // Buffer for the decrypted unpadded body, and its size.
+        uint8_t *decryptedBodyOut;
+        uint8_t decryptedBodyOutBuflen;
+        // Set to the decrypted body size for frames that pass.
+        uint8_t decodedBodyOutSize;
+        };
+
+    // Decode, authenticate and decrypt a batch of secure small frames, eg as received at a hub.
+    // Each frame gets the same checks and result as from checkAndDecodeSmallFrameHeader()
+    // followed by decodeSecureSmallFrameRaw() with AES-128-GCM.
+    // Frames with equal keys are grouped so that each key is expanded once per thread,
+    // or taken from the cache if one is given.
+    // Decodes on the caller's thread alone on a single core, or if no other thread can be started.
+    // Returns the number of frames that passed.
+    //
+    // Parameters:
+    //  * items  array of n frames; never NULL if n > 0
+    //  * n  number of frames
+    //  * passOut  array of n results, each set true iff that frame was authenticated and decoded;
+    //        never NULL if n > 0
+    //  * threads  maximum number of threads to use including the caller's,
+    //        limited to the number of cores; 0 for one per core
+    //  * cache  if not NULL, expanded keys are looked up (and kept) here by each frame's node ID,
+    //        as for the per-frame path; it is only used from the caller's thread
+    size_t decodeSecureSmallFramesBatch(SecureSmallFrameBatchItem *items, size_t n, bool *passOut,
+                                        unsigned threads = 1, AESGCMKeyCache *cache = NULL);
+
+
+    }
+
+#endif // !defined(__AVR__)
+
+#endif
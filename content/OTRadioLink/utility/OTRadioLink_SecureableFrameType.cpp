@@ -140,32 +140,15 @@ uint8_t SecurableFrameHeader::checkAndEncodeSmallFrameHeader(uint8_t *const buf,
     return(hlifl); // SUCCESS!
     }
 
-// Decode header and check parameters/validity for inbound short secureable frame.
-// The buffer starts with the fl frame length byte.
-//
-// Parameters:
-//  * buf  buffer to decode header from, of at least length buflen; never NULL
-//  * buflen  available length in buf; if too small for encoded header routine will fail (return 0)
-//
-// Performs as many as possible of the 'Quick Integrity Checks' from the spec, eg SecureBasicFrame-V0.1-201601.txt
-//  1) fl >= 4 (type, seq/il, bl, trailer bytes)
-//  2) fl may be further constrained by system limits, typically to <= 63
-//  3) type (the first frame byte) is never 0x00, 0x80, 0x7f, 0xff.
-//  4) il <= 8 for initial implementations (internal node ID is 8 bytes)
-//  5) il <= fl - 4 (ID length; minimum of 4 bytes of other overhead)
-//  6) bl <= fl - 4 - il (body length; minimum of 4 bytes of other overhead)
-//  7) the final frame byte (the final trailer byte) is never 0x00 nor 0xff (if whole frame available)
-//  8) tl == 1 for non-secure, tl >= 1 for secure (tl = fl - 3 - il - bl)
-// Note: fl = hl-1 + bl + tl = 3+il + bl + tl
-//
-// (If the header is invalid or the buffer too small, 0 is returned to indicate an error.)
-// The fl byte in the structure is set to the frame length, else 0 in case of any error.
-// Returns number of bytes of decoded header including nominally-leading fl length byte; 0 in case of error.
-uint8_t SecurableFrameHeader::checkAndDecodeSmallFrameHeader(const uint8_t *const buf, uint8_t buflen)
+// Performs the quick integrity checks on a small frame header for checkAndDecodeSmallFrameHeader()
+// and SecurableFrameViewT::checkAndDecodeSmallFrame(), without copying anything out of buf
+// other than the fl, fType, seqIl and bl header bytes.
+// Each header byte is read once, so buf may be volatile, eg an ISR RX queue buffer.
+// Returns the header length including the leading fl byte, or 0 in case of error.
+template<typename B>
+static uint8_t _checkSmallFrameHeader(B *const buf, const uint8_t buflen,
+                                      uint8_t &fl, uint8_t &fType, uint8_t &seqIl, uint8_t &bl)
     {
-    // Make frame 'invalid' until everything is finished and checks out.
-    fl = 0;
-
     // If buf is NULL or clearly too small to contain a valid header then return an error.
     if(NULL == buf) { return(0); } // ERROR
     if(buflen < 4) { return(0); } // ERROR
@@ -175,24 +158,22 @@ uint8_t SecurableFrameHeader::checkAndDecodeSmallFrameHeader(const uint8_t *cons
     const uint8_t fl_ = buf[0];
     if(fl_ < 4) { return(0); } // ERROR
     //  2) fl may be further constrained by system limits, typically to < 64, eg for 'small' frame.
-    if(fl_ > maxSmallFrameSize) { return(0); } // ERROR
+    if(fl_ > SecurableFrameHeader::maxSmallFrameSize) { return(0); } // ERROR
     //  3) type (the first frame byte) is never 0x00, 0x80, 0x7f, 0xff.
     fType = buf[1];
-    const bool secure_ = isSecure();
+    const bool secure_ = (0 != (0x80 & fType));
     const FrameType_Secureable fType_ = (FrameType_Secureable)(fType & 0x7f);
     if((FTS_NONE == fType_) || (fType_ >= FTS_INVALID_HIGH)) { return(0); } // ERROR
     //  4) il <= 8 for initial implementations (internal node ID is 8 bytes)
     seqIl = buf[2];
-    const uint8_t il_ = getIl();
-    if(il_ > maxIDLength) { return(0); } // ERROR
+    const uint8_t il_ = seqIl & 0xf;
+    if(il_ > SecurableFrameHeader::maxIDLength) { return(0); } // ERROR
     //  5) il <= fl - 4 (ID length; minimum of 4 bytes of other overhead)
     if(il_ > fl_ - 4) { return(0); } // ERROR
     // Header length including frame length byte.
     const uint8_t hlifl = 4 + il_;
     // If buffer doesn't contain enough data for the full header then return an error.
     if(hlifl > buflen) { return(0); } // ERROR
-    // Capture the ID bytes, in the storage in the instance, if any.
-    if(il_ > 0) { memcpy(id, buf+3, il_); }
     //  6) bl <= fl - 4 - il (body length; minimum of 4 bytes of other overhead)
     const uint8_t bl_ = buf[hlifl - 1];
     if(bl_ > fl_ - hlifl) { return(0); } // ERROR
@@ -204,10 +185,48 @@ uint8_t SecurableFrameHeader::checkAndDecodeSmallFrameHeader(const uint8_t *cons
         if((0x00 == lastByte) || (0xff == lastByte)) { return(0); } // ERROR
         }
     //  8) tl == 1 for non-secure, tl >= 1 for secure (tl = fl - 3 - il - bl)
-    const uint8_t tl_ = fl_ - 3 - il_ - bl; // Same calc, but getTl() can't be used as fl not yet set.
+    const uint8_t tl_ = fl_ - 3 - il_ - bl_;
     if(!secure_) { if(1 != tl_) { return(0); } } // ERROR
     else if(0 == tl_) { return(0); } // ERROR
 
+    fl = fl_;
+    return(hlifl); // SUCCESS!
+    }
+
+// Decode header and check parameters/validity for inbound short secureable frame.
+// The buffer starts with the fl frame length byte.
+//
+// Parameters:
+//  * buf  buffer to decode header from, of at least length buflen; never NULL
+//  * buflen  available length in buf; if too small for encoded header routine will fail (return 0)
+//
+// Performs as many as possible of the 'Quick Integrity Checks' from the spec, eg SecureBasicFrame-V0.1-201601.txt
+//  1) fl >= 4 (type, seq/il, bl, trailer bytes)
+//  2) fl may be further constrained by system limits, typically to <= 63
+//  3) type (the first frame byte) is never 0x00, 0x80, 0x7f, 0xff.
+//  4) il <= 8 for initial implementations (internal node ID is 8 bytes)
+//  5) il <= fl - 4 (ID length; minimum of 4 bytes of other overhead)
+//  6) bl <= fl - 4 - il (body length; minimum of 4 bytes of other overhead)
+//  7) the final frame byte (the final trailer byte) is never 0x00 nor 0xff (if whole frame available)
+//  8) tl == 1 for non-secure, tl >= 1 for secure (tl = fl - 3 - il - bl)
+// Note: fl = hl-1 + bl + tl = 3+il + bl + tl
+//
+// (If the header is invalid or the buffer too small, 0 is returned to indicate an error.)
+// The fl byte in the structure is set to the frame length, else 0 in case of any error.
+// Returns number of bytes of decoded header including nominally-leading fl length byte; 0 in case of error.
+uint8_t SecurableFrameHeader::checkAndDecodeSmallFrameHeader(const uint8_t *const buf, uint8_t buflen)
+    {
+    // Make frame 'invalid' until everything is finished and checks out.
+    fl = 0;
+
+    uint8_t fl_;
+    const uint8_t hlifl = _checkSmallFrameHeader(buf, buflen, fl_, fType, seqIl, bl);
+    if(0 == hlifl) { return(0); } // ERROR
+
+    // Capture the ID bytes, in the storage in the instance, if any.
+    const uint8_t il_ = getIl();
+    if(il_ > 0) { memcpy(id, buf+3, il_); }
+
     // Set fl field to valid value as last action / side-effect.
     fl = fl_;
 
@@ -215,6 +234,25 @@ uint8_t SecurableFrameHeader::checkAndDecodeSmallFrameHeader(const uint8_t *cons
     return(hlifl); // SUCCESS!
     }
 
+// Validate a small frame in place, retaining a pointer to it rather than copying any of it.
+template<typename B>
+uint8_t SecurableFrameViewT<B>::checkAndDecodeSmallFrame(B *const buf_, const uint8_t buflen)
+    {
+    // Make view 'invalid' until everything is finished and checks out.
+    buf = NULL;
+    uint8_t fl_;
+    const uint8_t hlifl = _checkSmallFrameHeader(buf_, buflen, fl_, fType, seqIl, bl);
+    if(0 == hlifl) { return(0); } // ERROR
+    // Unlike the header decode alone, the whole frame including trailer must be present.
+    if(fl_ >= buflen) { return(0); } // ERROR
+    fl = fl_;
+    buf = buf_;
+    return(hlifl); // SUCCESS!
+    }
+// The views are only needed for plain and ISR-queue (volatile) RX buffers.
+template class SecurableFrameViewT<const uint8_t>;
+template class SecurableFrameViewT<const volatile uint8_t>;
+
 // Compute and return CRC for non-secure frames; 0 indicates an error.
 // This is the value that should be at getTrailerOffset() / offset fl.
 // Can be called after checkAndEncodeSmallFrameHeader() or checkAndDecodeSmallFrameHeader()
@@ -232,10 +270,29 @@ uint8_t SecurableFrameHeader::computeNonSecureFrameCRC(const uint8_t *const buf,
     // Check that buffer is at least large enough for all but the CRC byte itself.
     if(buflen < fl) { return(0); } // ERROR
     // Initialise CRC with 0x7f;
-    uint8_t crc = 0x7f;
-    const uint8_t *p = buf;
-    // Include in calc all bytes up to but not including the trailer/CRC byte.
-    for(uint8_t i = fl; i > 0; --i) { crc = OTV0P2BASE::crc7_5B_update(crc, *p++); }
+    // include in calc all bytes up to but not including the trailer/CRC byte.
+    uint8_t crc = OTV0P2BASE::crc7_5B_block(0x7f, buf, fl);
+    // Ensure 0x00 result is converted to avoid forbidden value.
+    if(0 == crc) { crc = 0x80; }
+    return(crc);
+    }
+
+// As computeNonSecureFrameCRC() but starting from the CRC state after the first prefixLen bytes.
+// For frames with a fixed leading part, eg the fl and fType bytes of FTS_ALIVE frames,
+// prefixCRC can be computed at compile time with nonSecureFrameCRCPrefix()
+// so that only the variable remainder is hashed at run time.
+// The caller must ensure that the first prefixLen bytes of buf are those folded into prefixCRC.
+// Returns 0 in case of error, including prefixLen greater than fl.
+uint8_t SecurableFrameHeader::computeNonSecureFrameCRC(const uint8_t *const buf, const uint8_t buflen,
+                                                       const uint8_t prefixCRC, const uint8_t prefixLen) const
+    {
+    // Check that struct has been computed.
+    if(isInvalid()) { return(0); } // ERROR
+    // Check that buffer is at least large enough for all but the CRC byte itself.
+    if(buflen < fl) { return(0); } // ERROR
+    // Check that the prefix is within the CRC-protected part of the frame.
+    if(prefixLen > fl) { return(0); } // ERROR
+    uint8_t crc = OTV0P2BASE::crc7_5B_block(prefixCRC, buf + prefixLen, fl - prefixLen);
     // Ensure 0x00 result is converted to avoid forbidden value.
     if(0 == crc) { crc = 0x80; }
     return(crc);
@@ -281,6 +338,49 @@ uint8_t encodeNonsecureSmallFrame(uint8_t *const buf, const uint8_t buflen,
     }
 
 
+// Check the CRC trailers of a batch of non-secure small frames, eg as received at a hub.
+// For each frame the CRC over the fl bytes starting with the leading fl byte
+// is compared with the trailer byte at offset fl, as per computeNonSecureFrameCRC().
+// Only the CRC is checked: the header should be validated separately
+// eg with SecurableFrameHeader::checkAndDecodeSmallFrameHeader().
+// On hosts works through several frames side-by-side (see OTV0P2BASE::crc7_5B_multi()).
+// Returns the number of frames that passed.
+uint8_t checkNonSecureSmallFramesCRC(const SmallFrameBufLen *const frames, const uint8_t n, bool *const passOut)
+    {
+    // Frames are handed to the CRC routine a group at a time to bound stack use.
+    static const uint8_t groupSize = 32;
+    const uint8_t *bufs[groupSize];
+    uint8_t lens[groupSize];
+    uint8_t crcs[groupSize];
+    uint8_t passed = 0;
+    for(uint16_t base = 0; base < n; base += groupSize)
+        {
+        const uint8_t g = ((n - base) > groupSize) ? groupSize : (n - base);
+        for(uint8_t j = 0; j < g; ++j)
+            {
+            const SmallFrameBufLen &f = frames[base + j];
+            // Frames too broken to hold a CRC trailer get a zero-length CRC input and are failed below.
+            const uint8_t fl = (NULL == f.buf) ? 0 : f.buf[0];
+            const bool usable = (0 != fl) && (fl <= SecurableFrameHeader::maxSmallFrameSize) && (fl < f.buflen);
+            bufs[j] = f.buf;
+            lens[j] = usable ? fl : 0;
+            }
+        // Initialise each CRC with 0x7f as computeNonSecureFrameCRC() does.
+        OTV0P2BASE::crc7_5B_multi(0x7f, bufs, lens, g, crcs);
+        for(uint8_t j = 0; j < g; ++j)
+            {
+            const uint8_t fl = lens[j];
+            // Ensure 0x00 result is converted to avoid forbidden value.
+            const uint8_t crc = (0 == crcs[j]) ? 0x80 : crcs[j];
+            const bool ok = (0 != fl) && (crc == bufs[j][fl]);
+            passOut[base + j] = ok;
+            if(ok) { ++passed; }
+            }
+        }
+    return(passed);
+    }
+
+
 // Compose (encode) entire secure small frame from header params, body and CRC trailer.
 // This is a raw/partial impl that requires the IV/nonce to be supplied.
 // This uses fixed32BTextSize12BNonce16BTagSimpleEnc_ptr_t style encryption/authentication.
@@ -396,10 +496,12 @@ uint8_t decodeSecureSmallFrameRaw(const SecurableFrameHeader *const sfh,
     const uint8_t bl = sfh->bl;
     if((0 != bl) && (ENC_BODY_SMALL_FIXED_CTEXT_SIZE != bl)) { return(0); } // ERROR
     // Attempt to authenticate and decrypt.
+    // With no body there is no cipher-text, just the header to authenticate.
     uint8_t decryptBuf[ENC_BODY_SMALL_FIXED_CTEXT_SIZE];
     if(!d(state, key, iv, buf, sfh->getHl(),
-                buf + sfh->getBodyOffset(), buf + fl - 16,
+                (0 == bl) ? NULL : buf + sfh->getBodyOffset(), buf + fl - 16,
                 decryptBuf)) { return(0); } // ERROR
+    if(0 == bl) { decodedBodyOutSize = 0; return(fl + 1); }
     // Unpad the decrypted text in place.
     const uint8_t upbl = removePaddingTo32BTrailing0sAndPadCount(decryptBuf);
     if(upbl > ENC_BODY_SMALL_FIXED_PTEXT_MAX_SIZE) { return(0); } // ERROR
@@ -248,7 +248,101 @@ namespace OTRadioLink
         //  * buf  buffer containing the entire frame except trailer/CRC; never NULL
         //  * buflen  available length in buf; if too small then this routine will fail (return 0)
         uint8_t computeNonSecureFrameCRC(const uint8_t *buf, uint8_t buflen) const;
+
+        // As computeNonSecureFrameCRC() but starting from the CRC state after the first prefixLen bytes.
+        // For frames with a fixed leading part, eg the fl and fType bytes of FTS_ALIVE frames,
+        // prefixCRC can be computed at compile time with nonSecureFrameCRCPrefix()
+        // so that only the variable remainder is hashed at run time.
+        // The caller must ensure that the first prefixLen bytes of buf are those folded into prefixCRC.
+        // Returns 0 in case of error, including prefixLen greater than fl.
+        //
+        // Parameters:
+        //  * buf  buffer containing the entire frame except trailer/CRC; never NULL
+        //  * buflen  available length in buf; if too small then this routine will fail (return 0)
+        //  * prefixCRC  CRC state after the first prefixLen bytes, starting from the usual 0x7f
+        //  * prefixLen  number of leading bytes of buf already folded into prefixCRC
+        uint8_t computeNonSecureFrameCRC(const uint8_t *buf, uint8_t buflen,
+                                         uint8_t prefixCRC, uint8_t prefixLen) const;
+
+        // Compile-time CRC state after the first len bytes of a non-secure frame, for computeNonSecureFrameCRC().
+        // Eg with a constexpr array holding the leading fl and fType bytes.
+        static constexpr uint8_t nonSecureFrameCRCPrefix(const uint8_t *const prefix, const uint8_t len)
+            { return(OTV0P2BASE::crc7_5B_block_ce(0x7f, prefix, len)); }
+        };
+
+    // Read-only run of bytes within a frame buffer, eg the ID or body of a received frame.
+    // B is the byte type, const uint8_t or (for ISR RX queue buffers) const volatile uint8_t.
+    template<typename B>
+    struct FrameSpan
+        {
+        FrameSpan(B *const data_, const uint8_t size_) : data(data_), size(size_) { }
+        // First byte; NULL only for an invalid frame.
+        B *const data;
+        // Number of bytes from data.
+        const uint8_t size;
+        bool isEmpty() const { return(0 == size); }
+        B &operator[](const uint8_t i) const { return(data[i]); }
+        };
+
+    // Zero-copy read-only view of a received small secureable frame, eg on a hub.
+    // Validates the frame in place once, with the same checks as
+    // SecurableFrameHeader::checkAndDecodeSmallFrameHeader() but without copying out the ID,
+    // then gives access to its parts as spans pointing straight into the original buffer.
+    // The buffer must remain unchanged and in place for the lifetime of the view,
+    // eg until removeRXMsg() for a frame from peekRXMsg().
+    // B is const uint8_t, or const volatile uint8_t for peekRXMsg() buffers
+    // (see SecurableFrameView and VolatileSecurableFrameView).
+    // Accessors other than isInvalid() should only be used on a valid view.
+    template<typename B>
+    class SecurableFrameViewT
+        {
+        private:
+            // Start of the frame (its leading fl byte); NULL if invalid.
+            B *buf;
+            // Header bytes captured during validation.
+            uint8_t fl, fType, seqIl, bl;
+
+        public:
+            // Create an invalid view.
+            SecurableFrameViewT() : buf(NULL), fl(0), fType(0), seqIl(0), bl(0) { }
+            // Create a view of the given buffer; check isInvalid() before use.
+            SecurableFrameViewT(B *const buf_, const uint8_t buflen) : buf(NULL), fl(0), fType(0), seqIl(0), bl(0)
+                { checkAndDecodeSmallFrame(buf_, buflen); }
+
+            // Validate the small frame starting with the fl byte at buf_ and retain a pointer to it.
+            // The entire frame including the trailer must be within buflen.
+            // Returns the header length including the leading fl byte, ie the body offset,
+            // or 0 in case of error, leaving the view invalid.
+            uint8_t checkAndDecodeSmallFrame(B *buf_, uint8_t buflen);
+
+            // True if this view is not of a valid frame.
+            bool isInvalid() const { return(NULL == buf); }
+
+            // Frame length excluding the leading fl byte, ie the offset of the last trailer byte.
+            uint8_t getFl() const { return(fl); }
+            // Frame type including the secure (0x80) bit.
+            uint8_t type() const { return(fType); }
+            bool isSecure() const { return(0 != (0x80 & fType)); }
+            // Frame sequence number mod 16 [0,15].
+            uint8_t seq() const { return((seqIl >> 4) & 0xf); }
+
+            // ID bytes (possibly none).
+            FrameSpan<B> id() const { return(FrameSpan<B>(buf + 3, seqIl & 0xf)); }
+            // Body bytes (possibly none), still encrypted for secure frames.
+            FrameSpan<B> body() const { return(FrameSpan<B>(buf + 4 + (seqIl & 0xf), bl)); }
+            // Trailer bytes; a single CRC byte for non-secure frames.
+            FrameSpan<B> trailer() const
+                {
+                const uint8_t to = 4 + (seqIl & 0xf) + bl;
+                return(FrameSpan<B>(buf + to, fl + 1 - to));
+                }
+            // The whole frame including the leading fl byte.
+            FrameSpan<B> frame() const { return(FrameSpan<B>(buf, fl + 1)); }
         };
+    // View of a plain (non-volatile) buffer.
+    typedef SecurableFrameViewT<const uint8_t> SecurableFrameView;
+    // View of a buffer still in an ISR RX queue, as returned by peekRXMsg().
+    typedef SecurableFrameViewT<const volatile uint8_t> VolatileSecurableFrameView;
 
 
         // Encode entire non-secure small frame from header params and body.
@@ -270,6 +364,30 @@ namespace OTRadioLink
                                             const uint8_t *id_, uint8_t il_,
                                             const uint8_t *body, uint8_t bl_);
 
+        // A (typically received) frame to be checked in a batch:
+        // pointer to its leading fl byte and the number of bytes available there.
+        struct SmallFrameBufLen
+            {
+            const uint8_t *buf;
+            uint8_t buflen;
+            };
+
+        // Check the CRC trailers of a batch of non-secure small frames, eg as received at a hub.
+        // For each frame the CRC over the fl bytes starting with the leading fl byte
+        // is compared with the trailer byte at offset fl, as per computeNonSecureFrameCRC().
+        // Only the CRC is checked: the header should be validated separately
+        // eg with SecurableFrameHeader::checkAndDecodeSmallFrameHeader().
+        // On hosts works through several frames side-by-side (see OTV0P2BASE::crc7_5B_multi()).
+        // Returns the number of frames that passed.
+        //
+        // Parameters:
+        //  * frames  array of n frames; never NULL if n > 0
+        //  * n  number of frames to check
+        //  * passOut  array of n results, each set true iff that frame's CRC is correct;
+        //        false for a NULL buf, an fl of 0 or above maxSmallFrameSize, or a trailer beyond buflen;
+        //        never NULL if n > 0
+        uint8_t checkNonSecureSmallFramesCRC(const SmallFrameBufLen *frames, uint8_t n, bool *passOut);
+
 //        // Round up to next 16 multiple, eg for encryption that works in fixed-size blocks for input [0,240].
 //        // Eg 0 -> 0, 1 -> 16, ... 16 -> 16, 17 -> 32 ...
 //        // Undefined for values above 240.
@@ -0,0 +1,76 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+#include "OTRadioLink_TXDutyCycle.h"
+
+#include "OTV0P2BASE_RTC.h"
+
+// Use namespaces to help avoid collisions.
+namespace OTRadioLink
+    {
+
+// Drop buckets that have left the window since the last call;
+// drops all if a whole window or more has passed, or if the clock has gone back.
+void TXDutyCycle::_roll()
+    {
+    const uint8_t now = (uint8_t)(OTV0P2BASE::getMinutesSinceMidnightLT() / BUCKET_MINUTES);
+    const uint16_t today = OTV0P2BASE::getDaysSince1999LT();
+    if(0xff == lastBucket) { lastBucket = now; lastDay = today; return; }
+    if((now == lastBucket) && (today == lastDay)) { return; }
+    // Buckets started since the last call, however long ago; negative if the clock has been set back.
+    const int32_t steps = ((int32_t)today - (int32_t)lastDay) * BUCKETS_PER_DAY + (int32_t)now - (int32_t)lastBucket;
+    if((steps < 0) || (steps >= BUCKETS)) { clear(); }
+    else
+        {
+        for(uint8_t s = 1; s <= steps; ++s)
+            {
+            const uint8_t b = (uint8_t)((lastBucket + s) % BUCKETS);
+            for(uint8_t c = 0; c < nChannels; ++c) { airtime[c * BUCKETS + b] = 0; }
+            }
+        }
+    lastBucket = now;
+    lastDay = today;
+    }
+
+// Airtime used on the channel over the window, in ms; 0 if not tracked.
+uint32_t TXDutyCycle::getAirtimeMs(const int8_t channel)
+    {
+    if((channel < 0) || (channel >= nChannels)) { return(0); }
+    _roll();
+    const uint16_t *const a = airtime + channel * BUCKETS;
+    uint32_t total = 0;
+    for(uint8_t b = 0; b < BUCKETS; ++b) { total += a[b]; }
+    return(total);
+    }
+
+// Account for a TX of the given airtime (ms) on the channel.
+void TXDutyCycle::record(const int8_t channel, const uint16_t ms)
+    {
+    if((channel < 0) || (channel >= nChannels)) { return; }
+    _roll();
+    uint16_t &a = airtime[channel * BUCKETS + lastBucket % BUCKETS];
+    a = (ms > (uint16_t)(0xffff - a)) ? 0xffff : (a + ms);
+    }
+
+// Forget all airtime used.
+void TXDutyCycle::clear()
+    {
+    for(uint16_t i = 0; i < (uint16_t)nChannels * BUCKETS; ++i) { airtime[i] = 0; }
+    }
+
+    }
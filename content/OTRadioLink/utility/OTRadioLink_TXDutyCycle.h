@@ -0,0 +1,110 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+/*
+ * TX airtime accounting against a duty-cycle limit, per channel.
+ *
+ * Much of the 868MHz band is limited to (eg) 1% duty cycle, ie 36s of TX in any hour.
+ * TXDutyCycle keeps the airtime used on each channel over a rolling window of about an hour,
+ * in 10-minute buckets driven by the local-time RTC,
+ * so that a radio can refuse to transmit when a frame would exceed the budget.
+ *
+ * Keywords: C++ embedded Arduino radio TX duty cycle airtime regulatory
+ */
+
+#ifndef ARDUINO_LIB_OTRADIOLINK_TXDUTYCYCLE_H
+#define ARDUINO_LIB_OTRADIOLINK_TXDUTYCYCLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Use namespaces to help avoid collisions.
+namespace OTRadioLink
+    {
+    // Base class for per-channel TX airtime accounting over a rolling window.
+    // The window is BUCKETS buckets of BUCKET_MINUTES minutes each,
+    // the oldest being dropped as each new bucket starts,
+    // so the window covers between 50 and 60 minutes.
+    // Channels out of range are not tracked and are always allowed.
+    // Not ISR-safe: call from the (single) thread that transmits.
+    class TXDutyCycle
+        {
+        public:
+            // Number of buckets and minutes per bucket.
+            // BUCKETS divides the buckets per day exactly, so the window rolls over midnight.
+            static const uint8_t BUCKETS = 6;
+            static const uint8_t BUCKET_MINUTES = 10;
+            static const uint8_t BUCKETS_PER_DAY = (24 * 60) / BUCKET_MINUTES;
+
+        protected:
+            // Airtime per channel per bucket, in ms; saturates at 0xffff.
+            uint16_t *const airtime;
+            // Number of channels tracked.
+            const uint8_t nChannels;
+            // Airtime allowed per window, in ms.
+            const uint32_t budgetMs;
+            // Bucket of the day [0,BUCKETS_PER_DAY-1] last accounted for; 0xff before first use.
+            uint8_t lastBucket;
+            // Day (from the RTC) of lastBucket.
+            uint16_t lastDay;
+
+            TXDutyCycle(uint16_t *airtimep, uint8_t channels, uint8_t dutyPerMille)
+              : airtime(airtimep), nChannels(channels), budgetMs((uint32_t)dutyPerMille * 3600U), lastBucket(0xff), lastDay(0)
+                { clear(); }
+
+            // Drop buckets that have left the window since the last call;
+            // drops all if a whole window or more has passed, or if the clock has gone back.
+            void _roll();
+
+        public:
+            // Airtime allowed per window, in ms.
+            uint32_t getBudgetMs() const { return(budgetMs); }
+
+            // Airtime used on the channel over the window, in ms; 0 if not tracked.
+            uint32_t getAirtimeMs(int8_t channel);
+
+            // True if a TX of the given airtime (ms) on the channel would be within budget.
+            bool allows(const int8_t channel, const uint16_t ms)
+                { return((channel < 0) || (channel >= nChannels) || (getAirtimeMs(channel) + ms <= budgetMs)); }
+
+            // Account for a TX of the given airtime (ms) on the channel.
+            void record(int8_t channel, uint16_t ms);
+
+            // Forget all airtime used.
+            void clear();
+
+            // Airtime in ms, rounded up, of the given number of bits at the given bitrate (bps); 0 if bps is 0.
+            static uint16_t airtimeMs(const uint16_t bits, const uint32_t bps)
+                { return((0 == bps) ? 0 : (uint16_t)(((uint32_t)bits * 1000U + bps - 1) / bps)); }
+        };
+
+    // Airtime accounting for the given number of channels (typically the radio's nChannels)
+    // against a limit of dutyPerMille in 1000, eg 10 for 1%.
+    // Uses 12 bytes per channel.
+    template<uint8_t channels = 1>
+    class TXDutyCycleFixed : public TXDutyCycle
+        {
+        private:
+            uint16_t buf[channels * BUCKETS];
+        public:
+            explicit TXDutyCycleFixed(const uint8_t dutyPerMille = 10) : TXDutyCycle(buf, channels, dutyPerMille) { }
+        };
+
+    }
+
+#endif
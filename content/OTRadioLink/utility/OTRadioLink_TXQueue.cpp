@@ -0,0 +1,61 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+#include "OTRadioLink_TXQueue.h"
+
+#include <string.h>
+
+#include <util/atomic.h>
+
+// Use namespaces to help avoid collisions.
+namespace OTRadioLink
+    {
+
+// Copy a frame to the end of the queue, with its channel, power and optional completion callback.
+// Returns false if buf is NULL, buflen is 0 or more than getMaxMsgLen(), or the queue is full.
+bool TXQueue::enqueue(const uint8_t *const buf, const uint8_t buflen, const int8_t channel, const uint8_t power,
+                      TXCompletion_t *const callback, void *const context)
+    {
+    if((NULL == buf) || (0 == buflen) || (buflen > mf)) { return(false); } // ERROR
+    if(isFull()) { return(false); }
+    uint8_t s = oldest + queued;
+    if(s >= cap) { s -= cap; }
+    memcpy(b + (uint16_t)s * mf, buf, buflen);
+    lens[s] = buflen;
+    channels[s] = channel;
+    powers[s] = power;
+    callbacks[s] = callback;
+    contexts[s] = context;
+    // Publish the frame only once it is complete.
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { ++queued; }
+    return(true);
+    }
+
+// Remove the oldest queued frame, returning its completion callback (possibly NULL) and context.
+// Returns NULL and does nothing if the queue is empty.
+TXCompletion_t *TXQueue::remove(void *&context)
+    {
+    if(isEmpty()) { return(NULL); }
+    TXCompletion_t *const callback = callbacks[oldest];
+    context = contexts[oldest];
+    if(++oldest >= cap) { oldest = 0; }
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { --queued; }
+    return(callback);
+    }
+
+    }
@@ -0,0 +1,129 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+/*
+ * Bounded queue of frames waiting to be transmitted by an OTRadioLink.
+ *
+ * Frames are copied in (with their channel, power and an optional completion callback)
+ * by OTRadioLink::queueToSendAsync() and sent one after another by the radio's poll(),
+ * so that the caller need not block for each transmission.
+ * A full queue refuses new frames, which the caller sees as back-pressure.
+ *
+ * Keywords: C++ embedded Arduino radio TX transmit queue asynchronous callback
+ */
+
+#ifndef ARDUINO_LIB_OTRADIOLINK_TXQUEUE_H
+#define ARDUINO_LIB_OTRADIOLINK_TXQUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Use namespaces to help avoid collisions.
+namespace OTRadioLink
+    {
+    // Called once a queued frame has been sent (sent is true) or has failed or been abandoned (sent is false).
+    // Called from the radio's poll() (not from an ISR), so may queue further frames.
+    typedef void TXCompletion_t(void *context, bool sent);
+
+    // Base class for a queue of frames to transmit, with a fixed number of max-size slots.
+    // Frames are queued and dequeued from the main (non-ISR) thread,
+    // though the count may be read from anywhere.
+    // Does minimal checking; all arguments must be sane.
+    class TXQueue
+        {
+        protected:
+            // Frame slots, each mf bytes; cap of them.
+            uint8_t *const b;
+            // Maximum frame size.
+            const uint8_t mf;
+            // Maximum number of frames queued.
+            const uint8_t cap;
+            // Per-slot frame length, channel and power (an OTRadioLink::TXpower).
+            uint8_t *const lens;
+            int8_t *const channels;
+            uint8_t *const powers;
+            // Per-slot completion callback (may be NULL) and its context.
+            TXCompletion_t **const callbacks;
+            void **const contexts;
+            // Slot of oldest queued frame.
+            uint8_t oldest;
+            // Number of frames queued.
+            // Marked volatile for ISR-/thread- safe reads without a lock.
+            volatile uint8_t queued;
+
+            TXQueue(uint8_t maxFrame, uint8_t capacity, uint8_t *bp, uint8_t *lensp, int8_t *channelsp, uint8_t *powersp,
+                    TXCompletion_t **callbacksp, void **contextsp)
+              : b(bp), mf(maxFrame), cap(capacity), lens(lensp), channels(channelsp), powers(powersp),
+                callbacks(callbacksp), contexts(contextsp), oldest(0), queued(0)
+                { }
+
+        public:
+            // Maximum number of frames that can be queued, and maximum frame length.
+            uint8_t getCapacity() const { return(cap); }
+            uint8_t getMaxMsgLen() const { return(mf); }
+            // Number of frames queued, including any being sent.
+            // ISR-/thread- safe.
+            uint8_t getMsgsQueued() const { return(queued); }
+            bool isEmpty() const { return(0 == queued); }
+            bool isFull() const { return(queued >= cap); }
+
+            // Copy a frame to the end of the queue, with its channel, power and optional completion callback.
+            // Returns false if buf is NULL, buflen is 0 or more than getMaxMsgLen(), or the queue is full.
+            bool enqueue(const uint8_t *buf, uint8_t buflen, int8_t channel, uint8_t power,
+                         TXCompletion_t *callback, void *context);
+
+            // Peek at the oldest queued frame; NULL if none.
+            // Valid until remove().
+            const uint8_t *peek(uint8_t &buflen, int8_t &channel, uint8_t &power) const
+                {
+                if(isEmpty()) { return(NULL); }
+                buflen = lens[oldest];
+                channel = channels[oldest];
+                power = powers[oldest];
+                return(b + (uint16_t)oldest * mf);
+                }
+
+            // Remove the oldest queued frame, returning its completion callback (possibly NULL) and context.
+            // Returns NULL and does nothing if the queue is empty.
+            TXCompletion_t *remove(void *&context);
+        };
+
+    // Queue of up to queueCapacity frames each of up to maxTXBytes bytes.
+    // Uses about queueCapacity * (maxTXBytes + 3 + 2 pointers) bytes.
+    //   * maxTXBytes  maximum frame length in the range [1,255], eg 64 for an RFM23B
+    //   * queueCapacity  number of frames queueable [1,255], usually [2,4]
+    template<uint8_t maxTXBytes, uint8_t queueCapacity = 2>
+    class TXQueueFixed : public TXQueue
+        {
+        private:
+            uint8_t buf[queueCapacity * (uint16_t)maxTXBytes];
+            uint8_t lensBuf[queueCapacity];
+            int8_t channelsBuf[queueCapacity];
+            uint8_t powersBuf[queueCapacity];
+            TXCompletion_t *callbacksBuf[queueCapacity];
+            void *contextsBuf[queueCapacity];
+
+        public:
+            TXQueueFixed()
+              : TXQueue(maxTXBytes, queueCapacity, buf, lensBuf, channelsBuf, powersBuf, callbacksBuf, contextsBuf)
+                { }
+        };
+
+    }
+
+#endif
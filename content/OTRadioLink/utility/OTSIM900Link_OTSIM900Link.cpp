@@ -844,6 +844,7 @@ bool OTSIM900Link::handleInterruptSimple()
 //        }
 //    }
 //    return true;
+    return false; // Nothing handled yet.
 }
 
 //const char OTSIM900Link::AT_[] = "";
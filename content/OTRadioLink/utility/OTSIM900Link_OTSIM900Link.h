@@ -133,6 +133,8 @@ public:
   // set max frame bytes
     //void setMaxTypicalFrameBytes(uint8_t maxTypicalFrameBytes);
     void poll();
+    // poll() runs its own single-frame send state machine rather than the OTRadioLink TX queue.
+    bool supportsTXQueue() const { return(false); }
 
     /**
      * @brief    This will be called in interrupt while waiting for send prompt
@@ -299,4 +301,4 @@ virtual void panicShutdown() { preinit(NULL); }    // see above
 
 }    // namespace OTSIM900Link
 
-#endif /* OTSIM900LINK_H_ */
+#endif /* OTSIM900LINK_H_ */
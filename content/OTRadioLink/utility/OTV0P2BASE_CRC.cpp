@@ -16,7 +16,27 @@ under the Licence.
 Author(s) / Copyright (s): Damon Hart-Davis 2015--2016
 */
 
+#include <string.h>
+#include <avr/pgmspace.h>
+
 #include "OTV0P2BASE_CRC.h"
+#include "OTV0P2BASE_CycleProfile.h"
+
+// Pick the table used by crc7_5B_block() unless forced by the build.
+// The 16-byte table saves ~240 bytes of Flash where that matters.
+#if !defined(OTV0P2BASE_CRC7_5B_USE_T256) && !defined(OTV0P2BASE_CRC7_5B_USE_T16)
+#if defined(__AVR__)
+#define OTV0P2BASE_CRC7_5B_USE_T16
+#else
+#define OTV0P2BASE_CRC7_5B_USE_T256
+#endif
+#endif
+
+// On hosts (eg a hub) crc7_5B_multi() runs this many buffers' CRCs side-by-side with the 256-entry table,
+// so that the table lookups of independent buffers overlap rather than each waiting on the one before.
+#if !defined(__AVR__) && defined(OTV0P2BASE_CRC7_5B_USE_T256)
+#define OTV0P2BASE_CRC7_5B_MULTI_INTERLEAVE 4
+#endif
 
 
 // Use namespaces to help avoid collisions.
@@ -37,8 +57,9 @@ namespace OTV0P2BASE
      * <p>
      * For 2 or 3 byte payloads this should have a Hamming distance of 4 and be within a factor of 2 of optimal error detection.
      * <p>
-     * TODO: provide table-driven optimised alternative,
-     *     eg see http://www.tty1.net/pycrc/index_en.html
+     * This bit-at-a-time version is the reference implementation;
+     * see crc7_5B_update_t256(), crc7_5B_update_t16() and crc7_5B_block()
+     * for table-driven alternatives, eg see http://www.tty1.net/pycrc/index_en.html
      */
     uint8_t crc7_5B_update(uint8_t crc, const uint8_t datum)
         {
@@ -65,6 +86,142 @@ namespace OTV0P2BASE
         }
 
 
+    // The table-driven routines hold the 7-bit CRC left-aligned in an 8-bit register
+    // (ie crc << 1) so that the polynomial becomes 0x6e (0x37 << 1)
+    // and a whole byte (or nibble) of input can be folded in with one lookup.
+    // Entry i is the register after clocking 8 zero bits through a register holding i.
+
+    // 256-entry byte-at-a-time table.
+    static const uint8_t crc7_5B_t256[256] PROGMEM =
+        {
+        0x00, 0x6e, 0xdc, 0xb2, 0xd6, 0xb8, 0x0a, 0x64,
+        0xc2, 0xac, 0x1e, 0x70, 0x14, 0x7a, 0xc8, 0xa6,
+        0xea, 0x84, 0x36, 0x58, 0x3c, 0x52, 0xe0, 0x8e,
+        0x28, 0x46, 0xf4, 0x9a, 0xfe, 0x90, 0x22, 0x4c,
+        0xba, 0xd4, 0x66, 0x08, 0x6c, 0x02, 0xb0, 0xde,
+        0x78, 0x16, 0xa4, 0xca, 0xae, 0xc0, 0x72, 0x1c,
+        0x50, 0x3e, 0x8c, 0xe2, 0x86, 0xe8, 0x5a, 0x34,
+        0x92, 0xfc, 0x4e, 0x20, 0x44, 0x2a, 0x98, 0xf6,
+        0x1a, 0x74, 0xc6, 0xa8, 0xcc, 0xa2, 0x10, 0x7e,
+        0xd8, 0xb6, 0x04, 0x6a, 0x0e, 0x60, 0xd2, 0xbc,
+        0xf0, 0x9e, 0x2c, 0x42, 0x26, 0x48, 0xfa, 0x94,
+        0x32, 0x5c, 0xee, 0x80, 0xe4, 0x8a, 0x38, 0x56,
+        0xa0, 0xce, 0x7c, 0x12, 0x76, 0x18, 0xaa, 0xc4,
+        0x62, 0x0c, 0xbe, 0xd0, 0xb4, 0xda, 0x68, 0x06,
+        0x4a, 0x24, 0x96, 0xf8, 0x9c, 0xf2, 0x40, 0x2e,
+        0x88, 0xe6, 0x54, 0x3a, 0x5e, 0x30, 0x82, 0xec,
+        0x34, 0x5a, 0xe8, 0x86, 0xe2, 0x8c, 0x3e, 0x50,
+        0xf6, 0x98, 0x2a, 0x44, 0x20, 0x4e, 0xfc, 0x92,
+        0xde, 0xb0, 0x02, 0x6c, 0x08, 0x66, 0xd4, 0xba,
+        0x1c, 0x72, 0xc0, 0xae, 0xca, 0xa4, 0x16, 0x78,
+        0x8e, 0xe0, 0x52, 0x3c, 0x58, 0x36, 0x84, 0xea,
+        0x4c, 0x22, 0x90, 0xfe, 0x9a, 0xf4, 0x46, 0x28,
+        0x64, 0x0a, 0xb8, 0xd6, 0xb2, 0xdc, 0x6e, 0x00,
+        0xa6, 0xc8, 0x7a, 0x14, 0x70, 0x1e, 0xac, 0xc2,
+        0x2e, 0x40, 0xf2, 0x9c, 0xf8, 0x96, 0x24, 0x4a,
+        0xec, 0x82, 0x30, 0x5e, 0x3a, 0x54, 0xe6, 0x88,
+        0xc4, 0xaa, 0x18, 0x76, 0x12, 0x7c, 0xce, 0xa0,
+        0x06, 0x68, 0xda, 0xb4, 0xd0, 0xbe, 0x0c, 0x62,
+        0x94, 0xfa, 0x48, 0x26, 0x42, 0x2c, 0x9e, 0xf0,
+        0x56, 0x38, 0x8a, 0xe4, 0x80, 0xee, 0x5c, 0x32,
+        0x7e, 0x10, 0xa2, 0xcc, 0xa8, 0xc6, 0x74, 0x1a,
+        0xbc, 0xd2, 0x60, 0x0e, 0x6a, 0x04, 0xb6, 0xd8,
+        };
+
+    // 16-entry nibble-at-a-time table.
+    // (Happens to be the first 16 entries of the 256-entry table,
+    // but is kept separate so as not to drag the big table into small builds.)
+    static const uint8_t crc7_5B_t16[16] PROGMEM =
+        {
+        0x00, 0x6e, 0xdc, 0xb2, 0xd6, 0xb8, 0x0a, 0x64,
+        0xc2, 0xac, 0x1e, 0x70, 0x14, 0x7a, 0xc8, 0xa6,
+        };
+
+    // Fold one byte into the left-aligned register with the 256-entry table.
+    static inline uint8_t _crc7_5B_reg_t256(const uint8_t reg, const uint8_t datum)
+        { return(pgm_read_byte(&crc7_5B_t256[(uint8_t)(reg ^ datum)])); }
+
+    // Fold one byte into the left-aligned register with the 16-entry table, high nibble first.
+    static inline uint8_t _crc7_5B_reg_t16(uint8_t reg, const uint8_t datum)
+        {
+        reg = (uint8_t)(reg << 4) ^ pgm_read_byte(&crc7_5B_t16[(uint8_t)(reg ^ datum) >> 4]);
+        reg = (uint8_t)(reg << 4) ^ pgm_read_byte(&crc7_5B_t16[(uint8_t)(reg ^ (datum << 4)) >> 4]);
+        return(reg);
+        }
+
+    /**Table-driven equivalent of crc7_5B_update(), one lookup per byte.
+     * Uses a 256-byte table (in PROGMEM/Flash on AVR).
+     * Result is bit-for-bit identical to crc7_5B_update().
+     */
+    uint8_t crc7_5B_update_t256(const uint8_t crc, const uint8_t datum)
+        { return(_crc7_5B_reg_t256((uint8_t)(crc << 1), datum) >> 1); }
+
+    /**Table-driven equivalent of crc7_5B_update(), two lookups per byte.
+     * Uses a 16-byte table (in PROGMEM/Flash on AVR), so suits flash-constrained builds.
+     * Result is bit-for-bit identical to crc7_5B_update().
+     */
+    uint8_t crc7_5B_update_t16(const uint8_t crc, const uint8_t datum)
+        { return(_crc7_5B_reg_t16((uint8_t)(crc << 1), datum) >> 1); }
+
+    /**Update 7-bit CRC with len bytes from buf; result always has top bit zero.
+     * Equivalent to calling crc7_5B_update() on each byte in turn,
+     * but avoids a call and realignment of the CRC state per byte.
+     * Returns crc unchanged if len is zero; buf must not be NULL if len is non-zero.
+     */
+    uint8_t crc7_5B_block(const uint8_t crc, const uint8_t *buf, uint8_t len)
+        {
+        OTV0P2BASE_CYCLE_PROFILE_SCOPE(CPP_CRC);
+        // Hold the CRC left-aligned for the whole block.
+        uint8_t reg = (uint8_t)(crc << 1);
+        while(len-- > 0)
+            {
+#if defined(OTV0P2BASE_CRC7_5B_USE_T256)
+            reg = _crc7_5B_reg_t256(reg, *buf++);
+#else
+            reg = _crc7_5B_reg_t16(reg, *buf++);
+#endif
+            }
+        return(reg >> 1);
+        }
+
+    /**Compute the 7-bit CRCs of n separate buffers, each starting from the same initial crc.
+     * Each result is as crc7_5B_block(crc, bufs[i], lens[i]) and is written to crcsOut[i].
+     * On hosts several buffers are worked through side-by-side so that their table lookups overlap,
+     * which suits checking large batches of short frames, eg at a hub;
+     * elsewhere this simply calls crc7_5B_block() for each buffer in turn.
+     * None of the arrays may be NULL if n is non-zero;
+     * bufs[i] must not be NULL if lens[i] is non-zero.
+     */
+    void crc7_5B_multi(const uint8_t crc,
+                       const uint8_t *const bufs[], const uint8_t lens[], const uint8_t n,
+                       uint8_t crcsOut[])
+        {
+        uint8_t j = 0;
+#if defined(OTV0P2BASE_CRC7_5B_MULTI_INTERLEAVE)
+        static const uint8_t w = OTV0P2BASE_CRC7_5B_MULTI_INTERLEAVE;
+        for( ; (uint8_t)(n - j) >= w; j += w)
+            {
+            // Run all the buffers' left-aligned registers over their common length, then each over its own tail.
+            uint8_t reg[w];
+            uint8_t common = 0xff;
+            for(uint8_t k = 0; k < w; ++k)
+                {
+                reg[k] = (uint8_t)(crc << 1);
+                if(lens[j + k] < common) { common = lens[j + k]; }
+                }
+            for(uint8_t i = 0; i < common; ++i)
+                { for(uint8_t k = 0; k < w; ++k) { reg[k] = _crc7_5B_reg_t256(reg[k], bufs[j + k][i]); } }
+            for(uint8_t k = 0; k < w; ++k)
+                {
+                for(uint8_t i = common; i < lens[j + k]; ++i) { reg[k] = _crc7_5B_reg_t256(reg[k], bufs[j + k][i]); }
+                crcsOut[j + k] = reg[k] >> 1;
+                }
+            }
+#endif
+        for( ; j < n; ++j) { crcsOut[j] = crc7_5B_block(crc, bufs[j], lens[j]); }
+        }
+
+
 //// Update 'C2' 8-bit CRC with next byte.
 //// Usually initialised with 0xff.
 //// Should work well from 10--119 bits (2--~14 bytes); best 27-50, 52, 56-119 bits.
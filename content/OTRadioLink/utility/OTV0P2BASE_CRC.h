@@ -56,6 +56,68 @@ namespace OTV0P2BASE
      */
     extern uint8_t crc7_5B_update_nz_final(uint8_t crc, uint8_t datum);
 
+    /**Table-driven equivalent of crc7_5B_update(), one lookup per byte.
+     * Uses a 256-byte table (in PROGMEM/Flash on AVR).
+     * Result is bit-for-bit identical to crc7_5B_update().
+     */
+    extern uint8_t crc7_5B_update_t256(uint8_t crc, uint8_t datum);
+
+    /**Table-driven equivalent of crc7_5B_update(), two lookups per byte.
+     * Uses a 16-byte table (in PROGMEM/Flash on AVR), so suits flash-constrained builds.
+     * Result is bit-for-bit identical to crc7_5B_update().
+     */
+    extern uint8_t crc7_5B_update_t16(uint8_t crc, uint8_t datum);
+
+    /**Update 7-bit CRC with len bytes from buf; result always has top bit zero.
+     * Equivalent to calling crc7_5B_update() on each byte in turn,
+     * but avoids a call and realignment of the CRC state per byte.
+     * Uses the 16-byte table on AVR by default, else the 256-byte table;
+     * define OTV0P2BASE_CRC7_5B_USE_T256 or OTV0P2BASE_CRC7_5B_USE_T16 to force the choice.
+     * Returns crc unchanged if len is zero; buf must not be NULL if len is non-zero.
+     */
+    extern uint8_t crc7_5B_block(uint8_t crc, const uint8_t *buf, uint8_t len);
+
+    /**Compute the 7-bit CRCs of n separate buffers, each starting from the same initial crc.
+     * Each result is as crc7_5B_block(crc, bufs[i], lens[i]) and is written to crcsOut[i].
+     * On hosts several buffers are worked through side-by-side so that their table lookups overlap,
+     * which suits checking large batches of short frames, eg at a hub;
+     * elsewhere this simply calls crc7_5B_block() for each buffer in turn.
+     * None of the arrays may be NULL if n is non-zero;
+     * bufs[i] must not be NULL if lens[i] is non-zero.
+     */
+    extern void crc7_5B_multi(uint8_t crc,
+                              const uint8_t *const bufs[], const uint8_t lens[], uint8_t n,
+                              uint8_t crcsOut[]);
+
+    // Compile-time (constexpr) equivalents.
+    // These let the CRC state after a fixed frame or message prefix be folded in at compile time,
+    // so that at run time only the variable tail need be hashed, eg with crc7_5B_block().
+    // Bit-for-bit identical to the run-time routines, but slow if not evaluated at compile time.
+    // Written as single-expression recursive functions to remain valid C++11 constexpr.
+
+    // Apply the top n bits of datum (msb first) to the 7-bit crc; internal helper.
+    constexpr uint8_t _crc7_5B_update_ce_bits(const uint8_t crc, const uint8_t datum, const uint8_t n)
+        {
+        return((0 == n) ? crc :
+            _crc7_5B_update_ce_bits(
+                (uint8_t)(((crc << 1) ^ ((0 != (((crc >> 6) ^ (datum >> 7)) & 1)) ? 0x37 : 0)) & 0x7f),
+                (uint8_t)(datum << 1), (uint8_t)(n - 1)));
+        }
+
+    /**Compile-time equivalent of crc7_5B_update(). */
+    constexpr uint8_t crc7_5B_update_ce(const uint8_t crc, const uint8_t datum)
+        { return(_crc7_5B_update_ce_bits(crc, datum, 8)); }
+
+    /**Compile-time equivalent of crc7_5B_block(), eg over a constexpr array. */
+    constexpr uint8_t crc7_5B_block_ce(const uint8_t crc, const uint8_t *const buf, const uint8_t len)
+        { return((0 == len) ? crc : crc7_5B_block_ce(crc7_5B_update_ce(crc, buf[0]), buf + 1, (uint8_t)(len - 1))); }
+
+    /**Compile-time CRC over the chars of a null-terminated string (not including the terminator).
+     * Eg crc7_5B_str_ce('{', "\"@\":\"") gives the state after a JSON "@" lead-in.
+     */
+    constexpr uint8_t crc7_5B_str_ce(const uint8_t crc, const char *const s)
+        { return(('\0' == s[0]) ? crc : crc7_5B_str_ce(crc7_5B_update_ce(crc, (uint8_t)s[0]), s + 1)); }
+
 
     }
 
@@ -0,0 +1,116 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+/*
+ CPU cycle cost profiling of hot routines against the sub-cycle time budget.
+ */
+
+#include <Arduino.h>
+#include <util/atomic.h>
+
+#include "OTV0P2BASE_CycleProfile.h"
+
+namespace OTV0P2BASE
+{
+
+// Default counter: micros() scaled to CPU cycles; TIMER0 resolution on the AVR.
+static uint32_t defaultCycleCounter() { return((uint32_t)micros() * (F_CPU / 1000000UL)); }
+
+static CycleProfile::cycleCounter_t *volatile cycleCounter = defaultCycleCounter;
+
+// Worst-case cycles and call counts by routine.
+static volatile uint32_t worstCycles[CPP_COUNT];
+static volatile uint16_t calls[CPP_COUNT];
+
+void CycleProfile::setCycleCounter(cycleCounter_t *const counter)
+  { cycleCounter = (NULL == counter) ? defaultCycleCounter : counter; }
+
+uint32_t CycleProfile::cycles() { return(cycleCounter()); }
+
+void CycleProfile::record(const CycleProfilePoint point, const uint32_t c)
+  {
+  if(point >= CPP_COUNT) { return; } // ERROR
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+    if(c > worstCycles[point]) { worstCycles[point] = c; }
+    if(calls[point] != 0xffff) { ++calls[point]; }
+    }
+  }
+
+uint32_t CycleProfile::getWorstCycles(const CycleProfilePoint point)
+  {
+  if(point >= CPP_COUNT) { return(0); } // ERROR
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { return(worstCycles[point]); }
+  return(0); // Not reached.
+  }
+
+uint16_t CycleProfile::getCalls(const CycleProfilePoint point)
+  {
+  if(point >= CPP_COUNT) { return(0); } // ERROR
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { return(calls[point]); }
+  return(0); // Not reached.
+  }
+
+void CycleProfile::reset()
+  {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+    for(uint8_t i = 0; i < CPP_COUNT; ++i) { worstCycles[i] = 0; calls[i] = 0; }
+    }
+  }
+
+uint8_t CycleProfile::cyclesToSubCycleTicks(const uint32_t c)
+  {
+  const uint32_t ticks = (c / CYCLES_PER_SUB_CYCLE_TICK) + ((0 != (c % CYCLES_PER_SUB_CYCLE_TICK)) ? 1 : 0);
+  return((ticks > 255) ? 255 : (uint8_t)ticks);
+  }
+
+const __FlashStringHelper *CycleProfile::getName(const CycleProfilePoint point)
+  {
+  switch(point)
+    {
+    case CPP_RFM23B_TXFIFO: return(F("RFM23B _TXFIFO start"));
+    case CPP_RFM23B_RXFIFO: return(F("RFM23B _RXFIFO"));
+    case CPP_FHT8V_ENCODE: return(F("FHT8V encode"));
+    case CPP_CRC: return(F("CRC7/5B block"));
+    case CPP_JSON_WRITE: return(F("JSON write"));
+    case CPP_MRVS_TICK: return(F("MRVS tick"));
+    default: return(F("?"));
+    }
+  }
+
+void CycleProfile::printWorstCaseTable(Print &p)
+  {
+  p.print(F("routine,calls,worst cycles,worst sub-cycle ticks (of "));
+  p.print(1 + (uint16_t)GSCT_MAX);
+  p.println(F(")"));
+  for(uint8_t i = 0; i < CPP_COUNT; ++i)
+    {
+    const CycleProfilePoint point = (CycleProfilePoint)i;
+    const uint32_t worst = getWorstCycles(point);
+    p.print(getName(point));
+    p.print(',');
+    p.print(getCalls(point));
+    p.print(',');
+    p.print(worst);
+    p.print(',');
+    p.println(cyclesToSubCycleTicks(worst));
+    }
+  }
+
+}
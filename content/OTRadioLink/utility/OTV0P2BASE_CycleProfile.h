@@ -0,0 +1,120 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+/*
+ CPU cycle cost profiling of hot routines against the sub-cycle time budget.
+
+ All V0p2 work has to fit in the 2s major cycle of GSCT_MAX+1 sub-cycle ticks (see OTV0P2BASE_Sleep.h),
+ and some code (eg ValveMotorDirectV1) computes how much of that it may use by hand.
+ When the library is built with OTV0P2BASE_CYCLE_PROFILE defined,
+ selected routines record their worst-case cost in CPU cycles,
+ which can then be printed as a table in sub-cycle ticks, eg to check such budgets.
+ Without OTV0P2BASE_CYCLE_PROFILE the instrumentation compiles away to nothing.
+
+ By default cycles are derived from micros(),
+ ie with TIMER0 resolution (64 cycles at 1MHz) on the AVR.
+ Run on a board, or under an AVR simulator such as simavr (whose timers are cycle-accurate),
+ this gives real AVR costs.
+ Elsewhere, eg on the host build, the figures are only indicative of host speed
+ unless a cycle counter from an instruction-count model is supplied with setCycleCounter().
+ */
+
+#ifndef OTV0P2BASE_CYCLEPROFILE_H
+#define OTV0P2BASE_CYCLEPROFILE_H
+
+#include <stdint.h>
+#include <Print.h>
+
+#include "OTV0P2BASE_Sleep.h"
+
+namespace OTV0P2BASE
+{
+
+// Instrumented routines.
+enum CycleProfilePoint
+  {
+  CPP_RFM23B_TXFIFO,  // OTRFM23BLinkBase::_TXFIFO() up to starting TX, not the wait for completion
+  CPP_RFM23B_RXFIFO,  // OTRFM23BLinkBase::_RXFIFO()
+  CPP_FHT8V_ENCODE,   // FHT8VRadValveBase::FHT8VCreate200usBitStreamBptr()
+  CPP_CRC,            // crc7_5B_block()
+  CPP_JSON_WRITE,     // SimpleStatsRotationBase::writeJSON()
+  CPP_MRVS_TICK,      // ModelledRadValveState::tick()
+  CPP_COUNT           // Number of instrumented routines; not itself a routine.
+  };
+
+// Nominal CPU cycles per sub-cycle tick (getSubCycleTime()), rounded down, eg 7812 at 1MHz.
+static const uint32_t CYCLES_PER_SUB_CYCLE_TICK = ((F_CPU / 1000UL) * BASIC_CYCLE_MS) / (1 + (uint16_t)GSCT_MAX);
+
+// Worst-case cycle cost recorder for the instrumented routines.
+// Usable (eg with explicit record() calls) whether or not OTV0P2BASE_CYCLE_PROFILE is defined.
+// ISR-safe.
+class CycleProfile
+  {
+  public:
+    // Free-running CPU cycle counter, wrapping at 2^32.
+    typedef uint32_t cycleCounter_t();
+
+    // Set the cycle counter to use, eg from a simulator's instruction-count model; NULL restores the default.
+    static void setCycleCounter(cycleCounter_t *counter);
+
+    // Get the current cycle count.
+    static uint32_t cycles();
+
+    // Record one call of the given routine taking the given number of cycles.
+    static void record(CycleProfilePoint point, uint32_t cycles);
+
+    // Get the worst (largest) cost recorded in cycles for the given routine, or 0 if none.
+    static uint32_t getWorstCycles(CycleProfilePoint point);
+
+    // Get the number of calls recorded for the given routine; saturates at 0xffff.
+    static uint16_t getCalls(CycleProfilePoint point);
+
+    // Clear all records.
+    static void reset();
+
+    // Convert cycles to sub-cycle ticks, rounding up to be safe for budgeting; saturates at 255.
+    static uint8_t cyclesToSubCycleTicks(uint32_t cycles);
+
+    // Short printable name of the given routine.
+    static const __FlashStringHelper *getName(CycleProfilePoint point);
+
+    // Print a table of calls, worst-case cycles and worst-case sub-cycle ticks, one routine per line.
+    static void printWorstCaseTable(Print &p);
+  };
+
+// Records the cycles from construction to destruction against the given routine.
+class CycleProfileScope
+  {
+  private:
+    const CycleProfilePoint point;
+    const uint32_t start;
+  public:
+    CycleProfileScope(const CycleProfilePoint p) : point(p), start(CycleProfile::cycles()) { }
+    ~CycleProfileScope() { CycleProfile::record(point, CycleProfile::cycles() - start); }
+  };
+
+}
+
+// Place at the top of an instrumented routine, eg OTV0P2BASE_CYCLE_PROFILE_SCOPE(OTV0P2BASE::CPP_CRC);
+#ifdef OTV0P2BASE_CYCLE_PROFILE
+#define OTV0P2BASE_CYCLE_PROFILE_SCOPE(point) ::OTV0P2BASE::CycleProfileScope _cycleProfileScope((point))
+#else
+#define OTV0P2BASE_CYCLE_PROFILE_SCOPE(point) do { } while(0)
+#endif
+
+#endif
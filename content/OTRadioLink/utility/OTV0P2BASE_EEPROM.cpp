@@ -153,7 +153,7 @@ uint8_t getByHourStat(const uint8_t statsSet, const uint8_t hour)
 //  if(hh > 23) { return((uint8_t) 0xff); } // Invalid hour.
   const uint8_t hh = (STATS_SPECIAL_HOUR_CURRENT_HOUR == hour) ? OTV0P2BASE::getHoursLT() :
     ((hour > 23) ? OTV0P2BASE::getNextHourLT() : hour);
-  return(eeprom_read_byte((uint8_t *)(V0P2BASE_EE_START_STATS + (statsSet * (int)V0P2BASE_EE_STATS_SET_SIZE) + (int)hh)));
+  return(eeprom_read_byte((uint8_t *)(uintptr_t)(V0P2BASE_EE_START_STATS + (statsSet * (int)V0P2BASE_EE_STATS_SET_SIZE) + (int)hh)));
   }
 
 // Compute the number of stats samples in specified set less than the specified value; returns -1 for invalid stats set.
@@ -162,7 +162,7 @@ int8_t countStatSamplesBelow(const uint8_t statsSet, const uint8_t value)
   {
   if(statsSet > (V0P2BASE_EE_END_STATS - V0P2BASE_EE_START_STATS) / V0P2BASE_EE_STATS_SET_SIZE) { return(-1); } // Invalid set.
   if(0 == value) { return(0); } // Optimisation for common value.
-  const uint8_t *sE = (uint8_t *)(V0P2BASE_EE_STATS_START_ADDR(statsSet));
+  const uint8_t *sE = (uint8_t *)(uintptr_t)(V0P2BASE_EE_STATS_START_ADDR(statsSet));
   int8_t result = 0;
   for(int8_t hh = 24; --hh >= 0; ++sE)
     {
@@ -180,7 +180,7 @@ uint8_t getMinByHourStat(const uint8_t statsSet)
   for(int8_t hh = 24; --hh >= 0; )
     {
     // FIXME: optimise (move multiplication out of loop)
-    const uint8_t v = eeprom_read_byte((uint8_t *)(V0P2BASE_EE_START_STATS + (statsSet * (int)V0P2BASE_EE_STATS_SET_SIZE) + (int)hh));
+    const uint8_t v = eeprom_read_byte((uint8_t *)(uintptr_t)(V0P2BASE_EE_START_STATS + (statsSet * (int)V0P2BASE_EE_STATS_SET_SIZE) + (int)hh));
     // Optimisation/cheat: all valid samples are less than STATS_UNSET_BYTE.
     if(v < result) { result = v; }
     }
@@ -195,7 +195,7 @@ uint8_t getMaxByHourStat(const uint8_t statsSet)
   for(int8_t hh = 24; --hh >= 0; )
     {
     // FIXME: optimise (move multiplication out of loop)
-    const uint8_t v = eeprom_read_byte((uint8_t *)(V0P2BASE_EE_START_STATS + (statsSet * (int)V0P2BASE_EE_STATS_SET_SIZE) + (int)hh));
+    const uint8_t v = eeprom_read_byte((uint8_t *)(uintptr_t)(V0P2BASE_EE_START_STATS + (statsSet * (int)V0P2BASE_EE_STATS_SET_SIZE) + (int)hh));
     if((STATS_UNSET_BYTE != v) &&
        ((STATS_UNSET_BYTE == result) || (v > result)))
       { result = v; }
@@ -251,7 +251,7 @@ bool inOutlierQuartile(const bool inTop, const uint8_t statsSet, const uint8_t h
   // and to deal with current/next hour if specified.
   const uint8_t sample = getByHourStat(statsSet, hour);
   if(OTV0P2BASE::STATS_UNSET_BYTE == sample) { return(false); }
-  const uint8_t *ss = (uint8_t *)(V0P2BASE_EE_STATS_START_ADDR(statsSet));
+  const uint8_t *ss = (uint8_t *)(uintptr_t)(V0P2BASE_EE_STATS_START_ADDR(statsSet));
   if(inTop) { return(inTopQuartile(ss, sample)); }
   return(inBottomQuartile(ss, sample));
   }
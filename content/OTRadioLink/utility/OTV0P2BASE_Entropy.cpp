@@ -21,6 +21,7 @@ Author(s) / Copyright (s): Damon Hart-Davis 2015--2016
  */
 
 #include <util/crc16.h>
+#include <avr/eeprom.h>
 #include <Arduino.h>
 
 #include "OTV0P2BASE_Entropy.h"
@@ -122,7 +123,7 @@ void captureEntropy1()
 #endif
 uint16_t sramCRC()
   {
-  uint16_t result = ~0U;
+  uint16_t result = (uint16_t)~0U;
   for(uint8_t *p = (uint8_t *)RAMSTART; p <= (uint8_t *)RAMEND; ++p)
     { result = _crc_ccitt_update(result, *p); }
   return(result);
@@ -131,7 +132,7 @@ uint16_t sramCRC()
 // Compute a CRC of all of EEPROM as a hash that may contain some entropy, particularly across restarts.
 uint16_t eeCRC()
   {
-  uint16_t result = ~0U;
+  uint16_t result = (uint16_t)~0U;
   for(uint8_t *p = (uint8_t *)0; p <= (uint8_t *)E2END; ++p)
     {
     const uint8_t v = eeprom_read_byte(p);
@@ -33,8 +33,8 @@ namespace OTV0P2BASE
 // Avoids lots of logic (many 10s of CPU cycles) in normal digitalRead()/digitalWrite() calls,
 // and this saves time and energy on (critical) paths polling I/O.
 // Does not do any error checking: beware.
-// Only really intended for ATmega328P.
-#ifdef __AVR_ATmega328P__
+// Only really intended for ATmega328P (or the host build, which models its ports).
+#if defined(__AVR_ATmega328P__) || defined(ARDUINO_ARCH_HOST)
 /* Register: PIND for 0--7, PINB for 8--13, 14--19 PINC (ADC/AI). */
 /* Bit: 0--7 as-is, 8--13 subtract 8, else subtract 14. */
 // Compute the bit mask for the port pin.
@@ -70,12 +70,17 @@ namespace OTV0P2BASE
 // WRITE GENERIC
 /* Register: PORTD for 0--7, PORTB for 8--13, (eg 13 is PORTB), 14--19 PINC (ADC/AI). */
 /* Bit: 0--7 as-is, 8--13 subtract 8, else subtract 14. */
+#if defined(ARDUINO_ARCH_HOST)
+// On the host go through digitalWrite() so that simulated devices (see hostDigitalWrite) see each write.
+#define fastDigitalWrite(pin, value) digitalWrite((pin), (value))
+#else
 // Handle quickly constant-value pins that we know about; fall back to generic run-time routine for rest.
 #define fastDigitalWrite(pin, value) do { \
     if(__builtin_constant_p((pin)) && (__builtin_constant_p(value) && ((pin) >= 0) && ((pin) < 8))) { bitWrite(PORTD, (pin), (value)); } \
     else if(__builtin_constant_p((pin)) && (__builtin_constant_p((value)) && ((pin) >= 8) && ((pin) < 14))) { bitWrite(PORTB, max((pin)-8,0), (value)); } \
     else if(__builtin_constant_p((pin)) && (__builtin_constant_p((value)) && ((pin) >= 14) && ((pin) < 20))) { bitWrite(PORTC, max((pin)-14,0), (value)); } \
     else { digitalWrite((pin), (value)); } } while(false) // Fall back to generic routine.    
+#endif
 #else
 #define fastDigitalRead(pin) digitalRead((pin)) // Don't know about other AVRs.
 #define fastDigitalWrite(pin, value) digitalWrite((pin), (value)) // Don't know about other AVRs.
@@ -21,10 +21,12 @@ Author(s) / Copyright (s): Damon Hart-Davis 2014--2016
  */
 
 #include <stddef.h>
+#include <string.h>
 
 #include "OTV0P2BASE_JSONStats.h"
 
 #include "OTV0P2BASE_CRC.h"
+#include "OTV0P2BASE_CycleProfile.h"
 #include "OTV0P2BASE_EEPROM.h"
 
 
@@ -55,6 +57,22 @@ bool quickValidateRawSimpleJSONMessage(const char * const buf)
   return(false); // Bad (unterminated) message.
   }
 
+// Length of the "@" (ID) field lead-in "@":" that SimpleStatsRotationBase::writeJSON() always writes after the '{'.
+static const uint8_t JSONIDLeadInLength = 5;
+// CRC state after the '{' initialiser and the "@" lead-in, folded at compile time.
+static const uint8_t JSONIDLeadInCRC = crc7_5B_str_ce(MSG_JSON_LEADING_CHAR, "\"@\":\"");
+
+// Computes the JSON message CRC over the n bytes following the initial '{' at bptr.
+// If the message starts with the usual "@" lead-in then the precomputed CRC state is used for it
+// and only the variable remainder is hashed at run time.
+static uint8_t crcJSONMsgBody(const char *const bptr, const uint8_t n)
+  {
+  if((n >= JSONIDLeadInLength) &&
+     ('"' == bptr[1]) && ('@' == bptr[2]) && ('"' == bptr[3]) && (':' == bptr[4]) && ('"' == bptr[5]))
+    { return(crc7_5B_block(JSONIDLeadInCRC, (const uint8_t *)bptr + 1 + JSONIDLeadInLength, n - JSONIDLeadInLength)); }
+  return(crc7_5B_block(MSG_JSON_LEADING_CHAR, (const uint8_t *)bptr + 1, n));
+  }
+
 // Adjusts null-terminated text JSON message up to MSG_JSON_MAX_LENGTH bytes (not counting trailing '\0') for TX.
 // Sets high-bit on final '}' to make it unique, checking that all others are clear.
 // Computes and returns 0x5B 7-bit CRC in range [0,127]
@@ -65,26 +83,14 @@ bool quickValidateRawSimpleJSONMessage(const char * const buf)
 uint8_t adjustJSONMsgForTXAndComputeCRC(char * const bptr)
   {
   // Do initial quick validation before computing CRC, etc,
+  // which also guarantees that the message ends with "}\0"
+  // and contains no earlier such terminator.
   if(!quickValidateRawSimpleJSONMessage(bptr)) { return(adjustJSONMsgForTXAndComputeCRC_ERR); }
-//  if('{' != *bptr) { return(adjustJSONMsgForTXAndComputeCRC_ERR); }
-  bool seenTrailingClosingBrace = false;
-  uint8_t crc = '{';
-  for(char *p = bptr; *++p; ) // Skip first char ('{'); loop until '\0'.
-    {
-    const char c = *p;
-//    if(c & 0x80) { return(adjustJSONMsgForTXAndComputeCRC_ERR); } // No high-bits should be set!
-    if(('}' == c) && ('\0' == *(p+1)))
-      {
-      seenTrailingClosingBrace = true;
-      const char newC = c | 0x80;
-      *p = newC; // Set high bit.
-      crc = crc7_5B_update(crc, (uint8_t)newC); // Update CRC.
-      return(crc);
-      }
-    crc = crc7_5B_update(crc, (uint8_t)c); // Update CRC.
-    }
-  if(!seenTrailingClosingBrace) { return(adjustJSONMsgForTXAndComputeCRC_ERR); } // Missing ending '}'.
-  return(crc);
+  const uint8_t len = (uint8_t)strlen(bptr);
+  // Set high bit on the final '}'.
+  bptr[len-1] |= 0x80;
+  // CRC everything after the initial '{' (which is the initialiser) in one block.
+  return(crcJSONMsgBody(bptr, len - 1));
   }
 
 
@@ -120,14 +126,13 @@ int8_t checkJSONMsgRXCRC(const uint8_t * const bptr, const uint8_t bufLen)
 #if 0 && defined(DEBUG)
   DEBUG_SERIAL_PRINT_FLASHSTRING("checkJSONMsgRXCRC_ERR()... {");
 #endif
-  uint8_t crc = '{';
   // Scan up to maximum length for terminating '}'-with-high-bit.
+  // The CRC is computed in one block once the extent of the message is known.
   const uint8_t ml = min(MSG_JSON_ABS_MAX_LENGTH, bufLen);
   const uint8_t *p = bptr + 1;
   for(int i = 1; i < ml; ++i)
     {
     const char c = *p++;
-    crc = crc7_5B_update(crc, (uint8_t)c); // Update CRC.
 //#ifdef ALLOW_RAW_JSON_RX
     if(('}' == c) && ('\0' == *p))
       {
@@ -139,12 +144,16 @@ int8_t checkJSONMsgRXCRC(const uint8_t * const bptr, const uint8_t bufLen)
       }
 //#endif
     // With a terminating '}' (followed by '\0') the message is superficially valid.
-    if((((char)('}' | 0x80)) == c) && ((crc == *p) || ((0 == crc) && (0x80 == *p))))
+    if(((char)('}' | 0x80)) == c)
       {
+      const uint8_t crc = crcJSONMsgBody((const char *)bptr, (uint8_t)i);
+      if((crc == *p) || ((0 == crc) && (0x80 == *p)))
+        {
 #if 0 && defined(DEBUG)
-      DEBUG_SERIAL_PRINTLN_FLASHSTRING("} OK with CRC");
+        DEBUG_SERIAL_PRINTLN_FLASHSTRING("} OK with CRC");
 #endif
-      return(i+1);
+        return(i+1);
+        }
       }
     // Non-printable/control character makes the message invalid.
     if((c < 32) || (c > 126))
@@ -336,6 +345,7 @@ bool SimpleStatsRotationBase::changedValue()
 uint8_t SimpleStatsRotationBase::writeJSON(uint8_t *const buf, const uint8_t bufSize, const uint8_t sensitivity,
                                            const bool maximise, const bool suppressClearChanged)
   {
+  OTV0P2BASE_CYCLE_PROFILE_SCOPE(CPP_JSON_WRITE);
 #ifdef DEBUG
   if(NULL == buf) { panic(0); } // Should never happen.
 #endif
@@ -82,7 +82,7 @@ class MinimalOneWireBase
 
     // Fast direct GPIO operations.
     // Will be fastest (eg often single instructions) if their arguments are compile-time constants.
-#if defined(__AVR_ATmega328P__) // Probably all AVR.
+#if defined(__AVR_ATmega328P__) || defined(ARDUINO_ARCH_HOST) // Probably all AVR; the host build models ATmega328P ports.
     // Set selected bit low if an output, else turn off weak pull-up if an input.
     inline void bitWriteLow  (volatile uint8_t *const inputReg, const uint8_t bitmask) { *(inputReg+2) &= ~bitmask; }
     // Set selected bit high if an output, else turn on weak pull-up if an input.
@@ -86,7 +86,7 @@ static void SHT21_init()
 // This may consume significant power and time.
 // Probably no need to do this more than (say) once per minute.
 // The first read will initialise the device as necessary and leave it in a low-power mode afterwards.
-int RoomTemperatureC16_SHT21::read()
+int16_t RoomTemperatureC16_SHT21::read()
   {
   const bool neededPowerUp = OTV0P2BASE::powerUpTWIIfDisabled();
 
@@ -72,7 +72,7 @@ class SensorTemperaturePot : public OTV0P2BASE::SimpleTSUint8Sensor
   public:
     // Initialise raw to distinct/special value and all pointers to NULL.
     SensorTemperaturePot(uint16_t minExpected_ = 0, uint16_t maxExpected_ = TEMP_POT_RAW_MAX)
-      : raw(~0U),
+      : raw((uint16_t)~0U),
         occCallback(NULL), warmModeCallback(NULL), bakeStartCallback(NULL),
         minExpected(minExpected_), maxExpected(maxExpected_)
       { }
@@ -56,7 +56,7 @@ uint_least16_t SimpleValveScheduleBase::getSimpleScheduleOn(const uint8_t which)
   if(which >= MAX_SIMPLE_SCHEDULES) { return(~0); } // Invalid schedule number.
   uint8_t startMM;
   ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
-    { startMM = eeprom_read_byte((uint8_t*)(V0P2BASE_EE_START_SIMPLE_SCHEDULE0_ON + which)); }
+    { startMM = eeprom_read_byte((uint8_t*)(uintptr_t)(V0P2BASE_EE_START_SIMPLE_SCHEDULE0_ON + which)); }
   if(startMM > MAX_COMPRESSED_MINS_AFTER_MIDNIGHT) { return(~0); } // No schedule set.
   // Compute start time from stored schedule value.
   uint_least16_t startTime = SIMPLE_SCHEDULE_GRANULARITY_MINS * startMM;
@@ -96,7 +96,7 @@ bool SimpleValveScheduleBase::setSimpleSchedule(const uint_least16_t startMinute
   // Set the schedule, minimising wear.
   const uint8_t startMM = startMinutesSinceMidnightLT / SIMPLE_SCHEDULE_GRANULARITY_MINS; // Round down...
   ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
-    { OTV0P2BASE::eeprom_smart_update_byte((uint8_t*)(V0P2BASE_EE_START_SIMPLE_SCHEDULE0_ON + which), startMM); }
+    { OTV0P2BASE::eeprom_smart_update_byte((uint8_t*)(uintptr_t)(V0P2BASE_EE_START_SIMPLE_SCHEDULE0_ON + which), startMM); }
   return(true); // Assume EEPROM programmed OK...
   }
 
@@ -108,7 +108,7 @@ void SimpleValveScheduleBase::clearSimpleSchedule(const uint8_t which)
   if(which >= MAX_SIMPLE_SCHEDULES) { return; } // Invalid schedule number.
   // Clear the schedule back to 'unprogrammed' values, minimising wear.
   ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
-    { OTV0P2BASE::eeprom_smart_erase_byte((uint8_t*)(V0P2BASE_EE_START_SIMPLE_SCHEDULE0_ON + which)); }
+    { OTV0P2BASE::eeprom_smart_erase_byte((uint8_t*)(uintptr_t)(V0P2BASE_EE_START_SIMPLE_SCHEDULE0_ON + which)); }
   }
 
 // Returns true if any simple schedule is set, false otherwise.
@@ -130,7 +130,7 @@ bool SimpleValveScheduleBase::isAnySimpleScheduleSet()
     {
     for(uint8_t which = 0; which < MAX_SIMPLE_SCHEDULES; ++which)
       {
-      if(eeprom_read_byte((uint8_t*)(V0P2BASE_EE_START_SIMPLE_SCHEDULE0_ON + which)) <= MAX_COMPRESSED_MINS_AFTER_MIDNIGHT)
+      if(eeprom_read_byte((uint8_t*)(uintptr_t)(V0P2BASE_EE_START_SIMPLE_SCHEDULE0_ON + which)) <= MAX_COMPRESSED_MINS_AFTER_MIDNIGHT)
         { return(true); }
       }
     }
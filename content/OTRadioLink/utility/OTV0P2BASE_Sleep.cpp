@@ -73,7 +73,7 @@ ISR(WDT_vect)
   // Note: be careful of what is accessed from this ISR.
   // Capture some marginal entropy from the stack position.
   uint8_t x;
-  _watchdogFired = ((uint8_t) 0x80) | ((uint8_t) (int) &x); // Ensure non-zero, retaining any entropy in ls bits.
+  _watchdogFired = ((uint8_t) 0x80) | ((uint8_t) (uintptr_t) &x); // Ensure non-zero, retaining any entropy in ls bits.
   }
 
 // Idle the CPU for specified time but leave everything else running (eg UART), returning on any interrupt or the watchdog timer.
@@ -88,6 +88,11 @@ static __inline__ void _delay_x4cycles(uint8_t n) // Takes 4n CPU cycles to run,
       ::OTV0P2BASE::_delay_x4cycles(((us) & 63) << 2); \
       } } while(false)
 #endif
+#elif defined(ARDUINO_ARCH_HOST)
+// The host build has no cycle-accurate delays: approximate them with the (simulated) clock.
+static inline void _delay_NOP(void) { }
+static inline void _delay_x4cycles(const uint8_t n) { delayMicroseconds((unsigned int)((((0 == n) ? 256UL : n) * 4UL * 1000000UL) / F_CPU)); }
+#define OTV0P2BASE_busy_spin_delay(us) delayMicroseconds((us))
 #endif
 
 
@@ -0,0 +1,114 @@
+/**
+ * @brief Measures non-secure frame CRC verification throughput in frames/s.
+ *        Like is compared with like: CRC-only checks per frame with the original bitwise loop
+ *        and with crc7_5B_block(), against the batch crc7_5B_multi() and checkNonSecureSmallFramesCRC();
+ *        the per-frame header decode plus CRC that a receiver does now is shown separately for reference.
+ * @note  Results are printed to Serial once per loop().
+ *        Each figure is from repeated passes over a few hundred frames of mixed lengths
+ *        for at least minRunUs of host time.
+ */
+#include <OTV0p2Base.h>
+#include <OTRadioLink.h>
+
+// Number of frames checked per pass (one batch call), and minimum time per measurement.
+static const uint8_t nFrames = 240;
+static const unsigned long minRunUs = 500000;
+// Big enough for any non-secure small frame including its trailer.
+static const uint8_t frameSize = OTRadioLink::SecurableFrameHeader::maxSmallFrameSize + 1;
+
+static uint8_t frames[nFrames][frameSize];
+static OTRadioLink::SmallFrameBufLen fbl[nFrames];
+static const uint8_t *bufs[nFrames];
+static uint8_t lens[nFrames];
+static uint8_t crcs[nFrames];
+static bool pass[nFrames];
+
+// Prevents the optimiser discarding results.
+static volatile uint8_t sink;
+
+// Check all the frames once.
+typedef void check_t();
+
+static void checkBitwise()
+  {
+  for(uint8_t i = 0; i < nFrames; ++i)
+    {
+    const uint8_t fl = lens[i];
+    uint8_t crc = 0x7f;
+    for(uint8_t j = 0; j < fl; ++j) { crc = OTV0P2BASE::crc7_5B_update(crc, frames[i][j]); }
+    sink = (crc == frames[i][fl]);
+    }
+  }
+
+static void checkBlock()
+  {
+  for(uint8_t i = 0; i < nFrames; ++i)
+    {
+    const uint8_t fl = lens[i];
+    sink = (OTV0P2BASE::crc7_5B_block(0x7f, frames[i], fl) == frames[i][fl]);
+    }
+  }
+
+static void checkMulti()
+  {
+  OTV0P2BASE::crc7_5B_multi(0x7f, bufs, lens, nFrames, crcs);
+  sink = crcs[nFrames - 1];
+  }
+
+static void checkBatch() { sink = OTRadioLink::checkNonSecureSmallFramesCRC(fbl, nFrames, pass); }
+
+static void checkDecodeAndCRC()
+  {
+  OTRadioLink::SecurableFrameHeader sfh;
+  for(uint8_t i = 0; i < nFrames; ++i)
+    {
+    sfh.checkAndDecodeSmallFrameHeader(frames[i], frameSize);
+    const uint8_t fl = frames[i][0];
+    sink = (sfh.computeNonSecureFrameCRC(frames[i], fl) == frames[i][fl]);
+    }
+  }
+
+// Run check over all the frames repeatedly for at least minRunUs, then print the rate.
+static void measure(const char *name, check_t *const check)
+  {
+  unsigned long passes = 0;
+  const unsigned long start = micros();
+  unsigned long us;
+  do { check(); ++passes; } while((us = micros() - start) < minRunUs);
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print((unsigned long)(((float)passes * nFrames * 1000000.0f) / us));
+  Serial.println(" frames/s");
+  }
+
+void setup()
+  {
+  Serial.begin(4800);
+  Serial.println("Start");
+  // Frames of the spec test vector 2 form, with bodies of 0 to 15 bytes and the sequence number varied.
+  const uint8_t id[] = { 0x80, 0x81 };
+  uint8_t body[15];
+  for(uint8_t i = 0; i < sizeof(body); ++i) { body[i] = (uint8_t)(0x20 + i); }
+  for(uint8_t i = 0; i < nFrames; ++i)
+    {
+    OTRadioLink::encodeNonsecureSmallFrame(frames[i], frameSize,
+                                    OTRadioLink::FTS_BasicSensorOrValve,
+                                    i, id, sizeof(id), body, (uint8_t)(i % (sizeof(body) + 1)));
+    fbl[i].buf = frames[i];
+    fbl[i].buflen = frameSize;
+    bufs[i] = frames[i];
+    lens[i] = frames[i][0];
+    }
+  }
+
+void loop()
+  {
+  // CRC only.
+  measure("bitwise per frame", checkBitwise);
+  measure("crc7_5B_block per frame", checkBlock);
+  measure("crc7_5B_multi batch", checkMulti);
+  measure("checkNonSecureSmallFramesCRC batch", checkBatch);
+  // For reference: as a receiver checks a frame now, with the header decode that computeNonSecureFrameCRC() depends on.
+  measure("per-frame header decode + CRC", checkDecodeAndCRC);
+  delay(1000);
+  }
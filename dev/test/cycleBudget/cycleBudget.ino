@@ -0,0 +1,85 @@
+/**
+ * @brief Reports worst-case CPU cost of the instrumented hot routines in sub-cycle ticks.
+ *        Exercises RFM23B TX/RX FIFO handling, FHT8V encoding, CRC, JSON stats and the valve model,
+ *        then prints the OTV0P2BASE::CycleProfile table once per loop().
+ * @note  The library must be built with OTV0P2BASE_CYCLE_PROFILE defined,
+ *        eg cmake -DOT_CYCLE_PROFILE=ON for the host build.
+ *        Run on a V0p2 board or under simavr (eg simavr -m atmega328p -f 1000000 cycleBudget.elf)
+ *        for real AVR cycle counts; host figures only reflect host speed.
+ *        On a board this will transmit on the radio.
+ */
+#include <OTV0p2Base.h>
+#include <OTRadioLink.h>
+#include <OTRFM23BLink.h>
+#include <OTRadValve.h>
+
+#ifndef OTV0P2BASE_CYCLE_PROFILE
+#warning OTV0P2BASE_CYCLE_PROFILE not defined: no routines will be profiled.
+#endif
+
+// Exposes the RX FIFO read, normally only done from poll()/ISR on a valid packet.
+class BudgetRFM23BLink : public OTRFM23BLink::OTRFM23BLink<OTV0P2BASE::V0p2_PIN_SPI_nSS>
+  {
+  public:
+    void readRXFIFO(uint8_t *buf, uint8_t bufSize) { _RXFIFO(buf, bufSize); }
+  };
+static BudgetRFM23BLink radio;
+
+// Prevents the optimiser discarding results.
+static volatile uint8_t sink;
+
+void setup()
+  {
+  Serial.begin(4800);
+  Serial.println("Start");
+  OTV0P2BASE::CycleProfile::reset();
+  }
+
+void loop()
+  {
+  // Largest frames the radio is expected to handle, TX and (nominally) RX.
+  uint8_t frame[64];
+  for(uint8_t i = 0; i < sizeof(frame); ++i) { frame[i] = OTV0P2BASE::randRNG8(); }
+  radio.sendRaw(frame, sizeof(frame));
+  radio.readRXFIFO(frame, sizeof(frame));
+
+  // FHT8V command with a random house code and valve position.
+  OTRadValve::FHT8VRadValveBase::fht8v_msg_t command;
+  command.hc1 = OTV0P2BASE::randRNG8() % 100;
+  command.hc2 = OTV0P2BASE::randRNG8() % 100;
+#ifdef OTV0P2BASE_FHT8V_ADR_USED
+  command.address = 0;
+#endif
+  command.command = 0x26;
+  command.extension = OTV0P2BASE::randRNG8();
+  uint8_t stream[OTRadValve::FHT8VRadValveBase::MIN_FHT8V_200US_BIT_STREAM_BUF_SIZE];
+  OTRadValve::FHT8VRadValveBase::FHT8VCreate200usBitStreamBptr(stream, &command);
+
+  // Maximum-size small frame CRC.
+  sink = OTV0P2BASE::crc7_5B_block(0x7f, frame, OTRadioLink::SecurableFrameHeader::maxSmallFrameSize);
+
+  // Full-size JSON stats frame, maximised.
+  static OTV0P2BASE::SimpleStatsRotation<8> ssr;
+  ssr.setID("b39a");
+  ssr.put("T|C16", 320 + (OTV0P2BASE::randRNG8() & 15));
+  ssr.put("H|%", 65);
+  ssr.put("L", OTV0P2BASE::randRNG8());
+  ssr.put("B|cV", 256);
+  ssr.put("v|%", OTV0P2BASE::randRNG8() % 101);
+  ssr.put("tT|C", 19);
+  ssr.put("vac|h", 3);
+  uint8_t json[OTV0P2BASE::MSG_JSON_MAX_LENGTH + 2];
+  sink = ssr.writeJSON(json, sizeof(json), OTV0P2BASE::stTXalwaysAll, true);
+
+  // Valve model, swept over temperatures either side of target.
+  static OTRadValve::ModelledRadValveState rs;
+  static uint8_t valvePCOpen = 0;
+  OTRadValve::ModelledRadValveInputState is((18 << 4) + (OTV0P2BASE::randRNG8() & 63));
+  is.targetTempC = 19;
+  rs.tick(valvePCOpen, is);
+
+  OTV0P2BASE::CycleProfile::printWorstCaseTable(Serial);
+#ifndef ARDUINO_ARCH_HOST
+  delay(1000);
+#endif
+  }
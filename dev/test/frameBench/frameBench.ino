@@ -0,0 +1,383 @@
+/**
+ * @brief Microbenchmarks for the frame encode/decode hot paths.
+ *        Covers non-secure and secure small frames, secure frame replay checks, RX queue dequeueing, RX filtering,
+ *        FHT8V/FS20 bit streams, binary 'full' stats and JSON stats.
+ * @note  For each benchmark prints a line with ns/op, bytes/op and allocations/op,
+ *        then one machine-readable JSON line starting with '{' to track regressions between releases,
+ *        eg: frameBench | grep '^{' > bench.json
+ *        bytes/op is the frame/message size produced (encode) or consumed (decode).
+ *        Allocations are only counted on the host build; elsewhere they are reported as 0.
+ *        Secure frames use the NULL crypto backend,
+ *        plus real AES-128-GCM via OTAESGCM or (on the host) OpenSSL where available.
+ */
+#include <OTV0p2Base.h>
+#include <OTRadioLink.h>
+#include <OTRadValve.h>
+
+#if defined(OT_BENCH_OTAESGCM)
+#include <OTAESGCM.h>
+#elif defined(OT_BENCH_OPENSSL)
+#include <openssl/evp.h>
+#endif
+
+// Iterations per timed benchmark.
+#ifdef ARDUINO_ARCH_HOST
+static const unsigned long iters = 200000;
+#else
+static const unsigned long iters = 1000;
+#endif
+
+// Prevents the optimiser discarding results.
+static volatile uint8_t sink;
+
+#ifdef ARDUINO_ARCH_HOST
+static unsigned long allocs() { return(hostAllocations()); }
+#else
+static unsigned long allocs() { return(0); }
+#endif
+
+// Results, for the final JSON output.
+struct BenchResult
+  {
+  const char *name;
+  float nsPerOp;
+  uint8_t bytesPerOp;
+  float allocsPerOp;
+  };
+// One result per runBench() in loop(): the plain benchmarks, plus an encode and a decode per secure implementation.
+// Keep in step with loop(); runBench() stops the run rather than drop a result if this is too small.
+static const uint8_t nPlainBenches = 10;
+#if defined(OT_BENCH_OTAESGCM) || defined(OT_BENCH_OPENSSL)
+static const uint8_t nSecureImpls = 2;
+#else
+static const uint8_t nSecureImpls = 1;
+#endif
+static const uint8_t maxResults = nPlainBenches + 2*nSecureImpls;
+static BenchResult results[maxResults];
+static uint8_t nResults;
+
+// Benchmark function: performs one operation and returns the bytes produced/consumed (0 on failure).
+typedef uint8_t benchFn_t();
+
+static void runBench(const char *name, benchFn_t *fn)
+  {
+  const uint8_t bytes = fn(); // Warm up, and check it works.
+  if(0 == bytes) { Serial.print(name); Serial.println(": FAILED"); return; }
+  const unsigned long a0 = allocs();
+  const unsigned long start = micros();
+  for(unsigned long i = iters; i-- > 0; ) { sink = fn(); }
+  const unsigned long us = micros() - start;
+  const unsigned long a = allocs() - a0;
+  const float nsPerOp = (us * 1000.0f) / iters;
+  const float allocsPerOp = (float)a / iters;
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print(nsPerOp, 1);
+  Serial.print(" ns/op, ");
+  Serial.print(bytes);
+  Serial.print(" bytes/op, ");
+  Serial.print(allocsPerOp, 2);
+  Serial.println(" allocs/op");
+  if(nResults >= maxResults)
+    {
+    // A silently truncated JSON result set would be misread: stop instead.
+    Serial.println("***Bench FAILED*** results table full: raise nPlainBenches/nSecureImpls");
+#ifdef ARDUINO_ARCH_HOST
+    Serial.flush();
+    exit(1);
+#else
+    for( ; ; ) { }
+#endif
+    }
+  BenchResult &r = results[nResults++];
+  r.name = name;
+  r.nsPerOp = nsPerOp;
+  r.bytesPerOp = bytes;
+  r.allocsPerOp = allocsPerOp;
+  }
+
+static void printJSON()
+  {
+  Serial.print("{\"bench\":\"frameBench\",\"iters\":");
+  Serial.print(iters);
+  Serial.print(",\"results\":[");
+  for(uint8_t i = 0; i < nResults; ++i)
+    {
+    const BenchResult &r = results[i];
+    if(0 != i) { Serial.print(','); }
+    Serial.print("{\"name\":\"");
+    Serial.print(r.name);
+    Serial.print("\",\"ns_op\":");
+    Serial.print(r.nsPerOp, 1);
+    Serial.print(",\"bytes_op\":");
+    Serial.print(r.bytesPerOp);
+    Serial.print(",\"allocs_op\":");
+    Serial.print(r.allocsPerOp, 2);
+    Serial.print('}');
+    }
+  Serial.println("]}");
+  }
+
+
+// Spec test vector 2: 'O' frame with a small JSON body.
+static const uint8_t id[] = { 0x80, 0x81 };
+static const uint8_t body[] = { 0x7f, 0x11, 0x7b, 0x22, 0x62, 0x22, 0x3a, 0x31 };
+static uint8_t nsFrame[OTRadioLink::SecurableFrameHeader::maxSmallFrameSize + 1];
+static uint8_t nsFrameLen;
+
+static uint8_t benchEncodeNonsecure()
+  {
+  return(OTRadioLink::encodeNonsecureSmallFrame(nsFrame, sizeof(nsFrame),
+                                    OTRadioLink::FTS_BasicSensorOrValve,
+                                    0, id, sizeof(id), body, sizeof(body)));
+  }
+
+static OTRadioLink::SecurableFrameHeader sfh;
+static uint8_t benchDecodeHeader()
+  { return(sfh.checkAndDecodeSmallFrameHeader(nsFrame, nsFrameLen)); }
+
+// Secure frames, as in the spec test vector 3, with an all-zeros key.
+static const uint8_t secID[] = { 0xaa, 0xaa, 0xaa, 0xaa, 0x55, 0x55, 0x55, 0x55 };
+static const uint8_t iv[] = { 0xaa, 0xaa, 0xaa, 0xaa, 0x55, 0x55, 0x55, 0x55, 0x00, 0x00, 0x2a, 0x00 };
+static const uint8_t zeroKey[16] = { };
+static uint8_t secFrame[64];
+static uint8_t secFrameLen;
+static OTRadioLink::fixed32BTextSize12BNonce16BTagSimpleEnc_ptr_t secEnc;
+static OTRadioLink::fixed32BTextSize12BNonce16BTagSimpleDec_ptr_t secDec;
+static void *secState;
+
+static uint8_t benchEncodeSecure()
+  {
+  return(OTRadioLink::encodeSecureSmallFrameRaw(secFrame, sizeof(secFrame),
+                                    OTRadioLink::FTS_BasicSensorOrValve,
+                                    0, secID, 4, body, sizeof(body),
+                                    iv, secEnc, secState, zeroKey));
+  }
+
+static OTRadioLink::SecurableFrameHeader secSFH;
+static uint8_t benchDecodeSecure()
+  {
+  uint8_t decoded[OTRadioLink::ENC_BODY_SMALL_FIXED_PTEXT_MAX_SIZE];
+  uint8_t decodedSize;
+  return(OTRadioLink::decodeSecureSmallFrameRaw(&secSFH, secFrame, secFrameLen,
+                                    secDec, secState, zeroKey, iv,
+                                    decoded, sizeof(decoded), decodedSize));
+  }
+
+// Encodes once to set up for decoding, then times both.
+static void benchSecure(const char *encName, const char *decName)
+  {
+  secFrameLen = benchEncodeSecure();
+  if(0 == secSFH.checkAndDecodeSmallFrameHeader(secFrame, secFrameLen))
+    { Serial.print(decName); Serial.println(": FAILED"); return; }
+  runBench(encName, benchEncodeSecure);
+  runBench(decName, benchDecodeSecure);
+  }
+
+#if defined(OT_BENCH_OPENSSL)
+// Real AES-128-GCM via OpenSSL, with the cipher context passed as the crypto state.
+static bool fixed32BTextSize12BNonce16BTagSimpleEnc_OpenSSL(void *state,
+        const uint8_t *key, const uint8_t *iv,
+        const uint8_t *authtext, uint8_t authtextSize,
+        const uint8_t *plaintext,
+        uint8_t *ciphertextOut, uint8_t *tagOut)
+  {
+  EVP_CIPHER_CTX *const ctx = (EVP_CIPHER_CTX *)state;
+  int len;
+  if(1 != EVP_EncryptInit_ex(ctx, EVP_aes_128_gcm(), NULL, key, iv)) { return(false); } // ERROR
+  if((0 != authtextSize) && (1 != EVP_EncryptUpdate(ctx, NULL, &len, authtext, authtextSize))) { return(false); } // ERROR
+  if((NULL != plaintext) && (1 != EVP_EncryptUpdate(ctx, ciphertextOut, &len, plaintext, 32))) { return(false); } // ERROR
+  if(1 != EVP_EncryptFinal_ex(ctx, ciphertextOut, &len)) { return(false); } // ERROR
+  return(1 == EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, 16, tagOut));
+  }
+static bool fixed32BTextSize12BNonce16BTagSimpleDec_OpenSSL(void *state,
+        const uint8_t *key, const uint8_t *iv,
+        const uint8_t *authtext, uint8_t authtextSize,
+        const uint8_t *ciphertext, const uint8_t *tag,
+        uint8_t *plaintextOut)
+  {
+  EVP_CIPHER_CTX *const ctx = (EVP_CIPHER_CTX *)state;
+  int len;
+  if(1 != EVP_DecryptInit_ex(ctx, EVP_aes_128_gcm(), NULL, key, iv)) { return(false); } // ERROR
+  if((0 != authtextSize) && (1 != EVP_DecryptUpdate(ctx, NULL, &len, authtext, authtextSize))) { return(false); } // ERROR
+  if((NULL != ciphertext) && (1 != EVP_DecryptUpdate(ctx, plaintextOut, &len, ciphertext, 32))) { return(false); } // ERROR
+  if(1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, 16, (void *)tag)) { return(false); } // ERROR
+  return(1 == EVP_DecryptFinal_ex(ctx, plaintextOut, &len));
+  }
+#endif
+
+// Replay check of each new frame from one of a few senders, as in the RX poll path.
+static OTRadioLink::ReplayFilterFixed<4> replayFilter;
+static uint8_t replayTrailer[OTRadioLink::SECURE_FRAME_COUNTER_BYTES];
+static uint8_t benchReplayFilter()
+  {
+  // Advance the 6-byte big-endian counter.
+  for(uint8_t i = sizeof(replayTrailer); i-- > 0; ) { if(0 != ++replayTrailer[i]) { break; } }
+  return(replayFilter.acceptTrailer(secID, replayTrailer) ? sizeof(replayTrailer) : 0);
+  }
+
+// Dequeue a burst of small frames from the RX queue, one at a time and as a batch.
+static const uint8_t rxBurst = 4;
+static OTRadioLink::ISRRXQueueVarLenMsg<64, 3> rxQueue;
+static void fillRXQueue()
+  {
+  for(uint8_t i = 0; i < rxBurst; ++i)
+    {
+    volatile uint8_t *const ib = rxQueue._getRXBufForInbound();
+    if(NULL == ib) { return; }
+    ib[0] = i;
+    rxQueue._loadedBuf(8);
+    }
+  }
+static uint8_t benchRXQueuePeekRemove()
+  {
+  fillRXQueue();
+  OTRadioLink::ISRRXQueue &q = rxQueue;
+  uint8_t bytes = 0, len;
+  for(const volatile uint8_t *buf; NULL != (buf = q.peekRXMsg(len)); q.removeRXMsg()) { bytes += len + buf[0]; }
+  return(bytes);
+  }
+static bool rxDrainHandler(void *context, const volatile uint8_t *buf, const uint8_t len)
+  { *(uint8_t *)context += len + buf[0]; return(true); }
+static uint8_t benchRXQueueDrain()
+  {
+  fillRXQueue();
+  OTRadioLink::ISRRXQueue &q = rxQueue;
+  uint8_t bytes = 0;
+  q.drainRXMsgs(rxDrainHandler, &bytes);
+  return(bytes);
+  }
+
+// Quick RX filter chain as it might be set for the RX ISR, on a zero-padded secure 'O' frame it accepts.
+typedef OTRadioLink::FrameFilterChain<
+    OTRadioLink::FrameFilterTrimTrailingZeros,
+    OTRadioLink::FrameFilterLength<8, 63>,
+    OTRadioLink::FrameFilterSecureableTypes<OTRadioLink::FTS_BasicSensorOrValve, OTRadioLink::FTS_ALIVE>,
+    OTRadioLink::FrameFilterIDPrefix<0x81, 0x02> > rxFilterChain;
+static volatile uint8_t rxFilterFrame[64] = { 9, 0x80 | 'O', 0x02, 0x81, 0x02, 0, 1, 2, 3, 4 };
+static uint8_t benchFrameFilterChain()
+  {
+  // Called through a pointer, as from the RX ISR.
+  OTRadioLink::quickFrameFilter_t *volatile f = rxFilterChain::filter;
+  volatile uint8_t len = sizeof(rxFilterFrame);
+  return(f(rxFilterFrame, len) ? len : 0);
+  }
+
+// FHT8V command: house code 13/73, valve to 50%.
+static OTRadValve::FHT8VRadValveBase::fht8v_msg_t fhtCommand;
+static uint8_t fhtStream[OTRadValve::FHT8VRadValveBase::MIN_FHT8V_200US_BIT_STREAM_BUF_SIZE];
+static uint8_t fhtStreamLen;
+
+static uint8_t benchFHT8VCreate()
+  {
+  const uint8_t *const end = OTRadValve::FHT8VRadValveBase::FHT8VCreate200usBitStreamBptr(fhtStream, &fhtCommand);
+  return((uint8_t)(end - fhtStream));
+  }
+
+static uint8_t benchFHT8VDecode()
+  {
+  OTRadValve::FHT8VRadValveBase::fht8v_msg_t command;
+  const uint8_t *const end = OTRadValve::FHT8VRadValveBase::FHT8VDecodeBitStream(fhtStream, fhtStream + fhtStreamLen - 1, &command);
+  return((NULL == end) ? 0 : (uint8_t)(end - fhtStream));
+  }
+
+// Full stats with ID, temperature/power and ambient light.
+static OTV0P2BASE::FullStatsMessageCore_t fullStats;
+static uint8_t fullStatsBuf[OTV0P2BASE::FullStatsMessageCore_MAX_BYTES_ON_WIRE + 1];
+
+static uint8_t benchFullStats()
+  {
+  const uint8_t *const end = OTV0P2BASE::encodeFullStatsMessageCore(fullStatsBuf, sizeof(fullStatsBuf),
+                                    OTV0P2BASE::stTXalwaysAll, false, &fullStats);
+  return((NULL == end) ? 0 : (uint8_t)(end - fullStatsBuf));
+  }
+
+// Typical valve stats set, rotated through a small frame.
+static OTV0P2BASE::SimpleStatsRotation<8> ssr;
+static uint8_t jsonBuf[OTV0P2BASE::MSG_JSON_MAX_LENGTH + 2];
+static int statsTick;
+
+static uint8_t benchWriteJSON()
+  {
+  // Keep some values changing so that priority handling is exercised.
+  ssr.put("T|C16", 320 + (++statsTick & 7));
+  return(ssr.writeJSON(jsonBuf, sizeof(jsonBuf), OTV0P2BASE::stTXalwaysAll));
+  }
+
+void setup()
+  {
+  Serial.begin(4800);
+  Serial.println("Start");
+
+  nsFrameLen = benchEncodeNonsecure();
+
+  fhtCommand.hc1 = 13;
+  fhtCommand.hc2 = 73;
+#ifdef OTV0P2BASE_FHT8V_ADR_USED
+  fhtCommand.address = 0;
+#endif
+  fhtCommand.command = 0x26;
+  fhtCommand.extension = 128;
+  fhtStreamLen = benchFHT8VCreate() + 1;
+
+  OTV0P2BASE::clearFullStatsMessageCore(&fullStats);
+  fullStats.containsID = true;
+  fullStats.id0 = 0x80;
+  fullStats.id1 = 0x81;
+  fullStats.containsTempAndPower = true;
+  fullStats.tempAndPower.tempC16 = (20 << 4) + 5;
+  fullStats.tempAndPower.powerLow = false;
+  fullStats.containsAmbL = true;
+  fullStats.ambL = 42;
+
+  ssr.setID("b39a");
+  ssr.put("T|C16", 320);
+  ssr.put("H|%", 65);
+  ssr.put("L", 42);
+  ssr.put("B|cV", 256);
+  ssr.put("v|%", 50);
+  ssr.put("tT|C", 19);
+  ssr.put("vac|h", 3);
+  }
+
+void loop()
+  {
+  nResults = 0;
+
+  runBench("encodeNonsecureSmallFrame", benchEncodeNonsecure);
+  runBench("checkAndDecodeSmallFrameHeader", benchDecodeHeader);
+
+  secEnc = OTRadioLink::fixed32BTextSize12BNonce16BTagSimpleEnc_NULL_IMPL;
+  secDec = OTRadioLink::fixed32BTextSize12BNonce16BTagSimpleDec_NULL_IMPL;
+  secState = NULL;
+  benchSecure("encodeSecureSmallFrameRaw/NULL", "decodeSecureSmallFrameRaw/NULL");
+#if defined(OT_BENCH_OTAESGCM)
+  secEnc = OTAESGCM::fixed32BTextSize12BNonce16BTagSimpleEnc_DEFAULT_STATELESS;
+  secDec = OTAESGCM::fixed32BTextSize12BNonce16BTagSimpleDec_DEFAULT_STATELESS;
+  secState = NULL;
+  benchSecure("encodeSecureSmallFrameRaw/AESGCM", "decodeSecureSmallFrameRaw/AESGCM");
+#elif defined(OT_BENCH_OPENSSL)
+  EVP_CIPHER_CTX *const ctx = EVP_CIPHER_CTX_new();
+  secEnc = fixed32BTextSize12BNonce16BTagSimpleEnc_OpenSSL;
+  secDec = fixed32BTextSize12BNonce16BTagSimpleDec_OpenSSL;
+  secState = ctx;
+  benchSecure("encodeSecureSmallFrameRaw/AESGCM", "decodeSecureSmallFrameRaw/AESGCM");
+  EVP_CIPHER_CTX_free(ctx);
+#endif
+
+  runBench("ReplayFilterFixed::acceptTrailer", benchReplayFilter);
+
+  runBench("ISRRXQueue peekRXMsg/removeRXMsg x4", benchRXQueuePeekRemove);
+  runBench("ISRRXQueue drainRXMsgs x4", benchRXQueueDrain);
+  runBench("FrameFilterChain x4 stages", benchFrameFilterChain);
+
+  runBench("FHT8VCreate200usBitStreamBptr", benchFHT8VCreate);
+  runBench("FHT8VDecodeBitStream", benchFHT8VDecode);
+  runBench("encodeFullStatsMessageCore", benchFullStats);
+  runBench("SimpleStatsRotation::writeJSON", benchWriteJSON);
+
+  printJSON();
+#ifndef ARDUINO_ARCH_HOST
+  delay(1000);
+#endif
+  }
@@ -0,0 +1,97 @@
+/**
+ * @brief Load-tests the RFM23B driver's interrupt-driven RX path against the simulated radio
+ *        (host build only; see host/include/HostRFM23B.h).
+ *        Frames are injected on the air at several rates, in real time,
+ *        while loop() drains the driver's RX queue as an application would;
+ *        the radio's interrupts are taken asynchronously, at arbitrary points in that code,
+ *        so that races between the ISR and the queue consumer show up as lost, repeated or mangled frames.
+ * @note  Results are printed to Serial, one line per rate, once per loop().
+ *        Any frame received out of sequence or corrupt, or any SPI conflict, indicates a bug;
+ *        frames missed at the highest rates may just be the ISR not keeping up.
+ */
+#include <OTV0p2Base.h>
+#include <OTRadioLink.h>
+#include <OTRFM23BLink.h>
+
+#include <HostRFM23B.h>
+
+// Receiver with its own nSS and nIRQ, and a deep RX queue as on a hub.
+typedef OTRFM23BLink::OTRFM23BLink<OTV0P2BASE::V0p2_PIN_SPI_nSS, 9, 8, uint16_t> RX_t;
+static RX_t rx;
+
+static HostRFM23BEther ether;
+static HostRFM23B sim(OTV0P2BASE::V0p2_PIN_SPI_nSS, 9);
+
+static void rxISR(void *) { rx.handleInterruptSimple(); }
+
+// Frame length and seconds per rate; the rates (frames/s) to run at.
+static const uint8_t frameLen = 20;
+static const uint8_t seconds = 2;
+static const uint16_t rates[] = { 50, 100, 200, 250 };
+
+void setup()
+  {
+  Serial.begin(4800);
+  Serial.println("Start");
+  ether.attach(sim);
+  sim.setISR(rxISR);
+  static const OTRadioLink::OTRadioChannelConfig config(OTRFM23BLink::OTRFM23BLinkBase::StandardRegSettingsGFSK, true, true, true);
+  rx.configure(1, &config);
+  if(!rx.begin()) { Serial.println("RFM23B not found"); return; }
+  rx.listen(true);
+  Serial.print("Airtime us: ");
+  Serial.println(HostRFM23BEther::airtimeUs(sim, frameLen));
+  }
+
+void loop()
+  {
+  ether.setAsyncIRQ(true);
+  for(uint8_t r = 0; r < sizeof(rates) / sizeof(rates[0]); ++r)
+    {
+    const uint16_t nFrames = (uint16_t)(rates[r] * seconds);
+    const unsigned long gapUs = 1000000UL / rates[r];
+    const unsigned long isrBefore = sim.getISRCalls();
+    const unsigned long crcBefore = sim.getCRCErrors();
+    uint16_t injected = 0, received = 0, bad = 0;
+    uint8_t next = 0;
+    const unsigned long start = micros() + 1000;
+    // Allow the last frame to arrive.
+    const unsigned long end = start + nFrames * gapUs + 20000;
+    for(unsigned long now = micros(); now < end; now = micros())
+      {
+      // Keep a few frames queued up on the air ahead of time.
+      for( ; (injected < nFrames) && (start + injected * gapUs < now + 4 * gapUs); ++injected)
+        {
+        uint8_t frame[frameLen];
+        memset(frame, (uint8_t)injected, sizeof(frame));
+        if(!ether.inject(sim, frame, sizeof(frame), start + injected * gapUs)) { break; }
+        }
+      // Drain the RX queue, checking each frame is whole and later than the last.
+      uint8_t len;
+      for(const volatile uint8_t *f; NULL != (f = rx.peekRXMsg(len)); rx.removeRXMsg())
+        {
+        ++received;
+        bool ok = (frameLen == len);
+        for(uint8_t i = 1; ok && (i < len); ++i) { ok = (f[i] == f[0]); }
+        if(!ok || ((uint8_t)(f[0] - next) >= 128)) { ++bad; }
+        next = (uint8_t)(f[0] + 1);
+        }
+      }
+    Serial.print(rates[r]);
+    Serial.print(" frames/s: received ");
+    Serial.print(received);
+    Serial.print('/');
+    Serial.print(injected);
+    Serial.print(", bad ");
+    Serial.print(bad);
+    Serial.print(", CRC errors ");
+    Serial.print(sim.getCRCErrors() - crcBefore);
+    Serial.print(", ISR calls ");
+    Serial.print(sim.getISRCalls() - isrBefore);
+    Serial.print(", RX errors ");
+    Serial.print(rx.getRXErr());
+    Serial.print(", SPI conflicts ");
+    Serial.println(sim.getSPIConflicts());
+    }
+  ether.setAsyncIRQ(false);
+  }
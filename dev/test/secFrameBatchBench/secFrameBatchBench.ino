@@ -0,0 +1,133 @@
+/**
+ * @brief Measures hub secure frame decode throughput in frames/s.
+ *        Compares per-frame decodeSecureSmallFrameRaw() with the hub AES-GCM,
+ *        with and without an AESGCMKeyCache of expanded keys by node ID,
+ *        and the batch decodeSecureSmallFramesBatch() on up to 1, 2, 4 and 8 threads,
+ *        also with an AESGCMKeyCache, each with and without AES-NI/PCLMULQDQ.
+ * @note  Results are printed to Serial once per loop().
+ *        Hub (non-AVR) builds only.
+ *        Batch throughput should scale with threads up to the number of cores (beyond which no more are used).
+ */
+#include <OTV0p2Base.h>
+#include <OTRadioLink.h>
+
+// Frames decoded per timed pass, keys shared between them, and passes per measurement.
+static const uint16_t nFrames = 4096;
+static const uint8_t nKeys = 64;
+static const uint8_t passes = 4;
+
+static uint8_t keys[nKeys][16];
+static uint8_t nodeIDs[nKeys][4];
+static uint8_t ivs[nFrames][12];
+static uint8_t frames[nFrames][OTRadioLink::SecurableFrameHeader::maxSmallFrameSize + 1];
+static uint8_t bodies[nFrames][OTRadioLink::ENC_BODY_SMALL_FIXED_PTEXT_MAX_SIZE];
+static OTRadioLink::SecureSmallFrameBatchItem items[nFrames];
+static bool pass[nFrames];
+
+// Prevents the optimiser discarding results.
+static volatile uint8_t sink;
+
+static void printRate(const char *name, const unsigned threads, const unsigned long us)
+  {
+  Serial.print(name);
+  if(0 != threads) { Serial.print(" x"); Serial.print(threads); }
+  Serial.print(OTRadioLink::isAESGCMHardwareInUse() ? " (AES-NI)" : " (portable)");
+  Serial.print(": ");
+  const unsigned long n = (unsigned long)nFrames * passes;
+  if(0 == us) { Serial.println("too fast to time"); return; }
+  Serial.print((unsigned long)(((float)n * 1000000.0f) / us));
+  Serial.println(" frames/s");
+  }
+
+void setup()
+  {
+  Serial.begin(4800);
+  Serial.println("Start");
+  for(uint8_t k = 0; k < nKeys; ++k)
+    {
+    for(uint8_t j = 0; j < 16; ++j) { keys[k][j] = OTV0P2BASE::randRNG8(); }
+    for(uint8_t j = 0; j < 4; ++j) { nodeIDs[k][j] = OTV0P2BASE::randRNG8(); }
+    }
+  // 'O' frames with a small JSON body and 4-byte IDs, as from a population of valves each with its own key.
+  static const uint8_t body[] = { 0x7f, 0x11, 0x7b, 0x22, 0x62, 0x22, 0x3a, 0x31 };
+  for(uint16_t i = 0; i < nFrames; ++i)
+    {
+    const uint8_t *const key = keys[i % nKeys];
+    for(uint8_t j = 0; j < 12; ++j) { ivs[i][j] = OTV0P2BASE::randRNG8(); }
+    const uint8_t len = OTRadioLink::encodeSecureSmallFrameRaw(frames[i], sizeof(frames[i]),
+                                    OTRadioLink::FTS_BasicSensorOrValve,
+                                    i, nodeIDs[i % nKeys], 4, body, sizeof(body), ivs[i],
+                                    OTRadioLink::fixed32BTextSize12BNonce16BTagSimpleEnc_HUB, NULL, key);
+    items[i].buf = frames[i];
+    items[i].buflen = len;
+    items[i].key = key;
+    items[i].iv = ivs[i];
+    items[i].decryptedBodyOut = bodies[i];
+    items[i].decryptedBodyOutBuflen = sizeof(bodies[i]);
+    }
+  }
+
+void loop()
+  {
+  for(uint8_t hw = 2; hw-- > 0; )
+    {
+    OTRadioLink::setAESGCMHardwareAllowed(0 != hw);
+    unsigned long start;
+
+    // Per-frame, as a receiver does it now, expanding the key for each frame.
+    OTRadioLink::SecurableFrameHeader sfh;
+    start = micros();
+    for(uint8_t p = 0; p < passes; ++p)
+      {
+      for(uint16_t i = 0; i < nFrames; ++i)
+        {
+        sfh.checkAndDecodeSmallFrameHeader(frames[i], items[i].buflen);
+        uint8_t decodedSize;
+        sink = OTRadioLink::decodeSecureSmallFrameRaw(&sfh, frames[i], items[i].buflen,
+                                    OTRadioLink::fixed32BTextSize12BNonce16BTagSimpleDec_HUB, NULL,
+                                    items[i].key, items[i].iv,
+                                    bodies[i], sizeof(bodies[i]), decodedSize);
+        }
+      }
+    printRate("per-frame", 0, micros() - start);
+
+    // Per-frame with expanded keys cached by (frame) node ID.
+    static OTRadioLink::AESGCMKeyCache cache(nKeys);
+    start = micros();
+    for(uint8_t p = 0; p < passes; ++p)
+      {
+      for(uint16_t i = 0; i < nFrames; ++i)
+        {
+        sfh.checkAndDecodeSmallFrameHeader(frames[i], items[i].buflen);
+        const OTRadioLink::AESGCMKeyContext *const k = cache.get(sfh.id, sfh.getIl(), items[i].key);
+        uint8_t decodedSize;
+        sink = OTRadioLink::decodeSecureSmallFrameRaw(&sfh, frames[i], items[i].buflen,
+                                    OTRadioLink::fixed32BTextSize12BNonce16BTagSimpleDec_HUB, (void *)k,
+                                    items[i].key, items[i].iv,
+                                    bodies[i], sizeof(bodies[i]), decodedSize);
+        }
+      }
+    printRate("per-frame cached", 0, micros() - start);
+
+    // Batch.
+    for(unsigned threads = 1; threads <= 8; threads <<= 1)
+      {
+      start = micros();
+      for(uint8_t p = 0; p < passes; ++p)
+        { sink = (uint8_t)OTRadioLink::decodeSecureSmallFramesBatch(items, nFrames, pass, threads); }
+      printRate("batch", threads, micros() - start);
+      }
+    for(unsigned threads = 1; threads <= 8; threads <<= 1)
+      {
+      start = micros();
+      for(uint8_t p = 0; p < passes; ++p)
+        { sink = (uint8_t)OTRadioLink::decodeSecureSmallFramesBatch(items, nFrames, pass, threads, &cache); }
+      printRate("batch cached", threads, micros() - start);
+      }
+    }
+  OTRadioLink::setAESGCMHardwareAllowed(true);
+
+#ifndef ARDUINO_ARCH_HOST
+  delay(1000);
+#endif
+  }
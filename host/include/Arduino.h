@@ -0,0 +1,167 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+/*
+ Minimal host (eg Linux/x86-64) stand-in for the Arduino core.
+
+ Provides just enough of the Arduino API and ATmega328P register set
+ for the OpenTRV libraries (and their unit-test sketches) to compile and run natively,
+ eg for profiling and benchmarking off-device.
+ Registers are plain variables: writes are remembered and reads return the last value written,
+ except where noted (eg TCNT2 follows the host clock as the V0p2 32768Hz async timer would).
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+
+#ifndef ARDUINO_ARCH_HOST
+#define ARDUINO_ARCH_HOST
+#endif
+
+// Nominal CPU clock, as for a V0p2 board, unless set by the build.
+#ifndef F_CPU
+#define F_CPU 1000000UL
+#endif
+
+// As for the Arduino 1.6 IDE.
+#ifndef ARDUINO
+#define ARDUINO 10605
+#endif
+
+typedef bool boolean;
+typedef uint8_t byte;
+typedef unsigned int word;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define DEFAULT 1
+#define EXTERNAL 0
+#define INTERNAL 3
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define PI 3.1415926535897932384626433832795
+
+// As the Arduino core these are macros, to accept mixed argument types.
+#ifndef min
+#define min(a,b) ((a)<(b)?(a):(b))
+#endif
+#ifndef max
+#define max(a,b) ((a)>(b)?(a):(b))
+#endif
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+
+#define lowByte(w) ((uint8_t) ((w) & 0xff))
+#define highByte(w) ((uint8_t) ((w) >> 8))
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+// bitClear() mask of the target's own type, so that clearing a bit of a uint8_t register is not a narrowing conversion.
+template<class T> inline T hostBitClearMask(const volatile T &, const uint8_t bit) { return((T)~(1UL << bit)); }
+inline uint8_t hostBitClearMask(const volatile HostSpecialReg8 &, const uint8_t bit) { return((uint8_t)~(1U << bit)); }
+#define bitClear(value, bit) ((value) &= hostBitClearMask((value), (bit)))
+#define bitWrite(value, bit, bitvalue) (bitvalue ? bitSet(value, bit) : bitClear(value, bit))
+#define bit(b) (1UL << (b))
+
+#define interrupts() sei()
+#define noInterrupts() cli()
+
+#define clockCyclesPerMicrosecond() (F_CPU / 1000000L)
+
+#define NOT_A_PIN 0
+#define NOT_A_PORT 0
+// Pin-to-port mapping as for the ATmega328P Arduino core, but as compile-time constant expressions.
+#define PB 2
+#define PC 3
+#define PD 4
+#define digitalPinToPort(p) (((p) < 8) ? PD : (((p) < 14) ? PB : PC))
+#define digitalPinToBitMask(p) ((uint8_t)_BV(((p) < 8) ? (p) : (((p) < 14) ? ((p) - 8) : ((p) - 14))))
+#define portInputRegister(port) (&_SFR_MEM8(0x23 + 3 * ((port) - PB)))
+#define portModeRegister(port) (&_SFR_MEM8(0x24 + 3 * ((port) - PB)))
+#define portOutputRegister(port) (&_SFR_MEM8(0x25 + 3 * ((port) - PB)))
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : -1))
+
+// Timing: time advances with the host clock; delay() and delayMicroseconds() advance it
+// without actually sleeping so that tests and benchmarks run at full speed.
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+// Host-specific: stop (true) or restart (false) time following the host clock,
+// so that it advances only with delay(), delayMicroseconds() and sleep,
+// eg to run a simulation deterministically whatever the host's load; resumes without a jump.
+void hostFreezeClock(bool frozen);
+// Host-specific handler called when the CPU sleeps, with the host time (micros()) at which the watchdog
+// will wake it (0 if not armed), so that a simulated device can wake it sooner with an interrupt:
+// returns true having advanced time to (and delivered) that interrupt, else false to sleep as usual;
+// NULL (the default) for none.
+typedef bool hostSleepWake_t(unsigned long long wdtUs);
+extern hostSleepWake_t *hostSleepWake;
+
+// Digital and analogue I/O: pin states are remembered (outputs read back their last written value).
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+// Host-specific handler called after each digitalWrite() with the pin and level,
+// eg so that a simulated SPI device can follow its select line; NULL (the default) for none.
+typedef void hostDigitalWrite_t(uint8_t pin, uint8_t val);
+extern hostDigitalWrite_t *hostDigitalWrite;
+int analogRead(uint8_t pin);
+void analogReference(uint8_t mode);
+void analogWrite(uint8_t pin, int val);
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode);
+void detachInterrupt(uint8_t interruptNum);
+
+// As the avr-libc non-standard itoa().
+char *itoa(int value, char *s, int radix);
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+// Host only: number of heap allocations (malloc()/new) made so far, eg for benchmarks.
+// Needs the hostalloc library linked in.
+unsigned long hostAllocations(void);
+
+#include "Print.h"
+#include "HardwareSerial.h"
+
+// Sketch entry points.
+void setup(void);
+void loop(void);
+
+#endif
@@ -0,0 +1,54 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+/*
+ Host stand-in for the Arduino hardware serial port: output goes to stdout, input is always empty.
+ */
+
+#ifndef HOST_HARDWARESERIAL_H
+#define HOST_HARDWARESERIAL_H
+
+#include "Print.h"
+
+class Stream : public Print
+    {
+    public:
+        virtual int available() = 0;
+        virtual int read() = 0;
+        virtual int peek() = 0;
+    };
+
+class HardwareSerial : public Stream
+    {
+    public:
+        void begin(unsigned long) { }
+        void begin(unsigned long, uint8_t) { }
+        void end() { }
+        virtual int available() { return(0); }
+        virtual int read() { return(-1); }
+        virtual int peek() { return(-1); }
+        virtual void flush();
+        virtual size_t write(uint8_t c);
+        virtual size_t write(const uint8_t *buffer, size_t size);
+        using Print::write;
+        operator bool() { return(true); }
+    };
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,292 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+/*
+ Host-only register-level simulation of the RFM23B (Si4431) radio,
+ so that the unmodified OTRFM23BLink driver can be run, tested and load-tested without a module.
+
+ Each HostRFM23B sits on the simulated SPI bus (via hostSPITransfer) selected by its own nSS pin
+ (followed via hostDigitalWrite), so several radios and their drivers can run in one process.
+ Whatever path the driver takes to the chip (the virtual _readReg8Bit_()/_writeReg8Bit_()/_SELECT_() hooks
+ or the inline burst and FIFO code) the simulated chip sees the same SPI transactions as the real one would.
+
+ Modelled:
+   * the register file, with the reset values that matter to the driver, and SWRES;
+   * the 64-byte TX and RX FIFOs, their almost-empty/almost-full thresholds and overflow/underflow errors,
+     and the TX FIFO being resent as-is when TX is restarted without reloading it;
+   * the interrupt status registers (cleared on read), the interrupt enables and the active-low nIRQ pin;
+   * the packet handler: preamble, sync, header and length byte and CRC airtime, fixed and variable length,
+     received header and length registers, and packet-sent/valid and CRC-error status;
+   * mode transitions between standby, TX and RX, including the automatic exit from TX on packet-sent
+     and from RX on packet-valid (unless RXMPK is set);
+   * RSSI, as the strongest signal on air at the receiver, else the last frame received, else the noise floor.
+ Not modelled: header checking, sync word matching, AFC, the wake-up timer, ADC and GPIOs;
+ frames are heard by radios with the same frequency and data rate registers and packet handler use.
+
+ A HostRFM23BEther connects its attached radios: each frame transmitted is heard by the others
+ after a configurable latency, with configurable loss, and frames overlapping at a receiver collide
+ (corrupting the one being received).
+ Frames may also be injected directly, eg at hundreds per second, to load-test a receiver's RX path.
+
+ Host time (micros()) drives the simulation, so busy-waits and delay() in the driver advance it,
+ and sleeping (eg nap()) is cut short by the first simulated interrupt, as the nIRQ line would wake the AVR.
+ Each nIRQ falling edge calls the radio's ISR, if set, as a pin-change interrupt would:
+ when interrupts are enabled, at each SPI select/deselect on the bus, at poll() and on waking from sleep;
+ optionally also asynchronously (from a timer signal) at arbitrary points in the main code,
+ to shake out races between the driver's ISR and code that shares state with it, eg RX queue consumers.
+ */
+
+#ifndef HOST_RFM23B_H
+#define HOST_RFM23B_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+#include <Arduino.h>
+
+class HostRFM23BEther;
+
+// One simulated RFM23B, on SPI with the given nSS pin and optionally driving an nIRQ pin (-1 for none).
+// Attach to a HostRFM23BEther to put it on the SPI bus and the air.
+class HostRFM23B
+    {
+    friend class HostRFM23BEther;
+
+    public:
+        static const uint8_t FIFO_BYTES = 64;
+
+        // ISR called on each nIRQ falling edge, with its context.
+        typedef void isr_t(void *context);
+
+    private:
+        const uint8_t nSSPin;
+        const int8_t nIRQPin;
+        HostRFM23BEther *ether;
+
+        // Register file; status registers hold pending (unread) interrupt status.
+        uint8_t regs[128];
+
+        // SPI transaction state.
+        bool selected;
+        bool haveAddr;
+        bool writing;
+        uint8_t addr;
+
+        // TX FIFO as written since it was last cleared; TX reads from txRd.
+        uint8_t txFIFO[FIFO_BYTES];
+        uint16_t txWr, txRd;
+        // RX FIFO ring.
+        uint8_t rxFIFO[FIFO_BYTES];
+        uint8_t rxHead, rxCount;
+
+        // Frame being transmitted: air slot (-1 if none), length and payload bytes gone so far.
+        int8_t txSlot;
+        uint8_t txLen, txDone;
+        // Frame being received: air slot (-1 if none), payload bytes received so far, and whether corrupted.
+        int8_t rxSlot;
+        uint8_t rxDone;
+        bool rxCorrupt;
+        // Host time RX was (last) entered; frames that started arriving earlier are missed.
+        unsigned long rxSinceUs;
+        // RSSI of the last frame received, until RX is re-entered; 0 if none.
+        uint8_t rxLastRSSI;
+        // Air slots already heard or missed in the current RX (by slot bit).
+        uint32_t rxConsidered;
+
+        // RSSI register value seen by receivers of this radio's frames.
+        uint8_t txRSSI;
+
+        // nIRQ level (true when asserted, ie low) and a falling edge not yet passed to the ISR.
+        bool irqAsserted;
+        bool irqPending;
+        isr_t *isr;
+        void *isrContext;
+
+        // Statistics.
+        unsigned long framesSent, framesReceived, crcErrors, fifoErrors, spiConflicts, isrCalls;
+
+        // Restore the register reset values and clear all state but attachment, ISR and statistics.
+        void _reset();
+        uint8_t _spiTransfer(uint8_t out);
+        void _writeReg(uint8_t a, uint8_t v);
+        uint8_t _readReg(uint8_t a);
+        // Start/stop TX or RX to follow the operating mode register, at host time now.
+        void _setMode(uint8_t v, unsigned long now);
+        // Latch interrupt status bits and update nIRQ.
+        void _status(uint8_t st1, uint8_t st2);
+        void _updateIRQ();
+        // Bytes ahead of the payload, and after it, with the current packet handler settings if in use.
+        uint8_t _overheadBytes(bool packet) const;
+        uint8_t _trailerBytes(bool packet) const;
+        // Microseconds per byte at the configured data rate (at least 1).
+        unsigned long _byteUs() const;
+        // True if using the packet handler for TX / RX.
+        bool _packetTX() const { return(0 != (regs[0x30] & 0x08)); }
+        bool _packetRX() const { return(0 != (regs[0x30] & 0x80)); }
+        bool _inTX() const { return(txSlot >= 0); }
+        bool _inRX() const { return((0 != (regs[7] & 0x04)) && !_inTX()); }
+        // Advance TX and RX to host time now.
+        void _advanceTX(unsigned long now);
+        void _advanceRX(unsigned long now);
+        // End the current TX/RX, if any.
+        void _endTX(bool ok);
+        void _endRX();
+        // Push one received byte into the RX FIFO; false on overflow.
+        bool _pushRX(uint8_t b);
+        // Current RSSI at host time now.
+        uint8_t _rssi(unsigned long now) const;
+
+    public:
+        HostRFM23B(uint8_t nSSPin, int8_t nIRQPin = -1);
+
+        // Set the ISR called on each nIRQ falling edge (eg calling the driver's handleInterruptSimple()); NULL for none.
+        void setISR(isr_t *f, void *context = NULL) { isr = f; isrContext = context; }
+        // Set the RSSI register value that receivers see for this radio's frames; default 0x80.
+        void setTXRSSI(const uint8_t rssi) { txRSSI = rssi; }
+
+        // Register value as the chip holds it, without side effects (eg for tests).
+        uint8_t peekReg(const uint8_t a) const { return(regs[a & 0x7f]); }
+        // True while transmitting or receiving a frame.
+        bool isTransmitting() const { return(_inTX()); }
+        bool isReceiving() const { return(rxSlot >= 0); }
+
+        // Frames fully transmitted / received with packet-valid, and received with CRC errors.
+        unsigned long getFramesSent() const { return(framesSent); }
+        unsigned long getFramesReceived() const { return(framesReceived); }
+        unsigned long getCRCErrors() const { return(crcErrors); }
+        // TX FIFO overflows/underflows and RX FIFO overflows/underflows.
+        unsigned long getFIFOErrors() const { return(fifoErrors); }
+        // Selects while already selected, ie an SPI transaction interrupted by another (eg from an ISR).
+        unsigned long getSPIConflicts() const { return(spiConflicts); }
+        // Calls made to the ISR.
+        unsigned long getISRCalls() const { return(isrCalls); }
+    };
+
+// Air shared by the attached radios, and the SPI bus they sit on.
+// Installs the host SPI, digital-write and sleep hooks while it exists (one at a time),
+// passing on SPI traffic and pin writes not for its radios to any previous hooks.
+class HostRFM23BEther
+    {
+    friend class HostRFM23B;
+
+    public:
+        static const uint8_t MAX_RADIOS = 8;
+        static const uint8_t MAX_AIR = 32;
+        // Noise floor RSSI register value.
+        static const uint8_t NOISE_RSSI = 0x28;
+
+    private:
+        // A frame on the air, from a radio or injected.
+        struct Air
+            {
+            bool used;
+            // Sending radio (NULL if injected) and the settings it was sent with.
+            const HostRFM23B *src;
+            uint8_t channel[8];
+            bool packet;
+            bool crc;
+            uint8_t header[4];
+            uint8_t overhead, trailer;
+            unsigned long byteUs;
+            unsigned long startUs;
+            // Payload length and bytes sent so far (all of them if injected).
+            uint8_t len, have;
+            // Set once transmission has ended, at endUs; corrupt if cut short.
+            bool ended;
+            bool corrupt;
+            unsigned long endUs;
+            uint8_t rssi;
+            uint8_t bytes[255];
+            };
+
+        HostRFM23B *radios[MAX_RADIOS];
+        uint8_t nRadios;
+        Air air[MAX_AIR];
+
+        unsigned long latencyUs;
+        uint16_t lossPerMille;
+        uint32_t prng;
+
+        unsigned long framesOnAir, framesLost, collisions;
+
+        // Nesting depth of simulation code, so that the async signal never interrupts it.
+        volatile int busy;
+        bool asyncIRQ;
+        timer_t asyncTimer;
+
+        // Hooks replaced, to pass on other traffic and restore afterwards.
+        hostSPITransfer_t *oldSPI;
+        hostDigitalWrite_t *oldDigitalWrite;
+        hostSleepWake_t *oldSleepWake;
+
+        HostRFM23B *_selectedRadio() const;
+        // Allocate a free air slot, or -1 if none.
+        int8_t _allocAir();
+        // Advance all radios and the air to host time now.
+        void _update(unsigned long now);
+        // Deliver pending nIRQ edges to ISRs if interrupts are enabled; true if any were delivered.
+        bool _deliver();
+        // Time of the next simulated event after now, or 0 if none.
+        unsigned long _nextEventUs(unsigned long now) const;
+        // Host time when frame a would finish being sent in full.
+        static unsigned long _airEndUs(const Air &a);
+        // True if r is tuned as frame a was sent (and did not send it).
+        static bool _onChannel(const HostRFM23B &r, const Air &a);
+        uint32_t _random();
+
+        static uint8_t _spiHook(uint8_t out);
+        static void _digitalWriteHook(uint8_t pin, uint8_t val);
+        static bool _sleepHook(unsigned long long wdtUs);
+        static void _asyncHook(int);
+
+    public:
+        HostRFM23BEther();
+        ~HostRFM23BEther();
+
+        // Put a radio on the SPI bus and the air; false if too many.
+        bool attach(HostRFM23B &r);
+
+        // Delay from a frame starting to be sent to it starting to arrive, microseconds; default 0.
+        void setLatencyUs(const unsigned long us) { latencyUs = us; }
+        // Chance in 1000 of each receiver independently missing each frame; default 0.
+        void setLossPerMille(const uint16_t perMille) { lossPerMille = perMille; }
+        // Seed for the loss pseudo-random sequence.
+        void setSeed(const uint32_t seed) { prng = (0 == seed) ? 1 : seed; }
+        // If true, also deliver interrupts from a timer signal (SIGUSR1) every ~100us of real time,
+        // ie at arbitrary points in the main code, wherever interrupts are enabled; default false.
+        // Best with the simulation following real time, ie without delay()s skipping it forward.
+        void setAsyncIRQ(bool enable);
+
+        // Put a frame on the air starting at host time atUs (or now if earlier),
+        // as sent by a radio configured as r (which does not hear it itself), with the given RSSI at receivers.
+        // Returns false if the air is full.
+        bool inject(const HostRFM23B &r, const uint8_t *buf, uint8_t len, unsigned long atUs, uint8_t rssi = 0x80);
+        // Airtime of a frame of len bytes sent as by r, microseconds.
+        static unsigned long airtimeUs(const HostRFM23B &r, uint8_t len);
+
+        // Bring the simulation up to date with host time and deliver any pending interrupts.
+        void poll();
+
+        // Frames put on the air, missed by receivers through loss, and collided at receivers.
+        unsigned long getFramesOnAir() const { return(framesOnAir); }
+        unsigned long getFramesLost() const { return(framesLost); }
+        unsigned long getCollisions() const { return(collisions); }
+    };
+
+#endif
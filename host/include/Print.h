@@ -0,0 +1,77 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+/*
+ Host stand-in for the Arduino Print class, with matching formatting.
+ */
+
+#ifndef HOST_PRINT_H
+#define HOST_PRINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <avr/pgmspace.h>
+
+// Flash strings are ordinary strings on the host.
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(PSTR(string_literal)))
+
+class Print
+    {
+    private:
+        size_t printNumber(unsigned long n, uint8_t base);
+        size_t printFloat(double number, uint8_t digits);
+
+    public:
+        Print() { }
+
+        virtual size_t write(uint8_t) = 0;
+        size_t write(const char *str) { return((NULL == str) ? 0 : write((const uint8_t *)str, strlen(str))); }
+        virtual size_t write(const uint8_t *buffer, size_t size);
+        size_t write(const char *buffer, size_t size) { return(write((const uint8_t *)buffer, size)); }
+
+        size_t print(const __FlashStringHelper *);
+        size_t print(const char[]);
+        size_t print(char);
+        size_t print(unsigned char, int = DEC_);
+        size_t print(int, int = DEC_);
+        size_t print(unsigned int, int = DEC_);
+        size_t print(long, int = DEC_);
+        size_t print(unsigned long, int = DEC_);
+        size_t print(double, int = 2);
+
+        size_t println(const __FlashStringHelper *);
+        size_t println(const char[]);
+        size_t println(char);
+        size_t println(unsigned char, int = DEC_);
+        size_t println(int, int = DEC_);
+        size_t println(unsigned int, int = DEC_);
+        size_t println(long, int = DEC_);
+        size_t println(unsigned long, int = DEC_);
+        size_t println(double, int = 2);
+        size_t println(void);
+
+        virtual void flush() { }
+
+    private:
+        static const int DEC_ = 10;
+    };
+
+#endif
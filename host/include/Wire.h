@@ -0,0 +1,49 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+/*
+ Host stand-in for the Arduino Wire (I2C/TWI) library: no devices are present,
+ so every transmission is NAKed and nothing is ever received.
+ */
+
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+class TwoWire
+    {
+    public:
+        void begin() { }
+        void end() { }
+        void setClock(uint32_t) { }
+        void beginTransmission(uint8_t) { }
+        void beginTransmission(int) { }
+        uint8_t endTransmission(bool = true) { return(2); } // Address NAKed.
+        uint8_t requestFrom(uint8_t, uint8_t, bool = true) { return(0); }
+        uint8_t requestFrom(int, int, int = 1) { return(0); }
+        size_t write(uint8_t) { return(1); }
+        size_t write(const uint8_t *, size_t n) { return(n); }
+        int available() { return(0); }
+        int read() { return(-1); }
+        int peek() { return(-1); }
+    };
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,38 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+/*
+ Host stand-in for avr-libc <avr/interrupt.h>.
+ The global interrupt enable is the I bit of the (simulated) SREG;
+ no interrupts are delivered asynchronously on the host.
+ */
+
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+#include <avr/io.h>
+
+#define sei() do { SREG |= _BV(SREG_I); } while(0)
+#define cli() do { SREG &= (uint8_t)~_BV(SREG_I); } while(0)
+
+#define ISR(vector, ...) extern "C" void vector(void); void vector(void)
+#define ISR_NOBLOCK
+#define ISR_BLOCK
+#define ISR_NAKED
+
+#endif
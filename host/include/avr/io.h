@@ -0,0 +1,509 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+/*
+ Host stand-in for avr-libc <avr/io.h>: the ATmega328P register and bit names used by the V0p2 code.
+
+ Registers live at their ATmega328P data-space addresses within hostIO[],
+ so that (as on the AVR) eg &PINB + 1 == &DDRB and &PINB + 2 == &PORTB.
+ Writes are remembered and reads return the last value written, except for:
+   * TCNT0, which follows the host clock at F_CPU/64 as with the Arduino core's timer 0 setup;
+   * TCNT2, which follows the host clock at 128Hz as the V0p2 sub-cycle timer does (32768Hz / 256 prescale);
+   * SPSR, which always reports SPIF (transfer complete),
+     and SPDR, which passes each byte written through hostSPITransfer and reads back its result;
+   * ADCSRA, which never reports a conversion in progress (ADSC reads as clear).
+ PINx registers are never driven by the host itself, so simulated devices (or tests) may set input levels there.
+ */
+
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef _BV
+#define _BV(bit) (1 << (bit))
+#endif
+#define bit_is_set(sfr, bit) ((sfr) & _BV(bit))
+#define bit_is_clear(sfr, bit) (!((sfr) & _BV(bit)))
+#define loop_until_bit_is_set(sfr, bit) do { } while(bit_is_clear(sfr, bit))
+#define loop_until_bit_is_clear(sfr, bit) do { } while(bit_is_set(sfr, bit))
+
+#define E2END 0x3FF
+#define RAMEND 0x8FF
+#define FLASHEND 0x7FFF
+
+// Register file and I/O space, ie data addresses [0,0xff] of the ATmega328P.
+extern volatile uint8_t hostIO[0x100];
+#define _SFR_MEM8(addr) (*(volatile uint8_t *)(hostIO + (addr)))
+#define _SFR_MEM16(addr) (*(volatile uint16_t *)(hostIO + (addr)))
+
+// Plain 8-bit registers.
+#define PINB _SFR_MEM8(0x23)
+#define DDRB _SFR_MEM8(0x24)
+#define PORTB _SFR_MEM8(0x25)
+#define PINC _SFR_MEM8(0x26)
+#define DDRC _SFR_MEM8(0x27)
+#define PORTC _SFR_MEM8(0x28)
+#define PIND _SFR_MEM8(0x29)
+#define DDRD _SFR_MEM8(0x2A)
+#define PORTD _SFR_MEM8(0x2B)
+#define TIFR0 _SFR_MEM8(0x35)
+#define TIFR1 _SFR_MEM8(0x36)
+#define TIFR2 _SFR_MEM8(0x37)
+#define PCIFR _SFR_MEM8(0x3B)
+#define EIFR _SFR_MEM8(0x3C)
+#define EIMSK _SFR_MEM8(0x3D)
+#define GPIOR0 _SFR_MEM8(0x3E)
+#define EECR _SFR_MEM8(0x3F)
+#define EEDR _SFR_MEM8(0x40)
+#define EEARL _SFR_MEM8(0x41)
+#define EEARH _SFR_MEM8(0x42)
+#define GTCCR _SFR_MEM8(0x43)
+#define TCCR0A _SFR_MEM8(0x44)
+#define TCCR0B _SFR_MEM8(0x45)
+#define OCR0A _SFR_MEM8(0x47)
+#define OCR0B _SFR_MEM8(0x48)
+#define GPIOR1 _SFR_MEM8(0x4A)
+#define GPIOR2 _SFR_MEM8(0x4B)
+#define SPCR _SFR_MEM8(0x4C)
+#define ACSR _SFR_MEM8(0x50)
+#define SMCR _SFR_MEM8(0x53)
+#define MCUSR _SFR_MEM8(0x54)
+#define MCUCR _SFR_MEM8(0x55)
+#define SPMCSR _SFR_MEM8(0x57)
+#define SPL _SFR_MEM8(0x5D)
+#define SPH _SFR_MEM8(0x5E)
+#define SREG _SFR_MEM8(0x5F)
+#define WDTCSR _SFR_MEM8(0x60)
+#define CLKPR _SFR_MEM8(0x61)
+#define PRR _SFR_MEM8(0x64)
+#define OSCCAL _SFR_MEM8(0x66)
+#define PCICR _SFR_MEM8(0x68)
+#define EICRA _SFR_MEM8(0x69)
+#define PCMSK0 _SFR_MEM8(0x6B)
+#define PCMSK1 _SFR_MEM8(0x6C)
+#define PCMSK2 _SFR_MEM8(0x6D)
+#define TIMSK0 _SFR_MEM8(0x6E)
+#define TIMSK1 _SFR_MEM8(0x6F)
+#define TIMSK2 _SFR_MEM8(0x70)
+#define ADCL _SFR_MEM8(0x78)
+#define ADCH _SFR_MEM8(0x79)
+#define ADCSRB _SFR_MEM8(0x7B)
+#define ADMUX _SFR_MEM8(0x7C)
+#define DIDR0 _SFR_MEM8(0x7E)
+#define DIDR1 _SFR_MEM8(0x7F)
+#define TCCR1A _SFR_MEM8(0x80)
+#define TCCR1B _SFR_MEM8(0x81)
+#define TCCR1C _SFR_MEM8(0x82)
+#define TCCR2A _SFR_MEM8(0xB0)
+#define TCCR2B _SFR_MEM8(0xB1)
+#define OCR2A _SFR_MEM8(0xB3)
+#define OCR2B _SFR_MEM8(0xB4)
+#define ASSR _SFR_MEM8(0xB6)
+#define TWBR _SFR_MEM8(0xB8)
+#define TWSR _SFR_MEM8(0xB9)
+#define TWAR _SFR_MEM8(0xBA)
+#define TWDR _SFR_MEM8(0xBB)
+#define TWCR _SFR_MEM8(0xBC)
+#define TWAMR _SFR_MEM8(0xBD)
+#define UCSR0B _SFR_MEM8(0xC1)
+#define UCSR0C _SFR_MEM8(0xC2)
+#define UBRR0L _SFR_MEM8(0xC4)
+#define UBRR0H _SFR_MEM8(0xC5)
+#define UDR0 _SFR_MEM8(0xC6)
+
+// Plain 16-bit registers (low byte first, as on the AVR and x86).
+#define EEAR _SFR_MEM16(0x41)
+#define SP _SFR_MEM16(0x5D)
+#define TCNT1 _SFR_MEM16(0x84)
+#define ICR1 _SFR_MEM16(0x86)
+#define OCR1A _SFR_MEM16(0x88)
+#define OCR1B _SFR_MEM16(0x8A)
+#define UBRR0 _SFR_MEM16(0xC4)
+#define ADC _SFR_MEM16(0x78)
+#define ADCW ADC
+
+// Host-specific SPI handler: called with each byte written to SPDR, returns the byte clocked back in.
+// Defaults to returning 0xff (MISO idle high) as with nothing attached; replace to attach a simulated device.
+typedef uint8_t hostSPITransfer_t(uint8_t out);
+extern hostSPITransfer_t *hostSPITransfer;
+
+// Register with custom behaviour on read and/or write.
+// The write hook returns the value to be stored; the read hook maps the stored value to the value read.
+class HostSpecialReg8
+    {
+    public:
+        typedef uint8_t read_t(uint8_t stored);
+        typedef uint8_t write_t(uint8_t value);
+    private:
+        uint8_t v;
+        read_t *const r;
+        write_t *const w;
+    public:
+        HostSpecialReg8(read_t *r_, write_t *w_) : v(0), r(r_), w(w_) { }
+        operator uint8_t() const volatile { return((NULL == r) ? v : r(v)); }
+        // Assignments do not yield a value, so that register writes as statements do not imply a read.
+        void operator=(const uint8_t x) volatile { v = (NULL == w) ? x : w(x); }
+        // Masks of any integer type (eg ~_BV(n), an int) act on the low 8 bits, as for a plain uint8_t register.
+        template<class T> void operator|=(const T x) volatile { *this = (uint8_t)(*this | x); }
+        template<class T> void operator&=(const T x) volatile { *this = (uint8_t)(*this & x); }
+        template<class T> void operator^=(const T x) volatile { *this = (uint8_t)(*this ^ x); }
+    };
+extern volatile HostSpecialReg8 hostTCNT0;
+extern volatile HostSpecialReg8 hostTCNT2;
+extern volatile HostSpecialReg8 hostSPSR;
+extern volatile HostSpecialReg8 hostSPDR;
+extern volatile HostSpecialReg8 hostADCSRA;
+extern volatile HostSpecialReg8 hostUCSR0A;
+// Host-specific: while true TCNT2 holds its value, as if the 32768Hz crystal had stopped; false by default.
+extern bool hostTCNT2Stopped;
+#define TCNT0 hostTCNT0
+#define TCNT2 hostTCNT2
+#define SPSR hostSPSR
+#define SPDR hostSPDR
+#define ADCSRA hostADCSRA
+#define UCSR0A hostUCSR0A
+
+// Register bit numbers.
+#define SREG_C 0
+#define SREG_Z 1
+#define SREG_N 2
+#define SREG_V 3
+#define SREG_S 4
+#define SREG_H 5
+#define SREG_T 6
+#define SREG_I 7
+#define SPIE 7
+#define SPE 6
+#define DORD 5
+#define MSTR 4
+#define CPOL 3
+#define CPHA 2
+#define SPR1 1
+#define SPR0 0
+#define SPIF 7
+#define WCOL 6
+#define SPI2X 0
+#define PRTWI 7
+#define PRTIM2 6
+#define PRTIM0 5
+#define PRTIM1 3
+#define PRSPI 2
+#define PRUSART0 1
+#define PRADC 0
+#define ADEN 7
+#define ADSC 6
+#define ADATE 5
+#define ADIF 4
+#define ADIE 3
+#define ADPS2 2
+#define ADPS1 1
+#define ADPS0 0
+#define REFS1 7
+#define REFS0 6
+#define ADLAR 5
+#define MUX3 3
+#define MUX2 2
+#define MUX1 1
+#define MUX0 0
+#define ACME 6
+#define ADTS2 2
+#define ADTS1 1
+#define ADTS0 0
+#define ADC5D 5
+#define ADC4D 4
+#define ADC3D 3
+#define ADC2D 2
+#define ADC1D 1
+#define ADC0D 0
+#define AIN1D 1
+#define AIN0D 0
+#define ACD 7
+#define ACBG 6
+#define ACO 5
+#define ACI 4
+#define ACIE 3
+#define ACIC 2
+#define ACIS1 1
+#define ACIS0 0
+#define SM2 3
+#define SM1 2
+#define SM0 1
+#define SE 0
+#define BODS 6
+#define BODSE 5
+#define PUD 4
+#define IVSEL 1
+#define IVCE 0
+#define WDRF 3
+#define BORF 2
+#define EXTRF 1
+#define PORF 0
+#define WDIF 7
+#define WDIE 6
+#define WDP3 5
+#define WDCE 4
+#define WDE 3
+#define WDP2 2
+#define WDP1 1
+#define WDP0 0
+#define EEPM1 5
+#define EEPM0 4
+#define EERIE 3
+#define EEMPE 2
+#define EEPE 1
+#define EERE 0
+#define EXCLK 6
+#define AS2 5
+#define TCN2UB 4
+#define OCR2AUB 3
+#define OCR2BUB 2
+#define TCR2AUB 1
+#define TCR2BUB 0
+#define COM2A1 7
+#define COM2A0 6
+#define COM2B1 5
+#define COM2B0 4
+#define WGM21 1
+#define WGM20 0
+#define FOC2A 7
+#define FOC2B 6
+#define WGM22 3
+#define CS22 2
+#define CS21 1
+#define CS20 0
+#define OCIE2B 2
+#define OCIE2A 1
+#define TOIE2 0
+#define OCF2B 2
+#define OCF2A 1
+#define TOV2 0
+#define COM0A1 7
+#define COM0A0 6
+#define COM0B1 5
+#define COM0B0 4
+#define WGM01 1
+#define WGM00 0
+#define FOC0A 7
+#define FOC0B 6
+#define WGM02 3
+#define CS02 2
+#define CS01 1
+#define CS00 0
+#define OCIE0B 2
+#define OCIE0A 1
+#define TOIE0 0
+#define OCF0B 2
+#define OCF0A 1
+#define TOV0 0
+#define COM1A1 7
+#define COM1A0 6
+#define COM1B1 5
+#define COM1B0 4
+#define WGM11 1
+#define WGM10 0
+#define ICNC1 7
+#define ICES1 6
+#define WGM13 4
+#define WGM12 3
+#define CS12 2
+#define CS11 1
+#define CS10 0
+#define ICIE1 5
+#define OCIE1B 2
+#define OCIE1A 1
+#define TOIE1 0
+#define ICF1 5
+#define OCF1B 2
+#define OCF1A 1
+#define TOV1 0
+#define PSRASY 1
+#define PSRSYNC 0
+#define TSM 7
+#define PCIE2 2
+#define PCIE1 1
+#define PCIE0 0
+#define PCIF2 2
+#define PCIF1 1
+#define PCIF0 0
+#define INT1 1
+#define INT0 0
+#define INTF1 1
+#define INTF0 0
+#define ISC11 3
+#define ISC10 2
+#define ISC01 1
+#define ISC00 0
+#define RXC0 7
+#define TXC0 6
+#define UDRE0 5
+#define FE0 4
+#define DOR0 3
+#define UPE0 2
+#define U2X0 1
+#define MPCM0 0
+#define RXCIE0 7
+#define TXCIE0 6
+#define UDRIE0 5
+#define RXEN0 4
+#define TXEN0 3
+#define UCSZ02 2
+#define RXB80 1
+#define TXB80 0
+#define UMSEL01 7
+#define UMSEL00 6
+#define UPM01 5
+#define UPM00 4
+#define USBS0 3
+#define UCSZ01 2
+#define UCSZ00 1
+#define UCPOL0 0
+#define TWINT 7
+#define TWEA 6
+#define TWSTA 5
+#define TWSTO 4
+#define TWWC 3
+#define TWEN 2
+#define TWIE 0
+#define CLKPCE 7
+#define CLKPS3 3
+#define CLKPS2 2
+#define CLKPS1 1
+#define CLKPS0 0
+
+// Port bit numbers.
+#define PB0 0
+#define PINB0 0
+#define DDB0 0
+#define PORTB0 0
+#define PB1 1
+#define PINB1 1
+#define DDB1 1
+#define PORTB1 1
+#define PB2 2
+#define PINB2 2
+#define DDB2 2
+#define PORTB2 2
+#define PB3 3
+#define PINB3 3
+#define DDB3 3
+#define PORTB3 3
+#define PB4 4
+#define PINB4 4
+#define DDB4 4
+#define PORTB4 4
+#define PB5 5
+#define PINB5 5
+#define DDB5 5
+#define PORTB5 5
+#define PB6 6
+#define PINB6 6
+#define DDB6 6
+#define PORTB6 6
+#define PB7 7
+#define PINB7 7
+#define DDB7 7
+#define PORTB7 7
+#define PC0 0
+#define PINC0 0
+#define DDC0 0
+#define PORTC0 0
+#define PC1 1
+#define PINC1 1
+#define DDC1 1
+#define PORTC1 1
+#define PC2 2
+#define PINC2 2
+#define DDC2 2
+#define PORTC2 2
+#define PC3 3
+#define PINC3 3
+#define DDC3 3
+#define PORTC3 3
+#define PC4 4
+#define PINC4 4
+#define DDC4 4
+#define PORTC4 4
+#define PC5 5
+#define PINC5 5
+#define DDC5 5
+#define PORTC5 5
+#define PC6 6
+#define PINC6 6
+#define DDC6 6
+#define PORTC6 6
+#define PD0 0
+#define PIND0 0
+#define DDD0 0
+#define PORTD0 0
+#define PD1 1
+#define PIND1 1
+#define DDD1 1
+#define PORTD1 1
+#define PD2 2
+#define PIND2 2
+#define DDD2 2
+#define PORTD2 2
+#define PD3 3
+#define PIND3 3
+#define DDD3 3
+#define PORTD3 3
+#define PD4 4
+#define PIND4 4
+#define DDD4 4
+#define PORTD4 4
+#define PD5 5
+#define PIND5 5
+#define DDD5 5
+#define PORTD5 5
+#define PD6 6
+#define PIND6 6
+#define DDD6 6
+#define PORTD6 6
+#define PD7 7
+#define PIND7 7
+#define DDD7 7
+#define PORTD7 7
+
+// Pin-change interrupt bit numbers.
+#define PCINT0 0
+#define PCINT1 1
+#define PCINT2 2
+#define PCINT3 3
+#define PCINT4 4
+#define PCINT5 5
+#define PCINT6 6
+#define PCINT7 7
+#define PCINT8 0
+#define PCINT9 1
+#define PCINT10 2
+#define PCINT11 3
+#define PCINT12 4
+#define PCINT13 5
+#define PCINT14 6
+#define PCINT16 0
+#define PCINT17 1
+#define PCINT18 2
+#define PCINT19 3
+#define PCINT20 4
+#define PCINT21 5
+#define PCINT22 6
+#define PCINT23 7
+
+#endif
@@ -0,0 +1,53 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+/*
+ Host stand-in for avr-libc <avr/power.h>: updates the (simulated) PRR register.
+ */
+
+#ifndef HOST_AVR_POWER_H
+#define HOST_AVR_POWER_H
+
+#include <avr/io.h>
+
+typedef enum
+    {
+    clock_div_1 = 0, clock_div_2 = 1, clock_div_4 = 2, clock_div_8 = 3, clock_div_16 = 4,
+    clock_div_32 = 5, clock_div_64 = 6, clock_div_128 = 7, clock_div_256 = 8
+    } clock_div_t;
+// Only records the prescale in CLKPR: the host clock is not slowed.
+#define clock_prescale_set(x) do { CLKPR = (uint8_t)(x); } while(0)
+#define clock_prescale_get() ((clock_div_t)(CLKPR & (uint8_t)0x0F))
+
+#define power_adc_enable() (PRR &= (uint8_t)~_BV(PRADC))
+#define power_adc_disable() (PRR |= (uint8_t)_BV(PRADC))
+#define power_spi_enable() (PRR &= (uint8_t)~_BV(PRSPI))
+#define power_spi_disable() (PRR |= (uint8_t)_BV(PRSPI))
+#define power_usart0_enable() (PRR &= (uint8_t)~_BV(PRUSART0))
+#define power_usart0_disable() (PRR |= (uint8_t)_BV(PRUSART0))
+#define power_timer0_enable() (PRR &= (uint8_t)~_BV(PRTIM0))
+#define power_timer0_disable() (PRR |= (uint8_t)_BV(PRTIM0))
+#define power_timer1_enable() (PRR &= (uint8_t)~_BV(PRTIM1))
+#define power_timer1_disable() (PRR |= (uint8_t)_BV(PRTIM1))
+#define power_timer2_enable() (PRR &= (uint8_t)~_BV(PRTIM2))
+#define power_timer2_disable() (PRR |= (uint8_t)_BV(PRTIM2))
+#define power_twi_enable() (PRR &= (uint8_t)~_BV(PRTWI))
+#define power_twi_disable() (PRR |= (uint8_t)_BV(PRTWI))
+#define power_all_enable() (PRR &= (uint8_t)~(_BV(PRADC)|_BV(PRSPI)|_BV(PRUSART0)|_BV(PRTIM0)|_BV(PRTIM1)|_BV(PRTIM2)|_BV(PRTWI)))
+#define power_all_disable() (PRR |= (uint8_t)(_BV(PRADC)|_BV(PRSPI)|_BV(PRUSART0)|_BV(PRTIM0)|_BV(PRTIM1)|_BV(PRTIM2)|_BV(PRTWI)))
+
+#endif
@@ -0,0 +1,45 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+/*
+ Host stand-in for avr-libc <avr/sleep.h>.
+ Sleeping skips (host) time forward to the next watchdog interrupt, if one is pending, and delivers it;
+ otherwise it returns at once, as a spurious early wake-up.
+ A simulated device may wake it sooner with its own interrupt (see hostSleepWake in Arduino.h).
+ */
+
+#ifndef HOST_AVR_SLEEP_H
+#define HOST_AVR_SLEEP_H
+
+#include <avr/io.h>
+
+#define SLEEP_MODE_IDLE (0)
+#define SLEEP_MODE_ADC _BV(SM0)
+#define SLEEP_MODE_PWR_DOWN _BV(SM1)
+#define SLEEP_MODE_PWR_SAVE (_BV(SM0) | _BV(SM1))
+#define SLEEP_MODE_STANDBY (_BV(SM1) | _BV(SM2))
+#define SLEEP_MODE_EXT_STANDBY (_BV(SM0) | _BV(SM1) | _BV(SM2))
+
+#define set_sleep_mode(mode) do { SMCR = (uint8_t)((SMCR & ~(_BV(SM0) | _BV(SM1) | _BV(SM2))) | (mode)); } while(0)
+#define sleep_enable() do { SMCR |= _BV(SE); } while(0)
+#define sleep_disable() do { SMCR &= (uint8_t)~_BV(SE); } while(0)
+void hostSleepCPU(void);
+#define sleep_cpu() hostSleepCPU()
+#define sleep_mode() hostSleepCPU()
+#define sleep_bod_disable() do { } while(0)
+
+#endif
@@ -0,0 +1,46 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+/*
+ Host stand-in for avr-libc <avr/wdt.h>: the watchdog is modelled with a host interval timer.
+ */
+
+#ifndef HOST_AVR_WDT_H
+#define HOST_AVR_WDT_H
+
+#include <avr/io.h>
+
+#define WDTO_15MS 0
+#define WDTO_30MS 1
+#define WDTO_60MS 2
+#define WDTO_120MS 3
+#define WDTO_250MS 4
+#define WDTO_500MS 5
+#define WDTO_1S 6
+#define WDTO_2S 7
+#define WDTO_4S 8
+#define WDTO_8S 9
+
+#define wdt_reset() do { } while(0)
+// The modelled watchdog interrupts (WDT_vect) after its nominal timeout if WDIE is set in WDTCSR,
+// either asynchronously (from a host timer signal) or at once when the CPU sleeps.
+void hostWDTEnable(uint8_t value);
+void hostWDTDisable(void);
+#define wdt_enable(value) hostWDTEnable((value))
+#define wdt_disable() hostWDTDisable()
+
+#endif
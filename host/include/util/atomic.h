@@ -0,0 +1,55 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+/*
+ Host stand-in for avr-libc <util/atomic.h>.
+ As on the AVR, ATOMIC_BLOCK() clears the I bit of SREG for the enclosed block
+ and ATOMIC_RESTORESTATE/ATOMIC_FORCEON decide how it is left afterwards.
+ It also acts as a compiler barrier; it does NOT make the block atomic between host threads.
+ */
+
+#ifndef HOST_UTIL_ATOMIC_H
+#define HOST_UTIL_ATOMIC_H
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+static __inline__ uint8_t __iSeiRetVal(void) { sei(); __asm__ volatile ("" ::: "memory"); return(1); }
+static __inline__ uint8_t __iCliRetVal(void) { cli(); __asm__ volatile ("" ::: "memory"); return(1); }
+static __inline__ void __iSeiParam(const uint8_t *__s) { sei(); __asm__ volatile ("" ::: "memory"); (void)__s; }
+static __inline__ void __iCliParam(const uint8_t *__s) { cli(); __asm__ volatile ("" ::: "memory"); (void)__s; }
+static __inline__ void __iRestore(const uint8_t *__s) { SREG = *__s; __asm__ volatile ("" ::: "memory"); }
+
+// Each block is a scope guard: type declares sreg_save, whose cleanup restores (or forces) the I bit
+// however the block is left, including by return, break or goto.
+// Unlike avr-libc's run-once for loop, this loop has no exit but through the block,
+// so that the compiler sees that a return in the block always returns (no -Wreturn-type);
+// running off the end of the block (or continue) jumps out to a label just past it.
+#define __HOST_ATOMIC_CAT2(a, b) a##b
+#define __HOST_ATOMIC_CAT(a, b) __HOST_ATOMIC_CAT2(a, b)
+#define __HOST_ATOMIC_BLOCK(type, enter, done) \
+    if(0) { done: ; } else for(type, __ToDo __attribute__((__unused__)) = enter; ; __extension__ ({ goto done; }))
+#define ATOMIC_BLOCK(type) __HOST_ATOMIC_BLOCK(type, __iCliRetVal(), __HOST_ATOMIC_CAT(__atomicBlockDone, __COUNTER__))
+#define NONATOMIC_BLOCK(type) __HOST_ATOMIC_BLOCK(type, __iSeiRetVal(), __HOST_ATOMIC_CAT(__atomicBlockDone, __COUNTER__))
+
+#define ATOMIC_RESTORESTATE uint8_t sreg_save __attribute__((__cleanup__(__iRestore))) = SREG
+#define ATOMIC_FORCEON uint8_t sreg_save __attribute__((__cleanup__(__iSeiParam))) = 0
+#define NONATOMIC_RESTORESTATE uint8_t sreg_save __attribute__((__cleanup__(__iRestore))) = SREG
+#define NONATOMIC_FORCEOFF uint8_t sreg_save __attribute__((__cleanup__(__iCliParam))) = 0
+
+#endif
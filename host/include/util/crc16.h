@@ -0,0 +1,63 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+/*
+ Host stand-in for avr-libc <util/crc16.h>, using the C equivalents given in its documentation.
+ */
+
+#ifndef HOST_UTIL_CRC16_H
+#define HOST_UTIL_CRC16_H
+
+#include <stdint.h>
+
+static __inline__ uint16_t _crc16_update(uint16_t crc, uint8_t a)
+    {
+    crc ^= a;
+    for(int i = 0; i < 8; ++i) { crc = (crc & 1) ? ((crc >> 1) ^ 0xA001) : (crc >> 1); }
+    return(crc);
+    }
+
+static __inline__ uint16_t _crc_xmodem_update(uint16_t crc, uint8_t data)
+    {
+    crc = crc ^ ((uint16_t)data << 8);
+    for(int i = 0; i < 8; ++i) { crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1); }
+    return(crc);
+    }
+
+static __inline__ uint16_t _crc_ccitt_update(uint16_t crc, uint8_t data)
+    {
+    data ^= (uint8_t)(crc & 0xff);
+    data ^= (uint8_t)(data << 4);
+    return((((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4) ^ ((uint16_t)data << 3));
+    }
+
+static __inline__ uint8_t _crc_ibutton_update(uint8_t crc, uint8_t data)
+    {
+    crc = crc ^ data;
+    for(int i = 0; i < 8; ++i) { crc = (crc & 0x01) ? ((crc >> 1) ^ 0x8C) : (crc >> 1); }
+    return(crc);
+    }
+
+static __inline__ uint8_t _crc8_ccitt_update(uint8_t crc, uint8_t data)
+    {
+    crc ^= data;
+    for(int i = 0; i < 8; ++i) { crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) : (crc << 1); }
+    return(crc);
+    }
+
+#endif
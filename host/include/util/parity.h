@@ -0,0 +1,29 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+/*
+ Host stand-in for avr-libc <util/parity.h>.
+ */
+
+#ifndef HOST_UTIL_PARITY_H
+#define HOST_UTIL_PARITY_H
+
+// Returns 1 if val has an odd number of bits set, else 0.
+#define parity_even_bit(val) ((uint8_t)__builtin_parity((uint8_t)(val)))
+
+#endif
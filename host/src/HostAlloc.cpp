@@ -0,0 +1,62 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+/*
+ Heap allocation counting for host benchmarks.
+
+ Built as its own library (hostalloc), linked only into executables that call hostAllocations(),
+ since any reference to malloc() or new would otherwise pull it in everywhere;
+ where linked it replaces the global allocators with counting wrappers.
+ malloc() and friends are only wrapped with glibc and without a sanitizer (which has its own);
+ otherwise only C++ new is counted.
+ */
+
+#include <stdlib.h>
+#include <new>
+
+#include <Arduino.h>
+
+static volatile unsigned long allocations;
+
+unsigned long hostAllocations() { return(allocations); }
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+#define HOST_ALLOC_WRAP_MALLOC
+extern "C" void *__libc_malloc(size_t);
+extern "C" void *__libc_calloc(size_t, size_t);
+extern "C" void *__libc_realloc(void *, size_t);
+extern "C" void *malloc(const size_t size) { ++allocations; return(__libc_malloc(size)); }
+extern "C" void *calloc(const size_t n, const size_t size) { ++allocations; return(__libc_calloc(n, size)); }
+extern "C" void *realloc(void *const p, const size_t size) { ++allocations; return(__libc_realloc(p, size)); }
+#endif
+
+// With malloc() wrapped new is counted through it.
+void *operator new(const size_t size)
+    {
+#ifndef HOST_ALLOC_WRAP_MALLOC
+    ++allocations;
+#endif
+    void *const p = malloc((0 == size) ? 1 : size);
+    if(NULL == p) { throw std::bad_alloc(); }
+    return(p);
+    }
+void *operator new[](const size_t size) { return(operator new(size)); }
+void operator delete(void *const p) noexcept { free(p); }
+void operator delete[](void *const p) noexcept { free(p); }
+void operator delete(void *const p, size_t) noexcept { free(p); }
+void operator delete[](void *const p, size_t) noexcept { free(p); }
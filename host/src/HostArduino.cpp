@@ -0,0 +1,309 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+
+/*
+ Host (eg Linux/x86-64) implementation of the minimal Arduino core and AVR register stand-ins.
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <avr/eeprom.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+
+// Register file and I/O space, at the ATmega328P reset values (mostly zero).
+volatile uint8_t hostIO[0x100];
+
+// Host clock origin, at the first call to millis()/micros().
+static bool clockStarted;
+static struct timespec clockStart;
+// Time added by delay() and delayMicroseconds() rather than sleeping.
+static unsigned long long skippedUs;
+// Host clock time while frozen, and total host clock time spent frozen.
+static bool clockFrozen;
+static unsigned long long frozenAtUs;
+static unsigned long long frozenUs;
+
+// Microseconds of host clock since start.
+static unsigned long long clockUs()
+    {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if(!clockStarted) { clockStart = now; clockStarted = true; }
+    const long long ns = (now.tv_sec - clockStart.tv_sec) * 1000000000LL + (now.tv_nsec - clockStart.tv_nsec);
+    return((unsigned long long)(ns / 1000));
+    }
+
+// Microseconds since start, with skipped delay time and without frozen time.
+static unsigned long long hostUs()
+    { return((clockFrozen ? frozenAtUs : clockUs()) - frozenUs + skippedUs); }
+
+void hostFreezeClock(const bool frozen)
+    {
+    if(frozen == clockFrozen) { return; }
+    if(frozen) { frozenAtUs = clockUs(); }
+    else { frozenUs += clockUs() - frozenAtUs; }
+    clockFrozen = frozen;
+    }
+
+unsigned long millis() { return((unsigned long)(hostUs() / 1000)); }
+unsigned long micros() { return((unsigned long)hostUs()); }
+void delay(const unsigned long ms) { skippedUs += (unsigned long long)ms * 1000; }
+void delayMicroseconds(const unsigned int us) { skippedUs += us; }
+
+// Watchdog: WDT_vect is called once the timeout set by wdt_enable() expires, if WDIE is then set.
+// The ISR is supplied by the library (OTV0P2BASE_Sleep) when linked in.
+extern "C" void WDT_vect(void) __attribute__((weak));
+// Host time at which the watchdog expires; valid while wdtArmed.
+static unsigned long long wdtDeadlineUs;
+static volatile sig_atomic_t wdtArmed;
+// Delivers the watchdog interrupt if armed and enabled, as the hardware clears WDIE on entry.
+// Left pending while interrupts are globally disabled.
+static void deliverWDT()
+    {
+    if(!wdtArmed || !(SREG & _BV(SREG_I))) { return; }
+    wdtArmed = 0;
+    if(!(WDTCSR & _BV(WDIE))) { return; }
+    WDTCSR &= (uint8_t)~_BV(WDIE);
+    if(NULL != WDT_vect) { WDT_vect(); }
+    }
+static void onSIGALRM(int) { deliverWDT(); }
+// Nominal timeouts are 16ms << value.
+void hostWDTEnable(const uint8_t value)
+    {
+    static bool handlerSet;
+    if(!handlerSet) { signal(SIGALRM, onSIGALRM); handlerSet = true; }
+    const unsigned long long us = 16000ULL << ((value > WDTO_8S) ? WDTO_8S : value);
+    wdtDeadlineUs = hostUs() + us;
+    wdtArmed = 1;
+    struct itimerval it = { { 0, 0 }, { (time_t)(us / 1000000), (suseconds_t)(us % 1000000) } };
+    setitimer(ITIMER_REAL, &it, NULL);
+    }
+void hostWDTDisable()
+    {
+    wdtArmed = 0;
+    struct itimerval it = { { 0, 0 }, { 0, 0 } };
+    setitimer(ITIMER_REAL, &it, NULL);
+    }
+hostSleepWake_t *hostSleepWake;
+// Sleeping skips forward to the watchdog expiry rather than waiting for it,
+// unless a simulated device interrupts first.
+void hostSleepCPU()
+    {
+    if((NULL != hostSleepWake) && hostSleepWake(wdtArmed ? wdtDeadlineUs : 0)) { return; }
+    if(!wdtArmed) { return; }
+    sigset_t alrm, old;
+    sigemptyset(&alrm);
+    sigaddset(&alrm, SIGALRM);
+    sigprocmask(SIG_BLOCK, &alrm, &old);
+    const unsigned long long now = hostUs();
+    if(wdtDeadlineUs > now) { skippedUs += wdtDeadlineUs - now; }
+    struct itimerval it = { { 0, 0 }, { 0, 0 } };
+    setitimer(ITIMER_REAL, &it, NULL);
+    deliverWDT();
+    sigprocmask(SIG_SETMASK, &old, NULL);
+    }
+
+// TCNT2 counts at 128Hz (32768Hz crystal with /256 prescale), wrapping every 2s, unless stopped; writes are ignored.
+bool hostTCNT2Stopped;
+static uint8_t readTCNT2(uint8_t)
+    {
+    static uint8_t last;
+    if(!hostTCNT2Stopped) { last = (uint8_t)((hostUs() * 128) / 1000000); }
+    return(last);
+    }
+static uint8_t writeTCNT2(uint8_t) { return(0); }
+volatile HostSpecialReg8 hostTCNT2(readTCNT2, writeTCNT2);
+
+// TCNT0 counts CPU cycles / 64, as set up by the Arduino core for millis(); writes are ignored.
+static uint8_t readTCNT0(uint8_t) { return((uint8_t)((hostUs() * (F_CPU / 1000000UL)) / 64)); }
+volatile HostSpecialReg8 hostTCNT0(readTCNT0, writeTCNT2);
+
+// Each SPI transfer completes at once.
+static uint8_t readSPSR(const uint8_t stored) { return((uint8_t)(stored | _BV(SPIF))); }
+volatile HostSpecialReg8 hostSPSR(readSPSR, NULL);
+static uint8_t idleSPITransfer(uint8_t) { return(0xff); }
+hostSPITransfer_t *hostSPITransfer = idleSPITransfer;
+static uint8_t writeSPDR(const uint8_t out) { return(hostSPITransfer(out)); }
+volatile HostSpecialReg8 hostSPDR(NULL, writeSPDR);
+
+// The USART is always idle: Serial output goes straight to stdout.
+static uint8_t readUCSR0A(const uint8_t stored) { return((uint8_t)(stored | _BV(UDRE0) | _BV(TXC0))); }
+volatile HostSpecialReg8 hostUCSR0A(readUCSR0A, NULL);
+
+// Each ADC conversion completes at once, calling ADC_vect if the ADC interrupt and global interrupts are enabled.
+// The result is mid-scale (about 3.3V supply against the bandgap) with the bottom bits noisy, as with real hardware.
+extern "C" void ADC_vect(void) __attribute__((weak));
+static uint8_t writeADCSRA(const uint8_t value)
+    {
+    if(!(value & _BV(ADSC))) { return(value); }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    ADC = (uint16_t)(0x155 ^ ((now.tv_nsec >> 4) & 3));
+    if((value & _BV(ADIE)) && (SREG & _BV(SREG_I)) && (NULL != ADC_vect)) { ADC_vect(); }
+    return((uint8_t)(value & ~_BV(ADSC)));
+    }
+volatile HostSpecialReg8 hostADCSRA(NULL, writeADCSRA);
+
+// Digital pins map onto the ATmega328P port registers as for the Arduino UNO / V0p2:
+// pins 0--7 are PORTD, 8--13 PORTB and 14--19 PORTC.
+// Inputs float high, as if pulled up, until a simulated device or test drives a PINx register.
+static struct PortInit { PortInit() { PINB = 0xff; PINC = 0x7f; PIND = 0xff; } } portInit;
+static const uint8_t maxPins = 20;
+
+void pinMode(const uint8_t pin, const uint8_t mode)
+    {
+    if(pin >= maxPins) { return; }
+    const uint8_t port = digitalPinToPort(pin);
+    const uint8_t mask = digitalPinToBitMask(pin);
+    if(OUTPUT == mode) { *portModeRegister(port) |= mask; return; }
+    *portModeRegister(port) &= (uint8_t)~mask;
+    if(INPUT_PULLUP == mode) { *portOutputRegister(port) |= mask; }
+    else { *portOutputRegister(port) &= (uint8_t)~mask; }
+    }
+hostDigitalWrite_t *hostDigitalWrite = NULL;
+void digitalWrite(const uint8_t pin, const uint8_t val)
+    {
+    if(pin >= maxPins) { return; }
+    const uint8_t port = digitalPinToPort(pin);
+    const uint8_t mask = digitalPinToBitMask(pin);
+    if(LOW != val) { *portOutputRegister(port) |= mask; }
+    else { *portOutputRegister(port) &= (uint8_t)~mask; }
+    if(NULL != hostDigitalWrite) { hostDigitalWrite(pin, val); }
+    }
+// Outputs read back their driven level; inputs read PINx.
+int digitalRead(const uint8_t pin)
+    {
+    if(pin >= maxPins) { return(LOW); }
+    const uint8_t port = digitalPinToPort(pin);
+    const uint8_t mask = digitalPinToBitMask(pin);
+    const bool isOutput = (0 != (*portModeRegister(port) & mask));
+    return((0 != ((isOutput ? *portOutputRegister(port) : *portInputRegister(port)) & mask)) ? HIGH : LOW);
+    }
+int analogRead(uint8_t) { return(0); }
+void analogReference(uint8_t) { }
+void analogWrite(const uint8_t pin, const int val) { digitalWrite(pin, (val >= 128) ? HIGH : LOW); }
+void attachInterrupt(uint8_t, void (*)(void), int) { }
+void detachInterrupt(uint8_t) { }
+
+// As the avr-libc non-standard itoa().
+char *itoa(const int value, char *const s, const int radix)
+    {
+    if((radix < 2) || (radix > 36)) { s[0] = '\0'; return(s); }
+    unsigned int v = ((value < 0) && (10 == radix)) ? -(unsigned int)value : (unsigned int)value;
+    char buf[8 * sizeof(int) + 1];
+    char *p = buf + sizeof(buf);
+    *--p = '\0';
+    do { const int d = (int)(v % radix); *--p = (char)((d < 10) ? ('0' + d) : ('a' + d - 10)); v /= radix; } while(0 != v);
+    if((value < 0) && (10 == radix)) { *--p = '-'; }
+    memmove(s, p, (size_t)(buf + sizeof(buf) - p));
+    return(s);
+    }
+
+long random(const long howbig) { return((howbig <= 0) ? 0 : (rand() % howbig)); }
+long random(const long howsmall, const long howbig) { return((howsmall >= howbig) ? howsmall : (howsmall + random(howbig - howsmall))); }
+void randomSeed(const unsigned long seed) { if(0 != seed) { srand((unsigned)seed); } }
+
+// EEPROM, erased.
+uint8_t hostEEPROM[E2END + 1];
+static struct EEPROMEraser { EEPROMEraser() { memset(hostEEPROM, 0xff, sizeof(hostEEPROM)); } } eepromEraser;
+// Maps an AVR EEPROM address to the host array, wrapping as the AVR would.
+static inline uint8_t *ee(const void *p) { return(hostEEPROM + (((uintptr_t)p) & E2END)); }
+uint8_t eeprom_read_byte(const uint8_t *const p) { return(*ee(p)); }
+uint16_t eeprom_read_word(const uint16_t *const p) { uint16_t v; eeprom_read_block(&v, p, sizeof(v)); return(v); }
+uint32_t eeprom_read_dword(const uint32_t *const p) { uint32_t v; eeprom_read_block(&v, p, sizeof(v)); return(v); }
+void eeprom_read_block(void *const dst, const void *const src, const size_t n)
+    { for(size_t i = 0; i < n; ++i) { ((uint8_t *)dst)[i] = *ee((const uint8_t *)src + i); } }
+void eeprom_write_byte(uint8_t *const p, const uint8_t value) { *ee(p) = value; }
+void eeprom_write_word(uint16_t *const p, const uint16_t value) { eeprom_write_block(&value, p, sizeof(value)); }
+void eeprom_write_dword(uint32_t *const p, const uint32_t value) { eeprom_write_block(&value, p, sizeof(value)); }
+void eeprom_write_block(const void *const src, void *const dst, const size_t n)
+    { for(size_t i = 0; i < n; ++i) { *ee((uint8_t *)dst + i) = ((const uint8_t *)src)[i]; } }
+void eeprom_update_byte(uint8_t *const p, const uint8_t value) { if(value != *ee(p)) { *ee(p) = value; } }
+void eeprom_update_word(uint16_t *const p, const uint16_t value) { eeprom_write_word(p, value); }
+void eeprom_update_block(const void *const src, void *const dst, const size_t n) { eeprom_write_block(src, dst, n); }
+
+// Print, formatting as the Arduino core.
+size_t Print::write(const uint8_t *buffer, size_t size)
+    {
+    size_t n = 0;
+    while(size--) { if(0 == write(*buffer++)) { break; } ++n; }
+    return(n);
+    }
+size_t Print::print(const __FlashStringHelper *const s) { return(write((const char *)s)); }
+size_t Print::print(const char s[]) { return(write(s)); }
+size_t Print::print(const char c) { return(write((uint8_t)c)); }
+size_t Print::print(const unsigned char b, const int base) { return(print((unsigned long)b, base)); }
+size_t Print::print(const int n, const int base) { return(print((long)n, base)); }
+size_t Print::print(const unsigned int n, const int base) { return(print((unsigned long)n, base)); }
+size_t Print::print(const long n, const int base)
+    {
+    if(0 == base) { return(write((uint8_t)n)); }
+    if((10 == base) && (n < 0)) { const size_t t = print('-'); return(printNumber(-(unsigned long)n, 10) + t); }
+    return(printNumber((unsigned long)n, (uint8_t)base));
+    }
+size_t Print::print(const unsigned long n, const int base)
+    {
+    if(0 == base) { return(write((uint8_t)n)); }
+    return(printNumber(n, (uint8_t)base));
+    }
+size_t Print::print(const double n, const int digits) { return(printFloat(n, (uint8_t)digits)); }
+size_t Print::println(void) { return(write("\r\n")); }
+size_t Print::println(const __FlashStringHelper *const s) { const size_t n = print(s); return(n + println()); }
+size_t Print::println(const char s[]) { const size_t n = print(s); return(n + println()); }
+size_t Print::println(const char c) { const size_t n = print(c); return(n + println()); }
+size_t Print::println(const unsigned char b, const int base) { const size_t n = print(b, base); return(n + println()); }
+size_t Print::println(const int v, const int base) { const size_t n = print(v, base); return(n + println()); }
+size_t Print::println(const unsigned int v, const int base) { const size_t n = print(v, base); return(n + println()); }
+size_t Print::println(const long v, const int base) { const size_t n = print(v, base); return(n + println()); }
+size_t Print::println(const unsigned long v, const int base) { const size_t n = print(v, base); return(n + println()); }
+size_t Print::println(const double v, const int digits) { const size_t n = print(v, digits); return(n + println()); }
+size_t Print::printNumber(unsigned long n, uint8_t base)
+    {
+    char buf[8 * sizeof(long) + 1];
+    char *str = &buf[sizeof(buf) - 1];
+    *str = '\0';
+    if(base < 2) { base = 10; }
+    do
+        {
+        const char c = (char)(n % base);
+        n /= base;
+        *--str = (c < 10) ? (char)(c + '0') : (char)(c + 'A' - 10);
+        } while(0 != n);
+    return(write(str));
+    }
+size_t Print::printFloat(double number, const uint8_t digits)
+    {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", (int)digits, number);
+    return(write(buf));
+    }
+
+// Serial output goes to stdout, with Arduino "\r\n" line endings left as-is.
+HardwareSerial Serial;
+size_t HardwareSerial::write(const uint8_t c) { return((EOF == putchar(c)) ? 0 : 1); }
+size_t HardwareSerial::write(const uint8_t *const buffer, const size_t size) { return(fwrite(buffer, 1, size, stdout)); }
+void HardwareSerial::flush() { fflush(stdout); }
+
+TwoWire Wire;
@@ -0,0 +1,40 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+/*
+ Host entry point for Arduino sketches: runs setup() then loop() a fixed number of times.
+ The number of loop() iterations defaults to one and may be given as the first argument.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Arduino.h>
+
+int main(const int argc, const char *const argv[])
+    {
+    // Interrupts are enabled by the Arduino core before setup() is called.
+    sei();
+    // Line-buffer output so that progress is visible even when piped, eg under ctest.
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    const long loops = (argc > 1) ? atol(argv[1]) : 1;
+    setup();
+    for(long i = 0; i < loops; ++i) { loop(); }
+    Serial.flush();
+    return(0);
+    }
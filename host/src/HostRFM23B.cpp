@@ -0,0 +1,666 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2016
+*/
+
+#include <HostRFM23B.h>
+
+#include <signal.h>
+#include <time.h>
+
+// Interrupt status register 1 and 2 bits.
+static const uint8_t IFFERR = 0x80;
+static const uint8_t ITXFFAEM = 0x20;
+static const uint8_t IRXFFAFULL = 0x10;
+static const uint8_t IPKSENT = 0x04;
+static const uint8_t IPKVALID = 0x02;
+static const uint8_t ICRCERROR = 0x01;
+static const uint8_t ISWDET = 0x80;
+static const uint8_t IPREAVAL = 0x40;
+static const uint8_t ICHIPRDY = 0x02;
+static const uint8_t IPOR = 0x01;
+
+// Registers that must match for a frame to be heard: data rate, frequency band/carrier, channel and step.
+static const uint8_t channelRegs[8] = { 0x6e, 0x6f, 0x70, 0x75, 0x76, 0x77, 0x79, 0x7a };
+
+// Register reset values (Si4431 data sheet) that matter here; all others reset to 0.
+static const uint8_t resetValues[][2] =
+    {
+    { 0x00, 0x08 }, { 0x01, 0x06 }, { 0x06, 0x03 }, { 0x07, 0x01 },
+    { 0x30, 0x8d }, { 0x32, 0x0c }, { 0x33, 0x22 }, { 0x34, 0x08 },
+    { 0x35, 0x2a }, { 0x36, 0x2d }, { 0x37, 0xd4 },
+    { 0x6e, 0x0a }, { 0x6f, 0x3d }, { 0x70, 0x0c },
+    { 0x75, 0x75 }, { 0x76, 0xbb }, { 0x77, 0x80 },
+    { 0x7c, 0x37 }, { 0x7d, 0x04 }, { 0x7e, 0x37 },
+    };
+
+// The ether whose hooks are installed, if any.
+static HostRFM23BEther *current;
+
+HostRFM23B::HostRFM23B(const uint8_t _nSSPin, const int8_t _nIRQPin)
+  : nSSPin(_nSSPin), nIRQPin(_nIRQPin), ether(NULL), txSlot(-1), rxSlot(-1), txRSSI(0x80),
+    irqAsserted(false), irqPending(false), isr(NULL), isrContext(NULL),
+    framesSent(0), framesReceived(0), crcErrors(0), fifoErrors(0), spiConflicts(0), isrCalls(0)
+    {
+    selected = false;
+    _reset();
+    }
+
+// Restore the register reset values and clear all state but attachment, ISR and statistics.
+void HostRFM23B::_reset()
+    {
+    if(_inTX()) { _endTX(false); }
+    if(rxSlot >= 0) { _endRX(); }
+    memset(regs, 0, sizeof(regs));
+    for(size_t i = 0; i < sizeof(resetValues) / sizeof(resetValues[0]); ++i) { regs[resetValues[i][0]] = resetValues[i][1]; }
+    haveAddr = false;
+    writing = false;
+    addr = 0;
+    txWr = txRd = 0;
+    rxHead = rxCount = 0;
+    txLen = txDone = 0;
+    rxDone = 0;
+    rxCorrupt = false;
+    rxSinceUs = 0;
+    rxLastRSSI = 0;
+    rxConsidered = 0;
+    // Powered up (again) and ready.
+    _status(0, IPOR | ICHIPRDY);
+    }
+
+// One byte of an SPI transaction: the first gives the address and direction, the rest data.
+// Bursts auto-increment the address, except at the FIFO.
+uint8_t HostRFM23B::_spiTransfer(const uint8_t out)
+    {
+    if(!haveAddr) { haveAddr = true; writing = (0 != (out & 0x80)); addr = out & 0x7f; return(0); }
+    const uint8_t a = addr;
+    if(addr < 0x7f) { ++addr; }
+    if(writing) { _writeReg(a, out); return(0); }
+    return(_readReg(a));
+    }
+
+void HostRFM23B::_writeReg(const uint8_t a, const uint8_t v)
+    {
+    switch(a)
+        {
+        // Read-only: device type, version, status, interrupt status, RSSI, received header and length.
+        case 0x00: case 0x01: case 0x02: case 0x03: case 0x04: case 0x26:
+        case 0x47: case 0x48: case 0x49: case 0x4a: case 0x4b:
+            return;
+        case 0x05: case 0x06: regs[a] = v; _updateIRQ(); return;
+        case 0x07:
+            if(0 != (v & 0x80)) { _reset(); return; } // SWRES.
+            _setMode(v, micros());
+            return;
+        case 0x08:
+            regs[a] = v;
+            if(0 != (v & 0x01)) { txWr = txRd = 0; } // FFCLRTX.
+            if(0 != (v & 0x02)) { rxHead = rxCount = 0; } // FFCLRRX.
+            return;
+        case 0x7f:
+            if((uint16_t)(txWr - txRd) >= FIFO_BYTES) { ++fifoErrors; _status(IFFERR, 0); return; } // TX FIFO overflow.
+            txFIFO[txWr % FIFO_BYTES] = v;
+            ++txWr;
+            return;
+        default: regs[a] = v; return;
+        }
+    }
+
+uint8_t HostRFM23B::_readReg(const uint8_t a)
+    {
+    switch(a)
+        {
+        case 0x02: // Device status: chip power state and RX FIFO empty.
+            return((uint8_t)((_inTX() ? 2 : (_inRX() ? 1 : 0)) | ((0 == rxCount) ? 0x20 : 0)));
+        case 0x03: case 0x04: // Interrupt status: cleared by reading.
+            {
+            const uint8_t v = regs[a];
+            regs[a] = 0;
+            _updateIRQ();
+            return(v);
+            }
+        case 0x26: return(_rssi(micros()));
+        case 0x7f:
+            {
+            if(0 == rxCount) { ++fifoErrors; _status(IFFERR, 0); return(0); } // RX FIFO underflow.
+            const uint8_t b = rxFIFO[rxHead];
+            rxHead = (uint8_t)((rxHead + 1) % FIFO_BYTES);
+            --rxCount;
+            return(b);
+            }
+        default: return(regs[a]);
+        }
+    }
+
+// Start/stop TX or RX to follow the operating mode register, at host time now.
+// TX takes priority over RX if both are requested.
+void HostRFM23B::_setMode(const uint8_t v, const unsigned long now)
+    {
+    const bool wasRX = _inRX();
+    const bool txOn = (0 != (v & 0x08));
+    const bool rxOn = (0 != (v & 0x04));
+    regs[7] = v;
+    if(_inTX() && !txOn) { _endTX(false); } // Abandoned part way.
+    if((rxSlot >= 0) && (txOn || !rxOn)) { _endRX(); }
+    if(txOn && !_inTX())
+        {
+        const int8_t s = ether->_allocAir();
+        if(s < 0) { regs[7] &= (uint8_t)~0x08; return; } // Cannot get on the air.
+        // With the FIFO not reloaded since the last TX, send it again.
+        if(txWr <= FIFO_BYTES) { txRd = 0; }
+        const bool packet = _packetTX();
+        HostRFM23BEther::Air &air = ether->air[s];
+        air.src = this;
+        for(uint8_t i = 0; i < sizeof(channelRegs); ++i) { air.channel[i] = regs[channelRegs[i]]; }
+        air.packet = packet;
+        air.crc = packet && (0 != (regs[0x30] & 0x04));
+        memcpy(air.header, regs + 0x3a, sizeof(air.header));
+        air.overhead = _overheadBytes(packet);
+        air.trailer = _trailerBytes(packet);
+        air.byteUs = _byteUs();
+        air.startUs = now;
+        air.len = packet ? regs[0x3e] : (uint8_t)(txWr - txRd);
+        air.have = 0;
+        air.ended = false;
+        air.corrupt = false;
+        air.rssi = txRSSI;
+        ++ether->framesOnAir;
+        txSlot = s;
+        txLen = air.len;
+        txDone = 0;
+        }
+    if(_inRX() && !wasRX)
+        {
+        // Only frames that start arriving from now on can be heard.
+        rxSinceUs = now;
+        rxConsidered = 0;
+        rxLastRSSI = 0;
+        }
+    }
+
+// Latch interrupt status bits and update nIRQ.
+void HostRFM23B::_status(const uint8_t st1, const uint8_t st2)
+    {
+    regs[3] |= st1;
+    regs[4] |= st2;
+    _updateIRQ();
+    }
+
+// nIRQ is asserted (low) while any enabled status is pending; a falling edge is passed to the ISR.
+void HostRFM23B::_updateIRQ()
+    {
+    const bool asserted = (0 != ((regs[3] & regs[5]) | (regs[4] & regs[6])));
+    if(asserted && !irqAsserted) { irqPending = true; }
+    irqAsserted = asserted;
+    if(nIRQPin < 0) { return; }
+    volatile uint8_t *const pin = portInputRegister(digitalPinToPort(nIRQPin));
+    const uint8_t mask = digitalPinToBitMask(nIRQPin);
+    if(asserted) { *pin &= (uint8_t)~mask; } else { *pin |= mask; }
+    }
+
+// Bytes ahead of the payload with the packet handler: preamble (in nibbles), sync word, header and any length byte.
+uint8_t HostRFM23B::_overheadBytes(const bool packet) const
+    {
+    if(!packet) { return(0); }
+    const uint8_t hc2 = regs[0x33];
+    return((uint8_t)(((regs[0x34] + 1) / 2) + (((hc2 >> 1) & 3) + 1) + ((hc2 >> 4) & 7) + ((hc2 & 0x08) ? 0 : 1)));
+    }
+// Bytes after the payload with the packet handler: any CRC.
+uint8_t HostRFM23B::_trailerBytes(const bool packet) const
+    { return((packet && (0 != (regs[0x30] & 0x04))) ? 2 : 0); }
+
+// Microseconds per byte: bps is txdr * 1MHz / 2^16, or / 2^21 when scaled for low rates.
+unsigned long HostRFM23B::_byteUs() const
+    {
+    const unsigned long txdr = ((unsigned long)regs[0x6e] << 8) | regs[0x6f];
+    if(0 == txdr) { return(1); }
+    const uint8_t shift = (regs[0x70] & 0x20) ? 21 : 16;
+    const unsigned long us = ((8UL << shift) + txdr / 2) / txdr;
+    return((0 == us) ? 1 : us);
+    }
+
+// Send payload bytes from the TX FIFO as their time comes, then report packet-sent.
+void HostRFM23B::_advanceTX(const unsigned long now)
+    {
+    if(!_inTX()) { return; }
+    const HostRFM23BEther::Air &air = ether->air[txSlot];
+    const unsigned long bytes = (now - air.startUs) / air.byteUs;
+    const unsigned long want = (bytes <= air.overhead) ? 0 : ((bytes - air.overhead > txLen) ? txLen : (bytes - air.overhead));
+    while(txDone < want)
+        {
+        const uint16_t queued = (uint16_t)(txWr - txRd);
+        if(0 == queued) { ++fifoErrors; _status(IFFERR, 0); _endTX(false); return; } // TX FIFO underflow.
+        ether->air[txSlot].bytes[ether->air[txSlot].have++] = txFIFO[txRd % FIFO_BYTES];
+        ++txRd;
+        ++txDone;
+        const uint8_t threshold = regs[0x7d] & 0x3f;
+        if((queued > threshold) && (queued - 1 <= threshold)) { _status(ITXFFAEM, 0); }
+        }
+    if((txDone == txLen) && (now >= HostRFM23BEther::_airEndUs(air))) { _endTX(true); }
+    }
+
+// End the current TX: on success report packet-sent, else leave the frame corrupt for its receivers.
+// Either way drop out of TX mode.
+void HostRFM23B::_endTX(const bool ok)
+    {
+    HostRFM23BEther::Air &air = ether->air[txSlot];
+    air.ended = true;
+    air.endUs = micros();
+    air.corrupt = !ok;
+    txSlot = -1;
+    regs[7] &= (uint8_t)~0x08;
+    if(ok) { ++framesSent; _status(IPKSENT, 0); }
+    }
+
+// Receive payload bytes into the RX FIFO as they arrive, then report packet-valid or CRC error.
+void HostRFM23B::_advanceRX(const unsigned long now)
+    {
+    if(rxSlot < 0) { return; }
+    const HostRFM23BEther::Air &air = ether->air[rxSlot];
+    const unsigned long arrive = air.startUs + ether->latencyUs;
+    const unsigned long bytes = (now - arrive) / air.byteUs;
+    unsigned long want = (bytes <= air.overhead) ? 0 : ((bytes - air.overhead > air.len) ? air.len : (bytes - air.overhead));
+    // Sender stopped short: the receiver gives up on the frame.
+    if(air.ended && (want > air.have)) { _endRX(); return; }
+    if(want > air.have) { want = air.have; }
+    while(rxDone < want)
+        {
+        const uint8_t b = air.bytes[rxDone++];
+        if(!_pushRX(rxCorrupt ? (uint8_t)~b : b)) { ++fifoErrors; _status(IFFERR, 0); _endRX(); return; } // RX FIFO overflow.
+        if(rxCount == (regs[0x7e] & 0x3f)) { _status(IRXFFAFULL, 0); }
+        }
+    if(!air.packet)
+        {
+        // Without the packet handler there is no end of frame: just stop filling the FIFO once the sender stops.
+        if(air.ended && (rxDone == air.have)) { rxLastRSSI = air.rssi; _endRX(); }
+        return;
+        }
+    if((rxDone < air.len) || (now < HostRFM23BEther::_airEndUs(air) + ether->latencyUs)) { return; }
+    rxLastRSSI = air.rssi;
+    const bool crc = air.crc && (0 != (regs[0x30] & 0x04));
+    if(crc && (rxCorrupt || air.corrupt)) { ++crcErrors; _endRX(); _status(ICRCERROR, 0); return; }
+    ++framesReceived;
+    _endRX();
+    // Leave RX unless receiving multiple packets.
+    if(0 == (regs[8] & 0x10)) { regs[7] &= (uint8_t)~0x04; }
+    _status(IPKVALID, 0);
+    }
+
+// Stop receiving the current frame, if any.
+void HostRFM23B::_endRX()
+    {
+    rxSlot = -1;
+    rxCorrupt = false;
+    }
+
+// Push one received byte into the RX FIFO; false on overflow.
+bool HostRFM23B::_pushRX(const uint8_t b)
+    {
+    if(rxCount >= FIFO_BYTES) { return(false); }
+    rxFIFO[(rxHead + rxCount) % FIFO_BYTES] = b;
+    ++rxCount;
+    return(true);
+    }
+
+// RSSI: the strongest frame arriving now, else the last frame received since entering RX, else the noise floor.
+uint8_t HostRFM23B::_rssi(const unsigned long now) const
+    {
+    uint8_t rssi = 0;
+    if(NULL != ether)
+        {
+        for(uint8_t i = 0; i < HostRFM23BEther::MAX_AIR; ++i)
+            {
+            const HostRFM23BEther::Air &air = ether->air[i];
+            if(!air.used || !HostRFM23BEther::_onChannel(*this, air)) { continue; }
+            const unsigned long arrive = air.startUs + ether->latencyUs;
+            if((now >= arrive) && (now < HostRFM23BEther::_airEndUs(air) + ether->latencyUs) && (air.rssi > rssi)) { rssi = air.rssi; }
+            }
+        }
+    if(0 != rssi) { return(rssi); }
+    return((0 != rxLastRSSI) ? rxLastRSSI : HostRFM23BEther::NOISE_RSSI);
+    }
+
+
+HostRFM23BEther::HostRFM23BEther()
+  : nRadios(0), latencyUs(0), lossPerMille(0), prng(1),
+    framesOnAir(0), framesLost(0), collisions(0), busy(0), asyncIRQ(false)
+    {
+    memset(air, 0, sizeof(air));
+    current = this;
+    oldSPI = hostSPITransfer;
+    hostSPITransfer = _spiHook;
+    oldDigitalWrite = hostDigitalWrite;
+    hostDigitalWrite = _digitalWriteHook;
+    oldSleepWake = hostSleepWake;
+    hostSleepWake = _sleepHook;
+    }
+
+HostRFM23BEther::~HostRFM23BEther()
+    {
+    setAsyncIRQ(false);
+    hostSPITransfer = oldSPI;
+    hostDigitalWrite = oldDigitalWrite;
+    hostSleepWake = oldSleepWake;
+    // Detach the radios, leaving their nIRQ lines floating high again.
+    for(uint8_t i = 0; i < nRadios; ++i)
+        {
+        HostRFM23B &r = *radios[i];
+        r.ether = NULL;
+        if(r.nIRQPin >= 0) { *portInputRegister(digitalPinToPort(r.nIRQPin)) |= digitalPinToBitMask(r.nIRQPin); }
+        }
+    current = NULL;
+    }
+
+// Put a radio on the SPI bus and the air; false if too many.
+bool HostRFM23BEther::attach(HostRFM23B &r)
+    {
+    if(nRadios >= MAX_RADIOS) { return(false); }
+    ++busy;
+    r.ether = this;
+    radios[nRadios++] = &r;
+    // Drive nIRQ from now on.
+    r._updateIRQ();
+    --busy;
+    return(true);
+    }
+
+// The radio selected on the bus, if any.
+HostRFM23B *HostRFM23BEther::_selectedRadio() const
+    {
+    for(uint8_t i = 0; i < nRadios; ++i) { if(radios[i]->selected) { return(radios[i]); } }
+    return(NULL);
+    }
+
+// Allocate a free air slot, or -1 if none.
+int8_t HostRFM23BEther::_allocAir()
+    {
+    for(uint8_t s = 0; s < MAX_AIR; ++s)
+        {
+        if(air[s].used) { continue; }
+        memset(&air[s], 0, sizeof(air[s]));
+        air[s].used = true;
+        for(uint8_t i = 0; i < nRadios; ++i) { radios[i]->rxConsidered &= ~(1UL << s); }
+        return((int8_t)s);
+        }
+    return(-1);
+    }
+
+// Host time when the frame would finish being sent in full.
+unsigned long HostRFM23BEther::_airEndUs(const Air &a)
+    { return(a.startUs + ((unsigned long)a.overhead + a.len + a.trailer) * a.byteUs); }
+
+// True if r is tuned as the frame was sent (and did not send it).
+bool HostRFM23BEther::_onChannel(const HostRFM23B &r, const Air &a)
+    {
+    if(a.src == &r) { return(false); }
+    for(uint8_t i = 0; i < sizeof(channelRegs); ++i) { if(r.regs[channelRegs[i]] != a.channel[i]) { return(false); } }
+    return(true);
+    }
+
+// xorshift32.
+uint32_t HostRFM23BEther::_random()
+    {
+    prng ^= prng << 13;
+    prng ^= prng >> 17;
+    prng ^= prng << 5;
+    return(prng);
+    }
+
+// Advance all radios and the air to host time now.
+// TX goes first so that the bytes each receiver needs have been sent.
+void HostRFM23BEther::_update(const unsigned long now)
+    {
+    for(uint8_t i = 0; i < nRadios; ++i) { radios[i]->_advanceTX(now); }
+    for(uint8_t i = 0; i < nRadios; ++i)
+        {
+        HostRFM23B &r = *radios[i];
+        r._advanceRX(now);
+        // Take each frame that has started to arrive since last time, in order of arrival.
+        for( ; ; )
+            {
+            int8_t next = -1;
+            for(uint8_t s = 0; s < MAX_AIR; ++s)
+                {
+                if(!air[s].used || (0 != (r.rxConsidered & (1UL << s))) || (air[s].startUs + latencyUs > now)) { continue; }
+                if((next < 0) || (air[s].startUs < air[next].startUs)) { next = (int8_t)s; }
+                }
+            if(next < 0) { break; }
+            r.rxConsidered |= (1UL << next);
+            const Air &a = air[next];
+            const unsigned long arrive = a.startUs + latencyUs;
+            // Deaf to other channels and formats, and to frames already under way when RX started.
+            if(!_onChannel(r, a) || (a.packet != r._packetRX()) || !r._inRX() || (arrive < r.rxSinceUs)) { continue; }
+            if((0 != lossPerMille) && ((_random() % 1000) < lossPerMille)) { ++framesLost; continue; }
+            if(r.rxSlot >= 0)
+                {
+                // Overlaps the frame being received: both are spoilt, and the later one is not heard.
+                ++collisions;
+                r.rxCorrupt = true;
+                continue;
+                }
+            r.rxSlot = next;
+            r.rxDone = 0;
+            // A fixed-length receiver takes its own length.
+            r.rxCorrupt = a.packet && (0 != (r.regs[0x33] & 0x08)) && (r.regs[0x3e] != a.len);
+            if(a.packet)
+                {
+                memcpy(r.regs + 0x47, a.header, sizeof(a.header));
+                r.regs[0x4b] = a.len;
+                r._status(0, ISWDET | IPREAVAL);
+                }
+            r._advanceRX(now);
+            }
+        }
+    // Free frames that have finished arriving everywhere.
+    for(uint8_t s = 0; s < MAX_AIR; ++s)
+        {
+        Air &a = air[s];
+        if(!a.used || !a.ended || (now < a.endUs + latencyUs) || (now < _airEndUs(a) + latencyUs)) { continue; }
+        bool inUse = false;
+        for(uint8_t i = 0; i < nRadios; ++i) { if((s == radios[i]->rxSlot) || (s == radios[i]->txSlot)) { inUse = true; } }
+        if(!inUse) { a.used = false; }
+        }
+    }
+
+// Deliver pending nIRQ edges to ISRs if interrupts are enabled; true if any were delivered.
+// As on the AVR, interrupts are disabled while the ISR runs.
+bool HostRFM23BEther::_deliver()
+    {
+    bool any = false;
+    for(uint8_t i = 0; i < nRadios; ++i)
+        {
+        HostRFM23B &r = *radios[i];
+        if(!(SREG & _BV(SREG_I))) { break; }
+        if(!r.irqPending || (NULL == r.isr)) { continue; }
+        r.irqPending = false;
+        const uint8_t sreg = SREG;
+        cli();
+        ++r.isrCalls;
+        r.isr(r.isrContext);
+        SREG = sreg;
+        any = true;
+        }
+    return(any);
+    }
+
+// Time of the next simulated event after now (the next byte of a frame in progress, or the start of a frame), or 0 if none.
+unsigned long HostRFM23BEther::_nextEventUs(const unsigned long now) const
+    {
+    unsigned long next = 0;
+    for(uint8_t s = 0; s < MAX_AIR; ++s)
+        {
+        const Air &a = air[s];
+        if(!a.used) { continue; }
+        const unsigned long arrive = a.startUs + latencyUs;
+        unsigned long t;
+        if(now < a.startUs) { t = a.startUs; }
+        else if(now < arrive) { t = arrive; }
+        else if(now < _airEndUs(a) + latencyUs)
+            {
+            // Next byte boundary at the sender or the receivers.
+            const unsigned long sent = a.startUs + ((now - a.startUs) / a.byteUs + 1) * a.byteUs;
+            const unsigned long received = arrive + ((now - arrive) / a.byteUs + 1) * a.byteUs;
+            t = (sent < received) ? sent : received;
+            }
+        else { continue; }
+        if((0 == next) || (t < next)) { next = t; }
+        }
+    return(next);
+    }
+
+// Bring the simulation up to date with host time and deliver any pending interrupts.
+void HostRFM23BEther::poll()
+    {
+    ++busy;
+    _update(micros());
+    _deliver();
+    --busy;
+    }
+
+// Put a frame on the air as sent by a radio configured as r.
+bool HostRFM23BEther::inject(const HostRFM23B &r, const uint8_t *const buf, const uint8_t len, const unsigned long atUs, const uint8_t rssi)
+    {
+    ++busy;
+    const int8_t s = _allocAir();
+    if(s < 0) { --busy; return(false); }
+    const unsigned long now = micros();
+    const bool packet = r._packetRX();
+    Air &a = air[s];
+    a.src = NULL;
+    for(uint8_t i = 0; i < sizeof(channelRegs); ++i) { a.channel[i] = r.regs[channelRegs[i]]; }
+    a.packet = packet;
+    a.crc = packet && (0 != (r.regs[0x30] & 0x04));
+    a.overhead = r._overheadBytes(packet);
+    a.trailer = r._trailerBytes(packet);
+    a.byteUs = r._byteUs();
+    a.startUs = (atUs > now) ? atUs : now;
+    a.len = len;
+    a.have = len;
+    memcpy(a.bytes, buf, len);
+    a.ended = true;
+    a.endUs = _airEndUs(a);
+    a.rssi = rssi;
+    ++framesOnAir;
+    --busy;
+    return(true);
+    }
+
+// Airtime of a frame of len bytes sent as by r, microseconds.
+unsigned long HostRFM23BEther::airtimeUs(const HostRFM23B &r, const uint8_t len)
+    {
+    const bool packet = r._packetTX();
+    return(((unsigned long)r._overheadBytes(packet) + len + r._trailerBytes(packet)) * r._byteUs());
+    }
+
+// SPI traffic goes to the selected radio, else on to any previous hook.
+uint8_t HostRFM23BEther::_spiHook(const uint8_t out)
+    {
+    HostRFM23BEther *const e = current;
+    HostRFM23B *const r = e->_selectedRadio();
+    if(NULL == r) { return((NULL != e->oldSPI) ? e->oldSPI(out) : 0xff); }
+    ++e->busy;
+    const uint8_t in = r->_spiTransfer(out);
+    --e->busy;
+    return(in);
+    }
+
+// Follow each radio's nSS; interrupts pending are taken before a transaction starts and after it ends.
+void HostRFM23BEther::_digitalWriteHook(const uint8_t pin, const uint8_t val)
+    {
+    HostRFM23BEther *const e = current;
+    HostRFM23B *r = NULL;
+    for(uint8_t i = 0; i < e->nRadios; ++i) { if(pin == e->radios[i]->nSSPin) { r = e->radios[i]; } }
+    if(NULL == r) { if(NULL != e->oldDigitalWrite) { e->oldDigitalWrite(pin, val); } return; }
+    ++e->busy;
+    if(LOW == val)
+        {
+        // Selecting again mid-transaction (eg from an ISR) is no new edge: the chip sees one mangled burst.
+        if(r->selected) { ++r->spiConflicts; }
+        else
+            {
+            e->_update(micros());
+            e->_deliver();
+            r->selected = true;
+            r->haveAddr = false;
+            }
+        }
+    else if(r->selected)
+        {
+        r->selected = false;
+        e->_update(micros());
+        e->_deliver();
+        }
+    --e->busy;
+    }
+
+// Step through simulated events until one interrupts (waking the CPU) or the watchdog would.
+bool HostRFM23BEther::_sleepHook(const unsigned long long wdtUs)
+    {
+    HostRFM23BEther *const e = current;
+    bool woken = false;
+    ++e->busy;
+    for(unsigned long now = micros(); ; now = micros())
+        {
+        e->_update(now);
+        if(e->_deliver()) { woken = true; break; }
+        const unsigned long next = e->_nextEventUs(now);
+        if((0 == next) || ((0 != wdtUs) && (next >= wdtUs))) { break; }
+        const unsigned long step = next - now;
+        delayMicroseconds((step > 1000000UL) ? 1000000U : (unsigned int)step);
+        }
+    --e->busy;
+    if(!woken && (NULL != e->oldSleepWake)) { return(e->oldSleepWake(wdtUs)); }
+    return(woken);
+    }
+
+// Deliver interrupts at arbitrary points in the main code, though never inside the simulation itself.
+void HostRFM23BEther::_asyncHook(int)
+    {
+    HostRFM23BEther *const e = current;
+    if((NULL == e) || (0 != e->busy) || !(SREG & _BV(SREG_I))) { return; }
+    ++e->busy;
+    e->_update(micros());
+    e->_deliver();
+    --e->busy;
+    }
+
+// Also deliver interrupts from a timer signal (SIGUSR1) every ~100us.
+// (SIGALRM is the watchdog's, and CPU-time timers only run at the kernel tick.)
+void HostRFM23BEther::setAsyncIRQ(const bool enable)
+    {
+    if(enable == asyncIRQ) { return; }
+    asyncIRQ = enable;
+    if(enable)
+        {
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = _asyncHook;
+        sa.sa_flags = SA_RESTART;
+        sigaction(SIGUSR1, &sa, NULL);
+        struct sigevent sev;
+        memset(&sev, 0, sizeof(sev));
+        sev.sigev_notify = SIGEV_SIGNAL;
+        sev.sigev_signo = SIGUSR1;
+        if(0 != timer_create(CLOCK_MONOTONIC, &sev, &asyncTimer)) { asyncIRQ = false; return; }
+        const struct itimerspec its = { { 0, 100000 }, { 0, 100000 } };
+        timer_settime(asyncTimer, 0, &its, NULL);
+        }
+    else
+        {
+        timer_delete(asyncTimer);
+        signal(SIGUSR1, SIG_DFL);
+        }
+    }
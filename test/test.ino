@@ -28,8 +28,15 @@ Author(s) / Copyright (s): Damon Hart-Davis 2015
 #include <OTV0p2Base.h>
 #include <OTRadioLink.h>
 #include <OTRFM23BLink.h>
+#include <OTSIM900Link.h>
 #include <OTRadValve.h>
 
+#if !defined(__AVR__)
+#include <pthread.h>
+#include <sched.h>
+#include <HostRFM23B.h>
+#endif
+
 
 #if F_CPU == 1000000 // 1MHz CPU indicates V0p2 board.
 #define ON_V0P2_BOARD
@@ -66,6 +73,11 @@ static void error(int err, int line)
       Serial.print(line);
       }
     Serial.println();
+#ifdef ARDUINO_ARCH_HOST
+    // No one is watching for a flashing light on the host: stop with a failure status.
+    Serial.flush();
+    exit(1);
+#endif
 //    LED_HEATCALL_ON();
 //    tinyPause();
 //    LED_HEATCALL_OFF();
@@ -126,6 +138,7 @@ class PrintToBuf : public Print
         if(count+1 < buflen) { buf[count+1] = '\0'; }
         }
       ++count;
+      return(1);
       }
     int getCount() { return(count); }
     uint8_t *const buf;
@@ -154,12 +167,402 @@ static void testNullRadio()
 	AssertIsEqual(0, radio.getRXMsgsQueued());
 	// peekRXMsg
 	length = 10;
-	AssertIsEqual(NULL, (int)radio.peekRXMsg(length));
+	AssertIsTrue(NULL == radio.peekRXMsg(length));
 	AssertIsEqual(0, length);
 	// sendRaw
 	AssertIsTrue(radio.sendRaw(buffer, sizeof(buffer)));
 }
 
+// Record of TX completion callbacks for testTXQueue().
+struct TXQueueTestLog
+  {
+  uint8_t n;
+  uint8_t ids[8];
+  bool sent[8];
+  };
+static void txQueueTestCallback(void *context, const bool sent)
+  {
+  TXQueueTestLog &log = *(TXQueueTestLog *)context;
+  if(log.n < sizeof(log.ids)) { log.sent[log.n] = sent; ++log.n; }
+  }
+// Test radio whose transmissions complete when told to.
+class TXQueueTestRadioLink : public OTRadioLink::OTNullRadioLink
+  {
+  public:
+    bool startOK; // Result for the next _TXstart().
+    uint8_t status; // Result for the next _TXpoll().
+    uint8_t starts;
+    uint8_t lastFrame0;
+    int8_t lastChannel;
+    uint8_t lastPower;
+    TXQueueTestRadioLink() : startOK(true), status(TXS_BUSY), starts(0), lastFrame0(0), lastChannel(0), lastPower(0) { }
+    static const uint8_t SENT = TXS_SENT, FAILED = TXS_FAILED, BUSY = TXS_BUSY;
+  protected:
+    virtual bool _TXstart(const uint8_t *buf, uint8_t, int8_t channel, uint8_t power)
+      { ++starts; lastFrame0 = buf[0]; lastChannel = channel; lastPower = power; return(startOK); }
+    virtual uint8_t _TXpoll() { return(status); }
+  };
+
+// Test the TX queue and asynchronous send.
+static void testTXQueue()
+  {
+  Serial.println("TXQueue");
+  uint8_t frame[8] = { 1, 2, 3 };
+  TXQueueTestLog log;
+  memset(&log, 0, sizeof(log));
+  // Without a TX queue nothing can be queued asynchronously.
+  OTRadioLink::OTNullRadioLink nr;
+  AssertIsTrue(!nr.queueToSendAsync(frame, 3));
+  AssertIsEqual(0, nr.getTXMsgsQueued());
+  AssertIsTrue(!nr.isTXQueueFull());
+  // Synchronous radio: frames are sent by poll() back-to-back.
+  OTRadioLink::TXQueueFixed<8, 2> q;
+  AssertIsEqual(2, q.getCapacity());
+  AssertIsEqual(8, q.getMaxMsgLen());
+  AssertIsTrue(nr.supportsTXQueue());
+  AssertIsTrue(nr.setTXQueue(&q));
+  AssertIsTrue(!nr.queueToSendAsync(frame, 9)); // Too long.
+  AssertIsTrue(!nr.queueToSendAsync(frame, 0)); // Too short.
+  AssertIsTrue(nr.queueToSendAsync(frame, 3, 0, OTRadioLink::OTRadioLink::TXnormal, txQueueTestCallback, &log));
+  AssertIsTrue(nr.queueToSend(frame, 3)); // Queued too, without a callback.
+  AssertIsEqual(2, nr.getTXMsgsQueued());
+  AssertIsTrue(nr.isTXQueueFull());
+  // Back-pressure.
+  AssertIsTrue(!nr.queueToSendAsync(frame, 3, 0, OTRadioLink::OTRadioLink::TXnormal, txQueueTestCallback, &log));
+  AssertIsEqual(1, nr.getTXMsgsRejectedRecent());
+  nr.poll();
+  AssertIsEqual(0, nr.getTXMsgsQueued());
+  AssertIsEqual(1, log.n);
+  AssertIsTrue(log.sent[0]);
+  nr.poll();
+  AssertIsEqual(1, log.n);
+  AssertIsTrue(nr.setTXQueue(NULL));
+
+  // Asynchronous radio.
+  TXQueueTestRadioLink r;
+  OTRadioLink::TXQueueFixed<8, 3> q3;
+  AssertIsTrue(r.setTXQueue(&q3));
+  memset(&log, 0, sizeof(log));
+  for(uint8_t i = 0; i < 3; ++i)
+    {
+    frame[0] = 10 + i;
+    AssertIsTrue(r.queueToSendAsync(frame, 1 + i, i, (OTRadioLink::OTRadioLink::TXpower)(OTRadioLink::OTRadioLink::TXquiet + i), txQueueTestCallback, &log));
+    }
+  AssertIsTrue(r.isTXQueueFull());
+  // First frame starts and stays busy.
+  r.poll();
+  r.poll();
+  AssertIsEqual(1, r.starts);
+  AssertIsEqual(10, r.lastFrame0);
+  AssertIsEqual(0, r.lastChannel);
+  AssertIsEqual(OTRadioLink::OTRadioLink::TXquiet, r.lastPower);
+  AssertIsEqual(3, r.getTXMsgsQueued());
+  AssertIsEqual(0, log.n);
+  // First completes, second starts on its own channel and power.
+  r.status = TXQueueTestRadioLink::SENT;
+  r.poll();
+  // With the status still SENT the remaining frames are also sent within the same poll().
+  AssertIsEqual(3, log.n);
+  AssertIsEqual(3, r.starts);
+  AssertIsEqual(12, r.lastFrame0);
+  AssertIsEqual(2, r.lastChannel);
+  AssertIsEqual(OTRadioLink::OTRadioLink::TXloud, r.lastPower);
+  AssertIsEqual(0, r.getTXMsgsQueued());
+  // Failures: frames that fail to start or to send are reported and dropped.
+  memset(&log, 0, sizeof(log));
+  r.startOK = false;
+  AssertIsTrue(r.queueToSendAsync(frame, 1, 0, OTRadioLink::OTRadioLink::TXnormal, txQueueTestCallback, &log));
+  r.poll();
+  AssertIsEqual(1, log.n);
+  AssertIsTrue(!log.sent[0]);
+  AssertIsEqual(0, r.getTXMsgsQueued());
+  r.startOK = true;
+  r.status = TXQueueTestRadioLink::BUSY;
+  AssertIsTrue(r.queueToSendAsync(frame, 1, 0, OTRadioLink::OTRadioLink::TXnormal, txQueueTestCallback, &log));
+  r.poll();
+  AssertIsEqual(1, log.n);
+  AssertIsEqual(1, r.getTXMsgsQueued());
+  // The queue cannot be changed while a frame from it is being sent.
+  AssertIsTrue(!r.setTXQueue(NULL));
+  r.status = TXQueueTestRadioLink::FAILED;
+  r.poll();
+  AssertIsEqual(2, log.n);
+  AssertIsTrue(!log.sent[1]);
+  AssertIsEqual(0, r.getTXMsgsQueued());
+  // Wrap around the queue a few times.
+  r.status = TXQueueTestRadioLink::SENT;
+  memset(&log, 0, sizeof(log));
+  for(uint8_t i = 0; i < 7; ++i)
+    {
+    frame[0] = i;
+    AssertIsTrue(r.queueToSendAsync(frame, 1, 0, OTRadioLink::OTRadioLink::TXnormal, txQueueTestCallback, &log));
+    if(i & 1) { r.poll(); AssertIsEqual(i, r.lastFrame0); }
+    }
+  r.poll();
+  AssertIsEqual(7, log.n);
+  AssertIsEqual(6, r.lastFrame0);
+  AssertIsTrue(r.setTXQueue(NULL));
+  // A link whose poll() does not send from a TX queue refuses one, so frames cannot be queued and never sent.
+  OTSIM900Link::OTSIM900Link gsm(16, 17, 7, 8);
+  AssertIsTrue(!gsm.supportsTXQueue());
+  AssertIsTrue(!gsm.setTXQueue(&q3));
+  AssertIsTrue(!gsm.queueToSendAsync(frame, 1));
+  AssertIsEqual(0, gsm.getTXMsgsQueued());
+  AssertIsTrue(gsm.setTXQueue(NULL));
+  }
+
+// Test TX airtime accounting against a duty-cycle limit.
+static void testTXDutyCycle()
+  {
+  Serial.println("TXDutyCycle");
+  // Airtime of frames at the standard RFM23B rates.
+  AssertIsEqual(64, OTRadioLink::TXDutyCycle::airtimeMs(40*8, 5000));
+  AssertIsEqual(9, OTRadioLink::TXDutyCycle::airtimeMs(64*8, 57600));
+  AssertIsEqual(1, OTRadioLink::TXDutyCycle::airtimeMs(1, 57600));
+  AssertIsEqual(0, OTRadioLink::TXDutyCycle::airtimeMs(8, 0));
+  // 1% of an hour on each of 2 channels.
+  const uint_least16_t day0 = OTV0P2BASE::_daysSince1999LT;
+  AssertIsTrue(OTV0P2BASE::setHoursMinutesLT(23, 25));
+  OTRadioLink::TXDutyCycleFixed<2> d;
+  AssertIsEqual(36000, d.getBudgetMs());
+  AssertIsTrue(d.allows(0, 36000));
+  AssertIsTrue(!d.allows(0, 36001));
+  d.record(0, 30000);
+  AssertIsEqual(30000, d.getAirtimeMs(0));
+  AssertIsEqual(0, d.getAirtimeMs(1));
+  AssertIsTrue(d.allows(0, 6000));
+  AssertIsTrue(!d.allows(0, 6001));
+  AssertIsTrue(d.allows(1, 36000));
+  // Untracked channels are always allowed.
+  d.record(2, 60000);
+  AssertIsTrue(d.allows(2, 60000));
+  AssertIsTrue(d.allows(-1, 60000));
+  AssertIsEqual(0, d.getAirtimeMs(2));
+  // Later buckets add up within the window, across midnight.
+  AssertIsTrue(OTV0P2BASE::setHoursMinutesLT(23, 45));
+  d.record(0, 5000);
+  AssertIsEqual(35000, d.getAirtimeMs(0));
+  AssertIsTrue(OTV0P2BASE::setHoursMinutesLT(0, 15));
+  OTV0P2BASE::_daysSince1999LT = day0 + 1; // As the RTC does at midnight.
+  d.record(0, 1000);
+  AssertIsEqual(36000, d.getAirtimeMs(0));
+  AssertIsTrue(!d.allows(0, 1));
+  // The oldest bucket leaves the window after an hour.
+  AssertIsTrue(OTV0P2BASE::setHoursMinutesLT(0, 20));
+  AssertIsEqual(6000, d.getAirtimeMs(0));
+  AssertIsTrue(d.allows(0, 30000));
+  // All gone after a quiet hour.
+  AssertIsTrue(OTV0P2BASE::setHoursMinutesLT(1, 25));
+  AssertIsEqual(0, d.getAirtimeMs(0));
+  // All gone a day or more later, even at the same time of day.
+  d.record(0, 2000);
+  OTV0P2BASE::_daysSince1999LT = day0 + 2;
+  AssertIsEqual(0, d.getAirtimeMs(0));
+  d.record(0, 3000);
+  OTV0P2BASE::_daysSince1999LT = day0 + 3;
+  AssertIsTrue(OTV0P2BASE::setHoursMinutesLT(1, 35));
+  AssertIsEqual(0, d.getAirtimeMs(0));
+  // And if the clock is set back.
+  d.record(0, 4000);
+  AssertIsTrue(OTV0P2BASE::setHoursMinutesLT(1, 15));
+  AssertIsEqual(0, d.getAirtimeMs(0));
+  OTV0P2BASE::_daysSince1999LT = day0;
+  // Saturates rather than wrapping.
+  d.record(1, 0xffff);
+  d.record(1, 2);
+  AssertIsEqual(0xffff, d.getAirtimeMs(1));
+  d.clear();
+  AssertIsEqual(0, d.getAirtimeMs(1));
+  // A tighter limit.
+  OTRadioLink::TXDutyCycleFixed<> d01(1);
+  AssertIsEqual(3600, d01.getBudgetMs());
+  }
+
+// Test radio with frames received on demand and sends recorded.
+// If pending is set, each poll() receives the next of nPending 1-byte frames.
+class RadioMuxTestLink : public OTRadioLink::OTNullRadioLink
+  {
+  public:
+    ::OTRadioLink::ISRRXQueueVarLenMsg<8, 4> q;
+    const uint8_t *pending;
+    uint8_t nPending;
+    uint8_t sent;
+    uint8_t lastSent0;
+    uint8_t lastSentLen;
+    int8_t lastChannel;
+    bool acceptTX;
+    RadioMuxTestLink() : pending(NULL), nPending(0), sent(0), lastSent0(0), lastSentLen(0), lastChannel(0), acceptTX(true) { }
+    // Receive a frame.
+    bool inject(const uint8_t *buf, const uint8_t len)
+      {
+      volatile uint8_t *const b = q._getRXBufForInbound();
+      if(NULL == b) { return(false); }
+      for(uint8_t i = 0; i < len; ++i) { b[i] = buf[i]; }
+      q._loadedBuf(len);
+      return(true);
+      }
+    virtual void getCapacity(uint8_t &queueRXMsgsMin, uint8_t &maxRXMsgLen, uint8_t &maxTXMsgLen) const
+      { q.getRXCapacity(queueRXMsgsMin, maxRXMsgLen); maxTXMsgLen = maxRXMsgLen; }
+    virtual uint8_t getRXMsgsQueued() const { return(q.getRXMsgsQueued()); }
+    virtual const volatile uint8_t *peekRXMsg(uint8_t &len) const { return(q.peekRXMsg(len)); }
+    virtual void removeRXMsg() { q.removeRXMsg(); }
+    virtual bool sendRaw(const uint8_t *buf, uint8_t buflen, int8_t channel = 0, TXpower = TXnormal, bool = false)
+      {
+      if(!acceptTX) { return(false); }
+      ++sent; lastSent0 = buf[0]; lastSentLen = buflen; lastChannel = channel;
+      return(true);
+      }
+    virtual void poll()
+      { if((nPending > 0) && inject(pending, 1)) { ++pending; --nPending; } }
+  };
+
+// Test the multiplexer over several radio links.
+static void testRadioMux()
+  {
+  Serial.println("RadioMux");
+  RadioMuxTestLink l0, l1, l2;
+  OTRadioLink::OTRadioLink *const links[] = { &l0, &l1, &l2 };
+  typedef OTRadioLink::RadioMuxFixed<6, 2> mux_t;
+  mux_t mux(links, 3);
+  AssertIsEqual(2, (int)mux_t::MinQueueCapacityMsgs);
+#if !defined(__AVR__)
+  // Not capped at 256 bytes of queue on a host.
+  AssertIsEqual(4, (int)OTRadioLink::RadioMuxFixed<64>::MinQueueCapacityMsgs);
+#endif
+  AssertIsEqual(3, mux.getLinkCount());
+  AssertIsTrue(&l1 == mux.getLink(1));
+  AssertIsTrue(NULL == mux.getLink(3));
+  uint8_t len, link;
+  AssertIsEqual(0, mux.poll());
+  AssertIsTrue(NULL == mux.peekRXMsg(len, link));
+  // Frames from several links are merged, tagged with their link.
+  const uint8_t f1[] = { 'a', 'b', 'c' };
+  const uint8_t f2[] = { 'x' };
+  AssertIsTrue(l1.inject(f1, sizeof(f1)));
+  AssertIsTrue(l2.inject(f2, sizeof(f2)));
+  AssertIsTrue(l2.inject(f1, sizeof(f1)));
+  AssertIsEqual(3, mux.poll());
+  AssertIsEqual(3, mux.getRXMsgsQueued());
+  AssertIsEqual(0, l1.getRXMsgsQueued());
+  AssertIsEqual(0, l2.getRXMsgsQueued());
+  const volatile uint8_t *b = mux.peekRXMsg(len, link);
+  AssertIsTrue(NULL != b);
+  AssertIsEqual(1, link);
+  AssertIsEqual(3, len);
+  AssertIsEqual('c', b[2]);
+  mux.removeRXMsg();
+  b = mux.peekRXMsg(len, link);
+  AssertIsEqual(2, link);
+  AssertIsEqual(1, len);
+  AssertIsEqual('x', b[0]);
+  mux.removeRXMsg();
+  mux.removeRXMsg();
+  AssertIsEqual(0, mux.getRXMsgsQueued());
+  // When the merged queue is full frames wait in their links' queues.
+  const uint8_t f5[] = { 1, 2, 3, 4, 5 };
+  uint8_t injected = 0;
+  while((injected < 8) && l0.inject(f5, sizeof(f5))) { ++injected; }
+  const uint8_t collected = mux.poll();
+  AssertIsTrue(collected < injected);
+  AssertIsEqual(collected, mux.getRXMsgsQueued());
+  AssertIsEqual(injected - collected, l0.getRXMsgsQueued());
+  while(NULL != mux.peekRXMsg(len, link)) { AssertIsEqual(0, link); mux.removeRXMsg(); }
+  const uint8_t collected2 = mux.poll();
+  AssertIsTrue(collected2 > 0);
+  AssertIsEqual(injected - collected - collected2, l0.getRXMsgsQueued());
+  do { while(NULL != mux.peekRXMsg(len, link)) { mux.removeRXMsg(); } } while(0 != mux.poll());
+  AssertIsEqual(0, l0.getRXMsgsQueued());
+  // Frames too long for the merged queue are dropped.
+  const uint8_t big[8] = { 1 };
+  AssertIsTrue(l0.inject(big, sizeof(big)));
+  AssertIsEqual(0, mux.poll());
+  AssertIsEqual(1, mux.getRXMsgsDroppedRecent());
+  AssertIsEqual(0, l0.getRXMsgsQueued());
+
+  // TX fan-out to all links by default.
+  AssertIsEqual(7, mux.routeTX(f1, sizeof(f1)));
+  AssertIsEqual(7, mux.queueToSend(f1, sizeof(f1), 1));
+  AssertIsEqual(1, l0.sent);
+  AssertIsEqual(1, l2.sent);
+  AssertIsEqual(1, l2.lastChannel);
+  // Routing by frame type: 'x' frames to link 1 only, 'a' frames to links 0 and 2, others nowhere.
+  static const OTRadioLink::RadioMuxTXRoute routes[] = { { 0, 0xff, 'x', 2 }, { 0, 0xff, 'a', 5 } };
+  mux.setTXRoutes(routes, 2, 0);
+  AssertIsEqual(2, mux.routeTX(f2, sizeof(f2)));
+  AssertIsEqual(5, mux.routeTX(f1, sizeof(f1)));
+  AssertIsEqual(0, mux.routeTX(big, sizeof(big)));
+  AssertIsEqual(2, mux.queueToSend(f2, sizeof(f2)));
+  AssertIsEqual(2, l1.sent);
+  AssertIsEqual('x', l1.lastSent0);
+  AssertIsEqual(1, l0.sent);
+  l2.acceptTX = false;
+  AssertIsEqual(1, mux.queueToSend(f1, sizeof(f1)));
+  AssertIsEqual(2, l0.sent);
+  AssertIsEqual(0, mux.queueToSend(big, sizeof(big)));
+  // Explicit fan-out ignores the routes.
+  AssertIsEqual(3, mux.sendTo(0xff, big, sizeof(big)));
+
+#if !defined(__AVR__)
+  // Each link on its own thread, feeding a shared queue.
+  RadioMuxTestLink t0, t1;
+  static const uint8_t p0[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+  static const uint8_t p1[] = { 101, 102, 103, 104, 105, 106, 107, 108, 109, 110 };
+  t0.pending = p0; t0.nPending = sizeof(p0);
+  t1.pending = p1; t1.nPending = sizeof(p1);
+  OTRadioLink::OTRadioLink *const tlinks[] = { &t0, &t1 };
+  OTRadioLink::RadioMuxThreaded tmux(tlinks, 2, 4);
+  AssertIsTrue(!tmux.isRunning());
+  static const OTRadioLink::RadioMuxTXRoute troutes[] = { { 0, 0xff, 'x', 2 } };
+  tmux.setTXRoutes(troutes, 1, 1);
+  // Queued before starting, so sent once running.
+  AssertIsEqual(2, tmux.queueToSend(f2, sizeof(f2), 3));
+  AssertIsEqual(1, tmux.queueToSend(f1, sizeof(f1)));
+  AssertIsEqual(1, tmux.getTXMsgsQueued(0));
+  AssertIsTrue(tmux.start(100));
+  AssertIsTrue(tmux.isRunning());
+  AssertIsTrue(!tmux.start());
+  // Collect all the frames, in order from each link despite the small shared queue.
+  uint8_t next0 = 1, next1 = 101;
+  for(uint32_t spins = 0; ((next0 <= 10) || (next1 <= 110)) && (spins < 100000000UL); ++spins)
+    {
+    const uint8_t *const tb = tmux.peekRXMsg(len, link);
+    if(NULL == tb) { sched_yield(); continue; }
+    AssertIsEqual(1, len);
+    if(0 == link) { AssertIsEqual(next0, tb[0]); ++next0; }
+    else { AssertIsEqual(1, link); AssertIsEqual(next1, tb[0]); ++next1; }
+    tmux.removeRXMsg();
+    }
+  AssertIsEqual(11, next0);
+  AssertIsEqual(111, next1);
+  tmux.stop();
+  AssertIsTrue(!tmux.isRunning());
+  AssertIsEqual(0, tmux.getRXMsgsQueued());
+  AssertIsEqual(0, tmux.getTXMsgsQueued(0));
+  AssertIsEqual(1, t0.sent);
+  AssertIsEqual('a', t0.lastSent0);
+  AssertIsEqual(3, t0.lastSentLen);
+  AssertIsEqual(1, t1.sent);
+  AssertIsEqual('x', t1.lastSent0);
+  AssertIsEqual(3, t1.lastChannel);
+  // Multiple producers into the shared queue.
+  OTRadioLink::RadioMuxMPSCQueue mq(3);
+  AssertIsEqual(4, mq.getCapacity());
+  AssertIsTrue(NULL == mq.peek(len, link));
+  for(uint8_t i = 0; i < 4; ++i) { AssertIsTrue(mq.enqueue(i, f1, 1 + i % 3)); }
+  AssertIsTrue(!mq.enqueue(9, f1, 1));
+  AssertIsEqual(4, mq.getMsgsQueued());
+  for(uint8_t i = 0; i < 4; ++i)
+    {
+    const uint8_t *const mb = mq.peek(len, link);
+    AssertIsTrue(NULL != mb);
+    AssertIsEqual(i, link);
+    AssertIsEqual(1 + i % 3, len);
+    mq.remove();
+    }
+  AssertIsTrue(NULL == mq.peek(len, link));
+#endif // !defined(__AVR__)
+  }
+
 // Test the frame-dump routine.
 static void testFrameDump()
   {
@@ -199,6 +602,79 @@ static void testCRC7_5B()
   AssertIsEqual(0x7b, OTRadioLink::crc7_5B_update_nz_final(0x50, 40)); 
   }
 
+// Check that the table-driven CRC 7/5B routines exactly match the bitwise reference.
+static void testCRC7_5BTables()
+  {
+  Serial.println("CRC7_5BTables");
+  // Exhaustive over all 7-bit CRC states and all input bytes.
+  for(uint8_t crc = 0; crc < 0x80; ++crc)
+    {
+    uint8_t datum = 0;
+    do
+      {
+      const uint8_t expected = OTV0P2BASE::crc7_5B_update(crc, datum);
+      AssertIsEqual(expected, OTV0P2BASE::crc7_5B_update_t256(crc, datum));
+      AssertIsEqual(expected, OTV0P2BASE::crc7_5B_update_t16(crc, datum));
+      AssertIsEqual(expected, OTV0P2BASE::crc7_5B_block(crc, &datum, 1));
+      } while(0 != ++datum);
+    }
+  // Multi-byte block must match byte-at-a-time, for all lengths including zero.
+  uint8_t buf[64];
+  for(uint8_t i = 0; i < sizeof(buf); ++i) { buf[i] = OTV0P2BASE::randRNG8(); }
+  uint8_t crc = 0x7f;
+  for(uint8_t len = 0; len <= sizeof(buf); ++len)
+    {
+    AssertIsEqual(crc, OTV0P2BASE::crc7_5B_block(0x7f, buf, len));
+    if(len < sizeof(buf)) { crc = OTV0P2BASE::crc7_5B_update(crc, buf[len]); }
+    }
+  // Example frame from the secureable frame spec: 08 4f 02 80 81 02 | 00 01 | 23
+  const uint8_t f[] = { 0x08, 0x4f, 0x02, 0x80, 0x81, 0x02, 0x00, 0x01 };
+  AssertIsEqual(0x23, OTV0P2BASE::crc7_5B_block(0x7f, f, sizeof(f)));
+  }
+
+// Check that the compile-time CRC 7/5B routines match the run-time ones.
+static void testCRC7_5BConstexpr()
+  {
+  Serial.println("CRC7_5BConstexpr");
+  // Example frame from the secureable frame spec: 08 4f 02 80 81 02 | 00 01 | 23
+  static constexpr uint8_t f[] = { 0x08, 0x4f, 0x02, 0x80, 0x81, 0x02, 0x00, 0x01 };
+  static_assert(0x23 == OTV0P2BASE::crc7_5B_block_ce(0x7f, f, sizeof(f)), "compile-time CRC7/5B mismatch");
+  // Folding a prefix at compile time and hashing the rest at run time gives the same result.
+  static const uint8_t prefixCRC = OTV0P2BASE::crc7_5B_block_ce(0x7f, f, 5);
+  AssertIsEqual(0x23, OTV0P2BASE::crc7_5B_block(prefixCRC, f + 5, sizeof(f) - 5));
+  for(uint8_t crc = 0; crc < 0x80; crc += 0x7f)
+    {
+    uint8_t datum = 0;
+    do
+      {
+      AssertIsEqual(OTV0P2BASE::crc7_5B_update(crc, datum), OTV0P2BASE::crc7_5B_update_ce(crc, datum));
+      } while(0 != ++datum);
+    }
+  const char s[] = "{\"@\":\"";
+  AssertIsEqual(OTV0P2BASE::crc7_5B_block(0x7f, (const uint8_t *)s, sizeof(s) - 1), OTV0P2BASE::crc7_5B_str_ce(0x7f, s));
+  AssertIsEqual(0x7f, OTV0P2BASE::crc7_5B_str_ce(0x7f, ""));
+  }
+
+// Check that the multi-buffer CRC 7/5B routine matches per-buffer results, for mixed lengths.
+static void testCRC7_5BMulti()
+  {
+  Serial.println("CRC7_5BMulti");
+  // Not a multiple of the side-by-side group size, so that full groups and leftover buffers are exercised.
+  static const uint8_t n = 41;
+  static uint8_t data[n][16];
+  const uint8_t *bufs[n];
+  uint8_t lens[n];
+  uint8_t crcs[n];
+  for(uint8_t i = 0; i < n; ++i)
+    {
+    for(uint8_t j = 0; j < sizeof(data[i]); ++j) { data[i][j] = OTV0P2BASE::randRNG8(); }
+    bufs[i] = data[i];
+    lens[i] = OTV0P2BASE::randRNG8() % (sizeof(data[i]) + 1); // Includes zero length.
+    }
+  OTV0P2BASE::crc7_5B_multi(0x7f, bufs, lens, n, crcs);
+  for(uint8_t i = 0; i < n; ++i) { AssertIsEqual(OTV0P2BASE::crc7_5B_block(0x7f, bufs[i], lens[i]), crcs[i]); }
+  }
+
 // Test the trim-trailing-zeros frame filter.
 static void testFrameFilterTrailingZeros()
   {
@@ -227,6 +703,472 @@ static void testFrameFilterTrailingZeros()
   AssertIsEqual(sizeof(buf), len); // Should work with max frame without trailing zeros.
   }
 
+// Count of frames seen by testFrameFilterChainCounter(), which accepts all of them.
+static uint8_t frameFilterChainCounterCalls;
+static bool testFrameFilterChainCounter(const volatile uint8_t *, volatile uint8_t &)
+  { ++frameFilterChainCounterCalls; return(true); }
+
+// Test a compile-time chain of quick RX frame filters.
+static void testFrameFilterChain()
+  {
+  Serial.println("FrameFilterChain");
+  typedef OTRadioLink::FrameFilterChain<
+    OTRadioLink::FrameFilterTrimTrailingZeros,
+    OTRadioLink::FrameFilterLength<8, 63>,
+    OTRadioLink::FrameFilterSecureableTypes<OTRadioLink::FTS_BasicSensorOrValve, OTRadioLink::FTS_ALIVE>,
+    OTRadioLink::FrameFilterIDPrefix<0x81, 0x02>,
+    OTRadioLink::FrameFilterFunction<testFrameFilterChainCounter> > Chain;
+  AssertIsEqual(5, Chain::STAGES);
+  OTRadioLink::quickFrameFilter_t *const f = Chain::filter;
+  frameFilterChainCounterCalls = 0;
+  // Secure 'O' frame with 2-byte ID 81 02 and an empty body, padded with zeros.
+  uint8_t buf[16] = { 9, 0x80 | 'O', 0x02, 0x81, 0x02, 0, 1, 2, 3, 4 };
+  uint8_t len = sizeof(buf);
+  AssertIsTrue(f(buf, len));
+  AssertIsEqual(11, len); // Trimmed to leave one trailing zero.
+  AssertIsEqual(1, frameFilterChainCounterCalls);
+  // Too short once trimmed.
+  memset(buf + 6, 0, sizeof(buf) - 6);
+  len = sizeof(buf);
+  AssertIsTrue(!f(buf, len));
+  AssertIsEqual(6, len);
+  AssertIsEqual(1, Chain::getRejectedRecent(1));
+  buf[6] = 1; buf[7] = 2; buf[8] = 3; buf[9] = 4;
+  // Type not in the whitelist.
+  buf[1] = 0x80 | 'T';
+  len = sizeof(buf);
+  AssertIsTrue(!f(buf, len));
+  AssertIsEqual(1, Chain::getRejectedRecent(2));
+  buf[1] = OTRadioLink::FTS_ALIVE; // Non-secure is fine.
+  len = sizeof(buf);
+  AssertIsTrue(f(buf, len));
+  // ID prefix mismatch, and ID too short.
+  buf[4] = 0x03;
+  len = sizeof(buf);
+  AssertIsTrue(!f(buf, len));
+  buf[4] = 0x02;
+  buf[2] = 0x11;
+  len = sizeof(buf);
+  AssertIsTrue(!f(buf, len));
+  AssertIsEqual(2, Chain::getRejectedRecent(3));
+  // Later stages are skipped after a rejection.
+  AssertIsEqual(2, frameFilterChainCounterCalls);
+  AssertIsEqual(0, Chain::getRejectedRecent(0));
+  AssertIsEqual(0, Chain::getRejectedRecent(4));
+  AssertIsEqual(0, Chain::getRejectedRecent(5)); // Out of range.
+  Chain::resetRejected();
+  AssertIsEqual(0, Chain::getRejectedRecent(3));
+  // An empty chain accepts everything.
+  len = 0;
+  AssertIsTrue(OTRadioLink::FrameFilterChain<>::filter(buf, len));
+  }
+
+// ID prefilters for testRXIDPrefilter(), with static storage to be usable as frame filters.
+typedef OTRadioLink::RXIDPrefilterBitset<> TestRXIDBitset;
+static TestRXIDBitset testRXIDBitset;
+#if !defined(__AVR__)
+static OTRadioLink::RXIDPrefilterBloom testRXIDBloom(1000);
+#endif
+
+// Test the RX ID prefilters.
+static void testRXIDPrefilter()
+  {
+  Serial.println("RXIDPrefilter");
+  // Non-secure frame with a 2-byte ID, as in testFramePrioritySecureable().
+  uint8_t frame[] = { 7, 'T', 0x02, 0x81, 0x02, 1, 0, 0x55, 0 };
+  uint8_t len = sizeof(frame);
+  static const uint8_t ids[][2] = { { 0x81, 0x02 }, { 0xa3, 0xf0 }, { 0xd1, 0xd1 } };
+  testRXIDBitset.clear();
+  AssertIsTrue(!testRXIDBitset.filterFrame(frame, len));
+  testRXIDBitset.addAll(ids[0], 3, 2);
+  for(uint8_t i = 0; i < 3; ++i) { AssertIsTrue(testRXIDBitset.mayContain(ids[i])); }
+  // Usable directly as the RX ISR filter and as a chain stage.
+  typedef OTRadioLink::FrameFilterIDPrefilter<TestRXIDBitset, &testRXIDBitset> Stage;
+  OTRadioLink::quickFrameFilter_t *const f = Stage::filter;
+  AssertIsTrue(f(frame, len));
+  typedef OTRadioLink::FrameFilterChain<OTRadioLink::FrameFilterTrimTrailingZeros, Stage> Chain;
+  AssertIsTrue(Chain::filter(frame, len));
+  OTRadioLink::OTNullRadioLink nrl;
+  nrl.setFilterRXISR(f);
+  // No ID, or too short an ID, is rejected.
+  frame[2] = 0x01;
+  AssertIsTrue(!f(frame, len));
+  frame[2] = 0x02;
+  len = 4;
+  AssertIsTrue(!f(frame, len));
+  // Few false positives for a few IDs.
+  uint16_t falsePositives = 0;
+  for(uint16_t i = 0; i < 1000; ++i)
+    {
+    uint8_t id[2] = { (uint8_t)(0x80 | OTV0P2BASE::randRNG8()), OTV0P2BASE::randRNG8() };
+    if((0 == memcmp(id, ids[0], 2)) || (0 == memcmp(id, ids[1], 2)) || (0 == memcmp(id, ids[2], 2))) { continue; }
+    if(testRXIDBitset.mayContain(id)) { ++falsePositives; }
+    }
+  AssertIsTrueWithErr(falsePositives < 50, falsePositives);
+#if !defined(__AVR__)
+  // Hub: many 4-byte ID prefixes from 8-byte IDs.
+  AssertIsEqual(4, testRXIDBloom.getKeyBytes());
+  AssertIsTrue(testRXIDBloom.getBits() >= 16000);
+  static uint8_t hubIDs[1000][8];
+  for(uint16_t i = 0; i < 1000; ++i) { for(uint8_t j = 0; j < 8; ++j) { hubIDs[i][j] = OTV0P2BASE::randRNG8(); } }
+  testRXIDBloom.clear();
+  testRXIDBloom.addAll(hubIDs[0], 1000, 8);
+  for(uint16_t i = 0; i < 1000; ++i) { AssertIsTrue(testRXIDBloom.mayContain(hubIDs[i])); }
+  falsePositives = 0;
+  for(uint16_t i = 0; i < 10000; ++i)
+    {
+    uint8_t id[4] = { OTV0P2BASE::randRNG8(), OTV0P2BASE::randRNG8(), OTV0P2BASE::randRNG8(), OTV0P2BASE::randRNG8() };
+    if(testRXIDBloom.mayContain(id)) { ++falsePositives; }
+    }
+  AssertIsTrueWithErr(falsePositives < 100, falsePositives);
+  // Frame with the 4-byte ID prefix of the first hub ID.
+  uint8_t hubFrame[] = { 9, 0x80 | 'O', 0x04, 0, 0, 0, 0, 0, 0x55, 0 };
+  memcpy(hubFrame + 3, hubIDs[0], 4);
+  len = sizeof(hubFrame);
+  typedef OTRadioLink::FrameFilterIDPrefilter<OTRadioLink::RXIDPrefilterBloom, &testRXIDBloom> HubStage;
+  AssertIsTrue(HubStage::filter(hubFrame, len));
+  hubFrame[2] = 0x02;
+  AssertIsTrue(!testRXIDBloom.filterFrame(hubFrame, len));
+#endif
+  }
+
+// Test the quick secureable-frame classifier for priority RX queues.
+static void testFramePrioritySecureable()
+  {
+  Serial.println("FramePrioritySecureable");
+  // fl, fType, seq/il, 2-byte ID, bl, 1-byte body, 1-byte trailer, plus a trailing (eg CRC) byte.
+  uint8_t buf[] = { 7, 'T', 0x02, 0x81, 0x02, 1, 0, 0x55, 0 };
+  AssertIsEqual(OTRadioLink::FPS_NONSECURE, OTRadioLink::framePrioritySecureable(buf, sizeof(buf)));
+  buf[1] = 0x80 | 'T';
+  AssertIsEqual(OTRadioLink::FPS_SECURE, OTRadioLink::framePrioritySecureable(buf, sizeof(buf)));
+  buf[1] = 0x80 | OTRadioLink::FTS_BasicSensorOrValve;
+  AssertIsEqual(OTRadioLink::FPS_SECURE_VALVE, OTRadioLink::framePrioritySecureable(buf, sizeof(buf)));
+  // Insecure valve frames are not special.
+  buf[1] = OTRadioLink::FTS_BasicSensorOrValve;
+  AssertIsEqual(OTRadioLink::FPS_NONSECURE, OTRadioLink::framePrioritySecureable(buf, sizeof(buf)));
+  // Implausible headers.
+  AssertIsEqual(OTRadioLink::FPS_OTHER, OTRadioLink::framePrioritySecureable(buf, 3)); // Too short.
+  AssertIsEqual(OTRadioLink::FPS_OTHER, OTRadioLink::framePrioritySecureable(buf, 7)); // fl beyond buffer.
+  buf[2] = 0x04; // ID too long for the frame.
+  AssertIsEqual(OTRadioLink::FPS_OTHER, OTRadioLink::framePrioritySecureable(buf, sizeof(buf)));
+  buf[2] = 0x02;
+  buf[1] = 0xff;
+  AssertIsEqual(OTRadioLink::FPS_OTHER, OTRadioLink::framePrioritySecureable(buf, sizeof(buf)));
+  buf[1] = 0x80;
+  AssertIsEqual(OTRadioLink::FPS_OTHER, OTRadioLink::framePrioritySecureable(buf, sizeof(buf)));
+  // FS20-style OOK frame starting with 0xcc.
+  static const uint8_t fs20[] = { 0xcc, 0xcc, 0xcc, 0xcc, 0x38, 0xe3, 0x8e };
+  AssertIsEqual(OTRadioLink::FPS_OTHER, OTRadioLink::framePrioritySecureable(fs20, sizeof(fs20)));
+  }
+
+// Check replay filtering of secure frame message counters.
+static void testReplayFilter()
+  {
+  Serial.println("ReplayFilter");
+  // Trailer of spec example 3: counters 00 00 2a 00 03 19, then the tag.
+  static const uint8_t trailer[] = { 0x00, 0x00, 0x2a, 0x00, 0x03, 0x19, 0x97, 0x5b };
+  const uint64_t c0 = OTRadioLink::getSecureFrameMessageCounter(trailer);
+  AssertIsTrue(0x2a000319ULL == c0);
+  static const uint8_t id1[] = { 0xaa, 0xaa, 0xaa, 0xaa };
+  static const uint8_t id2[] = { 0x80, 0x81, 0x82, 0x83 };
+  static const uint8_t id3[] = { 0x01, 0x02, 0x03, 0x04 };
+  OTRadioLink::ReplayFilterFixed<2> f;
+  AssertIsEqual(0, f.size());
+  AssertIsTrue(!f.accept(NULL, c0));
+  AssertIsTrue(f.check(id1, c0));
+  AssertIsTrue(f.acceptTrailer(id1, trailer));
+  // Replays are rejected, by this or any other route.
+  AssertIsTrue(!f.check(id1, c0));
+  AssertIsTrue(!f.acceptTrailer(id1, trailer));
+  AssertIsTrue(!f.accept(id1, c0));
+  // Counters are per sender.
+  AssertIsTrue(f.accept(id2, c0));
+  AssertIsEqual(2, f.size());
+  // Table full, so new senders are rejected.
+  AssertIsTrue(!f.check(id3, 1));
+  AssertIsTrue(!f.accept(id3, 1));
+  // Frames reordered within the (16-frame) window are accepted once each.
+  AssertIsTrue(f.accept(id1, c0 + 3));
+  AssertIsTrue(f.accept(id1, c0 + 1));
+  AssertIsTrue(!f.accept(id1, c0 + 1));
+  AssertIsTrue(f.accept(id1, c0 + 2));
+  AssertIsTrue(!f.accept(id1, c0 + 3));
+  AssertIsTrue(f.accept(id1, c0 + 20));
+  AssertIsTrue(f.accept(id1, c0 + 5));
+  AssertIsTrue(!f.accept(id1, c0 + 5));
+  // Older than the window is rejected even if not seen.
+  AssertIsTrue(!f.accept(id1, c0 + 4));
+  // A large jump forward (eg after a sender restart) clears the window.
+  AssertIsTrue(f.accept(id1, c0 + 1000000));
+  AssertIsTrue(!f.accept(id1, c0 + 20));
+  AssertIsTrue(f.accept(id1, c0 + 999999));
+  f.clear();
+  AssertIsEqual(0, f.size());
+  AssertIsTrue(f.accept(id3, 1));
+#if !defined(__AVR__)
+  // Many senders at a hub, with the table growing from small.
+  OTRadioLink::ReplayFilterHub h(4);
+  static const uint16_t n = 20000;
+  for(uint8_t pass = 0; pass < 2; ++pass)
+    {
+    for(uint16_t i = 0; i < n; ++i)
+      {
+      const uint8_t id[8] = { (uint8_t)(i >> 8), (uint8_t)i, 1, 2, 3, 4, 5, 6 };
+      // First pass accepts; the second sees only replays.
+      AssertIsTrue((0 == pass) == h.accept(id, 1000 + (i & 63)));
+      }
+    }
+  AssertIsEqual(n, h.size());
+  const uint8_t id[8] = { 0, 7, 1, 2, 3, 4, 5, 6 };
+  AssertIsTrue(h.check(id, 1000 + 7 + 1));
+  AssertIsTrue(h.accept(id, 1000 + 7 + 64));
+  AssertIsTrue(h.accept(id, 1000 + 7 + 1)); // Still within the 64-frame window.
+  AssertIsTrue(!h.accept(id, 1000 + 7 + 64));
+  h.clear();
+  AssertIsEqual(0, h.size());
+  AssertIsTrue(h.accept(id, 1000 + 7));
+#endif // !defined(__AVR__)
+  }
+
+#if !defined(__AVR__)
+// Check the hub AES-128-GCM against NIST GCMVS and secure frame spec examples,
+// with and without AES-NI/PCLMULQDQ.
+static void testAESGCMHub()
+  {
+  Serial.println("AESGCMHub");
+  //Key = 298efa1ccf29cf62ae6824bfc19557fc
+  //IV = 6f58a93fe1d207fae4ed2f6d
+  //PT = cc38bccd6bc536ad919b1395f5d63801f99f8068d65ca5ac63872daf16b93901
+  //AAD = 021fafd238463973ffe80256e5b1c6b1
+  //CT = dfce4e9cd291103d7fe4e63351d9e79d3dfd391e3267104658212da96521b7db
+  //Tag = 542465ef599316f73a7a560509a2d9f2
+  static const uint8_t key[16] = { 0x29, 0x8e, 0xfa, 0x1c, 0xcf, 0x29, 0xcf, 0x62, 0xae, 0x68, 0x24, 0xbf, 0xc1, 0x95, 0x57, 0xfc };
+  static const uint8_t nonce[12] = { 0x6f, 0x58, 0xa9, 0x3f, 0xe1, 0xd2, 0x07, 0xfa, 0xe4, 0xed, 0x2f, 0x6d };
+  static const uint8_t aad[16] = { 0x02, 0x1f, 0xaf, 0xd2, 0x38, 0x46, 0x39, 0x73, 0xff, 0xe8, 0x02, 0x56, 0xe5, 0xb1, 0xc6, 0xb1 };
+  static const uint8_t input[32] = { 0xcc, 0x38, 0xbc, 0xcd, 0x6b, 0xc5, 0x36, 0xad, 0x91, 0x9b, 0x13, 0x95, 0xf5, 0xd6, 0x38, 0x01, 0xf9, 0x9f, 0x80, 0x68, 0xd6, 0x5c, 0xa5, 0xac, 0x63, 0x87, 0x2d, 0xaf, 0x16, 0xb9, 0x39, 0x01 };
+  static const uint8_t ct[32] = { 0xdf, 0xce, 0x4e, 0x9c, 0xd2, 0x91, 0x10, 0x3d, 0x7f, 0xe4, 0xe6, 0x33, 0x51, 0xd9, 0xe7, 0x9d, 0x3d, 0xfd, 0x39, 0x1e, 0x32, 0x67, 0x10, 0x46, 0x58, 0x21, 0x2d, 0xa9, 0x65, 0x21, 0xb7, 0xdb };
+  static const uint8_t tag[16] = { 0x54, 0x24, 0x65, 0xef, 0x59, 0x93, 0x16, 0xf7, 0x3a, 0x7a, 0x56, 0x05, 0x09, 0xa2, 0xd9, 0xf2 };
+  // PT and CT empty.
+  //Key = 77be63708971c4e240d1cb79e8d77feb
+  //IV = e0e00f19fed7ba0136a797f3
+  //AAD = 7a43ec1d9c0a5a78a0b16533a6213cab
+  //Tag = 209fcc8d3675ed938e9c7166709dd946
+  static const uint8_t key0[16] = { 0x77, 0xbe, 0x63, 0x70, 0x89, 0x71, 0xc4, 0xe2, 0x40, 0xd1, 0xcb, 0x79, 0xe8, 0xd7, 0x7f, 0xeb };
+  static const uint8_t nonce0[12] = { 0xe0, 0xe0, 0x0f, 0x19, 0xfe, 0xd7, 0xba, 0x01, 0x36, 0xa7, 0x97, 0xf3 };
+  static const uint8_t aad0[16] = { 0x7a, 0x43, 0xec, 0x1d, 0x9c, 0x0a, 0x5a, 0x78, 0xa0, 0xb1, 0x65, 0x33, 0xa6, 0x21, 0x3c, 0xab };
+  static const uint8_t tag0[16] = { 0x20, 0x9f, 0xcc, 0x8d, 0x36, 0x75, 0xed, 0x93, 0x8e, 0x9c, 0x71, 0x66, 0x70, 0x9d, 0xd9, 0x46 };
+  static const uint8_t zeroKey[16] = { };
+  // Secure frame spec example 3: 'O' frame {"b":1} with zero key and ID aa aa aa aa 55 55.
+  static const uint8_t id[] = { 0xaa, 0xaa, 0xaa, 0xaa, 0x55, 0x55 };
+  static const uint8_t iv[] = { 0xaa, 0xaa, 0xaa, 0xaa, 0x55, 0x55, 0x00, 0x00, 0x2a, 0x00, 0x03, 0x19 };
+  static const uint8_t body[] = { 0x7f, 0x11, 0x7b, 0x22, 0x62, 0x22, 0x3a, 0x31 };
+  for(uint8_t hw = 0; hw < 2; ++hw)
+    {
+    OTRadioLink::setAESGCMHardwareAllowed(0 != hw);
+    uint8_t co[32], to[16], po[32];
+    AssertIsTrue(!OTRadioLink::fixed32BTextSize12BNonce16BTagSimpleEnc_HUB(NULL, NULL, NULL, NULL, 0, NULL, NULL, NULL));
+    AssertIsTrue(OTRadioLink::fixed32BTextSize12BNonce16BTagSimpleEnc_HUB(NULL, key, nonce, aad, sizeof(aad), input, co, to));
+    AssertIsEqual(0, memcmp(ct, co, sizeof(ct)));
+    AssertIsEqual(0, memcmp(tag, to, sizeof(tag)));
+    AssertIsTrue(!OTRadioLink::fixed32BTextSize12BNonce16BTagSimpleDec_HUB(NULL, NULL, NULL, NULL, 0, NULL, NULL, NULL));
+    // Decrypt with a pre-expanded key.
+    OTRadioLink::AESGCMKeyContext k;
+    AssertIsTrue(k.init(key));
+    AssertIsTrue(OTRadioLink::fixed32BTextSize12BNonce16BTagSimpleDec_HUB(&k, NULL, nonce, aad, sizeof(aad), ct, tag, po));
+    AssertIsEqual(0, memcmp(input, po, sizeof(input)));
+    // Any change to the authenticated data should be rejected.
+    uint8_t badAAD[sizeof(aad)];
+    memcpy(badAAD, aad, sizeof(aad));
+    badAAD[OTV0P2BASE::randRNG8() % sizeof(aad)] ^= 1 << (OTV0P2BASE::randRNG8() & 7);
+    AssertIsTrue(!OTRadioLink::fixed32BTextSize12BNonce16BTagSimpleDec_HUB(&k, NULL, nonce, badAAD, sizeof(badAAD), ct, tag, po));
+    // An empty text authenticates the authtext alone.
+    AssertIsTrue(OTRadioLink::fixed32BTextSize12BNonce16BTagSimpleEnc_HUB(NULL, key0, nonce0, aad0, sizeof(aad0), NULL, NULL, to));
+    AssertIsEqual(0, memcmp(tag0, to, sizeof(tag0)));
+    AssertIsTrue(OTRadioLink::fixed32BTextSize12BNonce16BTagSimpleDec_HUB(NULL, key0, nonce0, aad0, sizeof(aad0), NULL, tag0, NULL));
+    AssertIsTrue(!OTRadioLink::fixed32BTextSize12BNonce16BTagSimpleDec_HUB(NULL, key0, nonce0, aad0, sizeof(aad0) - 1, NULL, tag0, NULL));
+    uint8_t buf[OTRadioLink::SecurableFrameHeader::maxSmallFrameSize];
+    const uint8_t encodedLength = OTRadioLink::encodeSecureSmallFrameRaw(buf, sizeof(buf),
+                                      OTRadioLink::FTS_BasicSensorOrValve, 0, id, 4, body, sizeof(body), iv,
+                                      OTRadioLink::fixed32BTextSize12BNonce16BTagSimpleEnc_HUB, NULL, zeroKey);
+    AssertIsEqual(63, encodedLength);
+    AssertIsEqual(0xb3, buf[8]); // 1st byte of encrypted body.
+    AssertIsEqual(0x75, buf[39]); // 32nd/last byte of encrypted body.
+    AssertIsEqual(0x97, buf[46]); // 1st byte of tag.
+    AssertIsEqual(0x8d, buf[61]); // 16th/last byte of tag.
+    OTRadioLink::SecurableFrameHeader sfh;
+    AssertIsTrue(0 != sfh.checkAndDecodeSmallFrameHeader(buf, encodedLength));
+    uint8_t decodedBodyOutSize;
+    uint8_t decryptedBodyOut[OTRadioLink::ENC_BODY_SMALL_FIXED_PTEXT_MAX_SIZE];
+    AssertIsTrue(0 != OTRadioLink::decodeSecureSmallFrameRaw(&sfh, buf, encodedLength,
+                                      OTRadioLink::fixed32BTextSize12BNonce16BTagSimpleDec_HUB, NULL, zeroKey, iv,
+                                      decryptedBodyOut, sizeof(decryptedBodyOut), decodedBodyOutSize));
+    AssertIsEqual(sizeof(body), decodedBodyOutSize);
+    AssertIsEqual(0, memcmp(body, decryptedBodyOut, sizeof(body)));
+    // A frame with no body (bl 0) is still authenticated, by its header.
+    const uint8_t emptyLength = OTRadioLink::encodeSecureSmallFrameRaw(buf, sizeof(buf),
+                                    OTRadioLink::FTS_BasicSensorOrValve, 0, id, 4, NULL, 0, iv,
+                                    OTRadioLink::fixed32BTextSize12BNonce16BTagSimpleEnc_HUB, NULL, zeroKey);
+    AssertIsEqual(31, emptyLength);
+    AssertIsTrue(0 != sfh.checkAndDecodeSmallFrameHeader(buf, emptyLength));
+    AssertIsEqual(0, sfh.bl);
+    decodedBodyOutSize = 0xff;
+    AssertIsEqual(emptyLength, OTRadioLink::decodeSecureSmallFrameRaw(&sfh, buf, emptyLength,
+                                      OTRadioLink::fixed32BTextSize12BNonce16BTagSimpleDec_HUB, NULL, zeroKey, iv,
+                                      decryptedBodyOut, sizeof(decryptedBodyOut), decodedBodyOutSize));
+    AssertIsEqual(0, decodedBodyOutSize);
+    buf[1] ^= 1;
+    AssertIsEqual(0, OTRadioLink::decodeSecureSmallFrameRaw(&sfh, buf, emptyLength,
+                                      OTRadioLink::fixed32BTextSize12BNonce16BTagSimpleDec_HUB, NULL, zeroKey, iv,
+                                      decryptedBodyOut, sizeof(decryptedBodyOut), decodedBodyOutSize));
+    }
+  OTRadioLink::setAESGCMHardwareAllowed(true);
+  }
+
+// Check the LRU cache of expanded keys by node ID.
+static void testAESGCMKeyCache()
+  {
+  Serial.println("AESGCMKeyCache");
+  static const uint8_t zeroKey[16] = { };
+  uint8_t key2[16];
+  for(uint8_t i = 0; i < sizeof(key2); ++i) { key2[i] = OTV0P2BASE::randRNG8(); }
+  const uint8_t ids[][8] = { { 1 }, { 2 }, { 3 }, { 4 }, { 1, 2 } };
+  OTRadioLink::AESGCMKeyCache cache(3);
+  AssertIsEqual(3, cache.getCapacity());
+  AssertIsTrue(NULL == cache.get(NULL, 1, zeroKey));
+  AssertIsTrue(NULL == cache.get(ids[0], 0, zeroKey));
+  AssertIsTrue(NULL == cache.get(ids[0], 9, zeroKey));
+  AssertIsTrue(NULL == cache.get(ids[0], 1, NULL));
+  // Misses expand the key; hits do not.
+  const OTRadioLink::AESGCMKeyContext *const k1 = cache.get(ids[0], 1, zeroKey);
+  AssertIsTrue(NULL != k1);
+  AssertIsEqual(1, cache.getExpansions());
+  AssertIsTrue(k1 == cache.get(ids[0], 1, zeroKey));
+  AssertIsEqual(1, cache.getExpansions());
+  // IDs differing only in length are distinct.
+  AssertIsTrue(NULL != cache.get(ids[0], 2, zeroKey));
+  AssertIsEqual(2, cache.getExpansions());
+  AssertIsTrue(NULL != cache.get(ids[1], 1, key2));
+  AssertIsEqual(3, cache.size());
+  // ids[0] is most recently used but one, so a fourth node evicts the 2-byte { 1, 0 }.
+  AssertIsTrue(k1 == cache.get(ids[0], 1, zeroKey));
+  AssertIsTrue(NULL != cache.get(ids[2], 1, zeroKey));
+  AssertIsEqual(3, cache.size());
+  AssertIsEqual(4, cache.getExpansions());
+  AssertIsTrue(NULL != cache.get(ids[0], 1, zeroKey));
+  AssertIsTrue(NULL != cache.get(ids[1], 1, key2));
+  AssertIsEqual(4, cache.getExpansions());
+  AssertIsTrue(NULL != cache.get(ids[0], 2, zeroKey));
+  AssertIsEqual(5, cache.getExpansions());
+  // A changed key for a cached node is expanded again.
+  AssertIsTrue(NULL != cache.get(ids[1], 1, zeroKey));
+  AssertIsEqual(6, cache.getExpansions());
+  // Removal.
+  AssertIsTrue(cache.remove(ids[0], 2));
+  AssertIsTrue(!cache.remove(ids[0], 2));
+  AssertIsEqual(2, cache.size());
+  AssertIsTrue(NULL != cache.get(ids[1], 1, zeroKey));
+  AssertIsEqual(6, cache.getExpansions());
+  cache.clear();
+  AssertIsEqual(0, cache.size());
+  // Many nodes through a small cache, checking that cached contexts decrypt correctly.
+  OTRadioLink::AESGCMKeyCache small(7);
+  static const uint8_t nonce[12] = { 'q', 'u', 'i', 'c', 'k', ' ', 6, 5, 4, 3, 2, 1 };
+  static const uint8_t plaintext[32] = { 'a', 'b', 'c', 'd' };
+  for(uint16_t i = 0; i < 200; ++i)
+    {
+    uint8_t id[2] = { (uint8_t)(OTV0P2BASE::randRNG8() % 10), 0x55 };
+    uint8_t key[16];
+    memcpy(key, zeroKey, sizeof(key));
+    key[0] = id[0];
+    const OTRadioLink::AESGCMKeyContext *const k = small.get(id, sizeof(id), key);
+    AssertIsTrue(NULL != k);
+    AssertIsTrue(small.size() <= 7);
+    if(0 == (OTV0P2BASE::randRNG8() & 15)) { small.remove(id, sizeof(id)); continue; }
+    uint8_t co[32], to[16], po[32];
+    AssertIsTrue(OTRadioLink::fixed32BTextSize12BNonce16BTagSimpleEnc_HUB(NULL, key, nonce, id, sizeof(id), plaintext, co, to));
+    AssertIsTrue(OTRadioLink::fixed32BTextSize12BNonce16BTagSimpleDec_HUB((void *)k, key, nonce, id, sizeof(id), co, to, po));
+    AssertIsEqual(0, memcmp(plaintext, po, sizeof(po)));
+    }
+  }
+
+// Check batched decoding of secure frames with several keys, some frames damaged,
+// on one and several threads, with and without AES-NI/PCLMULQDQ, and with a key cache too small for all keys.
+static void testSecureSmallFramesBatch()
+  {
+  Serial.println("SecureSmallFramesBatch");
+  static const uint16_t n = 300;
+  static const uint8_t nKeys = 5;
+  static uint8_t keys[nKeys][16];
+  static uint8_t ivs[n][12];
+  static uint8_t bufs[n][OTRadioLink::SecurableFrameHeader::maxSmallFrameSize + 1];
+  static uint8_t bodies[n][OTRadioLink::ENC_BODY_SMALL_FIXED_PTEXT_MAX_SIZE];
+  static uint8_t bodyLens[n];
+  static bool damaged[n];
+  static uint8_t out[n][OTRadioLink::ENC_BODY_SMALL_FIXED_PTEXT_MAX_SIZE];
+  static OTRadioLink::SecureSmallFrameBatchItem items[n];
+  static bool pass[n];
+  for(uint8_t i = 0; i < nKeys; ++i) { for(uint8_t j = 0; j < 16; ++j) { keys[i][j] = OTV0P2BASE::randRNG8(); } }
+  uint16_t expected = 0;
+  for(uint16_t i = 0; i < n; ++i)
+    {
+    const uint8_t *const key = keys[OTV0P2BASE::randRNG8() % nKeys];
+    for(uint8_t j = 0; j < 12; ++j) { ivs[i][j] = OTV0P2BASE::randRNG8(); }
+    // Some frames have no body at all (bl 0).
+    bodyLens[i] = OTV0P2BASE::randRNG8() % (OTRadioLink::ENC_BODY_SMALL_FIXED_PTEXT_MAX_SIZE + 1);
+    for(uint8_t j = 0; j < bodyLens[i]; ++j) { bodies[i][j] = OTV0P2BASE::randRNG8(); }
+    const uint8_t il = 1 + (OTV0P2BASE::randRNG8() % 5); // Longest ID that fits in a small frame.
+    const uint8_t len = OTRadioLink::encodeSecureSmallFrameRaw(bufs[i], sizeof(bufs[i]),
+                           OTRadioLink::FTS_BasicSensorOrValve, i, ivs[i], il, (0 == bodyLens[i]) ? NULL : bodies[i], bodyLens[i], ivs[i],
+                           OTRadioLink::fixed32BTextSize12BNonce16BTagSimpleEnc_HUB, NULL, key);
+    AssertIsTrue(0 != len);
+    // Damage one in four frames, anywhere.
+    damaged[i] = (0 == (OTV0P2BASE::randRNG8() & 3));
+    if(damaged[i]) { bufs[i][OTV0P2BASE::randRNG8() % len] ^= 1 << (OTV0P2BASE::randRNG8() & 7); }
+    else { ++expected; }
+    items[i].buf = bufs[i];
+    items[i].buflen = len;
+    items[i].key = key;
+    items[i].iv = ivs[i];
+    items[i].decryptedBodyOut = out[i];
+    items[i].decryptedBodyOutBuflen = sizeof(out[i]);
+    }
+  OTRadioLink::AESGCMKeyCache cache(nKeys - 2);
+  for(uint8_t run = 0; run < 6; ++run)
+    {
+    OTRadioLink::setAESGCMHardwareAllowed(0 != (run & 1));
+    memset(pass, 0, sizeof(pass));
+    const size_t passed = OTRadioLink::decodeSecureSmallFramesBatch(items, n, pass, (run < 2) ? 1 : 4,
+                                                                    (run < 4) ? NULL : &cache);
+    // A damaged frame may occasionally still decode, eg if only the sequence number was hit.
+    AssertIsTrue(passed >= expected);
+    size_t passCount = 0;
+    for(uint16_t i = 0; i < n; ++i)
+      {
+      if(pass[i]) { ++passCount; }
+      if(damaged[i]) { continue; }
+      AssertIsTrue(pass[i]);
+      AssertIsEqual(bodyLens[i], items[i].decodedBodyOutSize);
+      AssertIsEqual(0, memcmp(bodies[i], out[i], bodyLens[i]));
+      }
+    AssertIsEqual(passed, passCount);
+    }
+  OTRadioLink::setAESGCMHardwareAllowed(true);
+  // One node ID under two keys in a batch (eg across a key change) must not share a cached context.
+  for(uint8_t i = 0; i < 2; ++i)
+    {
+    const uint8_t len = OTRadioLink::encodeSecureSmallFrameRaw(bufs[i], sizeof(bufs[i]),
+                           OTRadioLink::FTS_BasicSensorOrValve, i, ivs[0], 4, bodies[i], 1, ivs[i],
+                           OTRadioLink::fixed32BTextSize12BNonce16BTagSimpleEnc_HUB, NULL, keys[i]);
+    AssertIsTrue(0 != len);
+    items[i].buflen = len;
+    items[i].key = keys[i];
+    items[i].iv = ivs[i];
+    }
+  AssertIsEqual(2, OTRadioLink::decodeSecureSmallFramesBatch(items, 2, pass, 1, &cache));
+  AssertIsTrue(pass[0] && pass[1]);
+  }
+#endif // !defined(__AVR__)
+
 // Do some basic exercise of the RFM23B class, eg that it compiles.
 static void testRFM23B()
   {
@@ -234,12 +1176,499 @@ static void testRFM23B()
   OTRFM23BLink::OTRFM23BLink<OTV0P2BASE::V0p2_PIN_SPI_nSS> l0;
   OTRFM23BLink::OTRFM23BLink<OTV0P2BASE::V0p2_PIN_SPI_nSS, -1> l1;
   OTRFM23BLink::OTRFM23BLink<OTV0P2BASE::V0p2_PIN_SPI_nSS, 9> l2;
+  // With an RX queue that drops low-priority frames first.
+  OTRFM23BLink::OTRFM23BLink<OTV0P2BASE::V0p2_PIN_SPI_nSS, -1, 3, uint8_t, false, OTRadioLink::FPS_CLASSES> l5;
+  l5.setPriorityRXISR(OTRadioLink::framePrioritySecureable);
+  AssertIsEqual(0, l5.getRXMsgsEvictedRecent(OTRadioLink::FPS_OTHER));
+#if !defined(__AVR__)
+  // Hub with a deep RX queue.
+  OTRFM23BLink::OTRFM23BLink<OTV0P2BASE::V0p2_PIN_SPI_nSS, -1, 32, uint16_t> l3;
+  // With RX metadata.
+  OTRFM23BLink::OTRFM23BLink<OTV0P2BASE::V0p2_PIN_SPI_nSS, -1, 32, uint16_t, true> l4;
+  OTRadioLink::ISRRXFrameMetadata m;
+  AssertIsTrue(!l4.peekRXMetadata(m));
+#endif
 //#ifdef ON_V0P2_BOARD
 //  // Can't do anything with this unless on V0p2 board.
 //  l0.preinit(NULL); // Must not break anything nor stall!
 //#endif
   }
 
+#if !defined(__AVR__)
+// Minimal RFM23B register file behind the host SPI and digital-write hooks.
+// The first byte after each select is the address (top bit set to write), which auto-increments.
+typedef uint8_t burstRegValPair_t[2];
+static uint8_t burstRegs[128];
+static uint8_t burstAddr;
+static bool burstWrite;
+static bool burstNewSelect;
+static uint16_t burstBytes;
+// Optional TX FIFO log (written bytes), RX FIFO source, and interrupt status 1 source.
+static uint8_t *burstTXLog;
+static uint16_t burstTXLogged;
+static const uint8_t *burstRXFIFO;
+static uint16_t burstRXRead;
+static uint8_t (*burstStatus1)();
+static uint8_t burstSPITransfer(const uint8_t out)
+  {
+  ++burstBytes;
+  if(burstNewSelect) { burstNewSelect = false; burstAddr = out & 0x7f; burstWrite = (0 != (out & 0x80)); return(0); }
+  const uint8_t a = burstAddr;
+  if(burstAddr < 0x7f) { ++burstAddr; }
+  if(burstWrite)
+    {
+    if((0x7f == a) && (NULL != burstTXLog)) { burstTXLog[burstTXLogged++] = out; }
+    burstRegs[a] = out;
+    return(0);
+    }
+  if((0x7f == a) && (NULL != burstRXFIFO)) { return(burstRXFIFO[burstRXRead++]); }
+  if((3 == a) && (NULL != burstStatus1)) { return(burstStatus1()); }
+  return(burstRegs[a]);
+  }
+static void burstDigitalWrite(const uint8_t pin, const uint8_t val)
+  { if((OTV0P2BASE::V0p2_PIN_SPI_nSS == pin) && (LOW == val)) { burstNewSelect = true; } }
+// RFM23B counting (virtual) selects and exposing register set-up and shadow internals.
+typedef OTRFM23BLink::OTRFM23BLink<OTV0P2BASE::V0p2_PIN_SPI_nSS> BurstTestRFM23BBase;
+class BurstTestRFM23B : public BurstTestRFM23BBase
+  {
+  public:
+    mutable uint16_t selects = 0;
+    virtual void _SELECT_() const override { ++selects; digitalWrite(OTV0P2BASE::V0p2_PIN_SPI_nSS, LOW); }
+    void setup(const burstRegValPair_t *const t) { _registerBlockSetup(t); }
+    uint8_t readCached(const uint8_t addr) { return(_readRegCached_(addr)); }
+    void writeCached(const uint8_t addr, const uint8_t val) { _writeRegCached_(addr, val); }
+  };
+// Check that register block setup writes every table entry, in one SPI burst per run of consecutive registers.
+static void testRFM23BRegisterBurst()
+  {
+  Serial.println("RFM23BRegisterBurst");
+  hostSPITransfer_t *const oldSPI = hostSPITransfer;
+  hostSPITransfer = burstSPITransfer;
+  hostDigitalWrite = burstDigitalWrite;
+  const burstRegValPair_t *const tables[] =
+    {
+    OTRFM23BLink::OTRFM23BLinkBase::StandardRegSettingsOOK,
+    OTRFM23BLink::OTRFM23BLinkBase::StandardRegSettingsGFSK,
+    };
+  for(const burstRegValPair_t *const t : tables)
+    {
+    memset(burstRegs, 0, sizeof(burstRegs));
+    BurstTestRFM23B l;
+    l.setup(t);
+    // Expect one select per run; the last write to each register wins.
+    uint8_t expected[128];
+    memset(expected, 0, sizeof(expected));
+    uint16_t entries = 0, runs = 0;
+    for(uint8_t i = 0, prev = 0xff; 0xff != t[i][0]; prev = t[i][0], ++i)
+      {
+      ++entries;
+      if(t[i][0] != (uint8_t)(prev + 1)) { ++runs; }
+      expected[t[i][0]] = t[i][1];
+      }
+    AssertIsTrue(0 == memcmp(expected, burstRegs, sizeof(expected)));
+    AssertIsEqual(runs, l.selects);
+    AssertIsTrue(l.selects < entries);
+    }
+  hostSPITransfer = oldSPI;
+  hostDigitalWrite = NULL;
+  }
+
+// Check that the RFM23B register shadow skips redundant SPI traffic and that its verify mode catches divergence.
+static void testRFM23BRegShadow()
+  {
+  Serial.println("RFM23BRegShadow");
+  hostSPITransfer_t *const oldSPI = hostSPITransfer;
+  hostSPITransfer = burstSPITransfer;
+  hostDigitalWrite = burstDigitalWrite;
+  memset(burstRegs, 0, sizeof(burstRegs));
+  BurstTestRFM23B l;
+  l.setup(OTRFM23BLink::OTRFM23BLinkBase::StandardRegSettingsGFSK);
+  // Config written by the register block set-up is read back from RAM.
+  burstBytes = 0;
+  AssertIsEqual(0x88, l.readCached(0x30));
+  AssertIsEqual(0x0e, l.readCached(0x6e));
+  AssertIsEqual(0, burstBytes);
+  // Unshadowed registers are always read from the radio.
+  l.readCached(0x26);
+  AssertIsEqual(2, burstBytes);
+  // Redundant writes are skipped; others go through.
+  burstBytes = 0;
+  l.writeCached(0x05, 0x07);
+  AssertIsEqual(0, burstBytes);
+  l.writeCached(0x05, 0);
+  AssertIsEqual(2, burstBytes);
+  AssertIsEqual(0, burstRegs[0x05]);
+  // Standby with interrupts already disabled skips the 3-byte interrupt-enable burst.
+  burstBytes = 0;
+  l.end();
+  const uint16_t b1 = burstBytes;
+  burstBytes = 0;
+  l.end();
+  AssertIsEqual(b1 - 3, burstBytes);
+  AssertIsEqual(0, burstRegs[0x06]);
+  // Verification finds and drops a diverged register, which is then re-read.
+  AssertIsEqual(0, l.verifyRegShadow());
+  burstRegs[0x30] = 0x08;
+  AssertIsEqual(0x88, l.readCached(0x30));
+  AssertIsEqual(1, l.verifyRegShadow());
+  AssertIsEqual(1, l.getRegShadowMismatchesRecent());
+  AssertIsEqual(0x08, l.readCached(0x30));
+  AssertIsEqual(0, l.verifyRegShadow());
+  // In verify mode each shadowed read checks the radio.
+  l.setRegShadowVerify(true);
+  burstRegs[0x30] = 0x88;
+  burstBytes = 0;
+  AssertIsEqual(0x88, l.readCached(0x30));
+  AssertIsEqual(2, burstBytes);
+  AssertIsEqual(2, l.getRegShadowMismatchesRecent());
+  hostSPITransfer = oldSPI;
+  hostDigitalWrite = NULL;
+  }
+
+// Length of the frame streamed in each direction by testRFM23BStreaming().
+static const uint8_t streamFrameLen = 150;
+// TX FIFO almost-empty until a whole frame has gone in, then packet sent.
+static uint8_t streamTXStatus1() { return((0 != (burstTXLogged % streamFrameLen)) ? 0x20 : 0x04); }
+// RX FIFO almost-full while more than its threshold is unread, then packet valid.
+static uint8_t streamRXStatus1()
+  { return(((streamFrameLen - burstRXRead) > OTRFM23BLink::OTRFM23BLinkBase::RX_STREAM_ALMOST_FULL) ? 0x10 : 0x02); }
+// Check that frames longer than the FIFOs are streamed through them whole.
+static void testRFM23BStreaming()
+  {
+  Serial.println("RFM23BStreaming");
+  hostSPITransfer_t *const oldSPI = hostSPITransfer;
+  hostSPITransfer = burstSPITransfer;
+  hostDigitalWrite = burstDigitalWrite;
+  memset(burstRegs, 0, sizeof(burstRegs));
+  burstRegs[0x30] = 0x80; // Packet handler on for RX (ENPACRX).
+  uint8_t frame[streamFrameLen];
+  for(uint8_t i = 0; i < streamFrameLen; ++i) { frame[i] = (uint8_t)(i * 7 + 1); }
+  // Without streaming frames are limited to the FIFO size.
+  OTRFM23BLink::OTRFM23BLink<OTV0P2BASE::V0p2_PIN_SPI_nSS> l0;
+  AssertIsTrue(!l0.sendRaw(frame, OTRFM23BLink::OTRFM23BLinkBase::FIFO_BYTES + 1));
+  OTRFM23BLink::OTRFM23BLink<OTV0P2BASE::V0p2_PIN_SPI_nSS, -1, 2, uint16_t, false, 0, 200> l;
+  uint8_t queueMin, maxRX, maxTX;
+  l.getCapacity(queueMin, maxRX, maxTX);
+  AssertIsEqual(200, maxTX);
+  AssertIsTrue(maxRX >= 200);
+  AssertIsTrue(queueMin >= 2);
+  uint8_t big[201];
+  AssertIsTrue(!l.sendRaw(big, sizeof(big)));
+  // TX: the TX FIFO is refilled as it empties, and reloaded for the repeat at TXmax.
+  uint8_t txLog[2 * streamFrameLen];
+  burstTXLog = txLog;
+  burstTXLogged = 0;
+  burstStatus1 = streamTXStatus1;
+  AssertIsTrue(l.sendRaw(frame, streamFrameLen));
+  AssertIsEqual(streamFrameLen, burstTXLogged);
+  AssertIsTrue(0 == memcmp(frame, txLog, streamFrameLen));
+  burstTXLogged = 0;
+  AssertIsTrue(l.sendRaw(frame, streamFrameLen, 0, OTRadioLink::OTRadioLink::TXmax));
+  AssertIsEqual(2 * streamFrameLen, burstTXLogged);
+  AssertIsTrue(0 == memcmp(frame, txLog + streamFrameLen, streamFrameLen));
+  burstTXLog = NULL;
+  // RX with the packet handler: the RX FIFO is drained as it fills and the whole frame queued.
+  burstRegs[0x4b] = streamFrameLen;
+  const OTRadioLink::OTRadioChannelConfig config(OTRFM23BLink::OTRFM23BLinkBase::StandardRegSettingsGFSK, true, true, true);
+  AssertIsTrue(l.configure(1, &config));
+  l.listen(true);
+  AssertIsEqual(OTRFM23BLink::OTRFM23BLinkBase::RX_STREAM_ALMOST_FULL, burstRegs[0x7e]);
+  burstRXFIFO = frame;
+  burstRXRead = 0;
+  burstStatus1 = streamRXStatus1;
+  for(uint8_t i = 0; (i < 10) && (0 == l.getRXMsgsQueued()); ++i) { l.poll(); }
+  AssertIsEqual(1, l.getRXMsgsQueued());
+  uint8_t len;
+  const volatile uint8_t *const rx = l.peekRXMsg(len);
+  AssertIsEqual(streamFrameLen, len);
+  AssertIsTrue(0 == memcmp(frame, (const uint8_t *)rx, len));
+  AssertIsEqual(streamFrameLen, burstRXRead);
+  l.listen(false);
+  burstRXFIFO = NULL;
+  burstStatus1 = NULL;
+  hostSPITransfer = oldSPI;
+  hostDigitalWrite = NULL;
+  }
+
+// Set if the packet-sent interrupt was enabled at any status read by txIRQStatus1(), and the status to return.
+static bool txIRQPKSENTEnabled;
+static uint8_t txIRQStatus;
+static uint8_t txIRQStatus1() { if(0 != (burstRegs[0x05] & 0x04)) { txIRQPKSENTEnabled = true; } return(txIRQStatus); }
+// Check that TX waits for the packet-sent interrupt, with a timeout from the frame's airtime.
+template<class L> static void checkRFM23BTXInterrupt(L &l)
+  {
+  const uint8_t frame[20] = { 1, 2, 3 };
+  burstStatus1 = txIRQStatus1;
+  txIRQStatus = 0x04;
+  txIRQPKSENTEnabled = false;
+  AssertIsTrue(l.sendRaw(frame, sizeof(frame)));
+  AssertIsTrue(txIRQPKSENTEnabled);
+  // Never sent: gives up after about the 32ms airtime plus margins, well within the fixed upper bound.
+  txIRQStatus = 0;
+  const unsigned long start = millis();
+  AssertIsTrue(!l.sendRaw(frame, sizeof(frame)));
+  const unsigned long elapsed = millis() - start;
+  AssertIsTrue(elapsed >= 32 + OTRFM23BLink::OTRFM23BLinkBase::TX_TIMEOUT_MARGIN_MS);
+  AssertIsTrue(elapsed < OTRFM23BLink::OTRFM23BLinkBase::MAX_TX_ms / 4);
+  // Likewise if the sub-cycle timer has stopped too.
+  hostTCNT2Stopped = true;
+  const unsigned long startStopped = millis();
+  AssertIsTrue(!l.sendRaw(frame, sizeof(frame)));
+  hostTCNT2Stopped = false;
+  const unsigned long elapsedStopped = millis() - startStopped;
+  AssertIsTrue(elapsedStopped >= 32 + OTRFM23BLink::OTRFM23BLinkBase::TX_TIMEOUT_MARGIN_MS);
+  AssertIsTrue(elapsedStopped < OTRFM23BLink::OTRFM23BLinkBase::MAX_TX_ms / 4);
+  burstStatus1 = NULL;
+  }
+static void testRFM23BTXInterrupt()
+  {
+  Serial.println("RFM23BTXInterrupt");
+  hostSPITransfer_t *const oldSPI = hostSPITransfer;
+  hostSPITransfer = burstSPITransfer;
+  hostDigitalWrite = burstDigitalWrite;
+  memset(burstRegs, 0, sizeof(burstRegs));
+  // 5000bps (TX data rate 0x28f6 with TXDTRTSCALE), no packet handler.
+  burstRegs[0x6e] = 0x28;
+  burstRegs[0x6f] = 0xf6;
+  burstRegs[0x70] = 0x20;
+  // Polled without nIRQ, and sleeping between checks with it.
+  OTRFM23BLink::OTRFM23BLink<OTV0P2BASE::V0p2_PIN_SPI_nSS> lPoll;
+  checkRFM23BTXInterrupt(lPoll);
+  OTRFM23BLink::OTRFM23BLink<OTV0P2BASE::V0p2_PIN_SPI_nSS, 9> lIRQ;
+  checkRFM23BTXInterrupt(lIRQ);
+  hostSPITransfer = oldSPI;
+  hostDigitalWrite = NULL;
+  }
+
+// Polled sender, and interrupt-driven receiver keeping RX metadata, on simulated RFM23Bs.
+typedef OTRFM23BLink::OTRFM23BLink<OTV0P2BASE::V0p2_PIN_SPI_nSS, -1, 2> SimSenderRFM23B;
+typedef OTRFM23BLink::OTRFM23BLink<8, 9, 4, uint8_t, true> SimReceiverRFM23B;
+static void simReceiverISR(void *const l) { static_cast<SimReceiverRFM23B *>(l)->handleInterruptSimple(); }
+// Drain the receiver's RX queue, checking that frames carry consecutive sequence numbers from next; returns the count.
+static uint16_t drainSimReceiver(SimReceiverRFM23B &b, uint8_t &next)
+  {
+  uint16_t n = 0;
+  uint8_t len;
+  for(const volatile uint8_t *f; NULL != (f = b.peekRXMsg(len)); b.removeRXMsg(), ++n)
+    {
+    AssertIsEqual(20, len);
+    AssertIsEqual(next, f[0]);
+    AssertIsEqual((uint8_t)~next, f[19]);
+    ++next;
+    }
+  return(n);
+  }
+// Check the RFM23B driver against the register-level simulator, sending between two radios and load-testing RX.
+static void testRFM23BSim()
+  {
+  Serial.println("RFM23BSim");
+  HostRFM23BEther ether;
+  HostRFM23B simA(OTV0P2BASE::V0p2_PIN_SPI_nSS), simB(8, 9);
+  AssertIsTrue(ether.attach(simA));
+  AssertIsTrue(ether.attach(simB));
+  SimSenderRFM23B a;
+  SimReceiverRFM23B b;
+  simB.setISR(simReceiverISR, &b);
+  simA.setTXRSSI(0xa0);
+  const OTRadioLink::OTRadioChannelConfig config(OTRFM23BLink::OTRFM23BLinkBase::StandardRegSettingsGFSK, true, true, true);
+  AssertIsTrue(a.configure(1, &config));
+  AssertIsTrue(a.begin());
+  AssertIsTrue(b.configure(1, &config));
+  AssertIsTrue(b.begin());
+  b.listen(true);
+  AssertIsEqual(0x05, simB.peekReg(0x07)); // RXON | XTON.
+  // A frame sent from A arrives in B's RX queue through B's ISR, with its RSSI.
+  uint8_t frame[20];
+  for(uint8_t i = 0; i < sizeof(frame); ++i) { frame[i] = (uint8_t)(i * 3); }
+  frame[19] = (uint8_t)~frame[0];
+  AssertIsTrue(a.sendRaw(frame, sizeof(frame)));
+  AssertIsEqual(1, simA.getFramesSent());
+  for(uint8_t i = 0; (i < 10) && (0 == b.getRXMsgsQueued()); ++i) { delay(1); ether.poll(); }
+  AssertIsEqual(1, simB.getFramesReceived());
+  AssertIsTrue(simB.getISRCalls() > 0);
+  OTRadioLink::ISRRXFrameMetadata m;
+  AssertIsTrue(b.peekRXMetadata(m));
+  AssertIsEqual(0xa0, m.rssi);
+  uint8_t next = 0;
+  AssertIsEqual(1, drainSimReceiver(b, next));
+  AssertIsEqual(0x05, simB.peekReg(0x07)); // Listening again.
+  // Lost on the air: nothing arrives.
+  ether.setLossPerMille(1000);
+  AssertIsTrue(a.sendRaw(frame, sizeof(frame)));
+  for(uint8_t i = 0; i < 10; ++i) { delay(1); ether.poll(); }
+  AssertIsEqual(0, b.getRXMsgsQueued());
+  AssertIsEqual(1, ether.getFramesLost());
+  ether.setLossPerMille(0);
+  // Load: 200 frames/s (of ~3.75ms airtime) injected for 1s of simulated time, while draining the queue.
+  // Time advances only with the polling loop's delays, so a stalled host cannot starve the ISR;
+  // dev/test/rfm23bLoad does this in real time.
+  hostFreezeClock(true);
+  const uint16_t nFrames = 200;
+  const unsigned long gapUs = 5000;
+  const unsigned long start = micros() + 1000;
+  const unsigned long deadline = start + (nFrames + 10) * gapUs;
+  uint16_t injected = 0, received = 0;
+  next = 0;
+  while(received < nFrames)
+    {
+    const unsigned long now = micros();
+    if(now > deadline) { break; } // Give up: frames lost.
+    // Keep a few frames queued up on the air ahead of time.
+    for( ; (injected < nFrames) && (start + injected * gapUs < now + 4 * gapUs); ++injected)
+      {
+      frame[0] = (uint8_t)injected;
+      frame[19] = (uint8_t)~injected;
+      AssertIsTrue(ether.inject(simB, frame, sizeof(frame), start + injected * gapUs, 0x90));
+      }
+    delayMicroseconds(100);
+    ether.poll();
+    received += drainSimReceiver(b, next);
+    }
+  hostFreezeClock(false);
+  AssertIsEqual(nFrames, received);
+  AssertIsEqual(0, ether.getCollisions());
+  AssertIsEqual(0, simB.getCRCErrors());
+  AssertIsEqual(0, simB.getFIFOErrors());
+  AssertIsEqual(0, simB.getSPIConflicts());
+  AssertIsEqual(0, simA.getSPIConflicts());
+  b.listen(false);
+  AssertIsEqual(0x00, simB.peekReg(0x07) & 0x0c); // Standby.
+  }
+
+// Keep the channel that sim is tuned to busy from now for at least us, with loud frames of len bytes back-to-back;
+// returns the time that it clears.
+static unsigned long busySimChannel(HostRFM23BEther &ether, const HostRFM23B &sim, const unsigned long us, const uint8_t len)
+  {
+  static const uint8_t noise[255] = { };
+  const unsigned long frameUs = HostRFM23BEther::airtimeUs(sim, len);
+  unsigned long t = micros();
+  const unsigned long end = t + us;
+  for( ; t < end; t += frameUs) { AssertIsTrue(ether.inject(sim, noise, len, t, 0xc0)); }
+  return(t);
+  }
+// Poll the link (and the simulation) every ~1ms until the async TX logged in log completes, or a few seconds pass.
+static void pollSimSenderTX(HostRFM23BEther &ether, OTRadioLink::OTRadioLink &a, TXQueueTestLog &log, const uint8_t n)
+  {
+  for(uint16_t i = 0; (i < 3000) && (log.n < n); ++i) { delay(1); ether.poll(); a.poll(); }
+  AssertIsEqual(n, log.n);
+  }
+// Check the RFM23B driver's TX scheduling against the simulator:
+// listen-before-talk backoff and give-up, duty-cycle refusal, the TXmax repeat gap and the TX timeout,
+// both blocking (sendRaw()) and from the TX queue (_TXstart()/_TXpoll()).
+static void testRFM23BTXSchedule()
+  {
+  Serial.println("RFM23BTXSchedule");
+  HostRFM23BEther ether;
+  HostRFM23B simA(OTV0P2BASE::V0p2_PIN_SPI_nSS);
+  AssertIsTrue(ether.attach(simA));
+  SimSenderRFM23B a;
+  const OTRadioLink::OTRadioChannelConfig config(OTRFM23BLink::OTRFM23BLinkBase::StandardRegSettingsGFSK, true, true, true);
+  AssertIsTrue(a.configure(1, &config));
+  AssertIsTrue(a.begin());
+  a.setLBT(0x60);
+  uint8_t frame[20];
+  memset(frame, 0x55, sizeof(frame));
+  const uint8_t busyLimit = SimSenderRFM23B::LBT_MAX_TRIES;
+  // Clear channel (noise floor below the threshold): sent at once.
+  AssertIsTrue(a.sendRaw(frame, sizeof(frame)));
+  AssertIsEqual(1, simA.getFramesSent());
+  AssertIsEqual(0, a.getTXChannelBusyRecent());
+  // Busy for one short frame (~10ms): backs off (at least one 15ms nap each time) and sends once the channel clears.
+  unsigned long clearAt = busySimChannel(ether, simA, 1, 64);
+  AssertIsTrue(a.sendRaw(frame, sizeof(frame)));
+  AssertIsEqual(2, simA.getFramesSent());
+  uint8_t busy = a.getTXChannelBusyRecent();
+  AssertIsTrue((busy >= 1) && (busy < busyLimit));
+  AssertIsTrue((long)(micros() - clearAt) >= 0);
+  // Busy throughout: gives up after LBT_MAX_TRIES assessments, without sending.
+  clearAt = busySimChannel(ether, simA, 500000, 255);
+  AssertIsTrue(!a.sendRaw(frame, sizeof(frame)));
+  AssertIsEqual(2, simA.getFramesSent());
+  AssertIsEqual(busy + busyLimit, a.getTXChannelBusyRecent());
+  busy = a.getTXChannelBusyRecent();
+  // Likewise from the TX queue, backing off without blocking poll().
+  OTRadioLink::TXQueueFixed<sizeof(frame), 2> q;
+  AssertIsTrue(a.setTXQueue(&q));
+  TXQueueTestLog log;
+  memset(&log, 0, sizeof(log));
+  AssertIsTrue(a.queueToSendAsync(frame, sizeof(frame), 0, OTRadioLink::OTRadioLink::TXnormal, txQueueTestCallback, &log));
+  const unsigned long before = micros();
+  a.poll();
+  AssertIsTrue(micros() - before < 5000);
+  AssertIsEqual(busy + 1, a.getTXChannelBusyRecent());
+  AssertIsEqual(0, log.n);
+  pollSimSenderTX(ether, a, log, 1);
+  AssertIsTrue(!log.sent[0]);
+  AssertIsEqual(2, simA.getFramesSent());
+  AssertIsEqual(busy + busyLimit, a.getTXChannelBusyRecent());
+  // From the TX queue, sent once the channel clears.
+  while((long)(micros() - clearAt) < 0) { delay(1); ether.poll(); }
+  busy = a.getTXChannelBusyRecent();
+  clearAt = busySimChannel(ether, simA, 1, 64);
+  AssertIsTrue(a.queueToSendAsync(frame, sizeof(frame), 0, OTRadioLink::OTRadioLink::TXnormal, txQueueTestCallback, &log));
+  pollSimSenderTX(ether, a, log, 2);
+  AssertIsTrue(log.sent[1]);
+  AssertIsEqual(3, simA.getFramesSent());
+  AssertIsTrue((a.getTXChannelBusyRecent() > busy) && (a.getTXChannelBusyRecent() < busy + busyLimit));
+  busy = a.getTXChannelBusyRecent();
+  // TXmax from the TX queue: sent twice, the repeat after a gap of at least TX_REPEAT_GAP_TICKS (less a partial tick).
+  AssertIsTrue(a.queueToSendAsync(frame, sizeof(frame), 0, OTRadioLink::OTRadioLink::TXmax, txQueueTestCallback, &log));
+  unsigned long firstSent = 0, repeatStart = 0;
+  for(uint16_t i = 0; (i < 3000) && (log.n < 3); ++i)
+    {
+    delayMicroseconds(200);
+    ether.poll();
+    a.poll();
+    if((0 == firstSent) && (4 == simA.getFramesSent())) { firstSent = micros(); }
+    if((0 != firstSent) && (0 == repeatStart) && simA.isTransmitting()) { repeatStart = micros(); }
+    }
+  AssertIsEqual(3, log.n);
+  AssertIsTrue(log.sent[2]);
+  AssertIsEqual(5, simA.getFramesSent());
+  AssertIsTrue((0 != firstSent) && (0 != repeatStart));
+  AssertIsTrue(repeatStart - firstSent >= (SimSenderRFM23B::TX_REPEAT_GAP_TICKS - 1) * OTV0P2BASE::SUBCYCLE_TICK_MS_RD * 1000UL);
+  AssertIsEqual(busy, a.getTXChannelBusyRecent());
+  // Duty-cycle budget (3.6s/hour) all but used: TXs refused up front, blocking and from the TX queue.
+  OTRadioLink::TXDutyCycleFixed<1> dc(1);
+  dc.record(0, (uint16_t)(dc.getBudgetMs() - 1));
+  a.setTXDutyCycle(&dc);
+  AssertIsTrue(!a.sendRaw(frame, sizeof(frame)));
+  AssertIsEqual(1, a.getTXDutyCycleRefusedRecent());
+  AssertIsTrue(a.queueToSendAsync(frame, sizeof(frame), 0, OTRadioLink::OTRadioLink::TXnormal, txQueueTestCallback, &log));
+  pollSimSenderTX(ether, a, log, 4);
+  AssertIsTrue(!log.sent[3]);
+  AssertIsEqual(2, a.getTXDutyCycleRefusedRecent());
+  AssertIsEqual(5, simA.getFramesSent());
+  AssertIsEqual(busy, a.getTXChannelBusyRecent()); // Not even listened.
+  // With budget for one TX but not the TXmax repeat: refused too; then sent, and accounted for.
+  dc.clear();
+  dc.record(0, (uint16_t)(dc.getBudgetMs() - 6));
+  AssertIsTrue(!a.sendRaw(frame, sizeof(frame), 0, OTRadioLink::OTRadioLink::TXmax));
+  AssertIsEqual(3, a.getTXDutyCycleRefusedRecent());
+  AssertIsTrue(a.sendRaw(frame, sizeof(frame)));
+  AssertIsEqual(6, simA.getFramesSent());
+  AssertIsTrue(dc.getAirtimeMs(0) > dc.getBudgetMs() - 6);
+  a.setTXDutyCycle(NULL);
+  // No room on the air (all slots taken by frames on another channel), so the packet-sent status never comes:
+  // each TX times out well within MAX_TX_ms, blocking and from the TX queue.
+  HostRFM23B simOff(7);
+  static const uint8_t off[1] = { };
+  while(ether.inject(simOff, off, sizeof(off), micros() + 10000000UL)) { }
+  a.setLBT(0);
+  unsigned long start = micros();
+  AssertIsTrue(!a.sendRaw(frame, sizeof(frame)));
+  AssertIsTrue(micros() - start < 100000UL);
+  AssertIsTrue(a.queueToSendAsync(frame, sizeof(frame), 0, OTRadioLink::OTRadioLink::TXnormal, txQueueTestCallback, &log));
+  start = micros();
+  pollSimSenderTX(ether, a, log, 5);
+  AssertIsTrue(!log.sent[4]);
+  AssertIsTrue(micros() - start < 100000UL);
+  AssertIsEqual(6, simA.getFramesSent());
+  AssertIsTrue(a.setTXQueue(NULL));
+  AssertIsEqual(0, simA.getSPIConflicts());
+  }
+#endif // !defined(__AVR__)
+
 // Pick test buffer size to match actual RFM23B buffer/FIFO size.
 static const uint8_t TEST_MIN_Q_MSG_SIZE = 64;
 
@@ -330,6 +1759,104 @@ static void allISRRXQueue(OTRadioLink::ISRRXQueue &q)
     }
   }
 
+// State for drainTestHandler().
+struct DrainTestState
+  {
+  // Messages dealt with so far, and how many to accept before refusing.
+  uint8_t handled, limit;
+  };
+// Checks each message is the next in sequence (first byte is its sequence number, length is 1+that mod 8).
+static bool drainTestHandler(void *context, const volatile uint8_t *buf, uint8_t len)
+  {
+  DrainTestState &s = *(DrainTestState *)context;
+  if(s.handled >= s.limit) { return(false); }
+  AssertIsEqual(s.handled, buf[0]);
+  AssertIsEqual(1 + (s.handled & 7), len);
+  ++s.handled;
+  return(true);
+  }
+
+// Tests for batch peek/remove/drain on all ISRRXQueue implementations.
+// Assumes being passed an empty freshly-created instance.
+// Leaves the queue instance empty when done.
+static void allISRRXQueueBatch(OTRadioLink::ISRRXQueue &q)
+  {
+  DrainTestState s = { 0, 255 };
+  OTRadioLink::ISRRXMsgSpan spans[4];
+  AssertIsEqual(0, q.peekRXMsgs(spans, 4));
+  AssertIsEqual(0, q.drainRXMsgs(drainTestHandler, &s));
+  q.removeRXMsgs(3);
+  AssertIsTrue(q.isEmpty());
+  for(uint8_t round = 0; round < 20; ++round)
+    {
+    // Fill the queue (to at most 255 messages), numbering the messages.
+    uint8_t queued = 0;
+    while((queued < 255) && !q.isFull())
+      {
+      volatile uint8_t *const ib = q._getRXBufForInbound();
+      AssertIsTrue(NULL != ib);
+      const uint8_t len = 1 + (queued & 7);
+      for(uint8_t i = 0; i < len; ++i) { ib[i] = queued; }
+      q._loadedBuf(len);
+      ++queued;
+      }
+    AssertIsEqual(queued, q.getRXMsgsQueued());
+    // Peek at up to 4 in place without removing them.
+    const uint8_t n = q.peekRXMsgs(spans, 4);
+    AssertIsEqual((queued < 4) ? queued : 4, n);
+    for(uint8_t i = 0; i < n; ++i)
+      {
+      AssertIsEqual(1 + (i & 7), spans[i].len);
+      AssertIsEqual(i, spans[i].buf[0]);
+      AssertIsEqual(i, spans[i].buf[spans[i].len - 1]);
+      }
+    AssertIsEqual(queued, q.getRXMsgsQueued());
+    // NULL handler does nothing.
+    AssertIsEqual(0, q.drainRXMsgs(NULL, &s));
+    // Drain some, the handler refusing part way, then the rest.
+    s.handled = 0;
+    s.limit = round % (queued + 1);
+    AssertIsEqual(s.limit, q.drainRXMsgs(drainTestHandler, &s));
+    AssertIsEqual(queued - s.limit, q.getRXMsgsQueued());
+    s.limit = 255;
+    if(0 != (round & 1))
+      {
+      // Drain the rest.
+      const uint8_t remaining = queued - s.handled;
+      AssertIsEqual(remaining, q.drainRXMsgs(drainTestHandler, &s, 255));
+      }
+    else
+      {
+      // Check the next is as expected, then remove the rest together.
+      uint8_t len;
+      const volatile uint8_t *const pb = q.peekRXMsg(len);
+      AssertIsTrue((s.handled == queued) || ((NULL != pb) && (s.handled == pb[0])));
+      q.removeRXMsgs(255);
+      }
+    AssertIsTrue(q.isEmpty());
+    AssertIsTrue(!q.isFull());
+    AssertIsEqual(0, q.getRXMsgsQueued());
+    }
+  }
+
+// Check batch RX queue operations on each queue type.
+static void testISRRXQueueBatch()
+  {
+  Serial.println("ISRRXQueueBatch");
+  OTRadioLink::ISRRXQueue1Deep<TEST_MIN_Q_MSG_SIZE> q1;
+  allISRRXQueueBatch(q1);
+  OTRadioLink::ISRRXQueueVarLenMsg<TEST_MIN_Q_MSG_SIZE, 2> q2;
+  allISRRXQueueBatch(q2);
+  OTRadioLink::ISRRXQueueVarLenMsg<TEST_MIN_Q_MSG_SIZE, 2, uint8_t, true> q3;
+  allISRRXQueueBatch(q3);
+#if !defined(__AVR__)
+  OTRadioLink::ISRRXQueueVarLenMsg<TEST_MIN_Q_MSG_SIZE, 100, uint16_t> q4;
+  allISRRXQueueBatch(q4);
+  OTRadioLink::ISRRXQueueVarLenMsgSPSC<TEST_MIN_Q_MSG_SIZE, 2> q5;
+  allISRRXQueueBatch(q5);
+#endif
+  }
+
 // Do some basic exercise of ISRRXQueue1Deep.
 static void testISRRXQueue1Deep()
   {
@@ -476,6 +2003,261 @@ static void testISRRXQueueVarLenMsg()
 #endif
   }
 
+// Check that ISRRXQueueVarLenMsg with metadata keeps it with each frame and preserves capacity.
+static void testISRRXQueueVarLenMsgMetadata()
+  {
+  Serial.println("ISRRXQueueVarLenMsgMetadata");
+  // No metadata kept by default.
+  OTRadioLink::ISRRXQueueVarLenMsg<TEST_MIN_Q_MSG_SIZE, 2> q0;
+  OTRadioLink::ISRRXFrameMetadata m = { 1, 2, 3, 4 };
+  volatile uint8_t *ib = q0._getRXBufForInbound();
+  AssertIsTrue(NULL != ib);
+  q0._setRXMetadata(m);
+  ib[0] = 42;
+  q0._loadedBuf(1);
+  AssertIsTrue(!q0.peekRXMetadata(m));
+  AssertIsEqual(1, m.subCycleTick);
+  q0.removeRXMsg();
+  OTRadioLink::ISRRXQueueVarLenMsg<TEST_MIN_Q_MSG_SIZE, 2, uint8_t, true> q;
+  allISRRXQueue(q);
+  AssertIsEqual(2, q.MinQueueCapacityMsgs);
+  AssertIsTrue(!q.peekRXMetadata(m));
+  // Fill to guaranteed capacity with max-size frames, each with distinct metadata.
+  for(uint8_t i = 0; i < q.MinQueueCapacityMsgs; ++i)
+    {
+    ib = q._getRXBufForInbound();
+    AssertIsTrue(NULL != ib);
+    const OTRadioLink::ISRRXFrameMetadata mi = { (uint8_t)(10+i), (uint8_t)(20+i), i, OTRadioLink::ISRRXFrameMetadata::FLAG_LOST_BEFORE };
+    q._setRXMetadata(mi);
+    ib[0] = i; ib[TEST_MIN_Q_MSG_SIZE-1] = ~i;
+    q._loadedBuf(TEST_MIN_Q_MSG_SIZE);
+    }
+  for(uint8_t i = 0; i < q.MinQueueCapacityMsgs; ++i)
+    {
+    uint8_t len;
+    const volatile uint8_t *const pb = q.peekRXMsg(len);
+    AssertIsTrue(NULL != pb);
+    AssertIsEqual(TEST_MIN_Q_MSG_SIZE, len);
+    AssertIsEqual(i, pb[0]);
+    AssertIsEqual((uint8_t)~i, pb[TEST_MIN_Q_MSG_SIZE-1]);
+    AssertIsTrue(q.peekRXMetadata(m));
+    AssertIsEqual(10+i, m.subCycleTick);
+    AssertIsEqual(20+i, m.rssi);
+    AssertIsEqual(i, m.channel);
+    AssertIsEqual(OTRadioLink::ISRRXFrameMetadata::FLAG_LOST_BEFORE, m.flags);
+    q.removeRXMsg();
+    }
+  AssertIsTrue(q.isEmpty());
+  AssertIsTrue(!q.peekRXMetadata(m));
+  }
+
+// Load a 1-byte frame with the given content and priority into a priority queue; returns true if one was dropped.
+static bool loadPriorityTestFrame(OTRadioLink::ISRRXQueuePriorityBase &q, const uint8_t content, const uint8_t priority)
+  {
+  volatile uint8_t *const ib = q._getRXBufForInbound();
+  AssertIsTrue(NULL != ib);
+  ib[0] = content;
+  return(q._loadedBufWithPriority(1, priority));
+  }
+
+// Check that ISRRXQueuePriority evicts the oldest lowest-priority frame (but never the oldest) when full.
+static void testISRRXQueuePriority()
+  {
+  Serial.println("ISRRXQueuePriority");
+  OTRadioLink::ISRRXQueuePriority<TEST_MIN_Q_MSG_SIZE, 3> q0;
+  allISRRXQueue(q0);
+  OTRadioLink::ISRRXQueuePriority<TEST_MIN_Q_MSG_SIZE, 4, 4, true> q;
+  allISRRXQueue(q);
+  AssertIsEqual(4, q.MinQueueCapacityMsgs);
+  for(uint8_t c = 0; c < 4; ++c) { AssertIsEqual(0, q.getRXEvictedRecent(c)); }
+  // Fill with frames 0..3 of priorities 0, 2, 1, 2.
+  static const uint8_t prios[] = { 0, 2, 1, 2 };
+  for(uint8_t i = 0; i < 4; ++i)
+    {
+    volatile uint8_t *const ib = q._getRXBufForInbound();
+    const OTRadioLink::ISRRXFrameMetadata mi = { i, 0, 0, 0 };
+    q._setRXMetadata(mi);
+    ib[0] = i;
+    AssertIsTrue(!q._loadedBufWithPriority(1, prios[i]));
+    }
+  AssertIsTrue(q.isFull());
+  // Only the oldest frame can be peeked in place, as others may be evicted.
+  OTRadioLink::ISRRXMsgSpan spans[4];
+  AssertIsEqual(1, q.peekRXMsgs(spans, 4));
+  AssertIsEqual(0, spans[0].buf[0]);
+  // The oldest frame (0, priority 0) is kept; frame 2 of priority 1 is evicted for frame 4 of priority 3.
+  AssertIsTrue(loadPriorityTestFrame(q, 4, 3));
+  AssertIsEqual(1, q.getRXEvictedRecent(1));
+  AssertIsEqual(4, q.getRXMsgsQueued());
+  // A new lowest-priority frame is itself dropped.
+  AssertIsTrue(loadPriorityTestFrame(q, 5, 0));
+  AssertIsEqual(1, q.getRXEvictedRecent(0));
+  // Equal lowest priority: the oldest of those (frame 1) goes; priority out of range is treated as highest.
+  AssertIsTrue(loadPriorityTestFrame(q, 6, 200));
+  AssertIsEqual(1, q.getRXEvictedRecent(2));
+  AssertIsEqual(0, q.getRXEvictedRecent(3));
+  AssertIsEqual(0, q.getRXEvictedRecent(4)); // Out of range.
+  // Remaining frames in arrival order: 0, 3, 4, 6, with their own metadata.
+  static const uint8_t expected[] = { 0, 3, 4, 6 };
+  static const uint8_t expectedPrio[] = { 0, 2, 3, 3 };
+  for(uint8_t i = 0; i < 4; ++i)
+    {
+    uint8_t len;
+    const volatile uint8_t *const pb = q.peekRXMsg(len);
+    AssertIsTrue(NULL != pb);
+    AssertIsEqual(1, len);
+    AssertIsEqual(expected[i], pb[0]);
+    AssertIsEqual(expectedPrio[i], q.peekRXPriority());
+    OTRadioLink::ISRRXFrameMetadata m;
+    AssertIsTrue(q.peekRXMetadata(m));
+    if(expected[i] < 4) { AssertIsEqual(expected[i], m.subCycleTick); }
+    q.removeRXMsg();
+    }
+  AssertIsTrue(q.isEmpty());
+  // A busy channel of low-priority frames does not displace high-priority frames.
+  for(uint8_t i = 0; i < 100; ++i)
+    {
+    const uint8_t p = ((i % 10) == 3) ? 3 : 0;
+    loadPriorityTestFrame(q, i, p);
+    }
+  uint8_t len;
+  AssertIsEqual(0, q.peekRXMsg(len)[0]); // Oldest is never evicted.
+  q.removeRXMsg();
+  for(uint8_t i = 0; i < 3; ++i)
+    {
+    AssertIsEqual(3, q.peekRXPriority());
+    AssertIsEqual(73 + 10*i, q.peekRXMsg(len)[0]);
+    q.removeRXMsg();
+    }
+  AssertIsTrue(q.isEmpty());
+  }
+
+#if !defined(__AVR__)
+// Check ISRRXQueueVarLenMsg with 16-bit indices and a buffer well beyond 256 bytes, as for a hub.
+static void testISRRXQueueVarLenMsgWide()
+  {
+  Serial.println("ISRRXQueueVarLenMsgWide");
+  OTRadioLink::ISRRXQueueVarLenMsg<TEST_MIN_Q_MSG_SIZE, 100, uint16_t> q;
+  allISRRXQueue(q);
+  // Capacity is not capped by the index size: 6464 bytes, so 99 max-size frames.
+  AssertIsEqual(99, q.MinQueueCapacityMsgs);
+  // The guarantee holds: fill with max-size frames.
+  for(uint8_t i = 0; i < q.MinQueueCapacityMsgs; ++i)
+    {
+    volatile uint8_t *const ib = q._getRXBufForInbound();
+    AssertIsTrue(NULL != ib);
+    ib[0] = i; ib[TEST_MIN_Q_MSG_SIZE-1] = ~i;
+    q._loadedBuf(TEST_MIN_Q_MSG_SIZE);
+    }
+  AssertIsEqual(99, q.getRXMsgsQueued());
+  // Drain some, then top up with short frames to wrap around the end,
+  // until the queued count (not the space) limits the queue.
+  for(uint8_t i = 0; i < 50; ++i)
+    {
+    uint8_t len;
+    const volatile uint8_t *const pb = q.peekRXMsg(len);
+    AssertIsTrue(NULL != pb);
+    AssertIsEqual(TEST_MIN_Q_MSG_SIZE, len);
+    AssertIsEqual(i, pb[0]);
+    AssertIsEqual((uint8_t)~i, pb[TEST_MIN_Q_MSG_SIZE-1]);
+    q.removeRXMsg();
+    }
+  uint16_t added = 0;
+  while(!q.isFull())
+    {
+    volatile uint8_t *const ib = q._getRXBufForInbound();
+    AssertIsTrue(NULL != ib);
+    ib[0] = (uint8_t)added++;
+    q._loadedBuf(1);
+    }
+  AssertIsEqual(255, q.getRXMsgsQueued());
+  AssertIsTrue(NULL == q._getRXBufForInbound());
+  // Remaining max-size frames come out first, in order, then the short ones.
+  for(uint8_t i = 50; i < 99; ++i)
+    {
+    uint8_t len;
+    const volatile uint8_t *const pb = q.peekRXMsg(len);
+    AssertIsEqual(TEST_MIN_Q_MSG_SIZE, len);
+    AssertIsEqual(i, pb[0]);
+    q.removeRXMsg();
+    }
+  for(uint16_t i = 0; i < added; ++i)
+    {
+    uint8_t len;
+    const volatile uint8_t *const pb = q.peekRXMsg(len);
+    AssertIsTrue(NULL != pb);
+    AssertIsEqual(1, len);
+    AssertIsEqual((uint8_t)i, pb[0]);
+    q.removeRXMsg();
+    }
+  AssertIsTrue(q.isEmpty());
+  AssertIsTrue(!q.isFull());
+  }
+
+// Frames pushed through the SPSC queue by the producer thread in testISRRXQueueVarLenMsgSPSC().
+static const uint32_t SPSC_TEST_FRAMES = 100000;
+// Producer: radio thread loading frames of varying length, each filled from its sequence number.
+static void *spscTestProducer(void *arg)
+  {
+  OTRadioLink::ISRRXQueue &q = *(OTRadioLink::ISRRXQueue *)arg;
+  uint8_t minQueueCapacity, maxRXMsgLen;
+  q.getRXCapacity(minQueueCapacity, maxRXMsgLen);
+  for(uint32_t i = 0; i < SPSC_TEST_FRAMES; )
+    {
+    volatile uint8_t *const ib = q._getRXBufForInbound();
+    if(NULL == ib) { sched_yield(); continue; }
+    const uint8_t len = 1 + (uint8_t)(i % maxRXMsgLen);
+    for(uint8_t j = 0; j < len; ++j) { ib[j] = (uint8_t)(i + j); }
+    q._loadedBuf(len);
+    ++i;
+    }
+  return(NULL);
+  }
+
+// Consumer: check all frames from spscTestProducer() arrive intact and in order.
+static void spscTestConsume(OTRadioLink::ISRRXQueue &q)
+  {
+  uint8_t minQueueCapacity, maxRXMsgLen;
+  q.getRXCapacity(minQueueCapacity, maxRXMsgLen);
+  pthread_t producer;
+  AssertIsEqual(0, pthread_create(&producer, NULL, spscTestProducer, &q));
+  for(uint32_t i = 0; i < SPSC_TEST_FRAMES; )
+    {
+    uint8_t len;
+    const volatile uint8_t *const pb = q.peekRXMsg(len);
+    if(NULL == pb) { sched_yield(); continue; }
+    AssertIsEqual(1 + (uint8_t)(i % maxRXMsgLen), len);
+    for(uint8_t j = 0; j < len; ++j) { AssertIsEqual((uint8_t)(i + j), pb[j]); }
+    q.removeRXMsg();
+    ++i;
+    }
+  AssertIsEqual(0, pthread_join(producer, NULL));
+  AssertIsTrue(q.isEmpty());
+  AssertIsEqual(0, q.getRXMsgsQueued());
+  }
+
+// Check ISRRXQueueVarLenMsgSPSC as for ISRRXQueueVarLenMsg, then with a producer and consumer thread.
+static void testISRRXQueueVarLenMsgSPSC()
+  {
+  Serial.println("ISRRXQueueVarLenMsgSPSC");
+  OTRadioLink::ISRRXQueueVarLenMsgSPSC<TEST_MIN_Q_MSG_SIZE, 2> q;
+  allISRRXQueue(q);
+  // Same capacity as the ISR variant.
+  AssertIsEqual((OTRadioLink::ISRRXQueueVarLenMsg<TEST_MIN_Q_MSG_SIZE, 2>::MinQueueCapacityMsgs), q.MinQueueCapacityMsgs);
+  // Small queue so that it wraps and fills often.
+  OTRadioLink::ISRRXQueueVarLenMsgSPSC<7, 2> qt;
+  spscTestConsume(qt);
+  // Large queue with wide indices, limited by the queued count.
+  OTRadioLink::ISRRXQueueVarLenMsgSPSC<7, 200, uint16_t> qw;
+  spscTestConsume(qw);
+  // With metadata.
+  OTRadioLink::ISRRXQueueVarLenMsgSPSC<TEST_MIN_Q_MSG_SIZE, 2, uint8_t, true> qm;
+  allISRRXQueue(qm);
+  OTRadioLink::ISRRXQueueVarLenMsgSPSC<7, 2, uint8_t, true> qmt;
+  spscTestConsume(qmt);
+  }
+#endif
+
 
 // OTRadValve
 
@@ -564,7 +2346,9 @@ static void testCurrentSenseValveMotorDirect()
   AssertIsEqual(0, csvmd1.getTargetPC());
 
   // FIRST POLL(S) AFTER POWER_UP; RETRACTING THE PIN.
-  csvmd1.poll();
+  // Start-up is randomly postponed (by ~7/8 chance on each poll) to spread out activity,
+  // so poll until the init state is left, which should happen well within 100 polls.
+  for(int i = 100; (--i > 0) && (OTRadValve::CurrentSenseValveMotorDirect::init == csvmd1.getState()); ) { csvmd1.poll(); }
   // Whitebox test of internal state: should be valvePinWithdrawing.
   AssertIsEqual(OTRadValve::CurrentSenseValveMotorDirect::valvePinWithdrawing, csvmd1.getState());
   // More polls shouldn't make any difference initially.
@@ -644,6 +2428,40 @@ static void testSleep()
     }
   }
 
+// Fake cycle counter for testCycleProfile(), stepped by the test.
+static uint32_t testCycleCount;
+static uint32_t testCycleCounter() { return(testCycleCount); }
+// Test worst-case cycle cost recording and conversion to sub-cycle ticks.
+static void testCycleProfile()
+  {
+  Serial.println("CycleProfile");
+  AssertIsEqual(0, OTV0P2BASE::CycleProfile::cyclesToSubCycleTicks(0));
+  AssertIsEqual(1, OTV0P2BASE::CycleProfile::cyclesToSubCycleTicks(1)); // Rounds up.
+  AssertIsEqual(1, OTV0P2BASE::CycleProfile::cyclesToSubCycleTicks(OTV0P2BASE::CYCLES_PER_SUB_CYCLE_TICK));
+  AssertIsEqual(2, OTV0P2BASE::CycleProfile::cyclesToSubCycleTicks(OTV0P2BASE::CYCLES_PER_SUB_CYCLE_TICK + 1));
+  AssertIsEqual(255, OTV0P2BASE::CycleProfile::cyclesToSubCycleTicks(0xffffffffUL)); // Saturates.
+  OTV0P2BASE::CycleProfile::setCycleCounter(testCycleCounter);
+  OTV0P2BASE::CycleProfile::reset();
+  AssertIsEqual(0, OTV0P2BASE::CycleProfile::getCalls(OTV0P2BASE::CPP_MRVS_TICK));
+  for(uint8_t i = 0; i < 3; ++i)
+    {
+    OTV0P2BASE::CycleProfileScope scope(OTV0P2BASE::CPP_MRVS_TICK);
+    testCycleCount += (1 == i) ? 1000 : 100; // Middle call is the worst.
+    }
+  AssertIsEqual(3, OTV0P2BASE::CycleProfile::getCalls(OTV0P2BASE::CPP_MRVS_TICK));
+  AssertIsTrue(1000 == OTV0P2BASE::CycleProfile::getWorstCycles(OTV0P2BASE::CPP_MRVS_TICK));
+  AssertIsTrue(0 == OTV0P2BASE::CycleProfile::getWorstCycles(OTV0P2BASE::CPP_CRC));
+  // Wrap of the free-running counter is harmless.
+  testCycleCount = 0xfffffff0UL;
+    {
+    OTV0P2BASE::CycleProfileScope scope(OTV0P2BASE::CPP_CRC);
+    testCycleCount += 0x20;
+    }
+  AssertIsTrue(0x20 == OTV0P2BASE::CycleProfile::getWorstCycles(OTV0P2BASE::CPP_CRC));
+  OTV0P2BASE::CycleProfile::setCycleCounter(NULL);
+  OTV0P2BASE::CycleProfile::reset();
+  }
+
 // Test basic behaviour of stats quartile and related routines.
 static void testQuartiles()
   {
@@ -837,14 +2655,44 @@ void loop()
 
   // OTRadioLink
   testNullRadio();
+  testTXQueue();
+  testTXDutyCycle();
+  testRadioMux();
   testFrameDump();
   testCRC7_5B();
+  testCRC7_5BTables();
+  testCRC7_5BConstexpr();
+  testCRC7_5BMulti();
   testFrameFilterTrailingZeros();
+  testFramePrioritySecureable();
+  testFrameFilterChain();
+  testRXIDPrefilter();
+  testReplayFilter();
+#if !defined(__AVR__)
+  testAESGCMHub();
+  testAESGCMKeyCache();
+  testSecureSmallFramesBatch();
+#endif // !defined(__AVR__)
   testISRRXQueue1Deep();
   testISRRXQueueVarLenMsg();
+  testISRRXQueueVarLenMsgMetadata();
+  testISRRXQueuePriority();
+  testISRRXQueueBatch();
+#if !defined(__AVR__)
+  testISRRXQueueVarLenMsgWide();
+  testISRRXQueueVarLenMsgSPSC();
+#endif
 
   // OTRFM23BLink
   testRFM23B();
+#if !defined(__AVR__)
+  testRFM23BRegisterBurst();
+  testRFM23BRegShadow();
+  testRFM23BStreaming();
+  testRFM23BTXInterrupt();
+  testRFM23BSim();
+  testRFM23BTXSchedule();
+#endif
 
   // OTRadValve
   testCSVMDC();
@@ -855,6 +2703,7 @@ void loop()
   testEEPROM();
   testQuartiles();
   testRNG8();
+  testCycleProfile();
   testEntropyGathering();
 #if !defined(DISABLE_SENSOR_UNIT_TESTS)
   testSupplyVoltageMonitor();
@@ -68,6 +68,11 @@ static void error(int err, int line)
       Serial.print(line);
       }
     Serial.println();
+#ifdef ARDUINO_ARCH_HOST
+    // No one is watching for a flashing light on the host: stop with a failure status.
+    Serial.flush();
+    exit(1);
+#endif
 //    LED_HEATCALL_ON();
 //    tinyPause();
 //    LED_HEATCALL_OFF();